@@ -161,6 +161,9 @@ void TLS_initialize_data(TLS* tls)
     
     memset(tls->stack_traces, 0, sizeof(tls->stack_traces));
 
+    memset(tls->stack_traces_hash_table, 0,
+           sizeof(tls->stack_traces_hash_table));
+
     tls->overflow_samples.message.time_begin = ~0;
     tls->overflow_samples.message.time_end = 0;
     
@@ -371,76 +374,71 @@ uint32_t TLS_add_current_call_site(TLS* tls)
         NULL, FALSE, 0, CBTF_ST_MAXFRAMES, &frame_count, frame_buffer
         );
 
-    /* Search for this stack trace amongst the existing stack traces */
-    
+    /* Get a pointer to the stack traces hash table for this thread */
+    uint32_t* const hash_table = tls->stack_traces_hash_table;
+
+    /* Compute the hash of this stack trace (FNV-1a over its addresses) */
+
+    uint64_t hash = 0xCBF29CE484222325ULL;
+
     int i, j;
-    
-    /* Iterate over the addresses in the existing stack traces */
-    for (i = 0, j = 0; i < MAX_ADDRESSES_PER_BLOB; ++i)
+    for (j = 0; j < frame_count; ++j)
     {
-        /* Is this the terminating null of an existing stack trace? */
-        if (tls->stack_traces[i] == 0)
-        {
-            /*
-             * Terminate the search if a complete match has been found
-             * between this stack trace and the existing stack trace.
-             */
-            if (j == frame_count)
-            {
-                break;
-            }
+        hash = (hash ^ frame_buffer[j]) * 0x100000001B3ULL;
+    }
 
-            /*
-             * Otherwise check for a null in the first or last entry, or
-             * for consecutive nulls, all of which indicate the end of the
-             * existing stack traces, and the need to add this stack trace
-             * to the existing stack traces.
-             */
-            else if ((i == 0) || 
-                     (i == (MAX_ADDRESSES_PER_BLOB - 1)) ||
-                     (tls->stack_traces[i - 1] == 0))
-            {
-                /*
-                 * Send performance data for this thread if there isn't enough
-                 * room in the existing stack traces to add this stack trace.
-                 * Doing so frees up enough space for this stack trace.
-                 */
-
-                if ((i + frame_count) >= MAX_ADDRESSES_PER_BLOB)
-                {
-                    TLS_send_data(tls);
-                    i = 0;
-                }
-
-                /* Add this stack trace to the existing stack traces */
-                for (j = 0; j < frame_count; ++j, ++i)
-                {
-                    tls->stack_traces[i] = frame_buffer[j];
-                    TLS_update_header_with_address(tls, tls->stack_traces[i]);
-                }
-                tls->stack_traces[i] = 0;
-                tls->data.stack_traces.stack_traces_len = i + 1;
-              
-                break;
-            }
-            
-            /* Otherwise reset the pointer within this stack trace to zero */
-            else
-            {
-                j = 0;
-            }
+    /*
+     * Search the existing stack traces for this stack trace. Accelerate the
+     * search using the hash table and a simple linear probe. The table never
+     * fills since it has more entries than there are stack trace addresses.
+     */
+    uint32_t bucket = hash % STACK_TRACES_HASH_TABLE_SIZE;
+    while (hash_table[bucket] > 0)
+    {
+        const CBTF_Protocol_Address* existing =
+            &tls->stack_traces[hash_table[bucket] - 1];
+        
+        j = 0;
+        while ((j < frame_count) && (existing[j] == frame_buffer[j]))
+        {
+            ++j;
         }
-        else
+
+        if ((j == frame_count) && (existing[j] == 0))
         {
-            /*
-             * Advance the pointer within this stack trace if the current
-             * address within this stack trace matches the current address
-             * within the existing stack traces. Otherwise reset the pointer
-             * to zero.
-             */
-            j = (frame_buffer[j] == tls->stack_traces[i]) ? (j + 1) : 0;
+            /* Return the index of the matching existing stack trace */
+            return hash_table[bucket] - 1;
         }
+        
+        bucket = (bucket + 1) % STACK_TRACES_HASH_TABLE_SIZE;
+    }
+
+    /*
+     * Send performance data for this thread if there isn't enough room in the
+     * existing stack traces to add this stack trace. Doing so frees up enough
+     * space for this stack trace, and empties the hash table.
+     */
+
+    i = tls->data.stack_traces.stack_traces_len;
+
+    if ((i + frame_count) >= MAX_ADDRESSES_PER_BLOB)
+    {
+        TLS_send_data(tls);
+        i = 0;
+        bucket = hash % STACK_TRACES_HASH_TABLE_SIZE;
+    }
+
+    /* Add this stack trace to the existing stack traces and hash table */
+
+    hash_table[bucket] = i + 1;
+
+    for (j = 0; j < frame_count; ++j, ++i)
+    {
+        tls->stack_traces[i] = frame_buffer[j];
+        TLS_update_header_with_address(tls, tls->stack_traces[i]);
     }
+    tls->stack_traces[i] = 0;
+    tls->data.stack_traces.stack_traces_len = i + 1;
 
     /* Return the index of this stack trace within the existing stack traces */
     return i - frame_count;
@@ -37,6 +37,12 @@
  */
 #define MAX_ADDRESSES_PER_BLOB 1024
 
+/**
+ * Number of entries in the stack traces hash table.
+ */
+#define STACK_TRACES_HASH_TABLE_SIZE \
+    (MAX_ADDRESSES_PER_BLOB + (MAX_ADDRESSES_PER_BLOB / 4))
+
 /**
  * Maximum number of bytes used to store the periodic sampling deltas within
  * each (CBTF_cuda_data) performance data blob.
@@ -149,6 +155,14 @@ typedef struct {
      */
     CBTF_Protocol_Address stack_traces[MAX_ADDRESSES_PER_BLOB];
 
+    /**
+     * Hash table used to map stack traces to their array index within the
+     * "stack_traces" array above. The value stored in the table is actually
+     * one more than the real index so that a zero value can be used to
+     * indicate an empty hash table entry.
+     */
+    uint32_t stack_traces_hash_table[STACK_TRACES_HASH_TABLE_SIZE];
+
     /** Current overflow samples for this thread. */
     struct {
 
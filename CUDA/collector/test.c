@@ -0,0 +1,264 @@
+/*******************************************************************************
+** Copyright (c) 2017 Argo Navis Technologies. All Rights Reserved.
+**
+** This program is free software; you can redistribute it and/or modify it under
+** the terms of the GNU General Public License as published by the Free Software
+** Foundation; either version 2 of the License, or (at your option) any later
+** version.
+**
+** This program is distributed in the hope that it will be useful, but WITHOUT
+** ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+** FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+** details.
+**
+** You should have received a copy of the GNU General Public License along with
+** this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+** Place, Suite 330, Boston, MA  02111-1307  USA
+*******************************************************************************/
+
+/**
+ * @file Unit test for the TLS support functions. Links TLS.c against stubs of
+ * the CBTF services and libmonitor functions it calls, so that it can be run
+ * on a machine without CUDA, CUPTI, or a running experiment.
+ */
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <KrellInstitute/Messages/CUDA_data.h>
+#include <KrellInstitute/Messages/DataHeader.h>
+
+#include "collector.h"
+#include "TLS.h"
+
+
+
+/** Number of distinct call sites added by the test. */
+#define NUM_SITES 4096
+
+/** Number of times each of the call sites is added by the test. */
+#define NUM_REPEATS 16
+
+/** Maximum number of frames in each of the call sites. */
+#define MAX_FRAMES 24
+
+
+
+/* Definitions normally found in collector.c */
+bool IsDebugEnabled = FALSE;
+CUDA_SamplingConfig TheSamplingConfig;
+
+/** Frames of each of the call sites. */
+static uint64_t Sites[NUM_SITES][MAX_FRAMES];
+
+/** Number of frames in each of the call sites. */
+static unsigned SiteFrameCounts[NUM_SITES];
+
+/** Call site returned by the next stack trace unwind. */
+static unsigned CurrentSite = 0;
+
+/** Number of messages checked in the sent performance data blobs. */
+static unsigned CheckedMessages = 0;
+
+/** Number of sent performance data blobs. */
+static unsigned SentBlobs = 0;
+
+/** Number of failed checks. */
+static unsigned Failures = 0;
+
+
+
+/** Check the given condition, reporting (and counting) its failure. */
+#define Check(x)                                                        \
+    do {                                                                \
+        if (!(x))                                                       \
+        {                                                               \
+            fprintf(stderr, "%s:%d: check failed: %s\n",                \
+                    __FILE__, __LINE__, #x);                            \
+            ++Failures;                                                 \
+        }                                                               \
+    } while (0)
+
+
+
+/** Stub of the libmonitor MPI rank query. */
+int monitor_mpi_comm_rank()
+{
+    return 0;
+}
+
+
+
+/** Stub of the libmonitor thread number query. */
+int monitor_get_thread_num()
+{
+    return 0;
+}
+
+
+
+/** Stub of the CBTF stack trace unwinder returning the current call site. */
+void CBTF_GetStackTraceFromContext(const void* context,
+                                   bool_t skip_signal_frames,
+                                   unsigned skip_frames,
+                                   unsigned max_frames,
+                                   unsigned* stacktrace_size,
+                                   uint64_t* stacktrace)
+{
+    *stacktrace_size = SiteFrameCounts[CurrentSite];
+    memcpy(stacktrace, Sites[CurrentSite],
+           SiteFrameCounts[CurrentSite] * sizeof(uint64_t));
+}
+
+
+
+/**
+ * Stub of the CBTF performance data blob sender. Checks that every message in
+ * the blob references the stack trace of the call site whose index is stored
+ * as the message's identifier.
+ */
+void cbtf_collector_send(const CBTF_DataHeader* header,
+                         const xdrproc_t xdrproc,
+                         const void* data)
+{
+    const CBTF_cuda_data* cuda_data = (const CBTF_cuda_data*)data;
+
+    u_int i;
+    for (i = 0; i < cuda_data->messages.messages_len; ++i)
+    {
+        const CUDA_EnqueueExec* message = &cuda_data->messages.messages_val[i].
+            CBTF_cuda_message_u.enqueue_exec;
+
+        unsigned site = message->id;
+        const CBTF_Protocol_Address* addresses =
+            &cuda_data->stack_traces.stack_traces_val[message->call_site];
+
+        Check((message->call_site + SiteFrameCounts[site]) <
+              cuda_data->stack_traces.stack_traces_len);
+
+        unsigned j;
+        for (j = 0; j < SiteFrameCounts[site]; ++j)
+        {
+            Check(addresses[j] == Sites[site][j]);
+        }
+        Check(addresses[SiteFrameCounts[site]] == 0);
+
+        ++CheckedMessages;
+    }
+
+    ++SentBlobs;
+}
+
+
+
+/**
+ * Add the given call site, and a message referencing it, to the given thread-
+ * local storage, in the same order as do the CUPTI callbacks.
+ */
+static uint32_t add_site(TLS* tls, unsigned site)
+{
+    CurrentSite = site;
+    uint32_t call_site = TLS_add_current_call_site(tls);
+
+    CBTF_cuda_message* raw_message = TLS_add_message(tls);
+    memset(raw_message, 0, sizeof(CBTF_cuda_message));
+    raw_message->type = EnqueueExec;
+    raw_message->CBTF_cuda_message_u.enqueue_exec.id = site;
+    raw_message->CBTF_cuda_message_u.enqueue_exec.call_site = call_site;
+
+    return call_site;
+}
+
+
+
+/**
+ * Test TLS_add_current_call_site() with call sites drawn from a small pool of
+ * addresses, so that many call sites are repeated, or are suffixes of other
+ * call sites, and time the addition of call sites repeated within a blob.
+ */
+int main(int argc, char* argv[])
+{
+    srand(1);
+
+    unsigned s, f, r;
+    for (s = 0; s < NUM_SITES; ++s)
+    {
+        SiteFrameCounts[s] = 1 + (rand() % MAX_FRAMES);
+        for (f = 0; f < SiteFrameCounts[s]; ++f)
+        {
+            Sites[s][f] = 0x400000 + (rand() % 8);
+        }
+    }
+
+    TLS_initialize();
+    TLS* tls = TLS_get();
+    TLS_initialize_data(tls);
+
+    unsigned added = 0;
+
+    for (s = 0; s < NUM_SITES; ++s, ++added)
+    {
+        add_site(tls, s);
+    }
+
+    /*
+     * Add small groups of call sites repeatedly. Until the blob is sent, the
+     * repeats must return the index of the existing stack trace.
+     */
+
+    clock_t start = clock();
+
+    for (s = 0; s < NUM_SITES; s += 8)
+    {
+        uint32_t call_sites[8];
+        bool known[8] = { FALSE };
+
+        for (r = 0; r < NUM_REPEATS; ++r)
+        {
+            unsigned i;
+            for (i = 0; i < 8; ++i, ++added)
+            {
+                unsigned sent = SentBlobs;
+                uint32_t call_site = add_site(tls, s + i);
+
+                if (SentBlobs != sent)
+                {
+                    memset(known, 0, sizeof(known));
+                }
+
+                if (known[i])
+                {
+                    Check(call_site == call_sites[i]);
+                }
+                else
+                {
+                    call_sites[i] = call_site;
+                    known[i] = TRUE;
+                }
+            }
+        }
+    }
+
+    double elapsed = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    TLS_send_data(tls);
+    TLS_destroy();
+
+    Check(CheckedMessages == added);
+
+    printf("%u call sites added in %u blobs, %.1f ns/call site (repeated)\n",
+           added, SentBlobs,
+           1000000000.0 * elapsed / (NUM_SITES * NUM_REPEATS));
+
+    if (Failures > 0)
+    {
+        printf("%u checks failed\n", Failures);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -20,7 +20,12 @@
 
 #include <boost/bind.hpp>
 #include <boost/shared_ptr.hpp>
+#include <cerrno>
+#include <cstddef>
 #include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <string>
 #include <typeinfo>
 
 #include <KrellInstitute/CBTF/Component.hpp>
@@ -37,6 +42,8 @@
 #include <KrellInstitute/Messages/PerformanceData.hpp>
 #include <KrellInstitute/Messages/Time.h>
 
+#include <ArgoNavis/Base/ThreadName.hpp>
+
 #include <ArgoNavis/CUDA/PerformanceData.hpp>
 #include <ArgoNavis/CUDA/stringify.hpp>
 
@@ -46,6 +53,90 @@ using namespace KrellInstitute::Core;
 
 
 
+/** Anonymous namespace hiding implementation details. */
+namespace {
+
+    /**
+     * Warn, when debugging is enabled for this component, that the given
+     * environment variable has an invalid value and is being ignored.
+     */
+    void warnInvalid(const char* name, const char* value)
+    {
+        if (getenv("CBTF_DEBUG_DATA_AGGREGATOR_FOR_CUDA") != NULL)
+        {
+            std::cout << std::endl
+                      << "[CUDA] Ignoring invalid value \"" << value
+                      << "\" of " << name << std::endl;
+        }
+    }
+
+    /**
+     * Configure the ingestion thread count, memory budget, and spill directory
+     * used by the CUDA performance data from the optional environment variables
+     * named CBTF_DATA_AGGREGATOR_FOR_CUDA_INGESTION_THREADS (where zero uses
+     * all hardware threads), CBTF_DATA_AGGREGATOR_FOR_CUDA_MEMORY_BUDGET (in
+     * megabytes), and CBTF_DATA_AGGREGATOR_FOR_CUDA_SPILL_DIRECTORY (if any).
+     */
+    void configurePerformanceData()
+    {
+        const char* threads =
+            getenv("CBTF_DATA_AGGREGATOR_FOR_CUDA_INGESTION_THREADS");
+        if (threads != NULL)
+        {
+            char* end = NULL;
+            errno = 0;
+            unsigned long count = strtoul(threads, &end, 10);
+
+            if ((end == threads) || (*end != '\0') || (errno != 0) ||
+                (std::string(threads).find('-') != std::string::npos) ||
+                (count > std::numeric_limits<unsigned int>::max()))
+            {
+                warnInvalid("CBTF_DATA_AGGREGATOR_FOR_CUDA_INGESTION_THREADS",
+                            threads);
+            }
+            else
+            {
+                CUDA::setIngestionThreadCount(
+                    static_cast<unsigned int>(count)
+                    );
+            }
+        }
+
+        const char* budget =
+            getenv("CBTF_DATA_AGGREGATOR_FOR_CUDA_MEMORY_BUDGET");
+        if (budget != NULL)
+        {
+            char* end = NULL;
+            double megabytes = strtod(budget, &end);
+
+            // Negative, infinite, and NaN budgets all fail these comparisons
+            if ((end == budget) || (*end != '\0') || !(megabytes >= 0.0) ||
+                !(megabytes * 1024 * 1024 <
+                  static_cast<double>(std::numeric_limits<std::size_t>::max())))
+            {
+                warnInvalid("CBTF_DATA_AGGREGATOR_FOR_CUDA_MEMORY_BUDGET",
+                            budget);
+            }
+            else
+            {
+                CUDA::setMemoryBudget(
+                    static_cast<std::size_t>(megabytes * 1024 * 1024)
+                    );
+            }
+        }
+
+        const char* directory =
+            getenv("CBTF_DATA_AGGREGATOR_FOR_CUDA_SPILL_DIRECTORY");
+        if (directory != NULL)
+        {
+            CUDA::setSpillDirectory(directory);
+        }
+    }
+
+} // namespace <anonymous>
+
+
+
 /**
  * Data aggregator for the performance data blobs generated by the CUDA
  * collector. This is used to perform 2 critical functions for Open|SpeedShop:
@@ -75,6 +166,7 @@ public:
     /** Factory function for this component type. */
     static Component::Instance factoryFunction()
     {
+        configurePerformanceData();
         return Component::Instance(
             reinterpret_cast<Component*>(new DataAggregatorForCUDA())
             );
@@ -99,9 +191,9 @@ private:
 
     /** Handler for the "TriggerData" input. */
     void handleTriggerData(const bool& value);
-    
-    /** Visit the performance data blobs for the given thread. */
-    bool visitBlobs(const Base::ThreadName& thread);
+
+    /** Handler for the "TriggerProcessData" input. */
+    void handleTriggerProcessData(const Base::ThreadName& process);
 
     /** Flag indicating if debugging is enabled for this component. */
     bool dm_is_debug_enabled;
@@ -140,6 +232,10 @@ DataAggregatorForCUDA::DataAggregatorForCUDA() :
         "TriggerData",
         boost::bind(&DataAggregatorForCUDA::handleTriggerData, this, _1)
         );
+    declareInput<Base::ThreadName>(
+        "TriggerProcessData",
+        boost::bind(&DataAggregatorForCUDA::handleTriggerProcessData, this, _1)
+        );
     
     declareOutput<AddressBuffer>("AddressBuffer");
     declareOutput<boost::shared_ptr<CBTF_Protocol_Blob> >("Data");
@@ -240,25 +336,38 @@ void DataAggregatorForCUDA::handleTriggerAddressBuffer(const bool& value)
 
 
 //------------------------------------------------------------------------------
-// Visit all of the threads containing performance data, visiting and emitting
-// all of the performance data blobs for each thread.
+// Visit and emit all of the performance data blobs for all of the threads. The
+// blobs are generated concurrently using all of the available hardware threads,
+// but are still emitted by this thread, in the same order as when generated one
+// thread at a time.
 //------------------------------------------------------------------------------
 void DataAggregatorForCUDA::handleTriggerData(const bool& value)
 {
-    dm_data.visitThreads(
-        boost::bind(&DataAggregatorForCUDA::visitBlobs, this, _1)
+    if (dm_is_debug_enabled)
+    {
+        std::cout << std::endl
+                  << "[CUDA] Performance Data: "
+                  << dm_data.residentBytes() << " bytes resident, "
+                  << dm_data.spilledBytes() << " bytes spilled" << std::endl;
+    }
+
+    dm_data.visitBlobs(
+        boost::bind(&DataAggregatorForCUDA::emitBlob, this, _1), 0
         );
 }
 
 
 
 //------------------------------------------------------------------------------
+// Visit and emit all of the performance data blobs for the threads in a newly
+// finished process, discarding their performance data afterwards. Any threads
+// still awaiting the completion of partial events are left for TriggerData.
 //------------------------------------------------------------------------------
-bool DataAggregatorForCUDA::visitBlobs(const Base::ThreadName& thread)
+void DataAggregatorForCUDA::handleTriggerProcessData(
+    const Base::ThreadName& process
+    )
 {
-    dm_data.visitBlobs(
-        thread, boost::bind(&DataAggregatorForCUDA::emitBlob, this, _1)
+    dm_data.discard(
+        process, boost::bind(&DataAggregatorForCUDA::emitBlob, this, _1)
         );
-    
-    return true; // Continue the iteration
 }
@@ -42,7 +42,9 @@ using namespace KrellInstitute::CBTF;
  * Simple (thread and linked object) state management for the experiments that
  * use the CUDA collector. This is used to aggregate the attached threads and
  * their address spaces, forwarding them on to Open|SpeedShop only once all of
- * the attached threads have finished.
+ * the attached threads have finished. The performance data for each process
+ * is, however, triggered as soon as all of that process' attached threads have
+ * finished.
  *
  * @note    This component is <em>not</em> scalable to large thread counts.
  *          It is currently being used as a temporary measure until the CUDA
@@ -150,6 +152,7 @@ StateManagementForCUDA::StateManagementForCUDA() :
     declareOutput<bool>("ThreadsFinished");
     declareOutput<bool>("TriggerAddressBuffer");
     declareOutput<bool>("TriggerData");
+    declareOutput<ThreadName>("TriggerProcessData");
 }
 
 
@@ -218,8 +221,10 @@ void StateManagementForCUDA::handleLoadedLinkedObject(
 
 
 //------------------------------------------------------------------------------
-// If threads are terminating, update the list of active threads and, if that
-// list is empty, emit a flurry of messages in the proper order.
+// If threads are terminating, update the list of active threads. Trigger the
+// performance data for any process left without active threads, including the
+// data of its threads that were never attached (e.g. the CUPTI threads). And if
+// the list is empty, emit a flurry of messages in the proper order.
 //------------------------------------------------------------------------------
 void StateManagementForCUDA::handleThreadsStateChanged(
     const boost::shared_ptr<CBTF_Protocol_ThreadsStateChanged>& message
@@ -227,6 +232,8 @@ void StateManagementForCUDA::handleThreadsStateChanged(
 {
     if (message->state == Terminated)
     {
+        std::set<ThreadName> processes;
+
         for (u_int i = 0; i < message->threads.names.names_len; ++i)
         {
             ThreadName thread(message->threads.names.names_val[i]);
@@ -238,6 +245,27 @@ void StateManagementForCUDA::handleThreadsStateChanged(
             }
             
             dm_threads.erase(thread);
+            processes.insert(ThreadName(thread.host(), thread.pid()));
+        }
+
+        for (std::set<ThreadName>::const_iterator
+                 i = processes.begin(); i != processes.end(); ++i)
+        {
+            std::set<ThreadName>::const_iterator j = dm_threads.lower_bound(*i);
+
+            if ((j != dm_threads.end()) &&
+                (j->host() == i->host()) && (j->pid() == i->pid()))
+            {
+                continue; // The process still has active threads
+            }
+
+            emitOutput<ThreadName>("TriggerProcessData", *i);
+
+            if (dm_is_debug_enabled)
+            {
+                std::cout << "[CUDA] Emitted TriggerProcessData for "
+                          << *i << std::endl;
+            }
         }
         
         if (dm_threads.empty())
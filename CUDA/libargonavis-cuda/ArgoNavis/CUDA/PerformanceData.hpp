@@ -59,6 +59,9 @@ namespace ArgoNavis { namespace CUDA {
 
         /**
          * Visit the PC (program counter) addresses within the given message.
+         * These are the addresses of the call sites of the enqueue and class
+         * (ExecClass and XferClass) messages, visited once for each message,
+         * and the sampled PC addresses of the overflow samples.
          *
          * @param message    Message containing the performance data.
          * @param visitor    Visitor invoked for each PC address.
@@ -74,6 +77,16 @@ namespace ArgoNavis { namespace CUDA {
          *
          * @param thread     Name of the thread containing this data.
          * @param message    Message containing the performance data.
+         *
+         * @note    When more than one ingestion thread is used, the message
+         *          is copied and queued for processing by those threads, and
+         *          this method may return before it is processed. Queries of
+         *          this performance data always wait for all such messages
+         *          to be processed first.
+         *
+         * @throw std::runtime_error    The message (or, when more than one
+         *                              ingestion thread is used, a previously
+         *                              applied message) could not be processed.
          */
         void apply(const Base::ThreadName& thread,
                    const CBTF_cuda_data& message);
@@ -117,6 +130,30 @@ namespace ArgoNavis { namespace CUDA {
         /** Information about all known CUDA devices. */
         const std::vector<Device>& devices() const;
 
+        /**
+         * Visit the (raw) performance data blobs for the threads in the given
+         * process, and then discard the performance data for those threads.
+         * Used once a process has finished in order to bound the memory used
+         * by the performance data of a long running experiment.
+         *
+         * @param process    Name of the process for the visitation. Its
+         *                   thread identifier (if any) is ignored.
+         * @param visitor    Visitor invoked for each performance data blob.
+         *
+         * @note    Threads in which any partial events (e.g. those whose
+         *          completions haven't been seen) could have occurred are
+         *          neither visited nor discarded.
+         *
+         * @note    Discarded threads are skipped by all later visitations,
+         *          unless further messages for them are applied. Their blobs
+         *          are then visited again, containing only the new data.
+         *
+         * @note    The visitation is terminated immediately if "false" is
+         *          returned by the visitor.
+         */
+        void discard(const Base::ThreadName& process,
+                     const Base::BlobVisitor& visitor);
+
         /** Smallest time interval containing this performance data. */
         const Base::TimeInterval& interval() const;
 
@@ -137,10 +174,25 @@ namespace ArgoNavis { namespace CUDA {
             const Base::TimeInterval& interval,
             std::size_t counter
             ) const;
+
+        /**
+         * Number of bytes of event instances and periodic samples resident in
+         * memory. The event classes, call sites, and other information, are
+         * always resident, and are not included.
+         */
+        std::size_t residentBytes() const;
         
         /** Call sites of all known CUDA requests. */
         const std::vector<Base::StackTrace>& sites() const;
 
+        /**
+         * Number of bytes of event instances and periodic samples spilled to
+         * disk in order to stay within the memory budget. Includes the disk
+         * space of any spilled data since copied back into memory, or
+         * discarded, that hasn't been reused yet.
+         */
+        std::size_t spilledBytes() const;
+
         /**
          * Visit the (raw) performance data blobs for the given thread.
          *
@@ -153,6 +205,24 @@ namespace ArgoNavis { namespace CUDA {
         void visitBlobs(const Base::ThreadName& thread,
                         const Base::BlobVisitor& visitor) const;
 
+        /**
+         * Visit the (raw) performance data blobs for all threads.
+         *
+         * @param visitor    Visitor invoked for each performance data blob.
+         * @param threads    Number of threads used to generate the blobs. A
+         *                   count of zero uses the number of hardware threads
+         *                   that are available.
+         *
+         * @note    The visitor is always invoked by the calling thread, and
+         *          visits the same blobs, in the same order, as visiting the
+         *          blobs for each thread in turn (in thread name order).
+         *
+         * @note    The visitation is terminated immediately if "false" is
+         *          returned by the visitor.
+         */
+        void visitBlobs(const Base::BlobVisitor& visitor,
+                        unsigned int threads = 1) const;
+
         /**
          * Visit those data transfers within the given thread whose request-
          * to-completion time interval intersects the specified time interval.
@@ -223,4 +293,68 @@ namespace ArgoNavis { namespace CUDA {
 
     }; // class PerformanceData
 
+    /**
+     * Get the number of threads used to process the messages applied to each
+     * PerformanceData. Unless set explicitly, this is one, and every message
+     * is processed in the calling thread before apply() returns.
+     */
+    unsigned int getIngestionThreadCount();
+
+    /**
+     * Set the number of threads used to process the messages applied to each
+     * PerformanceData. A count of one processes every message in the calling
+     * thread, while a count of zero uses the number of hardware threads that
+     * are available.
+     *
+     * @note    Only affects PerformanceData constructed after the count is set.
+     *
+     * @note    The messages for each process are always processed in order by
+     *          the same thread, so the performance data is identical for any
+     *          thread count, except that the indices of the call sites, the
+     *          counters, and the devices may be assigned in a different order.
+     */
+    void setIngestionThreadCount(unsigned int count);
+
+    /**
+     * Get the memory budget (in bytes) for the event instances and periodic
+     * samples of each PerformanceData. Unless set explicitly, this is zero,
+     * and all of the performance data is kept in memory.
+     */
+    std::size_t getMemoryBudget();
+
+    /**
+     * Set the memory budget (in bytes) for the event instances and periodic
+     * samples of each PerformanceData. Once that budget is exceeded, those of
+     * the least recently used threads are spilled to a file in the spill
+     * directory, and are memory-mapped back when they are visited or queried.
+     * A budget of zero keeps all of the performance data in memory.
+     *
+     * @note    Only affects PerformanceData constructed after the budget is
+     *          set.
+     *
+     * @note    The budget is checked periodically as messages are applied, so
+     *          it may be exceeded briefly.
+     *
+     * @note    Should the performance data fail to be spilled (e.g. because
+     *          the disk is full), it is kept in memory instead, and the budget
+     *          is ignored from then on.
+     */
+    void setMemoryBudget(std::size_t bytes);
+
+    /**
+     * Get the directory in which performance data exceeding the memory budget
+     * is spilled. Unless set explicitly, this is "/tmp".
+     */
+    std::string getSpillDirectory();
+
+    /**
+     * Set the directory in which performance data exceeding the memory budget
+     * is spilled. The spill file is removed from the directory immediately
+     * after it is created, and so is never left behind.
+     *
+     * @note    Only affects PerformanceData constructed after the directory is
+     *          set.
+     */
+    void setSpillDirectory(const std::string& directory);
+
 } } // namespace ArgoNavis::CUDA
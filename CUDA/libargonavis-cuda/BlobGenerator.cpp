@@ -20,6 +20,7 @@
 
 #include <boost/assert.hpp>
 #include <boost/bind.hpp>
+#include <boost/functional/hash.hpp>
 #include <cstring>
 #include <stddef.h>
 #include <stdlib.h>
@@ -54,6 +55,23 @@ namespace {
     
     /** Maximum number of individual messages contained within each blob. */
     const std::size_t kMaxMessagesPerBlob = 8 * 1024;
+
+    /**
+     * Hash the addresses of the given stack trace. The addresses are hashed
+     * from the last to the first, as are the suffixes of the stack traces in
+     * BlobGenerator::addSite(), so that the hash of a stack trace can be found
+     * among the hashes of those suffixes.
+     */
+    std::size_t hash(const StackTrace& site)
+    {
+        std::size_t seed = 0;
+        for (StackTrace::const_reverse_iterator
+                 i = site.rbegin(); i != site.rend(); ++i)
+        {
+            boost::hash_combine(seed, static_cast<boost::uint64_t>(*i));
+        }
+        return seed;
+    }
     
 } // namespace <anonymous>
 
@@ -70,7 +88,9 @@ BlobGenerator::BlobGenerator(const Base::ThreadName& thread,
     dm_terminate(false),
     dm_header(),
     dm_data(),    
+    dm_site_indices(),
     dm_periodic_samples(),
+    dm_periodic_samples_current(),
     dm_periodic_samples_previous()
 {
     initialize();
@@ -95,8 +115,11 @@ BlobGenerator::~BlobGenerator()
 
 
 //------------------------------------------------------------------------------
-// This method is almost identical to TLS_add_current_call_site() found in
-// "cbtf-argonavis/CUDA/collector/TLS.c".
+// This method is roughly equivalent to TLS_add_current_call_site() found in
+// "cbtf-argonavis/CUDA/collector/TLS.c". Like that function, it reuses any
+// existing stack trace ending with this stack trace. But rather than scanning
+// all of the existing stack traces for a match, it looks up the hash of this
+// stack trace among the hashes of the suffixes of the existing stack traces.
 //------------------------------------------------------------------------------
 boost::uint32_t BlobGenerator::addSite(const StackTrace& site)
 {
@@ -108,73 +131,63 @@ boost::uint32_t BlobGenerator::addSite(const StackTrace& site)
         generate();
     }
 
-    // Iterate over the addresses in the existing stack traces
-    int i, j;
-    for (i = 0, j = 0; i < kMaxAddressesPerBlob; ++i)
+    CBTF_Protocol_Address* addresses = dm_data->stack_traces.stack_traces_val;
+
+    // Return the index of an existing stack trace matching this stack trace.
+    // Hash collisions are possible, so the match is verified. In the unlikely
+    // event of a collision the stack trace is simply added again below.
+
+    boost::unordered_map<std::size_t, boost::uint32_t>::const_iterator i =
+        dm_site_indices.find(hash(site));
+
+    if (i != dm_site_indices.end())
     {
-        // Is this the terminating null of an existing stack trace?
-        if (dm_data->stack_traces.stack_traces_val[i] == 0)
+        const CBTF_Protocol_Address* existing = &addresses[i->second];
+
+        std::size_t j = 0;
+        while ((j < site.size()) && (site[j] == Address(existing[j])))
         {
-            // Terminate the search if a complete match has been found
-            // between this stack trace and the existing stack trace.
-
-            if (j == site.size())
-            {
-                break;
-            }
-
-            // Otherwise check for a null in the first or last entry, or
-            // for consecutive nulls, all of which indicate the end of the
-            // existing stack traces, and the need to add this stack trace
-            // to the existing stack traces.
-            
-            else if ((i == 0) || 
-                     (i == (kMaxAddressesPerBlob - 1)) ||
-                     (dm_data->stack_traces.stack_traces_val[i - 1] == 0))
-            {
-                // Generate a blob for the current header and data if there
-                // isn't enough room in the existing stack traces to add this
-                // stack trace. Doing so frees up enough space for this stack
-                // trace.
-               
-                if ((i + site.size()) >= kMaxAddressesPerBlob)
-                {
-                    generate();
-                    i = 0;
-                }
-                
-                // Add this stack trace to the existing stack traces
-                for (j = 0; j < site.size(); ++j, ++i)
-                {
-                    dm_data->stack_traces.stack_traces_val[i] = site[j];
-                }
-                dm_data->stack_traces.stack_traces_val[i] = 0;
-                dm_data->stack_traces.stack_traces_len = i + 1;
-                
-                break;
-            }
-            
-            // Otherwise reset the pointer within this stack trace to zero
-            else
-            {
-                j = 0;
-            }
+            ++j;
         }
-        else
+
+        if ((j == site.size()) && (existing[j] == 0))
         {
-            // Advance the pointer within this stack trace if the current
-            // address within this stack trace matches the current address
-            // within the existing stack traces. Otherwise reset the pointer
-            // to zero.
-
-            j = (site[j] ==
-                    Address(dm_data->stack_traces.stack_traces_val[i])) ?
-                (j + 1) : 0;
+            return i->second;
         }
     }
 
-    // Return the index of this stack trace within the existing stack traces
-    return i - site.size();
+    // Generate a blob for the current header and data if there isn't enough
+    // room in the existing stack traces to add this stack trace. Doing so
+    // frees up enough space for this stack trace.
+
+    if ((dm_data->stack_traces.stack_traces_len + site.size()) >=
+        kMaxAddressesPerBlob)
+    {
+        generate();
+        addresses = dm_data->stack_traces.stack_traces_val;
+    }
+
+    // Add this stack trace to the existing stack traces
+
+    boost::uint32_t index = dm_data->stack_traces.stack_traces_len;
+
+    for (std::size_t j = 0; j < site.size(); ++j)
+    {
+        addresses[index + j] = site[j];
+    }
+    addresses[index + site.size()] = 0;
+    dm_data->stack_traces.stack_traces_len = index + site.size() + 1;
+
+    // Index every suffix of this stack trace that isn't already indexed
+
+    std::size_t seed = 0;
+    for (std::size_t j = site.size(); j > 0; --j)
+    {
+        boost::hash_combine(seed, static_cast<boost::uint64_t>(site[j - 1]));
+        dm_site_indices.insert(std::make_pair(seed, index + j - 1));
+    }
+
+    return index;
 }
 
 
@@ -197,16 +210,17 @@ CBTF_cuda_message* BlobGenerator::addMessage()
 
 //------------------------------------------------------------------------------
 // This method is almost identical to timer_callback() found in
-// "cbtf-argonavis/CUDA/collector/PAPI.c".
+// "cbtf-argonavis/CUDA/collector/PAPI.c". The current and previous samples are
+// swapped rather than reallocated so that their storage is reused.
 //------------------------------------------------------------------------------
-void BlobGenerator::addPeriodicSample(
-    boost::uint64_t time,
-    const std::vector<boost::uint64_t>& counts
-    )
+void BlobGenerator::addPeriodicSample(boost::uint64_t time,
+                                      const boost::uint64_t* begin,
+                                      const boost::uint64_t* end)
 {
-    std::vector<boost::uint64_t> sample;
+    std::vector<boost::uint64_t>& sample = dm_periodic_samples_current;
+    sample.clear();
     sample.push_back(time);
-    sample.insert(sample.end(), counts.begin(), counts.end());
+    sample.insert(sample.end(), begin, end);
     
     if (dm_periodic_samples_previous.empty())
     {
@@ -358,6 +372,8 @@ void BlobGenerator::initialize()
     memset(dm_data->stack_traces.stack_traces_val, 0,
            kMaxAddressesPerBlob * sizeof(CBTF_Protocol_Address));
 
+    dm_site_indices.clear();
+
     dm_periodic_samples.deltas.deltas_len = 0;
     dm_periodic_samples.deltas.deltas_val =
         reinterpret_cast<boost::uint8_t*>(malloc(
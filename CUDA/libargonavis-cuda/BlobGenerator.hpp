@@ -23,6 +23,8 @@
 #include <boost/cstdint.hpp>
 #include <boost/noncopyable.hpp>
 #include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
+#include <cstddef>
 #include <utility>
 #include <vector>
 
@@ -80,7 +82,8 @@ namespace ArgoNavis { namespace CUDA { namespace Impl {
         
         /** Add the specified periodic sample to the current blob. */
         void addPeriodicSample(boost::uint64_t time,
-                               const std::vector<boost::uint64_t>& counts);
+                               const boost::uint64_t* begin,
+                               const boost::uint64_t* end);
         
     private:
         
@@ -110,10 +113,19 @@ namespace ArgoNavis { namespace CUDA { namespace Impl {
 
         /** Data for the current blob. */
         boost::shared_ptr<CBTF_cuda_data> dm_data;
+
+        /**
+         * Index within the current blob's stack traces of each of their
+         * suffixes, keyed by hashes of the suffix's addresses.
+         */
+        boost::unordered_map<std::size_t, boost::uint32_t> dm_site_indices;
         
         /** Message containing the periodic samples. */
         CUDA_PeriodicSamples dm_periodic_samples;
         
+        /** Currently taken periodic event sample (including its time). */
+        std::vector<boost::uint64_t> dm_periodic_samples_current;
+
         /** Previously taken periodic event sample (including its time). */
         std::vector<boost::uint64_t> dm_periodic_samples_previous;
 
@@ -18,11 +18,19 @@
 
 /** @file Definition of the DataTable class. */
 
+#include <algorithm>
 #include <boost/bind.hpp>
+#include <boost/functional/hash.hpp>
 #include <boost/ref.hpp>
+#include <cstdlib>
 #include <cstring>
+#include <new>
+#include <set>
+#include <stdexcept>
 #include <utility>
 
+#include <KrellInstitute/Messages/PerformanceData.hpp>
+
 #include <ArgoNavis/Base/Raise.hpp>
 
 #include <ArgoNavis/CUDA/CachePreference.hpp>
@@ -41,6 +49,52 @@ using namespace ArgoNavis::CUDA::Impl;
 /** Anonymous namespace hiding implementation details. */
 namespace {
 
+    /**
+     * Maximum number of messages queued to each shard. Processing of further
+     * messages blocks until the shard's thread catches up.
+     */
+    const std::size_t kMaxQueuedMessages = 64;
+
+    /**
+     * Number of messages processed between each check of the memory budget.
+     * Each check waits for any queued messages to be processed.
+     */
+    const boost::uint64_t kSpillInterval = 1024;
+
+    /** Visitor used to accumulate the blobs generated for a thread. */
+    bool addBlob(const boost::shared_ptr<CBTF_Protocol_Blob>& blob,
+                 std::vector<boost::shared_ptr<CBTF_Protocol_Blob> >& blobs)
+    {
+        blobs.push_back(blob);
+        return true;
+    }
+
+    /** Visitor used to accumulate the known threads. */
+    bool addThread(const ThreadName& thread, std::vector<ThreadName>& threads)
+    {
+        threads.push_back(thread);
+        return true;
+    }
+    
+    /**
+     * Visitor used to forward blobs to another visitor, noting whether that
+     * visitor terminated the visitation.
+     */
+    bool visitBlob(const boost::shared_ptr<CBTF_Protocol_Blob>& blob,
+                   const BlobVisitor& visitor, bool& terminate)
+    {
+        terminate |= !visitor(blob);
+        return !terminate;
+    }
+
+    /** Get the number of bytes of a thread's data resident in memory. */
+    std::size_t resident(const DataTable::PerThreadData& per_thread)
+    {
+        return per_thread.dm_data_transfers.resident() +
+            per_thread.dm_kernel_executions.resident() +
+            per_thread.dm_periodic_samples.resident();
+    }
+
     /** Convert a char* into a string. */
     std::string convert(char* value)
     {
@@ -507,14 +561,381 @@ namespace {
         return message;    
     }
 
+    /**
+     * Allocate a copy of the given array. The copy is allocated with malloc()
+     * so that it can be released by xdr_free() like a decoded array.
+     *
+     * @throw std::bad_alloc    The copy couldn't be allocated.
+     */
+    template <typename T>
+    T* copy(const T* values, u_int length)
+    {
+        if ((values == NULL) || (length == 0))
+        {
+            return NULL;
+        }
+
+        T* result = static_cast<T*>(malloc(length * sizeof(T)));
+
+        if (result == NULL)
+        {
+            throw std::bad_alloc();
+        }
+
+        memcpy(result, values, length * sizeof(T));
+        return result;
+    }
+
+    /**
+     * Allocate a copy of the given string. The copy is allocated with malloc()
+     * so that it can be released by xdr_free() like a decoded string.
+     *
+     * @throw std::bad_alloc    The copy couldn't be allocated.
+     */
+    char* copy(const char* value)
+    {
+        if (value == NULL)
+        {
+            return NULL;
+        }
+
+        char* result = strdup(value);
+
+        if (result == NULL)
+        {
+            throw std::bad_alloc();
+        }
+
+        return result;
+    }
+
+    /**
+     * Make a deep copy of the given CBTF_cuda_data. Used to copy messages whose
+     * processing is deferred. Every array and string in the copy is allocated
+     * separately, exactly as if the message had been decoded, so the copy is
+     * released by xdr_free() and the original can be released immediately.
+     *
+     * @throw std::bad_alloc    The copy couldn't be allocated.
+     */
+    boost::shared_ptr<CBTF_cuda_data> copy(const CBTF_cuda_data& message)
+    {
+        using namespace KrellInstitute::Messages::Impl;
+
+        boost::shared_ptr<CBTF_cuda_data> data(
+            new CBTF_cuda_data(),
+            boost::bind(&xdr_deleter<CBTF_cuda_data>, _1,
+                        reinterpret_cast<xdrproc_t>(xdr_CBTF_cuda_data))
+            );
+        memset(data.get(), 0, sizeof(CBTF_cuda_data));
+
+        // The (shallow) copy of the messages is filled in with their deep
+        // copies below. Each message's pointers are cleared first so that, if
+        // a copy fails part way through, xdr_free() never releases memory that
+        // is still owned by the original.
+        
+        data->messages.messages_val = copy(message.messages.messages_val,
+                                           message.messages.messages_len);
+        
+        if (data->messages.messages_val != NULL)
+        {
+            memset(data->messages.messages_val, 0,
+                   message.messages.messages_len * sizeof(CBTF_cuda_message));
+            data->messages.messages_len = message.messages.messages_len;
+        }
+        
+        for (u_int i = 0; i < data->messages.messages_len; ++i)
+        {
+            const CBTF_cuda_message& from = message.messages.messages_val[i];
+            CBTF_cuda_message& to = data->messages.messages_val[i];
+            
+            switch (from.type)
+            {
+
+            case CompletedExec:
+                {
+                    const CUDA_CompletedExec& msg = 
+                        from.CBTF_cuda_message_u.completed_exec;
+                    CUDA_CompletedExec& copied =
+                        to.CBTF_cuda_message_u.completed_exec;
+
+                    to.type = from.type;
+                    copied = msg;
+                    copied.function = NULL;
+                    copied.function = copy(msg.function);
+                }
+                break;
+
+            case DeviceInfo:
+                {
+                    const CUDA_DeviceInfo& msg =
+                        from.CBTF_cuda_message_u.device_info;
+                    CUDA_DeviceInfo& copied =
+                        to.CBTF_cuda_message_u.device_info;
+
+                    to.type = from.type;
+                    copied = msg;
+                    copied.name = NULL;
+                    copied.name = copy(msg.name);
+                }
+                break;
+
+            case OverflowSamples:
+                {
+                    const CUDA_OverflowSamples& msg =
+                        from.CBTF_cuda_message_u.overflow_samples;
+                    CUDA_OverflowSamples& copied =
+                        to.CBTF_cuda_message_u.overflow_samples;
+                    
+                    to.type = from.type;
+                    copied.time_begin = msg.time_begin;
+                    copied.time_end = msg.time_end;
+                    copied.pcs.pcs_val =
+                        copy(msg.pcs.pcs_val, msg.pcs.pcs_len);
+                    if (copied.pcs.pcs_val != NULL)
+                    {
+                        copied.pcs.pcs_len = msg.pcs.pcs_len;
+                    }
+                    copied.counts.counts_val =
+                        copy(msg.counts.counts_val, msg.counts.counts_len);
+                    if (copied.counts.counts_val != NULL)
+                    {
+                        copied.counts.counts_len = msg.counts.counts_len;
+                    }
+                }
+                break;
+                
+            case PeriodicSamples:
+                {
+                    const CUDA_PeriodicSamples& msg =
+                        from.CBTF_cuda_message_u.periodic_samples;
+                    CUDA_PeriodicSamples& copied =
+                        to.CBTF_cuda_message_u.periodic_samples;
+                    
+                    to.type = from.type;
+                    copied.deltas.deltas_val =
+                        copy(msg.deltas.deltas_val, msg.deltas.deltas_len);
+                    if (copied.deltas.deltas_val != NULL)
+                    {
+                        copied.deltas.deltas_len = msg.deltas.deltas_len;
+                    }
+                }
+                break;
+                
+            case SamplingConfig:
+                {
+                    const CUDA_SamplingConfig& msg =
+                        from.CBTF_cuda_message_u.sampling_config;
+                    CUDA_SamplingConfig& copied =
+                        to.CBTF_cuda_message_u.sampling_config;
+                    
+                    to.type = from.type;
+                    copied.interval = msg.interval;
+                    copied.events.events_val =
+                        copy(msg.events.events_val, msg.events.events_len);
+                    if (copied.events.events_val != NULL)
+                    {
+                        for (u_int j = 0; j < msg.events.events_len; ++j)
+                        {
+                            copied.events.events_val[j].name = NULL;
+                        }
+                        copied.events.events_len = msg.events.events_len;
+                        for (u_int j = 0; j < msg.events.events_len; ++j)
+                        {
+                            copied.events.events_val[j].name =
+                                copy(msg.events.events_val[j].name);
+                        }
+                    }
+                }
+                break;
+
+            case ExecClass:
+                {
+                    const CUDA_ExecClass& msg =
+                        from.CBTF_cuda_message_u.exec_class;
+                    CUDA_ExecClass& copied =
+                        to.CBTF_cuda_message_u.exec_class;
+
+                    to.type = from.type;
+                    copied = msg;
+                    copied.function = NULL;
+                    copied.function = copy(msg.function);
+                }
+                break;
+                
+            default:
+                to = from;
+                break;
+            }
+        }
+
+        data->stack_traces.stack_traces_val = copy(
+            message.stack_traces.stack_traces_val,
+            message.stack_traces.stack_traces_len
+            );
+        if (data->stack_traces.stack_traces_val != NULL)
+        {
+            data->stack_traces.stack_traces_len =
+                message.stack_traces.stack_traces_len;
+        }
+        
+        return data;
+    }
+
+    /**
+     * Visit the addresses of the stack trace at the given offset within the
+     * given message.
+     *
+     * @param site       Offset of the stack trace.
+     * @param message    Message containing the stack trace.
+     * @param visitor    Visitor invoked for each address.
+     * @return           Boolean "true" if the visitation should continue,
+     *                   or "false" otherwise.
+     */
+    bool visitSite(boost::uint32_t site, const CBTF_cuda_data& message,
+                   const AddressVisitor& visitor)
+    {
+        for (boost::uint32_t i = site;
+             (i < message.stack_traces.stack_traces_len) &&
+                 (message.stack_traces.stack_traces_val[i] != 0);
+             ++i)
+        {
+            if (!visitor(message.stack_traces.stack_traces_val[i]))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+    
 } // namespace <anonymous>
 
 
 
+/**
+ * Queue of messages awaiting processing by a single thread. Each process is
+ * assigned to exactly one shard, so its messages are processed in the order
+ * they were queued, and its per-process and per-thread data are only ever
+ * accessed by that shard's thread.
+ */
+struct DataTable::Shard
+{
+    /** Structure describing one queued message. */
+    struct Job
+    {
+        /** Identifier of the thread containing this message. */
+        ThreadNameTable::Identifier dm_thread;
+
+        /** Per-host data for that thread. */
+        PerHostData* dm_per_host;
+
+        /** Per-process data for that thread. */
+        PerProcessData* dm_per_process;
+
+        /** Per-thread data for that thread. */
+        PerThreadData* dm_per_thread;
+
+        /** Deep copy of the message. */
+        boost::shared_ptr<CBTF_cuda_data> dm_message;
+    };
+
+    /** Mutual exclusion lock for this shard. */
+    boost::mutex dm_mutex;
+
+    /** Condition variable signaled whenever this shard changes state. */
+    boost::condition_variable dm_changed;
+
+    /** Queued messages. */
+    std::deque<Job> dm_jobs;
+
+    /** Is a message currently being processed? */
+    bool dm_busy;
+    
+    /** Should this shard's thread stop? */
+    bool dm_stop;
+
+    /** Description of the first error encountered processing a message. */
+    boost::optional<std::string> dm_error;
+
+    /** Construct an empty shard. */
+    Shard() :
+        dm_mutex(),
+        dm_changed(),
+        dm_jobs(),
+        dm_busy(false),
+        dm_stop(false),
+        dm_error()
+    {
+    }
+};
+
+
+
+/**
+ * Reorder buffer of the blobs generated concurrently for many threads. Each
+ * thread's blobs are generated by a single worker, and are handed back to the
+ * visiting thread in thread order. Workers only start on a thread within a
+ * bounded window past the next thread to be visited, bounding the number of
+ * generated blobs held in memory.
+ */
+struct DataTable::BlobQueue
+{
+    /** Names of the threads whose blobs are generated. */
+    std::vector<ThreadName> dm_threads;
+
+    /** Generated blobs for each of those threads. */
+    std::vector<std::vector<boost::shared_ptr<CBTF_Protocol_Blob> > > dm_blobs;
+
+    /** Have the blobs for each of those threads been generated? */
+    std::vector<bool> dm_done;
+
+    /** Index of the next thread whose blobs are to be generated. */
+    std::size_t dm_next;
+
+    /** Index of the next thread whose blobs are to be visited. */
+    std::size_t dm_visited;
+
+    /** Maximum number of threads generated ahead of those visited. */
+    std::size_t dm_window;
+
+    /** Mutual exclusion lock for this queue. */
+    boost::mutex dm_mutex;
+
+    /** Condition variable signaled whenever this queue changes state. */
+    boost::condition_variable dm_changed;
+
+    /** Should the workers stop? */
+    bool dm_stop;
+
+    /** Description of the first error encountered generating blobs. */
+    boost::optional<std::string> dm_error;
+
+    /** Construct a queue for the given threads and window. */
+    BlobQueue(const std::vector<ThreadName>& threads, std::size_t window) :
+        dm_threads(threads),
+        dm_blobs(threads.size()),
+        dm_done(threads.size(), false),
+        dm_next(0),
+        dm_visited(0),
+        dm_window(window),
+        dm_mutex(),
+        dm_changed(),
+        dm_stop(false),
+        dm_error()
+    {
+    }
+};
+
+
+
 //------------------------------------------------------------------------------
 // Iterate over each of the individual CUDA messages that are "packed" into the
 // specified performance data. For all of the messages containing stack traces
-// or sampled PC addresses, invoke the given visitor.
+// or sampled PC addresses, invoke the given visitor. A stack trace is visited
+// once for each message referring to it, so that the number of times a PC is
+// visited counts its uses, as expected by the AddressBuffer of observed PCs.
+// The class messages refer to stack traces exactly as the enqueue messages do,
+// and must be visited for their PCs to be observed at all.
 //------------------------------------------------------------------------------
 void DataTable::visitPCs(const CBTF_cuda_data& message,
                          const AddressVisitor& visitor)
@@ -529,39 +950,31 @@ void DataTable::visitPCs(const CBTF_cuda_data& message,
         {
             
         case EnqueueExec:
-            {
-                const CUDA_EnqueueExec& msg = 
-                    raw.CBTF_cuda_message_u.enqueue_exec;
-                
-                for (uint32_t i = msg.call_site;
-                     !terminate &&
-                         (i < message.stack_traces.stack_traces_len) &&
-                         (message.stack_traces.stack_traces_val[i] != 0);
-                     ++i)
-                {
-                    terminate |= !visitor(
-                        message.stack_traces.stack_traces_val[i]
-                        );
-                }
-            }
+            terminate |= !visitSite(
+                raw.CBTF_cuda_message_u.enqueue_exec.call_site,
+                message, visitor
+                );
             break;
             
         case EnqueueXfer:
-            {
-                const CUDA_EnqueueXfer& msg = 
-                    raw.CBTF_cuda_message_u.enqueue_xfer;
-                
-                for (uint32_t i = msg.call_site;
-                     !terminate && 
-                         (i < message.stack_traces.stack_traces_len) &&
-                         (message.stack_traces.stack_traces_val[i] != 0);
-                     ++i)
-                {
-                    terminate |= !visitor(
-                        message.stack_traces.stack_traces_val[i]
-                        );
-                }
-            }
+            terminate |= !visitSite(
+                raw.CBTF_cuda_message_u.enqueue_xfer.call_site,
+                message, visitor
+                );
+            break;
+            
+        case ExecClass:
+            terminate |= !visitSite(
+                raw.CBTF_cuda_message_u.exec_class.call_site,
+                message, visitor
+                );
+            break;
+            
+        case XferClass:
+            terminate |= !visitSite(
+                raw.CBTF_cuda_message_u.xfer_class.call_site,
+                message, visitor
+                );
             break;
             
         case OverflowSamples:
@@ -586,91 +999,204 @@ void DataTable::visitPCs(const CBTF_cuda_data& message,
 
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
-DataTable::DataTable() :
+DataTable::DataTable(unsigned int threads, std::size_t budget,
+                     const std::string& directory) :
     dm_counters(),
     dm_devices(),
     dm_interval(),
     dm_sites(),
+    dm_site_indices(),
+    dm_host_names(),
+    dm_process_names(),
+    dm_thread_names(),
     dm_hosts(),
     dm_processes(),
-    dm_threads()
+    dm_threads(),
+    dm_owners(),
+    dm_used(),
+    dm_clock(0),
+    dm_budget(budget),
+    dm_directory(directory),
+    dm_spill_file(),
+    dm_shared_mutex(),
+    dm_shards(),
+    dm_workers()
 {
+    for (unsigned int i = 0; (threads > 1) && (i < threads); ++i)
+    {
+        boost::shared_ptr<Shard> shard(new Shard());
+        dm_shards.push_back(shard);
+        dm_workers.create_thread(
+            boost::bind(&DataTable::work, this, boost::ref(*shard))
+            );
+    }
 }
 
 
 
 //------------------------------------------------------------------------------
+// Any messages that are still queued are discarded.
+//------------------------------------------------------------------------------
+DataTable::~DataTable()
+{
+    for (std::vector<boost::shared_ptr<Shard> >::const_iterator
+             i = dm_shards.begin(); i != dm_shards.end(); ++i)
+    {
+        boost::mutex::scoped_lock lock((*i)->dm_mutex);
+        (*i)->dm_stop = true;
+        (*i)->dm_changed.notify_all();
+    }
+
+    dm_workers.join_all();
+}
+
+
+
+//------------------------------------------------------------------------------
+// The thread is interned by the calling thread, so that the list of all known
+// threads is only modified by that thread, before the message is processed.
+// Each process is assigned to a shard by its identifier. The memory budget is
+// also only checked by the calling thread, periodically, before the message is
+// processed.
 //------------------------------------------------------------------------------
 void DataTable::process(const Base::ThreadName& thread,
                         const CBTF_cuda_data& message)
 {
-    PerHostData& per_host = accessPerHostData(thread);
-    PerProcessData& per_process = accessPerProcessData(thread);
-    PerThreadData& per_thread = accessPerThreadData(thread);
+    if ((dm_budget > 0) && (((dm_clock + 1) % kSpillInterval) == 0))
+    {
+        spill();
+    }
+
+    ThreadNameTable::Identifier identifier = intern(thread);
+
+    dm_used[identifier] = ++dm_clock;
+
+    PerHostData& per_host = dm_hosts[dm_owners[identifier].second];
+    PerProcessData& per_process = dm_processes[dm_owners[identifier].first];
+    PerThreadData& per_thread = dm_threads[identifier];
+
+    if (dm_shards.empty())
+    {
+        process(message, identifier, per_host, per_process, per_thread);
+        return;
+    }
     
-    for (u_int i = 0; i < message.messages.messages_len; ++i)
+    Shard::Job job = {
+        identifier, &per_host, &per_process, &per_thread, copy(message)
+    };
+    
+    Shard& shard =
+        *dm_shards[dm_owners[identifier].first % dm_shards.size()];
+    
+    boost::mutex::scoped_lock lock(shard.dm_mutex);
+
+    while (shard.dm_jobs.size() >= kMaxQueuedMessages)
     {
-        const CBTF_cuda_message& raw = message.messages.messages_val[i];
-        
-        switch (raw.type)
-        {
-            
-        case CompletedExec:
-            process(raw.CBTF_cuda_message_u.completed_exec, per_process);
-            break;
-            
-        case CompletedXfer:
-            process(raw.CBTF_cuda_message_u.completed_xfer, per_process);
-            break;
+        shard.dm_changed.wait(lock);
+    }
 
-        case ContextInfo:
-            process(raw.CBTF_cuda_message_u.context_info, per_process);
-            break;
-            
-        case DeviceInfo:
-            process(raw.CBTF_cuda_message_u.device_info, per_host, per_process);
-            break;
+    shard.dm_jobs.push_back(job);
+    shard.dm_changed.notify_all();
 
-        case EnqueueExec:
-            process(raw.CBTF_cuda_message_u.enqueue_exec, message, thread,
-                    per_process);
-            break;
+    if (shard.dm_error)
+    {
+        std::string error = *shard.dm_error;
+        shard.dm_error = boost::none;
+        raise<std::runtime_error>("%1%", error);
+    }
+}
 
-        case EnqueueXfer:
-            process(raw.CBTF_cuda_message_u.enqueue_xfer, message, thread,
-                    per_process);
-            break;
 
-        case OverflowSamples:
-            process(raw.CBTF_cuda_message_u.overflow_samples, per_thread);
-            break;
 
-        case ::PeriodicSamples:
-            process(raw.CBTF_cuda_message_u.periodic_samples, per_thread);
-            break;
-            
-        case SamplingConfig:
-            process(raw.CBTF_cuda_message_u.sampling_config, per_thread);
-            break;
+//------------------------------------------------------------------------------
+// Once a process has finished, completions can still arrive for the events it
+// enqueued, but only if they are still partial. A thread in which none of the
+// partial events could have occurred thus won't gain any new data. Its blobs
+// can be visited now, and its data discarded, without losing anything. Only
+// the thread's event instances and periodic samples are discarded. The thread's
+// name, sampled counters, and event classes, and the shared counters, devices,
+// and call sites, are all kept so that every identifier and index is unchanged.
+// Finding the partial events' threads is only a heuristic. Should a message for
+// a discarded thread arrive anyway, it is processed exactly as it would have
+// been, and the thread's blobs are visited again containing only its new data.
+//------------------------------------------------------------------------------
+void DataTable::discard(const ThreadName& process, const BlobVisitor& visitor)
+{
+    wait();
 
-        case ExecClass:
-            process(raw.CBTF_cuda_message_u.exec_class, message, per_process,
-                    per_thread);
-            break;
+    boost::optional<ThreadNameTable::Identifier> identifier =
+        dm_process_names.find(ThreadName(process.host(), process.pid()));
 
-        case ExecInstance:
-            process(raw.CBTF_cuda_message_u.exec_instance, per_thread);
-            break;
+    if (!identifier)
+    {
+        return;
+    }
 
-        case XferClass:
-            process(raw.CBTF_cuda_message_u.xfer_class, message, per_process,
-                    per_thread);
-            break;
+    const PerProcessData& per_process = dm_processes[*identifier];
 
-        case XferInstance:
-            process(raw.CBTF_cuda_message_u.xfer_instance, per_thread);
-            break;
+    std::map<ThreadName, PerThreadData*> threads;
+
+    for (std::map<ThreadNameTable::Identifier, PerThreadData*>::const_iterator
+             i = per_process.dm_threads.begin();
+         i != per_process.dm_threads.end();
+         ++i)
+    {
+        if (!i->second->dm_discarded &&
+            !per_process.dm_partial_data_transfers.contains(i->first) &&
+            !per_process.dm_partial_kernel_executions.contains(i->first))
+        {
+            threads.insert(
+                std::make_pair(dm_thread_names.name(i->first), i->second)
+                );
+        }
+    }
+
+    bool terminate = false;
+
+    for (std::map<ThreadName, PerThreadData*>::const_iterator
+             i = threads.begin(); !terminate && (i != threads.end()); ++i)
+    {
+        visitBlobs(i->first, boost::bind(
+            visitBlob, _1, boost::cref(visitor), boost::ref(terminate)
+            ));
 
+        if (!terminate)
+        {
+            PerThreadData& per_thread = *i->second;
+
+            per_thread.dm_data_transfers.clearInstances();
+            per_thread.dm_kernel_executions.clearInstances();
+            per_thread.dm_periodic_samples =
+                PeriodicSamples(per_thread.dm_counters.size());
+            per_thread.dm_interval = TimeInterval();
+            per_thread.dm_discarded = true;
+        }
+    }
+}
+
+
+
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+void DataTable::wait() const
+{
+    for (std::vector<boost::shared_ptr<Shard> >::const_iterator
+             i = dm_shards.begin(); i != dm_shards.end(); ++i)
+    {
+        Shard& shard = **i;
+
+        boost::mutex::scoped_lock lock(shard.dm_mutex);
+
+        while (!shard.dm_jobs.empty() || shard.dm_busy)
+        {
+            shard.dm_changed.wait(lock);
+        }
+
+        if (shard.dm_error)
+        {
+            std::string error = *shard.dm_error;
+            shard.dm_error = boost::none;
+            raise<std::runtime_error>("%1%", error);
         }
     }
 }
@@ -684,8 +1210,17 @@ void DataTable::process(const Base::ThreadName& thread,
 //------------------------------------------------------------------------------
 boost::optional<std::size_t> DataTable::device(const ThreadName& thread) const
 {
-    PerProcessData& per_process = 
-        const_cast<DataTable*>(this)->accessPerProcessData(thread);
+    wait();
+
+    boost::optional<ThreadNameTable::Identifier> identifier =
+        dm_process_names.find(ThreadName(thread.host(), thread.pid()));
+
+    if (!identifier)
+    {
+        return boost::none;
+    }
+
+    const PerProcessData& per_process = dm_processes[*identifier];
     
     try
     {
@@ -714,24 +1249,78 @@ boost::optional<std::size_t> DataTable::device(const ThreadName& thread) const
 
 
 
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+const DataTable::PerThreadData* DataTable::findPerThreadData(
+    const ThreadName& thread
+    ) const
+{
+    wait();
+    
+    boost::optional<ThreadNameTable::Identifier> identifier =
+        dm_thread_names.find(thread);
+
+    return identifier ? &dm_threads[*identifier] : NULL;
+}
+
+
+
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+std::size_t DataTable::resident() const
+{
+    wait();
+
+    std::size_t bytes = 0;
+
+    for (std::deque<PerThreadData>::const_iterator
+             i = dm_threads.begin(); i != dm_threads.end(); ++i)
+    {
+        bytes += ::resident(*i);
+    }
+
+    return bytes;
+}
+
+
+
+//------------------------------------------------------------------------------
+// The spill file's whole size is reported, including space that was released
+// by data since copied back into memory or discarded, as the disk space used
+// is what matters.
+//------------------------------------------------------------------------------
+std::size_t DataTable::spilled() const
+{
+    wait();
+
+    return dm_spill_file ? dm_spill_file->size() : 0;
+}
+
+
+
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
 void DataTable::visitBlobs(const Base::ThreadName& thread,
                            const Base::BlobVisitor& visitor) const
 {
-    std::map<ThreadName, PerProcessData>::const_iterator i_process = 
-        dm_processes.find(ThreadName(thread.host(), thread.pid()));
+    wait();
     
-    std::map<ThreadName, PerThreadData>::const_iterator i_thread = 
-        dm_threads.find(thread);
+    boost::optional<ThreadNameTable::Identifier> identifier =
+        dm_thread_names.find(thread);
     
-    if ((i_process == dm_processes.end()) || (i_thread == dm_threads.end()))
+    if (!identifier)
     {
         return;
     }
     
-    const PerProcessData& per_process = i_process->second;
-    const PerThreadData& per_thread = i_thread->second;
+    const PerProcessData& per_process =
+        dm_processes[dm_owners[*identifier].first];
+    const PerThreadData& per_thread = dm_threads[*identifier];
+
+    if (per_thread.dm_discarded)
+    {
+        return;
+    }
     
     BlobGenerator generator(thread, visitor, dm_interval);
 
@@ -757,152 +1346,394 @@ void DataTable::visitBlobs(const Base::ThreadName& thread,
 
     // Add all of the kernel execution classes to the generator
 
-    per_thread.dm_kernel_executions.visitClasses(boost::bind(
-        &DataTable::generateExecClass, this, _1, boost::ref(generator)
-        ));
+    per_thread.dm_kernel_executions.visitClasses(boost::bind(
+        &DataTable::generateExecClass, this, _1, boost::ref(generator)
+        ));
+
+    if (generator.terminate())
+    {
+        return; // Terminate the iteration
+    }
+    
+    // Add all of the data transfer instances to the generator
+
+    per_thread.dm_data_transfers.visitInstances(boost::bind(
+        &DataTable::generateXferInstance, this, _1, boost::ref(generator)
+        ));
+
+    if (generator.terminate())
+    {
+        return; // Terminate the iteration
+    }
+
+    // Add all of the kernel execution instances to the generator
+
+    per_thread.dm_kernel_executions.visitInstances(boost::bind(
+        &DataTable::generateExecInstance, this, _1, boost::ref(generator)
+        ));
+
+    if (generator.terminate())
+    {
+        return; // Terminate the iteration
+    }
+        
+    // Add the periodic samples to the generator
+    
+    const PeriodicSamples& periodic_samples = per_thread.dm_periodic_samples;
+
+    for (std::size_t i = 0;
+         (i < periodic_samples.size()) && !generator.terminate();
+         ++i)
+    {
+        const boost::uint64_t* values = periodic_samples.values(i);
+
+        generator.addPeriodicSample(
+            periodic_samples.time(i), values,
+            values + periodic_samples.counters()
+            );
+    }
+
+    if (generator.terminate())
+    {
+        return; // Terminate the iteration
+    }
+}
+
+
+
+//------------------------------------------------------------------------------
+// Generating a thread's blobs only reads this table, so the blobs for several
+// threads can be generated at once. But they are always visited by the calling
+// thread, in the same order as if each thread's blobs were visited in turn.
+//------------------------------------------------------------------------------
+void DataTable::visitBlobs(const Base::BlobVisitor& visitor,
+                           unsigned int threads) const
+{
+    std::vector<ThreadName> names;
+    visitThreads(boost::bind(addThread, _1, boost::ref(names)));
+
+    bool terminate = false;
+
+    if (threads <= 1)
+    {
+        for (std::vector<ThreadName>::const_iterator
+                 i = names.begin(); !terminate && (i != names.end()); ++i)
+        {
+            visitBlobs(*i, boost::bind(
+                visitBlob, _1, boost::cref(visitor), boost::ref(terminate)
+                ));
+        }
+        return;
+    }
+
+    BlobQueue queue(names, 2 * threads);
+
+    boost::thread_group workers;
+    for (unsigned int i = 0; i < threads; ++i)
+    {
+        workers.create_thread(
+            boost::bind(&DataTable::generate, this, boost::ref(queue))
+            );
+    }
+
+    boost::optional<std::string> error;
+    
+    for (std::size_t i = 0; !terminate && (i < names.size()); ++i)
+    {
+        std::vector<boost::shared_ptr<CBTF_Protocol_Blob> > blobs;
+
+        {
+            boost::mutex::scoped_lock lock(queue.dm_mutex);
+
+            while (!queue.dm_done[i] && !queue.dm_error)
+            {
+                queue.dm_changed.wait(lock);
+            }
+
+            if (queue.dm_error)
+            {
+                error = queue.dm_error;
+                break;
+            }
+
+            blobs.swap(queue.dm_blobs[i]);
+            queue.dm_visited = i + 1;
+            queue.dm_changed.notify_all();
+        }
+
+        for (std::vector<boost::shared_ptr<CBTF_Protocol_Blob> >::const_iterator
+                 j = blobs.begin(); !terminate && (j != blobs.end()); ++j)
+        {
+            terminate |= !visitor(*j);
+        }
+    }
 
-    if (generator.terminate())
     {
-        return; // Terminate the iteration
+        boost::mutex::scoped_lock lock(queue.dm_mutex);
+        queue.dm_stop = true;
+        queue.dm_changed.notify_all();
     }
     
-    // Add all of the data transfer instances to the generator
-
-    per_thread.dm_data_transfers.visitInstances(boost::bind(
-        &DataTable::generateXferInstance, this, _1, boost::ref(generator)
-        ));
+    workers.join_all();
 
-    if (generator.terminate())
+    if (error)
     {
-        return; // Terminate the iteration
+        raise<std::runtime_error>("%1%", *error);
     }
+}
 
-    // Add all of the kernel execution instances to the generator
 
-    per_thread.dm_kernel_executions.visitInstances(boost::bind(
-        &DataTable::generateExecInstance, this, _1, boost::ref(generator)
-        ));
 
-    if (generator.terminate())
-    {
-        return; // Terminate the iteration
-    }
-        
-    // Add the periodic samples to the generator
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+void DataTable::visitThreads(const Base::ThreadVisitor& visitor) const
+{
+    wait();
     
-    for (PeriodicSamples::const_iterator
-             i = per_thread.dm_periodic_samples.begin();
-         (i != per_thread.dm_periodic_samples.end()) && !generator.terminate();
-         ++i)
+    bool terminate = false;
+    std::set<ThreadName> threads;
+
+    for (ThreadNameTable::Identifier
+             i = 0, i_end = dm_thread_names.size(); i != i_end; ++i)
     {
-        generator.addPeriodicSample(i->first, i->second);
+        if (!dm_threads[i].dm_discarded)
+        {
+            threads.insert(dm_thread_names.name(i));
+        }
     }
 
-    if (generator.terminate())
+    for (std::set<ThreadName>::const_iterator
+             i = threads.begin(), i_end = threads.end();
+         !terminate && (i != i_end);
+         ++i)
     {
-        return; // Terminate the iteration
+        terminate |= !visitor(*i);
     }
 }
 
 
 
 //------------------------------------------------------------------------------
+// The per-thread, per-process, and per-host data are all indexed by the dense
+// identifiers assigned by the corresponding thread name tables. A thread that
+// is already known needs only one hash table lookup. A thread that isn't also
+// has its process and host interned, and the data for any of the three that
+// are new is appended to the end of the corresponding table.
 //------------------------------------------------------------------------------
-DataTable::PerHostData& DataTable::accessPerHostData(const ThreadName& thread)
+ThreadNameTable::Identifier DataTable::intern(const ThreadName& thread)
 {
-    ThreadName key(thread.host(), 0 /* Dummy PID */);
-    
-    std::map<ThreadName, PerHostData>::iterator i = dm_hosts.find(key);
+    ThreadNameTable::Identifier identifier = dm_thread_names.add(thread);
+
+    if (identifier < dm_threads.size())
+    {
+        return identifier;
+    }
+
+    ThreadNameTable::Identifier process =
+        dm_process_names.add(ThreadName(thread.host(), thread.pid()));
+
+    if (process == dm_processes.size())
+    {
+        dm_processes.push_back(PerProcessData());
+    }
     
-    if (i == dm_hosts.end())
+    ThreadNameTable::Identifier host =
+        dm_host_names.add(ThreadName(thread.host(), 0 /* Dummy PID */));
+
+    if (host == dm_hosts.size())
     {
-        i = dm_hosts.insert(std::make_pair(key, PerHostData())).first;
+        dm_hosts.push_back(PerHostData());
     }
+
+    dm_threads.push_back(PerThreadData());
+    dm_owners.push_back(Owners(process, host));
+    dm_used.push_back(0);
     
-    return i->second;
+    return identifier;
 }
 
 
 
 //------------------------------------------------------------------------------
+// Offsets already found earlier in the same message are resolved by the given
+// cache without examining their frames again. Otherwise hash the frames for
+// the given call site in place, then search the known call sites with that
+// hash for one containing the same frames. The existing call site is reused if
+// it is found. Only otherwise is a stack trace constructed and added to the
+// known call sites.
 //------------------------------------------------------------------------------
-DataTable::PerProcessData& DataTable::accessPerProcessData(
-    const ThreadName& thread
-    )
+size_t DataTable::findSite(boost::uint32_t site, const CBTF_cuda_data& data,
+                           SiteCache& sites)
 {
-    ThreadName key(thread.host(), thread.pid());
+    SiteCache::const_iterator cached = sites.find(site);
+
+    if (cached != sites.end())
+    {
+        return cached->second;
+    }
+    
+    const CBTF_Protocol_Address* begin = data.stack_traces.stack_traces_val +
+        std::min(site, data.stack_traces.stack_traces_len);
 
-    std::map<ThreadName, PerProcessData>::iterator i = dm_processes.find(key);
+    const CBTF_Protocol_Address* end = begin;
     
-    if (i == dm_processes.end())
+    while ((end != data.stack_traces.stack_traces_val +
+                data.stack_traces.stack_traces_len) && (*end != 0))
     {
-        i = dm_processes.insert(std::make_pair(key, PerProcessData())).first;
+        ++end;
     }
+
+    std::size_t hash = boost::hash_range(begin, end);
+
+    boost::mutex::scoped_lock lock(dm_shared_mutex);
+
+    typedef boost::unordered_multimap<
+        std::size_t, std::size_t
+        >::const_iterator Iterator;
     
-    return i->second;
+    for (std::pair<Iterator, Iterator> i = dm_site_indices.equal_range(hash);
+         i.first != i.second;
+         ++i.first)
+    {
+        const StackTrace& trace = dm_sites[i.first->second];
+        
+        if ((trace.size() == static_cast<std::size_t>(end - begin)) &&
+            std::equal(begin, end, trace.begin()))
+        {
+            sites.insert(std::make_pair(site, i.first->second));
+            return i.first->second;
+        }
+    }
+
+    dm_sites.push_back(StackTrace(begin, end));
+    dm_site_indices.insert(std::make_pair(hash, dm_sites.size() - 1));
+
+    sites.insert(std::make_pair(site, dm_sites.size() - 1));
+    return dm_sites.size() - 1;
 }
 
 
 
 //------------------------------------------------------------------------------
+// Errors are recorded rather than propagated so that the remaining messages are
+// still processed. The first one is reported by the next wait() or process().
+// Any exception escaping this thread would terminate the process, so even those
+// not derived from std::exception are recorded.
 //------------------------------------------------------------------------------
-DataTable::PerThreadData& DataTable::accessPerThreadData(
-    const ThreadName& thread
-    )
+void DataTable::work(Shard& shard)
 {
-    ThreadName key(thread);
-
-    std::map<ThreadName, PerThreadData>::iterator i = dm_threads.find(key);
-    
-    if (i == dm_threads.end())
+    while (true)
     {
-        i = dm_threads.insert(std::make_pair(key, PerThreadData())).first;
+        Shard::Job job;
+
+        {
+            boost::mutex::scoped_lock lock(shard.dm_mutex);
+
+            while (shard.dm_jobs.empty() && !shard.dm_stop)
+            {
+                shard.dm_changed.wait(lock);
+            }
+
+            if (shard.dm_stop)
+            {
+                return;
+            }
+
+            job = shard.dm_jobs.front();
+            shard.dm_jobs.pop_front();
+            shard.dm_busy = true;
+            shard.dm_changed.notify_all();
+        }
+        
+        boost::optional<std::string> error;
+        
+        try
+        {
+            process(*job.dm_message, job.dm_thread,
+                    *job.dm_per_host, *job.dm_per_process, *job.dm_per_thread);
+        }
+        catch (const std::exception& exception)
+        {
+            error = std::string(exception.what());
+        }
+        catch (...)
+        {
+            error = std::string("Unknown error processing a CBTF_cuda_data.");
+        }
+
+        {
+            boost::mutex::scoped_lock lock(shard.dm_mutex);
+
+            if (error && !shard.dm_error)
+            {
+                shard.dm_error = error;
+            }
+            
+            shard.dm_busy = false;
+            shard.dm_changed.notify_all();
+        }
     }
-    
-    return i->second;
 }
 
 
 
 //------------------------------------------------------------------------------
-// Construct a stack trace containing all frames for the given call site, then
-// search the known call sites for that stack trace. The existing call site is
-// reused if it is found. Otherwise the stack trace is added to the known call
-// sites.
-//
-// Note that a linear search is currently employed here because the number of
-// unique CUDA call sites is expected to be low. If that ends up not being the
-// case, and performance is inadequate, a hash of each stack trace could be
-// computed and used to accelerate this search.
 //------------------------------------------------------------------------------
-size_t DataTable::findSite(boost::uint32_t site, const CBTF_cuda_data& data)
+void DataTable::generate(BlobQueue& queue) const
 {
-    StackTrace trace;
-
-    for (boost::uint32_t i = site;
-         (i < data.stack_traces.stack_traces_len) &&
-             (data.stack_traces.stack_traces_val[i] != 0);
-         ++i)
+    while (true)
     {
-        trace.push_back(data.stack_traces.stack_traces_val[i]);
-    }
-    
-    std::vector<StackTrace>::size_type i;
+        std::size_t i;
 
-    for (i = 0; i < dm_sites.size(); ++i)
-    {
-        if (dm_sites[i] == trace)
         {
-            break;
+            boost::mutex::scoped_lock lock(queue.dm_mutex);
+
+            while (!queue.dm_stop &&
+                   (queue.dm_next < queue.dm_threads.size()) &&
+                   (queue.dm_next >= (queue.dm_visited + queue.dm_window)))
+            {
+                queue.dm_changed.wait(lock);
+            }
+
+            if (queue.dm_stop || (queue.dm_next == queue.dm_threads.size()))
+            {
+                return;
+            }
+
+            i = queue.dm_next++;
+        }
+        
+        std::vector<boost::shared_ptr<CBTF_Protocol_Blob> > blobs;
+        boost::optional<std::string> error;
+        
+        try
+        {
+            visitBlobs(queue.dm_threads[i], boost::bind(
+                addBlob, _1, boost::ref(blobs)
+                ));
+        }
+        catch (const std::exception& exception)
+        {
+            error = std::string(exception.what());
+        }
+        catch (...)
+        {
+            error = std::string("Unknown error generating blobs.");
         }
-    }
-    
-    if (i == dm_sites.size())
-    {
-        dm_sites.push_back(trace);
-    }
 
-    return i;
+        {
+            boost::mutex::scoped_lock lock(queue.dm_mutex);
+
+            if (error && !queue.dm_error)
+            {
+                queue.dm_error = error;
+            }
+            
+            queue.dm_blobs[i].swap(blobs);
+            queue.dm_done[i] = true;
+            queue.dm_changed.notify_all();
+        }
+    }
 }
 
 
@@ -1185,6 +2016,96 @@ bool DataTable::generateXferInstance(const EventInstance& instance,
 
 
 
+//------------------------------------------------------------------------------
+// The time intervals of the process' completions and the thread's instances and
+// samples are united with the overall time interval only once all the messages
+// are processed, minimizing contention for the shared data. Similarly the call
+// site found at each stack trace offset is cached for the remaining messages.
+//------------------------------------------------------------------------------
+void DataTable::process(const CBTF_cuda_data& message,
+                        const ThreadNameTable::Identifier& thread,
+                        PerHostData& per_host,
+                        PerProcessData& per_process,
+                        PerThreadData& per_thread)
+{
+    per_process.dm_threads.insert(std::make_pair(thread, &per_thread));
+    per_thread.dm_discarded = false;
+
+    SiteCache sites;
+    
+    for (u_int i = 0; i < message.messages.messages_len; ++i)
+    {
+        const CBTF_cuda_message& raw = message.messages.messages_val[i];
+        
+        switch (raw.type)
+        {
+            
+        case CompletedExec:
+            process(raw.CBTF_cuda_message_u.completed_exec, per_process);
+            break;
+            
+        case CompletedXfer:
+            process(raw.CBTF_cuda_message_u.completed_xfer, per_process);
+            break;
+
+        case ContextInfo:
+            process(raw.CBTF_cuda_message_u.context_info, per_process);
+            break;
+            
+        case DeviceInfo:
+            process(raw.CBTF_cuda_message_u.device_info, per_host, per_process);
+            break;
+
+        case EnqueueExec:
+            process(raw.CBTF_cuda_message_u.enqueue_exec, message, sites,
+                    thread, per_process);
+            break;
+
+        case EnqueueXfer:
+            process(raw.CBTF_cuda_message_u.enqueue_xfer, message, sites,
+                    thread, per_process);
+            break;
+
+        case OverflowSamples:
+            process(raw.CBTF_cuda_message_u.overflow_samples, per_thread);
+            break;
+
+        case ::PeriodicSamples:
+            process(raw.CBTF_cuda_message_u.periodic_samples, per_thread);
+            break;
+            
+        case SamplingConfig:
+            process(raw.CBTF_cuda_message_u.sampling_config, per_thread);
+            break;
+
+        case ExecClass:
+            process(raw.CBTF_cuda_message_u.exec_class, message, sites,
+                    per_process, per_thread);
+            break;
+
+        case ExecInstance:
+            process(raw.CBTF_cuda_message_u.exec_instance, per_thread);
+            break;
+
+        case XferClass:
+            process(raw.CBTF_cuda_message_u.xfer_class, message, sites,
+                    per_process, per_thread);
+            break;
+
+        case XferInstance:
+            process(raw.CBTF_cuda_message_u.xfer_instance, per_thread);
+            break;
+
+        }
+    }
+
+    boost::mutex::scoped_lock lock(dm_shared_mutex);
+    dm_interval |= per_process.dm_interval;
+    dm_interval |= per_thread.dm_interval;
+}
+
+
+
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
 void DataTable::process(const struct CUDA_CompletedExec& message,
@@ -1192,7 +2113,7 @@ void DataTable::process(const struct CUDA_CompletedExec& message,
 {
     process(per_process.dm_partial_kernel_executions.addCompleted(
                 message.id, convert(message)
-                ));
+                ), per_process);
 }
 
 
@@ -1204,7 +2125,7 @@ void DataTable::process(const struct CUDA_CompletedXfer& message,
 {
     process(per_process.dm_partial_data_transfers.addCompleted(
                 message.id, convert(message)
-                ));
+                ), per_process);
 }
 
 
@@ -1216,10 +2137,10 @@ void DataTable::process(const struct CUDA_ContextInfo& message,
 {
     process(per_process.dm_partial_data_transfers.addContext(
                 message.context, message.device
-                ));
+                ), per_process);
     process(per_process.dm_partial_kernel_executions.addContext(
                 message.context, message.device
-                ));
+                ), per_process);
 }
 
 
@@ -1230,25 +2151,33 @@ void DataTable::process(const struct CUDA_DeviceInfo& message,
                         PerHostData& per_host,
                         PerProcessData& per_process)
 {
-    std::map<boost::uint32_t, std::size_t>::const_iterator i =
-        per_host.dm_devices.find(message.device);
+    std::size_t index;
 
-    if (i == per_host.dm_devices.end())
     {
-        CUDA::Device device = convert(message);
-        dm_devices.push_back(device);
+        boost::mutex::scoped_lock lock(dm_shared_mutex);
+        
+        std::map<boost::uint32_t, std::size_t>::const_iterator i =
+            per_host.dm_devices.find(message.device);
+        
+        if (i == per_host.dm_devices.end())
+        {
+            CUDA::Device device = convert(message);
+            dm_devices.push_back(device);
+            
+            i = per_host.dm_devices.insert(std::make_pair(
+                    message.device, dm_devices.size() - 1
+                    )).first;
+        }
 
-        i = per_host.dm_devices.insert(std::make_pair(
-                message.device, dm_devices.size() - 1
-                )).first;
+        index = i->second;
     }
-
+    
     process(per_process.dm_partial_data_transfers.addDevice(
-                i->first, i->second
-                ));
+                message.device, index
+                ), per_process);
     process(per_process.dm_partial_kernel_executions.addDevice(
-                i->first, i->second
-                ));
+                message.device, index
+                ), per_process);
 }
 
 
@@ -1257,16 +2186,17 @@ void DataTable::process(const struct CUDA_DeviceInfo& message,
 //------------------------------------------------------------------------------
 void DataTable::process(const struct CUDA_EnqueueExec& message,
                         const struct CBTF_cuda_data& data,
-                        const Base::ThreadName& thread,
+                        SiteCache& sites,
+                        const ThreadNameTable::Identifier& thread,
                         PerProcessData& per_process)
 {
     KernelExecution event = convert(message);
 
-    event.call_site = findSite(message.call_site, data);
+    event.call_site = findSite(message.call_site, data, sites);
     
     process(per_process.dm_partial_kernel_executions.addEnqueued(
                 message.id, event, message.context, thread
-                ));
+                ), per_process);
 }
 
 
@@ -1275,16 +2205,17 @@ void DataTable::process(const struct CUDA_EnqueueExec& message,
 //------------------------------------------------------------------------------
 void DataTable::process(const struct CUDA_EnqueueXfer& message,
                         const struct CBTF_cuda_data& data,
-                        const Base::ThreadName& thread,
+                        SiteCache& sites,
+                        const ThreadNameTable::Identifier& thread,
                         PerProcessData& per_process)
 {
     DataTransfer event = convert(message);
 
-    event.call_site = findSite(message.call_site, data);
+    event.call_site = findSite(message.call_site, data, sites);
 
     process(per_process.dm_partial_data_transfers.addEnqueued(
                 message.id, event, message.context, thread
-                ));
+                ), per_process);
 }
 
 
@@ -1335,25 +2266,33 @@ void DataTable::process(const CUDA_SamplingConfig& message,
             );
     }
     
-    for (u_int i = 0; i < message.events.events_len; ++i)
     {
-        CounterDescription description = convert(message.events.events_val[i]);
+        boost::mutex::scoped_lock lock(dm_shared_mutex);
         
-        std::vector<CounterDescription>::size_type j;
-        for (j = 0; j < dm_counters.size(); ++j)
+        for (u_int i = 0; i < message.events.events_len; ++i)
         {
-            if (dm_counters[j].name == description.name)
+            CounterDescription description =
+                convert(message.events.events_val[i]);
+            
+            std::vector<CounterDescription>::size_type j;
+            for (j = 0; j < dm_counters.size(); ++j)
             {
-                break;
+                if (dm_counters[j].name == description.name)
+                {
+                    break;
+                }
             }
+            if (j == dm_counters.size())
+            {
+                dm_counters.push_back(description);
+            }
+            
+            per_thread.dm_counters.push_back(j);
         }
-        if (j == dm_counters.size())
-        {
-            dm_counters.push_back(description);
-        }
-        
-        per_thread.dm_counters.push_back(j);
     }
+
+    per_thread.dm_periodic_samples =
+        PeriodicSamples(per_thread.dm_counters.size());
     
     for (std::vector<std::vector<boost::uint8_t> >::const_iterator
              i = per_thread.dm_unprocessed_periodic_samples.begin();
@@ -1372,6 +2311,7 @@ void DataTable::process(const CUDA_SamplingConfig& message,
 //------------------------------------------------------------------------------
 void DataTable::process(const CUDA_ExecClass& message,
                         const CBTF_cuda_data& data,
+                        SiteCache& sites,
                         const PerProcessData& per_process,
                         PerThreadData& per_thread)
 {
@@ -1381,7 +2321,7 @@ void DataTable::process(const CUDA_ExecClass& message,
         per_process.dm_partial_kernel_executions.device(message.context)
         );
 
-    event.call_site = findSite(message.call_site, data);
+    event.call_site = findSite(message.call_site, data, sites);
 
     per_thread.dm_kernel_executions.addClass(event);
 }
@@ -1397,9 +2337,9 @@ void DataTable::process(const CUDA_ExecInstance& message,
 
     per_thread.dm_kernel_executions.addInstance(instance);
 
-    dm_interval |= instance.time;
-    dm_interval |= instance.time_begin;
-    dm_interval |= instance.time_end;
+    per_thread.dm_interval |= instance.time;
+    per_thread.dm_interval |= instance.time_begin;
+    per_thread.dm_interval |= instance.time_end;
 }
 
 
@@ -1408,6 +2348,7 @@ void DataTable::process(const CUDA_ExecInstance& message,
 //------------------------------------------------------------------------------
 void DataTable::process(const CUDA_XferClass& message,
                         const CBTF_cuda_data& data,
+                        SiteCache& sites,
                         const PerProcessData& per_process,
                         PerThreadData& per_thread)
 {
@@ -1417,7 +2358,7 @@ void DataTable::process(const CUDA_XferClass& message,
         per_process.dm_partial_data_transfers.device(message.context)
         );
     
-    event.call_site = findSite(message.call_site, data);
+    event.call_site = findSite(message.call_site, data, sites);
     
     per_thread.dm_data_transfers.addClass(event);
 }
@@ -1433,9 +2374,9 @@ void DataTable::process(const CUDA_XferInstance& message,
     
     per_thread.dm_data_transfers.addInstance(instance);
 
-    dm_interval |= instance.time;
-    dm_interval |= instance.time_begin;
-    dm_interval |= instance.time_end;
+    per_thread.dm_interval |= instance.time;
+    per_thread.dm_interval |= instance.time_begin;
+    per_thread.dm_interval |= instance.time_end;
 }
 
 
@@ -1443,18 +2384,18 @@ void DataTable::process(const CUDA_XferInstance& message,
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
 void DataTable::process(
-    const PartialEventTable<DataTransfer>::Completions& completions
+    const PartialEventTable<DataTransfer>::Completions& completions,
+    PerProcessData& per_process
     )
 {
     for (PartialEventTable<DataTransfer>::Completions::const_iterator
              i = completions.begin(); i != completions.end(); ++i)
     {
-        PerThreadData& per_thread = accessPerThreadData(i->first);
-        per_thread.dm_data_transfers.add(i->second);
+        per_process.dm_threads[i->first]->dm_data_transfers.add(i->second);
         
-        dm_interval |= i->second.time;
-        dm_interval |= i->second.time_begin;
-        dm_interval |= i->second.time_end;
+        per_process.dm_interval |= i->second.time;
+        per_process.dm_interval |= i->second.time_begin;
+        per_process.dm_interval |= i->second.time_end;
     }
 }
 
@@ -1463,18 +2404,18 @@ void DataTable::process(
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
 void DataTable::process(
-    const PartialEventTable<KernelExecution>::Completions& completions
+    const PartialEventTable<KernelExecution>::Completions& completions,
+    PerProcessData& per_process
     )
 {
     for (PartialEventTable<KernelExecution>::Completions::const_iterator
              i = completions.begin(); i != completions.end(); ++i)
     {
-        PerThreadData& per_thread = accessPerThreadData(i->first);
-        per_thread.dm_kernel_executions.add(i->second);
+        per_process.dm_threads[i->first]->dm_kernel_executions.add(i->second);
         
-        dm_interval |= i->second.time;
-        dm_interval |= i->second.time_begin;
-        dm_interval |= i->second.time_end;
+        per_process.dm_interval |= i->second.time;
+        per_process.dm_interval |= i->second.time_begin;
+        per_process.dm_interval |= i->second.time_end;
     }
 }
 
@@ -1513,17 +2454,75 @@ void DataTable::processPeriodicSamples(const boost::uint8_t* begin,
 
         if (n == N)
         {
-            dm_interval |= Time(samples[0]);
+            per_thread.dm_interval |= Time(samples[0]);
             
-            per_thread.dm_periodic_samples.insert(
-                std::make_pair(
-                    samples[0],
-                    std::vector<boost::uint64_t>(
-                        samples.begin() + 1, samples.end()
-                        )
-                    )
-                );
+            per_thread.dm_periodic_samples.add(samples[0], &samples[0] + 1);
             n = 0;
         }
     }
 }
+
+
+
+//------------------------------------------------------------------------------
+// Threads are spilled until only three quarters of the budget is used, so that
+// a table hovering around its budget isn't checked and spilled every interval.
+// A spilled thread that receives further data is copied back into memory, and
+// is spilled again when it is once more among the least recently used. Should
+// spilling fail (e.g. the disk is full), spilling is stopped for good and the
+// data is kept in memory, rather than failing the message being processed.
+//------------------------------------------------------------------------------
+void DataTable::spill()
+{
+    wait();
+
+    std::size_t bytes = 0;
+    std::vector<std::pair<boost::uint64_t, ThreadNameTable::Identifier> > lru;
+
+    for (ThreadNameTable::Identifier i = 0; i < dm_threads.size(); ++i)
+    {
+        std::size_t thread_bytes = ::resident(dm_threads[i]);
+
+        if (thread_bytes > 0)
+        {
+            bytes += thread_bytes;
+            lru.push_back(std::make_pair(dm_used[i], i));
+        }
+    }
+
+    if (bytes <= dm_budget)
+    {
+        return;
+    }
+
+    std::sort(lru.begin(), lru.end());
+
+    try
+    {
+        if (!dm_spill_file)
+        {
+            dm_spill_file.reset(new SpillFile(dm_directory));
+        }
+
+        for (std::vector<
+                 std::pair<boost::uint64_t, ThreadNameTable::Identifier>
+                 >::const_iterator i = lru.begin();
+             (i != lru.end()) && (bytes > ((dm_budget / 4) * 3));
+             ++i)
+        {
+            PerThreadData& per_thread = dm_threads[i->second];
+
+            bytes -= ::resident(per_thread);
+
+            per_thread.dm_data_transfers.spill(*dm_spill_file);
+            per_thread.dm_kernel_executions.spill(*dm_spill_file);
+            per_thread.dm_periodic_samples.spill(*dm_spill_file);
+
+            bytes += ::resident(per_thread);
+        }
+    }
+    catch (const std::runtime_error&)
+    {
+        dm_budget = 0;
+    }
+}
@@ -23,6 +23,9 @@
 #include <boost/cstdint.hpp>
 #include <boost/optional.hpp>
 #include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+#include <boost/unordered_map.hpp>
+#include <deque>
 #include <map>
 #include <set>
 #include <stddef.h>
@@ -36,6 +39,8 @@
 #include <ArgoNavis/Base/BlobVisitor.hpp>
 #include <ArgoNavis/Base/StackTrace.hpp>
 #include <ArgoNavis/Base/ThreadName.hpp>
+#include <ArgoNavis/Base/ThreadNameTable.hpp>
+#include <ArgoNavis/Base/ThreadVisitor.hpp>
 #include <ArgoNavis/Base/TimeInterval.hpp>
 
 #include <ArgoNavis/CUDA/CounterDescription.hpp>
@@ -47,6 +52,8 @@
 #include "EventInstance.hpp"
 #include "EventTable.hpp"
 #include "PartialEventTable.hpp"
+#include "PeriodicSampleTable.hpp"
+#include "SpillFile.hpp"
 
 namespace ArgoNavis { namespace CUDA { namespace Impl {
 
@@ -63,9 +70,7 @@ namespace ArgoNavis { namespace CUDA { namespace Impl {
         typedef boost::shared_ptr<DataTable> Handle;
 
         /** Type of container used to store processed periodic samples. */
-        typedef std::map<
-            boost::uint64_t, std::vector<boost::uint64_t>
-            > PeriodicSamples;
+        typedef PeriodicSampleTable PeriodicSamples;
         
         /** Structure containing per-thread data. */
         struct PerThreadData
@@ -89,22 +94,63 @@ namespace ArgoNavis { namespace CUDA { namespace Impl {
             std::vector<
                 std::vector<boost::uint8_t>
                 > dm_unprocessed_periodic_samples;
+
+            /**
+             * Smallest time interval containing this thread's event instances
+             * and periodic samples.
+             */
+            Base::TimeInterval dm_interval;
+
+            /**
+             * Flag indicating if this thread's event instances and periodic
+             * samples were discarded after its blobs were visited. Cleared if
+             * further messages are processed.
+             */
+            bool dm_discarded;
         };
 
         /** Visit the PC addresses within the given message. */
         static void visitPCs(const CBTF_cuda_data& message,
                              const Base::AddressVisitor& visitor);
 
-        /** Construct an empty data table. */
-        DataTable();
+        /**
+         * Construct an empty data table whose messages are processed by the
+         * given number of threads. A single thread processes every message
+         * synchronously within process(). Once the event instances and the
+         * periodic samples exceed the given memory budget (in bytes, or zero
+         * for no budget), those of the least recently used threads are spilled
+         * to a file in the given directory.
+         */
+        DataTable(unsigned int threads = 1, std::size_t budget = 0,
+                  const std::string& directory = "/tmp");
 
+        /** Destroy this data table. */
+        ~DataTable();
+        
         /** Process the performance data contained within the given message. */
         void process(const Base::ThreadName& thread,
                      const CBTF_cuda_data& message);
+
+        /**
+         * Visit the (raw) performance data blobs for the threads in the given
+         * process, in thread name order, and then discard their data. Threads
+         * in which partial events could still occur are skipped.
+         */
+        void discard(const Base::ThreadName& process,
+                     const Base::BlobVisitor& visitor);
+
+        /**
+         * Wait until all of the messages passed to process() are processed.
+         *
+         * @throw std::runtime_error    One of those messages could not be
+         *                              processed.
+         */
+        void wait() const;
         
         /** Name and kind of all sampled hardware performance counters. */
         const std::vector<CounterDescription>& counters() const
         {
+            wait();
             return dm_counters;
         }
 
@@ -120,30 +166,57 @@ namespace ArgoNavis { namespace CUDA { namespace Impl {
         /** Information about all known CUDA devices. */
         const std::vector<Device>& devices() const
         {
+            wait();
             return dm_devices;
         }
 
         /** Smallest time interval containing this performance data. */
         const Base::TimeInterval& interval() const
         {
+            wait();
             return dm_interval;
         }
 
+        /**
+         * Number of bytes of event instances and periodic samples resident in
+         * memory.
+         */
+        std::size_t resident() const;
+        
         /** Call sites of all known CUDA requests. */
         const std::vector<Base::StackTrace>& sites() const
         {
+            wait();
             return dm_sites;
         }
 
-        /** Access the per-thread data for all known threads. */
-        const std::map<Base::ThreadName, PerThreadData>& threads() const
-        {
-            return dm_threads;
-        }
+        /**
+         * Number of bytes of the file to which event instances and periodic
+         * samples are spilled.
+         */
+        std::size_t spilled() const;
+
+        /**
+         * Find the per-thread data for the given thread. Returns a null
+         * pointer if the thread isn't a known thread.
+         */
+        const PerThreadData* findPerThreadData(
+            const Base::ThreadName& thread
+            ) const;
 
         /** Visit the (raw) performance data blobs for the given thread. */
         void visitBlobs(const Base::ThreadName& thread,
                         const Base::BlobVisitor& visitor) const;
+
+        /**
+         * Visit the (raw) performance data blobs for all known threads, in
+         * thread name order, generating them with the given number of threads.
+         */
+        void visitBlobs(const Base::BlobVisitor& visitor,
+                        unsigned int threads) const;
+
+        /** Visit all known threads, in thread name order. */
+        void visitThreads(const Base::ThreadVisitor& visitor) const;
         
     private:
 
@@ -162,19 +235,64 @@ namespace ArgoNavis { namespace CUDA { namespace Impl {
 
             /** Table of this process' partial kernel executions. */
             PartialEventTable<KernelExecution> dm_partial_kernel_executions;
+
+            /**
+             * Per-thread data for each of this process' threads whose messages
+             * have been processed. Used to complete events without accessing
+             * the (concurrently growing) list of all known threads.
+             */
+            std::map<
+                Base::ThreadNameTable::Identifier, PerThreadData*
+                > dm_threads;
+
+            /** Smallest time interval containing this process' completions. */
+            Base::TimeInterval dm_interval;
         };
-        
-        /** Access the per-host data for the specified thread. */
-        PerHostData& accessPerHostData(const Base::ThreadName& thread);
 
-        /** Access the per-process data for the specified thread. */
-        PerProcessData& accessPerProcessData(const Base::ThreadName& thread);
+        /**
+         * Queue of messages, all for the same subset of processes, awaiting
+         * processing by a single thread.
+         */
+        struct Shard;
+
+        /**
+         * Blobs generated concurrently for many threads, awaiting visitation
+         * in thread name order.
+         */
+        struct BlobQueue;
+        
+        /**
+         * Identifiers, within dm_processes and dm_hosts respectively, of the
+         * process and host containing a thread.
+         */
+        typedef std::pair<
+            Base::ThreadNameTable::Identifier, Base::ThreadNameTable::Identifier
+            > Owners;
         
-        /** Access the per-thread data for the specified thread. */
-        PerThreadData& accessPerThreadData(const Base::ThreadName& thread);
+        /**
+         * Type of cache of the call sites found within a single message,
+         * mapping each offset within the message's stack traces to the index
+         * of the call site at that offset.
+         */
+        typedef boost::unordered_map<boost::uint32_t, std::size_t> SiteCache;
+
+        /**
+         * Find the identifier of the specified thread, adding that thread, as
+         * well as its process and host, if it isn't already known.
+         */
+        Base::ThreadNameTable::Identifier intern(
+            const Base::ThreadName& thread
+            );
 
         /** Find the given call site in (or add it to) the known call sites. */
-        size_t findSite(boost::uint32_t site, const CBTF_cuda_data& data);
+        size_t findSite(boost::uint32_t site, const CBTF_cuda_data& data,
+                        SiteCache& sites);
+
+        /** Process the messages queued in the given shard until stopped. */
+        void work(Shard& shard);
+
+        /** Generate the blobs for the threads in the given queue until done. */
+        void generate(BlobQueue& queue) const;
 
         /** 
          * Generate the context/device information and sampling config messages.
@@ -199,6 +317,13 @@ namespace ArgoNavis { namespace CUDA { namespace Impl {
         bool generateXferInstance(const EventInstance& instance,
                                   BlobGenerator& generator) const;
         
+        /** Process all of the messages within the given message. */
+        void process(const CBTF_cuda_data& message,
+                     const Base::ThreadNameTable::Identifier& thread,
+                     PerHostData& per_host,
+                     PerProcessData& per_process,
+                     PerThreadData& per_thread);
+
         /** Process a CUDA_CompletedExec message. */
         void process(const CUDA_CompletedExec& message,
                      PerProcessData& per_process);
@@ -219,13 +344,15 @@ namespace ArgoNavis { namespace CUDA { namespace Impl {
         /** Process a CUDA_EnqueueExec message. */
         void process(const CUDA_EnqueueExec& message,
                      const CBTF_cuda_data& data,
-                     const Base::ThreadName& thread,
+                     SiteCache& sites,
+                     const Base::ThreadNameTable::Identifier& thread,
                      PerProcessData& per_process);
         
         /** Process a CUDA_EnqueueXfer message. */
         void process(const CUDA_EnqueueXfer& message,
                      const CBTF_cuda_data& data,
-                     const Base::ThreadName& thread,
+                     SiteCache& sites,
+                     const Base::ThreadNameTable::Identifier& thread,
                      PerProcessData& per_process);
         
         /** Process a CUDA_OverflowSamples message. */
@@ -243,6 +370,7 @@ namespace ArgoNavis { namespace CUDA { namespace Impl {
         /** Process a CUDA_ExecClass message. */
         void process(const CUDA_ExecClass& message,
                      const CBTF_cuda_data& data,
+                     SiteCache& sites,
                      const PerProcessData& per_process,
                      PerThreadData& per_thread);
                      
@@ -253,6 +381,7 @@ namespace ArgoNavis { namespace CUDA { namespace Impl {
         /** Process a CUDA_XferClass message. */
         void process(const CUDA_XferClass& message,
                      const CBTF_cuda_data& data,
+                     SiteCache& sites,
                      const PerProcessData& per_process,
                      PerThreadData& per_thread);
                      
@@ -262,12 +391,14 @@ namespace ArgoNavis { namespace CUDA { namespace Impl {
             
         /** Process a DataTransfer event completions. */
         void process(
-            const PartialEventTable<DataTransfer>::Completions& completions
+            const PartialEventTable<DataTransfer>::Completions& completions,
+            PerProcessData& per_process
             );
 
         /** Process a KernelExecution event completions. */
         void process(
-            const PartialEventTable<KernelExecution>::Completions& completions
+            const PartialEventTable<KernelExecution>::Completions& completions,
+            PerProcessData& per_process
             );
 
         /** Process periodic samples. */
@@ -275,6 +406,12 @@ namespace ArgoNavis { namespace CUDA { namespace Impl {
                                     const boost::uint8_t* end,
                                     PerThreadData& per_thread);
 
+        /**
+         * Spill the data of the least recently used threads until the event
+         * instances and periodic samples are well within the memory budget.
+         */
+        void spill();
+
         /** Name and kind of all sampled hardware performance counters. */
         std::vector<CounterDescription> dm_counters;
 
@@ -287,14 +424,77 @@ namespace ArgoNavis { namespace CUDA { namespace Impl {
         /** Call sites of all known CUDA requests. */
         std::vector<Base::StackTrace> dm_sites;
 
-        /** Per-host data for all known hosts. */
-        std::map<Base::ThreadName, PerHostData> dm_hosts;
+        /** Indices of the known call sites keyed by hashes of their frames. */
+        boost::unordered_multimap<std::size_t, std::size_t> dm_site_indices;
+
+        /**
+         * Names of all known hosts. Each host is named by a thread name with
+         * a dummy process identifier of zero.
+         */
+        Base::ThreadNameTable dm_host_names;
+
+        /**
+         * Names of all known processes. Each process is named by a thread
+         * name without a thread identifier.
+         */
+        Base::ThreadNameTable dm_process_names;
+
+        /** Names of all known threads. */
+        Base::ThreadNameTable dm_thread_names;
 
-        /** Per-process data for all known processes. */
-        std::map<Base::ThreadName, PerProcessData> dm_processes;
+        /** Per-host data for all known hosts, indexed by host identifier. */
+        std::deque<PerHostData> dm_hosts;
+
+        /**
+         * Per-process data for all known processes, indexed by process
+         * identifier.
+         */
+        std::deque<PerProcessData> dm_processes;
+
+        /**
+         * Per-thread data for all known threads, indexed by thread
+         * identifier.
+         */
+        std::deque<PerThreadData> dm_threads;
+
+        /** Owners of all known threads, indexed by thread identifier. */
+        std::vector<Owners> dm_owners;
+
+        /**
+         * Number of messages processed when each thread was last used, indexed
+         * by thread identifier.
+         */
+        std::vector<boost::uint64_t> dm_used;
+
+        /** Number of messages processed. */
+        boost::uint64_t dm_clock;
+
+        /**
+         * Memory budget (in bytes) for the event instances and periodic
+         * samples, or zero if there is no budget or spilling failed.
+         */
+        std::size_t dm_budget;
+
+        /** Directory in which the spill file is created. */
+        std::string dm_directory;
+
+        /** Spill file. Null until data is first spilled. */
+        boost::shared_ptr<SpillFile> dm_spill_file;
+
+        /**
+         * Mutual exclusion lock for the data shared by all processes: the
+         * counters, devices, call sites, time interval, and per-host data.
+         */
+        boost::mutex dm_shared_mutex;
+
+        /**
+         * Shards, each processed by its own thread, to which the messages for
+         * each process are queued. Empty when messages are processed directly.
+         */
+        std::vector<boost::shared_ptr<Shard> > dm_shards;
 
-        /** Per-thread data for all known threads. */
-        std::map<Base::ThreadName, PerThreadData> dm_threads;
+        /** Threads processing the shards. */
+        boost::thread_group dm_workers;
         
     }; // class DataTable
 
@@ -20,19 +20,22 @@
 
 #pragma once
 
-#include <boost/bimap.hpp>
-#include <boost/bimap/set_of.hpp>
+#include <algorithm>
 #include <boost/cstdint.hpp>
+#include <boost/thread.hpp>
 #include <map>
 #include <set>
 #include <utility>
+#include <vector>
 
 #include <ArgoNavis/Base/Address.hpp>
+#include <ArgoNavis/Base/IntervalTree.hpp>
 #include <ArgoNavis/Base/Raise.hpp>
 #include <ArgoNavis/Base/TimeInterval.hpp>
 
 #include "EventClass.hpp"
 #include "EventInstance.hpp"
+#include "SpillableColumn.hpp"
 
 namespace ArgoNavis { namespace CUDA { namespace Impl {
 
@@ -41,7 +44,29 @@ namespace ArgoNavis { namespace CUDA { namespace Impl {
      * contained within a data table. Completed events are those for which
      * all needed messages (e.g. enqueue, completion) have been seen.
      *
+     * Each distinct event class is stored once, and the event instances are
+     * stored compactly, referencing their class by its index, in a vector.
+     * New instances are appended to the end of that vector, and are sorted
+     * by their time interval, and merged with the previously sorted ones, on
+     * the next query. This is inexpensive since events are normally added in
+     * bulk, and mostly in time order, before being queried.
+     *
+     * An IntervalTree is laid over the sorted instances, with the maximum
+     * ending time of each node's subtree kept in a parallel vector. Queries
+     * for the events intersecting a time interval thus find all such events,
+     * including long running ones that began well before the interval, in
+     * O(log n + k) time.
+     *
+     * The sorted instances, and the maximum ending times, can be spilled to a
+     * SpillFile to free their memory. They are then queried directly from the
+     * file's mapping, and are only copied back into memory if more instances
+     * are added. Spilling them again only writes the added instances, unless
+     * they had to be merged with the sorted ones, but always rewrites all of
+     * the maximum ending times.
+     *
      * @tparam T    Type containing the information for the events.
+     *
+     * @sa https://github.com/lh3/cgranges
      */
     template <typename T>
     class EventTable
@@ -54,24 +79,69 @@ namespace ArgoNavis { namespace CUDA { namespace Impl {
             dm_contexts(),
             dm_actual(),
             dm_classes(),
-            dm_instances()
+            dm_class_indices(),
+            dm_mutex(),
+            dm_instances(),
+            dm_sorted(0),
+            dm_max_ends(),
+            dm_levels(0)
         {
         }
 
+        /** Construct a completed event table from an existing one. */
+        EventTable(const EventTable& other) :
+            dm_contexts(other.dm_contexts),
+            dm_actual(other.dm_actual),
+            dm_classes(other.dm_classes),
+            dm_class_indices(other.dm_class_indices),
+            dm_mutex(),
+            dm_instances(),
+            dm_sorted(0),
+            dm_max_ends(),
+            dm_levels(0)
+        {
+            boost::mutex::scoped_lock lock(other.dm_mutex);
+            dm_instances = other.dm_instances;
+            dm_sorted = other.dm_sorted;
+            dm_max_ends = other.dm_max_ends;
+            dm_levels = other.dm_levels;
+        }
+
+        /** Replace this completed event table with a copy of another one. */
+        EventTable& operator=(const EventTable& other)
+        {
+            if (this != &other)
+            {
+                dm_contexts = other.dm_contexts;
+                dm_actual = other.dm_actual;
+                dm_classes = other.dm_classes;
+                dm_class_indices = other.dm_class_indices;
+
+                boost::mutex::scoped_lock other_lock(other.dm_mutex);
+                boost::mutex::scoped_lock lock(dm_mutex);
+                dm_instances = other.dm_instances;
+                dm_sorted = other.dm_sorted;
+                dm_max_ends = other.dm_max_ends;
+                dm_levels = other.dm_levels;
+            }
+            return *this;
+        }
+        
         /** Add a new completed event to this table. */
         void add(const T& event)
         {
             dm_contexts.insert(event.context);
 
-            typename Classes::right_const_iterator i = 
-                dm_classes.right.find(event);
+            typename ClassIndices::const_iterator i = 
+                dm_class_indices.find(event);
 
-            if (i == dm_classes.right.end())
+            if (i == dm_class_indices.end())
             {
                 T copy(event);
                 copy.clas = static_cast<boost::uint32_t>(dm_classes.size());
 
-                i = dm_classes.right.insert(
+                dm_classes.push_back(copy);
+                i = dm_class_indices.insert(
                     std::make_pair(copy, copy.clas)
                     ).first;
             }
@@ -84,12 +154,7 @@ namespace ArgoNavis { namespace CUDA { namespace Impl {
             instance.time_begin = event.time_begin;
             instance.time_end = event.time_end;
 
-            dm_instances.insert(
-                std::make_pair(
-                    Base::TimeInterval(instance.time_begin, instance.time_end),
-                    instance
-                    )
-                );
+            dm_instances.values(dm_instances.size()).push_back(instance);
         }
 
         /** Add an existing event class to this table. */
@@ -99,17 +164,22 @@ namespace ArgoNavis { namespace CUDA { namespace Impl {
 
             boost::uint32_t original = event.clas;
             
-            typename Classes::right_const_iterator i = 
-                dm_classes.right.find(event);
+            typename ClassIndices::const_iterator i = 
+                dm_class_indices.find(event);
 
-            if (i == dm_classes.right.end())
+            if (i == dm_class_indices.end())
             {
                 event.clas = static_cast<boost::uint32_t>(dm_classes.size());
-                
-                i = dm_classes.right.insert(
+
+                dm_classes.push_back(event);
+                i = dm_class_indices.insert(
                     std::make_pair(event, event.clas)
                     ).first;
             }
+            else
+            {
+                event.clas = i->second;
+            }
 
             dm_actual.insert(std::make_pair(original, event.clas));
         }
@@ -129,12 +199,21 @@ namespace ArgoNavis { namespace CUDA { namespace Impl {
 
             instance.clas = i->second;
 
-            dm_instances.insert(
-                std::make_pair(
-                    Base::TimeInterval(instance.time_begin, instance.time_end),
-                    instance
-                    )
-                );
+            dm_instances.values(dm_instances.size()).push_back(instance);
+        }
+
+        /**
+         * Remove all of the event instances from this table. The contexts and
+         * event classes are kept, so that instances added later can still
+         * refer to their classes.
+         */
+        void clearInstances()
+        {
+            boost::mutex::scoped_lock lock(dm_mutex);
+            dm_instances = Instances();
+            dm_sorted = 0;
+            dm_max_ends = SpillableColumn<Base::Time>();
+            dm_levels = 0;
         }
 
         /** All known context addresses. */
@@ -142,9 +221,43 @@ namespace ArgoNavis { namespace CUDA { namespace Impl {
         {
             return dm_contexts;
         }
+
+        /**
+         * Get the number of bytes of event instances resident in memory. Event
+         * classes are few, and are always resident, so they aren't included.
+         */
+        std::size_t resident() const
+        {
+            boost::mutex::scoped_lock lock(dm_mutex);
+            return dm_instances.resident() + dm_max_ends.resident();
+        }
+
+        /**
+         * Spill the event instances in this table to the given spill file.
+         *
+         * @param file    Spill file to which to spill the event instances.
+         *
+         * @throw std::runtime_error    The event instances couldn't be spilled.
+         */
+        void spill(SpillFile& file)
+        {
+            update();
+
+            boost::mutex::scoped_lock lock(dm_mutex);
+            dm_instances.spill(file);
+            dm_max_ends.spill(file);
+        }
+
+        /** Get the number of bytes of event instances spilled to a file. */
+        std::size_t spilled() const
+        {
+            boost::mutex::scoped_lock lock(dm_mutex);
+            return dm_instances.spilled() + dm_max_ends.spilled();
+        }
         
         /**
-         * Visit the events in this table intersecting an address range.
+         * Visit the events in this table intersecting a time interval. The
+         * events are visited in ascending order of their time interval.
          *
          * @tparam V    Type of visitor for the events.
          *
@@ -154,48 +267,31 @@ namespace ArgoNavis { namespace CUDA { namespace Impl {
          *
          * @note    The visitation is terminated immediately if "false" is
          *          returned by the visitor.
+         *
+         * @note    The event passed to the visitor is only valid for the
+         *          duration of that call. Its class information is only
+         *          copied when it differs from that of the previous event.
          */
         template <typename V>
         void visit(const Base::TimeInterval& interval, const V& visitor) const
         {
-            bool terminate = false;
+            update();
 
-            typename Instances::const_iterator i =
-                dm_instances.lower_bound(interval.begin());
-
-            if (i != dm_instances.begin())
+            if (dm_instances.empty())
             {
-                --i;
+                return;
             }
-
-            typename Instances::const_iterator i_end =
-                dm_instances.upper_bound(interval.end());
             
-            for (; !terminate && (i != i_end); ++i)
-            {
-                if (i->first.intersects(interval))
-                {
-                    typename Classes::left_const_iterator j = 
-                        dm_classes.left.find(i->second.clas);
-
-                    if (j == dm_classes.left.end())
-                    {
-                        Base::raise<std::runtime_error>(
-                            "Encountered unknown event class UID %1%.",
-                            i->second.clas
-                            );
-                    }
-
-                    T event = j->second;
-                    event.clas = i->second.clas;
-                    event.id = i->second.id;
-                    event.time = i->second.time;
-                    event.time_begin = i->second.time_begin;
-                    event.time_end = i->second.time_end;
-
-                    terminate |= !visitor(event);
-                }
-            }
+            T event = T();
+            bool have_class = false;
+
+            Base::IntervalTree<Nodes<const Base::Time> >::visit(
+                Nodes<const Base::Time>(dm_instances.data(),
+                                        dm_max_ends.data(),
+                                        dm_instances.size()),
+                dm_levels, interval.begin(), interval.end(),
+                Visitor<V>(*this, event, have_class, visitor)
+                );
         }
 
         /**
@@ -214,12 +310,12 @@ namespace ArgoNavis { namespace CUDA { namespace Impl {
         {
             bool terminate = false;
 
-            typename Classes::left_const_iterator i = dm_classes.left.begin();
-            typename Classes::left_const_iterator i_end = dm_classes.left.end();
+            typename std::vector<T>::const_iterator i = dm_classes.begin();
+            typename std::vector<T>::const_iterator i_end = dm_classes.end();
 
             for (; !terminate && (i != i_end); ++i)
             {
-                terminate |= !visitor(i->second);
+                terminate |= !visitor(*i);
             }
         }
 
@@ -237,27 +333,224 @@ namespace ArgoNavis { namespace CUDA { namespace Impl {
         template <typename V>
         void visitInstances(const V& visitor) const
         {
+            update();
+            
             bool terminate = false;
 
-            typename Instances::const_iterator i = dm_instances.begin();            
-            typename Instances::const_iterator i_end = dm_instances.end();
+            const EventInstance* i = dm_instances.data();
+            const EventInstance* i_end = i + dm_instances.size();
 
             for (; !terminate && (i != i_end); ++i)
             {
-                terminate |= !visitor(i->second);
+                terminate |= !visitor(*i);
             }
         }
 
     private:
 
-        /** Type of container used to store the known event classes. */
-        typedef boost::bimap<
-            boost::uint32_t, boost::bimaps::set_of<T, EventClass<T> >
-            > Classes;
+        /** Type of container used to find the known event classes. */
+        typedef std::map<T, boost::uint32_t, EventClass<T> > ClassIndices;
 
         /** Type of container used to store the known event instances. */
-        typedef std::multimap<Base::TimeInterval, EventInstance> Instances;
+        typedef SpillableColumn<EventInstance> Instances;
+
+        /**
+         * Adapter laying an interval tree over the sorted event instances and
+         * the maximum ending times of their subtrees.
+         *
+         * @tparam M    Type of the maximum ending times, which are only
+         *              modified while building the tree.
+         */
+        template <typename M>
+        class Nodes
+        {
+
+        public:
+
+            /** Type of the intervals' values. */
+            typedef Base::Time Point;
+
+            /** Construct an adapter for the given instances. */
+            Nodes(const EventInstance* instances, M* max_ends, std::size_t n) :
+                dm_instances(instances),
+                dm_max_ends(max_ends),
+                dm_size(n)
+            {
+            }
+
+            /** Get the number of event instances. */
+            std::size_t size() const
+            {
+                return dm_size;
+            }
+
+            /** Get the beginning time of the given instance. */
+            Base::Time begin(std::size_t i) const
+            {
+                return dm_instances[i].time_begin;
+            }
+
+            /** Get the ending time of the given instance. */
+            Base::Time end(std::size_t i) const
+            {
+                return dm_instances[i].time_end;
+            }
+
+            /** Get the maximum ending time within the given subtree. */
+            Base::Time maxEnd(std::size_t i) const
+            {
+                return dm_max_ends[i];
+            }
 
+            /** Set the maximum ending time within the given subtree. */
+            void setMaxEnd(std::size_t i, const Base::Time& end)
+            {
+                dm_max_ends[i] = end;
+            }
+
+        private:
+
+            /** Sorted event instances. */
+            const EventInstance* dm_instances;
+
+            /** Maximum ending time within the subtree of each instance. */
+            M* dm_max_ends;
+
+            /** Number of event instances. */
+            std::size_t dm_size;
+
+        }; // class Nodes<M>
+
+        /**
+         * Visitor passing each event instance found by the interval tree on to
+         * the given visitor as an event.
+         */
+        template <typename V>
+        class Visitor
+        {
+
+        public:
+
+            /** Construct a visitor for the given table and event visitor. */
+            Visitor(const EventTable& table, T& event, bool& have_class,
+                    const V& visitor) :
+                dm_table(table),
+                dm_event(event),
+                dm_have_class(have_class),
+                dm_visitor(visitor)
+            {
+            }
+
+            /** Visit the given event instance. */
+            bool operator()(std::size_t i) const
+            {
+                return dm_table.visit(dm_table.dm_instances.data()[i],
+                                      dm_event, dm_have_class, dm_visitor);
+            }
+
+        private:
+
+            /** Table containing the event instances. */
+            const EventTable& dm_table;
+
+            /** Event passed to the visitor. */
+            T& dm_event;
+
+            /** Does the event contain any class yet? */
+            bool& dm_have_class;
+
+            /** Visitor invoked for each event. */
+            const V& dm_visitor;
+
+        }; // class Visitor<V>
+
+        /** Compare two event instances by their time interval. */
+        static bool compare(const EventInstance& x, const EventInstance& y)
+        {
+            return (x.time_begin < y.time_begin) ||
+                ((x.time_begin == y.time_begin) && (x.time_end < y.time_end));
+        }
+
+        /**
+         * Visit one event instance intersecting the queried time interval.
+         *
+         * @param instance      Event instance to be visited.
+         * @param event         Event passed to the visitor, whose class is
+         *                      reused when it is the same as the instance's.
+         * @param have_class    Does the event contain any class yet?
+         * @param visitor       Visitor invoked for the event.
+         * @return              Boolean "true" if the visitation should
+         *                      continue, or "false" otherwise.
+         */
+        template <typename V>
+        bool visit(const EventInstance& instance, T& event, bool& have_class,
+                   const V& visitor) const
+        {
+            if (!have_class || (event.clas != instance.clas))
+            {
+                if (instance.clas >= dm_classes.size())
+                {
+                    Base::raise<std::runtime_error>(
+                        "Encountered unknown event class UID %1%.",
+                        instance.clas
+                        );
+                }
+                
+                event = dm_classes[instance.clas];
+                have_class = true;
+            }
+            
+            event.id = instance.id;
+            event.time = instance.time;
+            event.time_begin = instance.time_begin;
+            event.time_end = instance.time_end;
+            
+            return visitor(event);
+        }
+        
+        /**
+         * Sort the event instances added since the last query, merge them with
+         * the previously sorted ones, and then rebuild the tree. Instances with
+         * identical intervals are kept in the order in which they were added.
+         */
+        void update() const
+        {
+            boost::mutex::scoped_lock lock(dm_mutex);
+
+            if (dm_sorted == dm_instances.size())
+            {
+                return;
+            }
+
+            std::vector<EventInstance>& instances =
+                dm_instances.values(dm_sorted);
+            std::vector<Base::Time>& max_ends = dm_max_ends.values();
+            
+            std::vector<EventInstance>::iterator middle =
+                instances.begin() + dm_sorted;
+
+            std::stable_sort(middle, instances.end(), compare);
+
+            if ((middle != instances.begin()) &&
+                compare(*middle, *(middle - 1)))
+            {
+                // Merging modifies the sorted instances too
+                dm_instances.values();
+
+                std::inplace_merge(instances.begin(), middle,
+                                   instances.end(), compare);
+            }
+
+            dm_sorted = instances.size();
+
+            max_ends.resize(instances.size());
+
+            Nodes<Base::Time> nodes(
+                &instances[0], &max_ends[0], instances.size()
+                );
+            dm_levels = Base::IntervalTree<Nodes<Base::Time> >::build(nodes);
+        }
+        
         /** All known context addresses. */
         std::set<Base::Address> dm_contexts;
 
@@ -265,10 +558,30 @@ namespace ArgoNavis { namespace CUDA { namespace Impl {
         std::map<boost::uint32_t, boost::uint32_t> dm_actual;
 
         /** Event class for each known unique identifer. */
-        Classes dm_classes;
+        std::vector<T> dm_classes;
+
+        /** Unique identifier of each known event class. */
+        ClassIndices dm_class_indices;
+
+        /** Mutual exclusion lock for sorting the event instances. */
+        mutable boost::mutex dm_mutex;
         
-        /** Event instances indexed by their time interval. */
-        Instances dm_instances;
+        /**
+         * Event instances. Those before the first unsorted instance are
+         * sorted by their time interval.
+         */
+        mutable Instances dm_instances;
+
+        /** Index of the first unsorted event instance. */
+        mutable std::size_t dm_sorted;
+
+        /**
+         * Maximum ending time within the subtree of each sorted event instance.
+         */
+        mutable SpillableColumn<Base::Time> dm_max_ends;
+
+        /** Level of the root of the tree. */
+        mutable int dm_levels;
          
     }; // class EventTable<T>
 
@@ -31,7 +31,7 @@
 
 #include <ArgoNavis/Base/Address.hpp>
 #include <ArgoNavis/Base/Raise.hpp>
-#include <ArgoNavis/Base/ThreadName.hpp>
+#include <ArgoNavis/Base/ThreadNameTable.hpp>
 
 namespace ArgoNavis { namespace CUDA { namespace Impl {
     
@@ -50,9 +50,12 @@ namespace ArgoNavis { namespace CUDA { namespace Impl {
         
         /**
          * Type used to return event completions. Each completion includes the
-         * thread in which the event occurred and information for that event.
+         * identifier of the thread in which the event occurred and information
+         * for that event.
          */
-        typedef std::vector<std::pair<Base::ThreadName, T> > Completions;
+        typedef std::vector<
+            std::pair<Base::ThreadNameTable::Identifier, T>
+            > Completions;
         
         /** Construct an empty partial event table. */
         PartialEventTable() :
@@ -127,12 +130,14 @@ namespace ArgoNavis { namespace CUDA { namespace Impl {
          * @param id         Correlation ID of the event.
          * @param event      Partial information for this event.
          * @param context    Address of the context for this event.
-         * @param thread     Thread in which this event occurred.
+         * @param thread     Identifier of the thread in which this event
+         *                   occurred.
          * @return           Any events which are completed by this addition.
          */
-        Completions addEnqueued(boost::uint32_t id, const T& event,
-                                const Base::Address& context,
-                                const Base::ThreadName& thread)
+        Completions addEnqueued(
+            boost::uint32_t id, const T& event, const Base::Address& context,
+            const Base::ThreadNameTable::Identifier& thread
+            )
         {
             Completions completions;
 
@@ -208,6 +213,29 @@ namespace ArgoNavis { namespace CUDA { namespace Impl {
             return i->second;
         }
 
+        /**
+         * Could any of the partial events have occurred in the given thread?
+         * Events whose enqueuing hasn't been seen could have occurred in any
+         * thread, so their presence always returns "true".
+         *
+         * @param thread    Identifier of the thread to be found.
+         * @return          Boolean "true" if any partial events could have
+         *                  occurred in that thread, or "false" otherwise.
+         */
+        bool contains(const Base::ThreadNameTable::Identifier& thread) const
+        {
+            for (typename Events::const_iterator
+                     i = dm_events.begin(); i != dm_events.end(); ++i)
+            {
+                if (!i->second.dm_thread || (*i->second.dm_thread == thread))
+                {
+                    return true;
+                }
+            }
+            
+            return false;
+        }
+
         /**
          * Get the index within DataTable::dm_devices for the given device ID.
          */
@@ -239,8 +267,8 @@ namespace ArgoNavis { namespace CUDA { namespace Impl {
             /** Address of the context in which this event occurred. */
             boost::optional<Base::Address> dm_context;
 
-            /** Thread in which this event occurred. */
-            boost::optional<Base::ThreadName> dm_thread;
+            /** Identifier of the thread in which this event occurred. */
+            boost::optional<Base::ThreadNameTable::Identifier> dm_thread;
         };
         
         /** Type of container used to store the known context addresses. */
@@ -18,10 +18,13 @@
 
 /** @file Definition of the PerformanceData class. */
 
+#include <algorithm>
 #include <boost/assert.hpp>
+#include <boost/thread.hpp>
 #include <map>
 #include <stddef.h>
 #include <stdexcept>
+#include <string>
 
 #include <ArgoNavis/Base/Raise.hpp>
 
@@ -39,45 +42,15 @@ using namespace ArgoNavis::CUDA::Impl;
 /** Anonymous namespace hiding implementation details. */
 namespace {
 
-    /** Find the smallest range of samples enclosing the given interval. */
-    bool find(const DataTable::PeriodicSamples& samples,
-              const TimeInterval& interval,
-              DataTable::PeriodicSamples::const_iterator& min,
-              DataTable::PeriodicSamples::const_iterator& max)
-    {
-        if (samples.empty())
-        {
-            return false;
-        }
-        
-        TimeInterval clamped = interval & 
-            TimeInterval(samples.begin()->first, samples.rbegin()->first);
-        
-        if (clamped.empty())
-        {
-            return false;
-        }
-        
-        min = samples.lower_bound(clamped.begin());
-        max = samples.upper_bound(clamped.end());
-        
-        if ((min != samples.begin()) && (Time(min->first) != clamped.begin()))
-        {
-            --min;
-        }
+    /** Number of threads used for ingestion (zero for one per core). */
+    unsigned int ingestion_thread_count = 1;
 
-        if (max != samples.begin())
-        {
-            --max;
-            if (Time(max->first) != clamped.end())
-            {
-                ++max;
-            }
-        }
+    /** Memory budget (in bytes) of each data table (zero for no budget). */
+    std::size_t memory_budget = 0;
+
+    /** Directory in which each data table spills its performance data. */
+    std::string spill_directory = "/tmp";
 
-        return true;
-    }
-    
 } // namespace <anonymous>
 
 
@@ -98,7 +71,9 @@ void PerformanceData::visitPCs(const CBTF_cuda_data& message,
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
 PerformanceData::PerformanceData() :
-    dm_data_table(new Impl::DataTable())
+    dm_data_table(new Impl::DataTable(
+        getIngestionThreadCount(), memory_budget, spill_directory
+        ))
 {
 }
 
@@ -133,36 +108,43 @@ std::vector<boost::uint64_t> PerformanceData::counts(
     std::size_t N = dm_data_table->counters().size();
     std::vector<boost::uint64_t> counts(N, 0);
     
-    std::map<ThreadName, DataTable::PerThreadData>::const_iterator i =
-        dm_data_table->threads().find(thread);
+    const DataTable::PerThreadData* per_thread =
+        dm_data_table->findPerThreadData(thread);
     
-    if (i == dm_data_table->threads().end())
+    if (per_thread == NULL)
     {
         return counts;
     }
 
-    std::size_t M = i->second.dm_counters.size();
+    std::size_t M = per_thread->dm_counters.size();
     BOOST_ASSERT(M <= N);
     
-    DataTable::PeriodicSamples::const_iterator j_min, j_max;
+    const DataTable::PeriodicSamples& periodic_samples =
+        per_thread->dm_periodic_samples;
+
+    std::size_t j_min, j_max;
 
-    if (!find(i->second.dm_periodic_samples, interval, j_min, j_max))
+    if (!periodic_samples.find(interval, j_min, j_max))
     {
         return counts;
     }
     
-    TimeInterval sample_interval(j_min->first, j_max->first);
+    TimeInterval sample_interval(periodic_samples.time(j_min),
+                                 periodic_samples.time(j_max));
     
     boost::uint64_t interval_width = (interval & sample_interval).width();
     boost::uint64_t sample_width = sample_interval.width();
 
-    BOOST_ASSERT((j_min->second.size() == M) && (j_max->second.size() == M));
+    BOOST_ASSERT(periodic_samples.counters() == M);
+    const boost::uint64_t* values_min = periodic_samples.values(j_min);
+    const boost::uint64_t* values_max = periodic_samples.values(j_max);
+
     for (std::size_t m = 0; m < M; ++m)
     {
-        std::size_t n = i->second.dm_counters[m];
+        std::size_t n = per_thread->dm_counters[m];
         BOOST_ASSERT(n < N);
         
-        boost::uint64_t count_delta = j_max->second[m] - j_min->second[m];
+        boost::uint64_t count_delta = values_max[m] - values_min[m];
         counts[n] = count_delta * interval_width / sample_width;
     }
     
@@ -195,6 +177,19 @@ const std::vector<ArgoNavis::CUDA::Device>& PerformanceData::devices() const
 
 
 
+//------------------------------------------------------------------------------
+// Simply pass the provided arguments on to the identically named method of the
+// DataTable class. The actual implementation is located there in order to keep
+// as much of the message-specific code centralized in one place.
+//------------------------------------------------------------------------------
+void PerformanceData::discard(const ThreadName& process,
+                              const BlobVisitor& visitor)
+{
+    dm_data_table->discard(process, visitor);
+}
+
+
+
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
 const TimeInterval& PerformanceData::interval() const
@@ -232,10 +227,10 @@ Base::PeriodicSamples PerformanceData::periodic(const ThreadName& thread,
         dm_data_table->counters()[counter].name, kind
         );
     
-    std::map<ThreadName, DataTable::PerThreadData>::const_iterator i =
-        dm_data_table->threads().find(thread);
+    const DataTable::PerThreadData* per_thread =
+        dm_data_table->findPerThreadData(thread);
 
-    if (i == dm_data_table->threads().end())
+    if (per_thread == NULL)
     {
         return samples;
     }
@@ -243,31 +238,32 @@ Base::PeriodicSamples PerformanceData::periodic(const ThreadName& thread,
     std::size_t n;
 
     for (n = 0;
-         (n < i->second.dm_counters.size()) &&
-             (i->second.dm_counters[n] != counter);
+         (n < per_thread->dm_counters.size()) &&
+             (per_thread->dm_counters[n] != counter);
          ++n);
     
-    if (n == i->second.dm_counters.size())
+    if (n == per_thread->dm_counters.size())
     {
         return samples;
     }
 
-    DataTable::PeriodicSamples::const_iterator j_min, j_max;
+    const DataTable::PeriodicSamples& periodic_samples =
+        per_thread->dm_periodic_samples;
+
+    std::size_t j_min, j_max;
 
-    if (!find(i->second.dm_periodic_samples, interval, j_min, j_max))
+    if (!periodic_samples.find(interval, j_min, j_max))
     {
         return samples;
     }
 
-    ++j_max;
-
-    for (DataTable::PeriodicSamples::const_iterator j = j_min; j != j_max; ++j)
+    for (std::size_t j = j_min; j <= j_max; ++j)
     {
-        Time t(j->first);
+        Time t(periodic_samples.time(j));
 
         if (interval.contains(t))
         {
-            samples.add(t, j->second[n]);
+            samples.add(t, periodic_samples.values(j)[n]);
         }
     }
 
@@ -276,6 +272,15 @@ Base::PeriodicSamples PerformanceData::periodic(const ThreadName& thread,
 
 
 
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+std::size_t PerformanceData::residentBytes() const
+{
+    return dm_data_table->resident();
+}
+
+
+
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
 const std::vector<StackTrace>& PerformanceData::sites() const
@@ -285,6 +290,15 @@ const std::vector<StackTrace>& PerformanceData::sites() const
 
 
 
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+std::size_t PerformanceData::spilledBytes() const
+{
+    return dm_data_table->spilled();
+}
+
+
+
 //------------------------------------------------------------------------------
 // Simply pass the provided arguments on to the identically named method of the
 // DataTable class. The actual implementation is located there in order to keep
@@ -298,6 +312,19 @@ void PerformanceData::visitBlobs(const ThreadName& thread,
 
 
 
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+void PerformanceData::visitBlobs(const BlobVisitor& visitor,
+                                 unsigned int threads) const
+{
+    dm_data_table->visitBlobs(
+        visitor, (threads > 0) ? threads :
+        std::max(boost::thread::hardware_concurrency(), 1u)
+        );
+}
+
+
+
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
 void PerformanceData::visitDataTransfers(
@@ -306,12 +333,12 @@ void PerformanceData::visitDataTransfers(
     const DataTransferVisitor& visitor
     ) const
 {
-    std::map<ThreadName, DataTable::PerThreadData>::const_iterator i =
-        dm_data_table->threads().find(thread);
+    const DataTable::PerThreadData* per_thread =
+        dm_data_table->findPerThreadData(thread);
     
-    if (i != dm_data_table->threads().end())
+    if (per_thread != NULL)
     {
-        i->second.dm_data_transfers.visit<DataTransferVisitor>(
+        per_thread->dm_data_transfers.visit<DataTransferVisitor>(
             interval, visitor
             );
     }
@@ -327,12 +354,12 @@ void PerformanceData::visitKernelExecutions(
     const KernelExecutionVisitor& visitor
     ) const
 {
-    std::map<ThreadName, DataTable::PerThreadData>::const_iterator i =
-        dm_data_table->threads().find(thread);
+    const DataTable::PerThreadData* per_thread =
+        dm_data_table->findPerThreadData(thread);
     
-    if (i != dm_data_table->threads().end())
+    if (per_thread != NULL)
     {
-        i->second.dm_kernel_executions.visit<KernelExecutionVisitor>(
+        per_thread->dm_kernel_executions.visit<KernelExecutionVisitor>(
             interval, visitor
             );
     }
@@ -348,10 +375,10 @@ void PerformanceData::visitPeriodicSamples(
     const PeriodicSampleVisitor& visitor
     ) const
 {
-    std::map<ThreadName, DataTable::PerThreadData>::const_iterator i =
-        dm_data_table->threads().find(thread);
+    const DataTable::PerThreadData* per_thread =
+        dm_data_table->findPerThreadData(thread);
     
-    if (i == dm_data_table->threads().end())
+    if (per_thread == NULL)
     {
         return;
     }
@@ -359,35 +386,38 @@ void PerformanceData::visitPeriodicSamples(
     std::size_t N = dm_data_table->counters().size();
     std::vector<boost::uint64_t> counts(N, 0);
     
-    std::size_t M = i->second.dm_counters.size();
+    std::size_t M = per_thread->dm_counters.size();
     BOOST_ASSERT(M <= N);
     
     bool terminate = false;
 
-    DataTable::PeriodicSamples::const_iterator j_min, j_max;
+    const DataTable::PeriodicSamples& periodic_samples =
+        per_thread->dm_periodic_samples;
 
-    if (!find(i->second.dm_periodic_samples, interval, j_min, j_max))
+    std::size_t j_min, j_max;
+
+    if (!periodic_samples.find(interval, j_min, j_max))
     {
         return;
     }
 
-    ++j_max;
+    BOOST_ASSERT(periodic_samples.counters() == M);
     
-    for (DataTable::PeriodicSamples::const_iterator
-             j = j_min; !terminate && (j != j_max); ++j)
+    for (std::size_t j = j_min; !terminate && (j <= j_max); ++j)
     {
-        Time t(j->first);
+        Time t(periodic_samples.time(j));
         
         if (interval.contains(t))
         {
+            const boost::uint64_t* values = periodic_samples.values(j);
+
             counts.assign(N, 0);
-            BOOST_ASSERT(j->second.size() == M);
             for (std::size_t m = 0; m < M; ++m)
             {
-                std::size_t n = i->second.dm_counters[m];
+                std::size_t n = per_thread->dm_counters[m];
                 BOOST_ASSERT(n < N);
 
-                counts[n] = j->second[m];
+                counts[n] = values[m];
             }
             
             terminate |= !visitor(t, counts);
@@ -401,14 +431,60 @@ void PerformanceData::visitPeriodicSamples(
 //------------------------------------------------------------------------------
 void PerformanceData::visitThreads(const ThreadVisitor& visitor) const
 {
-    bool terminate = false;
+    dm_data_table->visitThreads(visitor);
+}
 
-    for (std::map<ThreadName, DataTable::PerThreadData>::const_iterator
-             i = dm_data_table->threads().begin(),
-             i_end = dm_data_table->threads().end();
-         !terminate && (i != i_end);
-         ++i)
-    {
-        terminate |= !visitor(i->first);
-    }
+
+
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+unsigned int ArgoNavis::CUDA::getIngestionThreadCount()
+{
+    return (ingestion_thread_count > 0) ? ingestion_thread_count :
+        std::max(boost::thread::hardware_concurrency(), 1u);
+}
+
+
+
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+void ArgoNavis::CUDA::setIngestionThreadCount(unsigned int count)
+{
+    ingestion_thread_count = count;
+}
+
+
+
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+std::size_t ArgoNavis::CUDA::getMemoryBudget()
+{
+    return memory_budget;
+}
+
+
+
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+void ArgoNavis::CUDA::setMemoryBudget(std::size_t bytes)
+{
+    memory_budget = bytes;
+}
+
+
+
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+std::string ArgoNavis::CUDA::getSpillDirectory()
+{
+    return spill_directory;
+}
+
+
+
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+void ArgoNavis::CUDA::setSpillDirectory(const std::string& directory)
+{
+    spill_directory = directory;
 }
@@ -0,0 +1,124 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2017 Argo Navis Technologies. All Rights Reserved.
+//
+// This library is free software; you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation; either version 2.1 of the License, or (at your option)
+// any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+// details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this library; if not, write to the Free Software Foundation, Inc.,
+// 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+////////////////////////////////////////////////////////////////////////////////
+
+/** @file Definition of the PeriodicSampleTable class. */
+
+#include <algorithm>
+#include <vector>
+
+#include "PeriodicSampleTable.hpp"
+
+using namespace ArgoNavis::Base;
+using namespace ArgoNavis::CUDA::Impl;
+
+
+
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+PeriodicSampleTable::PeriodicSampleTable(std::size_t counters) :
+    dm_counters(counters),
+    dm_times(),
+    dm_values()
+{
+}
+
+
+
+//------------------------------------------------------------------------------
+// Samples almost always arrive in time order, and are simply appended to the
+// end of the table, leaving any spilled samples unmodified. Otherwise the
+// sample is inserted at its sorted position.
+//------------------------------------------------------------------------------
+void PeriodicSampleTable::add(boost::uint64_t time,
+                              const boost::uint64_t* values)
+{
+    if (dm_times.empty() || (time > dm_times.data()[dm_times.size() - 1]))
+    {
+        dm_times.values(dm_times.size()).push_back(time);
+
+        std::vector<boost::uint64_t>& all_values =
+            dm_values.values(dm_values.size());
+        all_values.insert(all_values.end(), values, values + dm_counters);
+        return;
+    }
+
+    std::vector<boost::uint64_t>& times = dm_times.values();
+    std::vector<boost::uint64_t>& all_values = dm_values.values();
+
+    std::vector<boost::uint64_t>::iterator i =
+        std::lower_bound(times.begin(), times.end(), time);
+
+    if (*i == time)
+    {
+        return;
+    }
+
+    all_values.insert(all_values.begin() + ((i - times.begin()) * dm_counters),
+                      values, values + dm_counters);
+    times.insert(i, time);
+}
+
+
+
+//------------------------------------------------------------------------------
+// The range includes the last sample at or before the beginning of the given
+// interval and the first sample at or after its end, so that the counts over
+// the interval can be interpolated from the samples enclosing it.
+//------------------------------------------------------------------------------
+bool PeriodicSampleTable::find(const TimeInterval& interval,
+                               std::size_t& min, std::size_t& max) const
+{
+    if (dm_times.empty())
+    {
+        return false;
+    }
+
+    const boost::uint64_t* times = dm_times.data();
+    const boost::uint64_t* times_end = times + dm_times.size();
+
+    TimeInterval clamped = interval & TimeInterval(times[0], times_end[-1]);
+
+    if (clamped.empty())
+    {
+        return false;
+    }
+
+    boost::uint64_t begin = clamped.begin(), end = clamped.end();
+
+    const boost::uint64_t* i = std::lower_bound(times, times_end, begin);
+    const boost::uint64_t* j = std::upper_bound(times, times_end, end);
+
+    if ((i != times) && (*i != begin))
+    {
+        --i;
+    }
+
+    if (j != times)
+    {
+        --j;
+        if (*j != end)
+        {
+            ++j;
+        }
+    }
+
+    min = i - times;
+    max = j - times;
+
+    return true;
+}
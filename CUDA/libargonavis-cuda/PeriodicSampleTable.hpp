@@ -0,0 +1,143 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2017 Argo Navis Technologies. All Rights Reserved.
+//
+// This library is free software; you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation; either version 2.1 of the License, or (at your option)
+// any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+// details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this library; if not, write to the Free Software Foundation, Inc.,
+// 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+////////////////////////////////////////////////////////////////////////////////
+
+/** @file Declaration of the PeriodicSampleTable class. */
+
+#pragma once
+
+#include <boost/cstdint.hpp>
+#include <cstddef>
+
+#include <ArgoNavis/Base/TimeInterval.hpp>
+
+#include "SpillFile.hpp"
+#include "SpillableColumn.hpp"
+
+namespace ArgoNavis { namespace CUDA { namespace Impl {
+
+    /**
+     * Table of a thread's periodic samples of its hardware performance
+     * counters. The samples are stored in columns: one vector containing
+     * the time of each sample, sorted by time, and one row-major matrix
+     * containing the values of every counter for each sample. Each sample
+     * thus costs only one 64-bit value per counter plus its time. Both of
+     * the columns can be spilled to a SpillFile to free their memory.
+     */
+    class PeriodicSampleTable
+    {
+
+    public:
+
+        /**
+         * Construct an empty periodic sample table.
+         *
+         * @param counters    Number of counters in each sample.
+         */
+        PeriodicSampleTable(std::size_t counters = 0);
+
+        /**
+         * Add a new sample to this table. A sample with the same time as an
+         * existing sample is ignored.
+         *
+         * @param time      Time of the sample.
+         * @param values    Value of each counter in the sample.
+         */
+        void add(boost::uint64_t time, const boost::uint64_t* values);
+
+        /** Get the number of counters in each sample. */
+        std::size_t counters() const
+        {
+            return dm_counters;
+        }
+
+        /** Is this table empty? */
+        bool empty() const
+        {
+            return dm_times.empty();
+        }
+
+        /**
+         * Find the smallest range of samples enclosing the given interval.
+         *
+         * @param interval    Time interval to be found.
+         * @param min         Index of the first sample in the range.
+         * @param max         Index of the last sample in the range.
+         * @return            Boolean "true" if the range was found, or
+         *                    "false" if the interval doesn't intersect the
+         *                    samples in this table.
+         */
+        bool find(const Base::TimeInterval& interval,
+                  std::size_t& min, std::size_t& max) const;
+
+        /** Get the number of bytes of samples resident in memory. */
+        std::size_t resident() const
+        {
+            return dm_times.resident() + dm_values.resident();
+        }
+
+        /** Get the number of samples in this table. */
+        std::size_t size() const
+        {
+            return dm_times.size();
+        }
+
+        /**
+         * Spill the samples in this table to the given spill file.
+         *
+         * @param file    Spill file to which to spill the samples.
+         *
+         * @throw std::runtime_error    The samples couldn't be spilled.
+         */
+        void spill(SpillFile& file)
+        {
+            dm_times.spill(file);
+            dm_values.spill(file);
+        }
+
+        /** Get the number of bytes of samples spilled to a file. */
+        std::size_t spilled() const
+        {
+            return dm_times.spilled() + dm_values.spilled();
+        }
+
+        /** Get the time of the sample with the given index. */
+        boost::uint64_t time(std::size_t i) const
+        {
+            return dm_times.data()[i];
+        }
+
+        /** Get the counter values of the sample with the given index. */
+        const boost::uint64_t* values(std::size_t i) const
+        {
+            return dm_values.data() + (i * dm_counters);
+        }
+
+    private:
+
+        /** Number of counters in each sample. */
+        std::size_t dm_counters;
+
+        /** Time of each sample. */
+        SpillableColumn<boost::uint64_t> dm_times;
+
+        /** Values of every counter, for each sample, in row-major order. */
+        SpillableColumn<boost::uint64_t> dm_values;
+
+    }; // class PeriodicSampleTable
+
+} } } // namespace ArgoNavis::CUDA::Impl
@@ -0,0 +1,389 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2017 Argo Navis Technologies. All Rights Reserved.
+//
+// This library is free software; you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation; either version 2.1 of the License, or (at your option)
+// any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+// details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this library; if not, write to the Free Software Foundation, Inc.,
+// 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+////////////////////////////////////////////////////////////////////////////////
+
+/** @file Definition of the SpillFile class. */
+
+#include <boost/thread.hpp>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+#include <ArgoNavis/Base/Raise.hpp>
+
+#include "SpillFile.hpp"
+
+using namespace ArgoNavis::Base;
+using namespace ArgoNavis::CUDA::Impl;
+
+
+
+/** Anonymous namespace hiding implementation details. */
+namespace {
+
+    /** Round the given size up to a multiple of eight bytes. */
+    boost::uint64_t round(boost::uint64_t size)
+    {
+        return (size + 7) & ~static_cast<boost::uint64_t>(7);
+    }
+
+    /**
+     * Deleter unmapping a region of a spill file mapped into memory. Holds a
+     * handle to the region so that it isn't reused while it is still mapped.
+     */
+    class Unmapper
+    {
+
+    public:
+
+        /** Construct a deleter for the given mapping. */
+        Unmapper(void* address, std::size_t length,
+                 const SpillFile::RegionHandle& region) :
+            dm_address(address),
+            dm_length(length),
+            dm_region(region)
+        {
+        }
+
+        /** Unmap the mapping. */
+        void operator()(const void*) const
+        {
+            munmap(dm_address, dm_length);
+        }
+
+    private:
+
+        /** Address of the mapping. */
+        void* dm_address;
+
+        /** Length (in bytes) of the mapping. */
+        std::size_t dm_length;
+
+        /** Region that was mapped. */
+        SpillFile::RegionHandle dm_region;
+
+    }; // class Unmapper
+
+} // namespace <anonymous>
+
+
+
+/**
+ * Space allocated within a spill file. Space released in the middle of the
+ * file is kept, coalesced with any adjacent released space, and reused by
+ * the smallest released space large enough for each new region. Released
+ * space at the end of the file is instead given back to the file system.
+ */
+struct SpillFile::Space :
+    private boost::noncopyable
+{
+    /** Construct the space of the given (empty) file. */
+    Space(int fd) :
+        dm_fd(fd),
+        dm_mutex(),
+        dm_size(0),
+        dm_released(),
+        dm_sizes()
+    {
+    }
+
+    /** Destroy the space, closing its file. */
+    ~Space()
+    {
+        close(dm_fd);
+    }
+
+    /** Allocate space of the given size, returning its offset. */
+    boost::uint64_t allocate(boost::uint64_t size)
+    {
+        boost::mutex::scoped_lock lock(dm_mutex);
+
+        std::set<std::pair<boost::uint64_t, boost::uint64_t> >::iterator i =
+            dm_sizes.lower_bound(std::make_pair(size, 0));
+
+        if (i == dm_sizes.end())
+        {
+            boost::uint64_t offset = dm_size;
+            dm_size += size;
+            return offset;
+        }
+
+        boost::uint64_t offset = i->second;
+        boost::uint64_t length = i->first;
+
+        dm_sizes.erase(i);
+        dm_released.erase(offset);
+
+        if (length > size)
+        {
+            insert(offset + size, length - size);
+        }
+
+        return offset;
+    }
+
+    /** Insert released space. The caller must hold the mutex. */
+    void insert(boost::uint64_t offset, boost::uint64_t size)
+    {
+        dm_released.insert(std::make_pair(offset, size));
+        dm_sizes.insert(std::make_pair(size, offset));
+    }
+
+    /** Release the space of the given size at the given offset. */
+    void release(boost::uint64_t offset, boost::uint64_t size)
+    {
+        boost::mutex::scoped_lock lock(dm_mutex);
+
+        std::map<boost::uint64_t, boost::uint64_t>::iterator i =
+            dm_released.find(offset + size);
+
+        if (i != dm_released.end())
+        {
+            size += i->second;
+            dm_sizes.erase(std::make_pair(i->second, i->first));
+            dm_released.erase(i);
+        }
+
+        i = dm_released.lower_bound(offset);
+
+        if (i != dm_released.begin())
+        {
+            --i;
+
+            if (i->first + i->second == offset)
+            {
+                offset = i->first;
+                size += i->second;
+                dm_sizes.erase(std::make_pair(i->second, i->first));
+                dm_released.erase(i);
+            }
+        }
+
+        if (offset + size < dm_size)
+        {
+            insert(offset, size);
+            return;
+        }
+
+        // Should the file fail to be truncated, the space is simply reused by
+        // the next region allocated at the end of the file instead.
+        dm_size = offset;
+        while ((ftruncate(dm_fd, dm_size) == -1) && (errno == EINTR))
+        {
+        }
+    }
+
+    /** File descriptor of the file. */
+    int dm_fd;
+
+    /** Mutual exclusion lock for the space. */
+    boost::mutex dm_mutex;
+
+    /** Size (in bytes) of the file. */
+    boost::uint64_t dm_size;
+
+    /** Size of the released space at each offset. */
+    std::map<boost::uint64_t, boost::uint64_t> dm_released;
+
+    /** Size and offset of all released space. */
+    std::set<std::pair<boost::uint64_t, boost::uint64_t> > dm_sizes;
+
+}; // struct SpillFile::Space
+
+
+
+/** Region of a spill file, which is released when it is destroyed. */
+class SpillFile::Region :
+    private boost::noncopyable
+{
+
+public:
+
+    /** Construct a region by allocating space of the given capacity. */
+    Region(const boost::shared_ptr<Space>& space, boost::uint64_t capacity) :
+        dm_space(space),
+        dm_offset(space->allocate(capacity)),
+        dm_capacity(capacity),
+        dm_size(0)
+    {
+    }
+
+    /** Destroy this region, releasing its space. */
+    ~Region()
+    {
+        dm_space->release(dm_offset, dm_capacity);
+    }
+
+    /** Space containing this region. */
+    boost::shared_ptr<Space> dm_space;
+
+    /** Offset of this region within its file. */
+    boost::uint64_t dm_offset;
+
+    /** Capacity (in bytes) of this region. */
+    boost::uint64_t dm_capacity;
+
+    /** Size (in bytes) of the data written to this region. */
+    boost::uint64_t dm_size;
+
+}; // class SpillFile::Region
+
+
+
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+SpillFile::SpillFile(const std::string& directory) :
+    dm_directory(directory),
+    dm_space()
+{
+    std::string path = directory + "/argonavis-cuda-XXXXXX";
+    std::vector<char> buffer(path.begin(), path.end());
+    buffer.push_back('\0');
+
+    int fd = mkstemp(&buffer[0]);
+
+    if (fd == -1)
+    {
+        raise<std::runtime_error>(
+            "Unable to create a spill file in %1% (%2%).",
+            directory, strerror(errno)
+            );
+    }
+
+    unlink(&buffer[0]);
+
+    dm_space.reset(new Space(fd));
+}
+
+
+
+//------------------------------------------------------------------------------
+// The file itself is closed once the last of its regions is released.
+//------------------------------------------------------------------------------
+SpillFile::~SpillFile()
+{
+}
+
+
+
+//------------------------------------------------------------------------------
+// Data is appended in place only when the given region contains exactly the
+// data's leading bytes. Another handle to the region may already have appended
+// other data to it, which must not be overwritten. A region replaced because
+// it was outgrown gets half again as much room as its data, so that data which
+// keeps growing is rewritten a bounded number of times overall.
+//------------------------------------------------------------------------------
+SpillFile::RegionHandle SpillFile::write(const RegionHandle& region,
+                                         const void* data, std::size_t size,
+                                         std::size_t unchanged)
+{
+    const char* bytes = static_cast<const char*>(data);
+
+    if (region && (region->dm_space == dm_space) &&
+        (region->dm_size == unchanged) && (unchanged <= size) &&
+        (size <= region->dm_capacity))
+    {
+        writeAt(region->dm_offset + unchanged,
+                bytes + unchanged, size - unchanged);
+        region->dm_size = size;
+        return region;
+    }
+
+    RegionHandle replacement(
+        new Region(dm_space, round(region ? (size + (size / 2)) : size))
+        );
+
+    writeAt(replacement->dm_offset, bytes, size);
+    replacement->dm_size = size;
+
+    return replacement;
+}
+
+
+
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+SpillFile::Mapping SpillFile::map(const RegionHandle& region,
+                                  std::size_t size) const
+{
+    static const boost::uint64_t kPageSize = sysconf(_SC_PAGESIZE);
+
+    boost::uint64_t offset = region->dm_offset;
+    boost::uint64_t begin = offset - (offset % kPageSize);
+    std::size_t length = static_cast<std::size_t>(offset - begin) + size;
+
+    void* address = mmap(
+        NULL, length, PROT_READ, MAP_SHARED, dm_space->dm_fd, begin
+        );
+
+    if (address == MAP_FAILED)
+    {
+        raise<std::runtime_error>(
+            "Unable to map the spill file in %1% (%2%).",
+            dm_directory, strerror(errno)
+            );
+    }
+
+    return Mapping(static_cast<const char*>(address) + (offset - begin),
+                   Unmapper(address, length, region));
+}
+
+
+
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+boost::uint64_t SpillFile::size() const
+{
+    boost::mutex::scoped_lock lock(dm_space->dm_mutex);
+    return dm_space->dm_size;
+}
+
+
+
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+void SpillFile::writeAt(boost::uint64_t offset,
+                        const char* data, std::size_t size)
+{
+    for (std::size_t n = 0; n < size;)
+    {
+        ssize_t written = pwrite(dm_space->dm_fd, data + n, size - n,
+                                 offset + n);
+
+        if (written <= 0)
+        {
+            if ((written == -1) && (errno == EINTR))
+            {
+                continue;
+            }
+
+            raise<std::runtime_error>(
+                "Unable to write to the spill file in %1% (%2%).",
+                dm_directory, strerror(errno)
+                );
+        }
+
+        n += written;
+    }
+}
@@ -0,0 +1,140 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2017 Argo Navis Technologies. All Rights Reserved.
+//
+// This library is free software; you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation; either version 2.1 of the License, or (at your option)
+// any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+// details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this library; if not, write to the Free Software Foundation, Inc.,
+// 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+////////////////////////////////////////////////////////////////////////////////
+
+/** @file Declaration of the SpillFile class. */
+
+#pragma once
+
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <cstddef>
+#include <string>
+
+namespace ArgoNavis { namespace CUDA { namespace Impl {
+
+    /**
+     * Scratch file to which data that doesn't fit within a data table's memory
+     * budget is spilled. The file is unlinked as soon as it is created, so it
+     * never outlives the process, and its data is only read back by mapping
+     * the regions that were written to it. The space of regions that are no
+     * longer used is reused for new regions, and is given back to the file
+     * system when found at the end of the file.
+     */
+    class SpillFile :
+        private boost::noncopyable
+    {
+
+    public:
+
+        /** Region of this file. Opaque to users of the file. */
+        class Region;
+
+        /**
+         * Type of handle (smart pointer) to a region of this file. The region
+         * is released for reuse when the last handle to it is gone, including
+         * those held by its mappings, which may be after the file itself is
+         * destroyed.
+         */
+        typedef boost::shared_ptr<Region> RegionHandle;
+
+        /**
+         * Type of handle (smart pointer) to a region of this file mapped into
+         * memory. The region is unmapped when the last handle to it is gone,
+         * which may be after the file itself is destroyed.
+         */
+        typedef boost::shared_ptr<const void> Mapping;
+
+        /**
+         * Construct a new, empty, spill file.
+         *
+         * @param directory    Directory in which to create the file.
+         *
+         * @throw std::runtime_error    The file couldn't be created.
+         */
+        SpillFile(const std::string& directory);
+
+        /** Destroy this spill file. */
+        ~SpillFile();
+
+        /**
+         * Write data to this file. When the given region already contains
+         * the leading bytes of the data, and nothing more, only the remaining
+         * bytes are written, appending them to that region if they fit within
+         * it. Otherwise all of the data is written to a new region, reusing
+         * released space where possible. New regions replacing a given region
+         * are allocated with room to grow, as their data usually does.
+         *
+         * @param region       Region previously written with the leading
+         *                     bytes of the data, or null if there is none.
+         * @param data         Data to be written.
+         * @param size         Size (in bytes) of that data.
+         * @param unchanged    Number of leading bytes of the data already
+         *                     written to the given region.
+         * @return             Region containing the data. Its offset within
+         *                     this file is always a multiple of eight bytes.
+         *
+         * @throw std::runtime_error    The data couldn't be written, leaving
+         *                              the given region unchanged.
+         */
+        RegionHandle write(const RegionHandle& region,
+                           const void* data, std::size_t size,
+                           std::size_t unchanged = 0);
+
+        /**
+         * Map the leading bytes of a region of this file into memory.
+         *
+         * @param region    Region to be mapped.
+         * @param size      Size (in bytes) to be mapped.
+         * @return          Read-only mapping of the region.
+         *
+         * @throw std::runtime_error    The region couldn't be mapped.
+         */
+        Mapping map(const RegionHandle& region, std::size_t size) const;
+
+        /**
+         * Get the size (in bytes) of this file. Includes the space of any
+         * released regions that hasn't been reused yet.
+         */
+        boost::uint64_t size() const;
+
+    private:
+
+        /** Space allocated within a spill file. */
+        struct Space;
+
+        /**
+         * Write data at the given offset within this file.
+         *
+         * @throw std::runtime_error    The data couldn't be written.
+         */
+        void writeAt(boost::uint64_t offset,
+                     const char* data, std::size_t size);
+
+        /** Directory containing this file. */
+        std::string dm_directory;
+
+        /**
+         * Space allocated within this file. Shared with its regions so that
+         * they can be released after this file is destroyed.
+         */
+        boost::shared_ptr<Space> dm_space;
+
+    }; // class SpillFile
+
+} } } // namespace ArgoNavis::CUDA::Impl
@@ -0,0 +1,168 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2017 Argo Navis Technologies. All Rights Reserved.
+//
+// This library is free software; you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation; either version 2.1 of the License, or (at your option)
+// any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+// details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this library; if not, write to the Free Software Foundation, Inc.,
+// 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+////////////////////////////////////////////////////////////////////////////////
+
+/** @file Declaration and definition of the SpillableColumn class. */
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "SpillFile.hpp"
+
+namespace ArgoNavis { namespace CUDA { namespace Impl {
+
+    /**
+     * Column of values that is either resident in memory or has been spilled
+     * to a spill file. A spilled column is read directly from its read-only
+     * mapping, so its pages are only brought into memory when they are read,
+     * and may be evicted again by the operating system. Modifying a spilled
+     * column copies it back into memory first. The spilled values are kept
+     * in the file for as long as they remain unmodified, so that only values
+     * appended since are written when the column is spilled again.
+     *
+     * @tparam T    Type of the values. Must be trivially copyable.
+     */
+    template <typename T>
+    class SpillableColumn
+    {
+
+    public:
+
+        /** Construct an empty, resident, column. */
+        SpillableColumn() :
+            dm_values(),
+            dm_region(),
+            dm_written(0),
+            dm_mapping()
+        {
+        }
+
+        /** Get a pointer to the values in this column. */
+        const T* data() const
+        {
+            if (dm_mapping)
+            {
+                return static_cast<const T*>(dm_mapping.get());
+            }
+
+            return dm_values.empty() ? NULL : &dm_values[0];
+        }
+
+        /** Is this column empty? */
+        bool empty() const
+        {
+            return size() == 0;
+        }
+
+        /** Get the number of bytes of this column resident in memory. */
+        std::size_t resident() const
+        {
+            return dm_values.capacity() * sizeof(T);
+        }
+
+        /** Restore this column into memory if it was spilled. */
+        void restore()
+        {
+            if (dm_mapping)
+            {
+                const T* values = data();
+                dm_values.assign(values, values + dm_written);
+                dm_mapping.reset();
+            }
+        }
+
+        /** Get the number of values in this column. */
+        std::size_t size() const
+        {
+            return dm_mapping ? dm_written : dm_values.size();
+        }
+
+        /**
+         * Spill this column to the given spill file and release its memory.
+         * Does nothing if the column is empty or was already spilled.
+         *
+         * @param file    Spill file to which to spill this column.
+         *
+         * @throw std::runtime_error    The column couldn't be spilled. It
+         *                              remains resident and unchanged.
+         */
+        void spill(SpillFile& file)
+        {
+            if (dm_mapping || dm_values.empty())
+            {
+                return;
+            }
+
+            std::size_t bytes = dm_values.size() * sizeof(T);
+
+            SpillFile::RegionHandle region = file.write(
+                dm_region, &dm_values[0], bytes, dm_written * sizeof(T)
+                );
+            dm_mapping = file.map(region, bytes);
+            dm_region = region;
+            dm_written = dm_values.size();
+
+            std::vector<T>().swap(dm_values);
+        }
+
+        /** Get the number of bytes of this column spilled to a file. */
+        std::size_t spilled() const
+        {
+            return dm_mapping ? (dm_written * sizeof(T)) : 0;
+        }
+
+        /**
+         * Get the values in this column for modification, restoring them into
+         * memory first if they were spilled. Only the values from the given
+         * index onwards may be modified, so that any values before it which
+         * were spilled needn't be written again.
+         */
+        std::vector<T>& values(std::size_t first = 0)
+        {
+            restore();
+
+            if (first < dm_written)
+            {
+                dm_region.reset();
+                dm_written = 0;
+            }
+
+            return dm_values;
+        }
+
+    private:
+
+        /** Values in this column when it is resident. */
+        std::vector<T> dm_values;
+
+        /** Region of the spill file containing the written values. */
+        SpillFile::RegionHandle dm_region;
+
+        /**
+         * Number of leading values in this column written to that region.
+         * These are all of the values when the column is spilled.
+         */
+        std::size_t dm_written;
+
+        /** Mapping of the written values when this column is spilled. */
+        SpillFile::Mapping dm_mapping;
+
+    }; // class SpillableColumn<T>
+
+} } } // namespace ArgoNavis::CUDA::Impl
@@ -0,0 +1,1847 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2017 Argo Navis Technologies. All Rights Reserved.
+//
+// This library is free software; you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation; either version 2.1 of the License, or (at your option)
+// any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+// details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this library; if not, write to the Free Software Foundation, Inc.,
+// 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+////////////////////////////////////////////////////////////////////////////////
+
+/** @file Unit tests for the ArgoNavis CUDA library. */
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_MODULE ArgoNavis-CUDA
+
+#include <boost/assign/list_of.hpp>
+#include <boost/bind.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_int_distribution.hpp>
+#include <boost/ref.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/version.hpp>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <KrellInstitute/Messages/Blob.h>
+#include <KrellInstitute/Messages/CUDA_data.h>
+#include <KrellInstitute/Messages/PerformanceData.hpp>
+
+#include <ArgoNavis/Base/BlobVisitor.hpp>
+#include <ArgoNavis/Base/StackTrace.hpp>
+#include <ArgoNavis/Base/ThreadName.hpp>
+#include <ArgoNavis/Base/Time.hpp>
+#include <ArgoNavis/Base/TimeInterval.hpp>
+
+#include <ArgoNavis/CUDA/DataTransfer.hpp>
+#include <ArgoNavis/CUDA/KernelExecution.hpp>
+#include <ArgoNavis/CUDA/PerformanceData.hpp>
+
+#include "BlobGenerator.hpp"
+#include "EventTable.hpp"
+#include "PeriodicSampleTable.hpp"
+#include "SpillFile.hpp"
+
+using namespace ArgoNavis::Base;
+using namespace ArgoNavis::CUDA;
+using namespace ArgoNavis::CUDA::Impl;
+
+
+
+/**
+ * Declare a benchmark test case. Benchmarks are disabled by default, and run
+ * only when selected explicitly (e.g. "--run_test='Benchmark*'"), where the
+ * Boost version supports test case decorators (1.59 and later). Older versions
+ * run them along with the tests.
+ */
+#if BOOST_VERSION >= 105900
+#define BENCHMARK_TEST_CASE(name) \
+    BOOST_AUTO_TEST_CASE(name, *boost::unit_test::disabled())
+#else
+#define BENCHMARK_TEST_CASE(name) BOOST_AUTO_TEST_CASE(name)
+#endif
+
+
+
+/** Anonymous namespace hiding implementation details. */
+namespace {
+
+    /** Name of the synthetic device. */
+    char kDeviceName[] = "Synthetic GPU";
+
+    /** Name of the synthetic kernel. */
+    char kFunctionName[] = "synthetic_kernel";
+
+    /** Name of the synthetic hardware performance counter. */
+    char kCounterName[] = "inst_executed";
+
+    /**
+     * Builder of a synthetic CBTF_cuda_data. The individual CUDA messages,
+     * the stack traces, and the periodic sample deltas are all owned by the
+     * builder, which is therefore not copyable.
+     */
+    class MessageBuilder
+    {
+
+    public:
+
+        /** Construct an empty message builder. */
+        MessageBuilder() :
+            dm_messages(),
+            dm_stack_traces(),
+            dm_deltas(),
+            dm_events()
+        {
+        }
+
+        /**
+         * Add a zero-initialized CUDA message of the given type. The returned
+         * reference is only valid until the next CUDA message is added.
+         */
+        CBTF_cuda_message& add(CUDA_MessageTypes type)
+        {
+            CBTF_cuda_message message;
+            memset(&message, 0, sizeof(CBTF_cuda_message));
+            message.type = type;
+            dm_messages.push_back(message);
+            return dm_messages.back();
+        }
+
+        /** Add a stack trace, returning the index of its first address. */
+        boost::uint32_t add(const StackTrace& trace)
+        {
+            boost::uint32_t index = dm_stack_traces.size();
+            for (StackTrace::const_iterator
+                     i = trace.begin(); i != trace.end(); ++i)
+            {
+                dm_stack_traces.push_back(*i);
+            }
+            dm_stack_traces.push_back(0);
+            return index;
+        }
+
+        /**
+         * Add a CUDA_PeriodicSamples containing the given deltas, using the
+         * same variable-length encoding as the CUDA collector.
+         */
+        void addPeriodicSamples(const std::vector<boost::uint64_t>& deltas)
+        {
+            static const int kAdditionalBytes[4] = { 0, 2, 3, 8 };
+
+            dm_deltas.push_back(std::vector<boost::uint8_t>());
+            std::vector<boost::uint8_t>& bytes = dm_deltas.back();
+
+            for (std::vector<boost::uint64_t>::const_iterator
+                     i = deltas.begin(); i != deltas.end(); ++i)
+            {
+                boost::uint8_t encoding = (*i < (1ULL << 6)) ? 0 :
+                    (*i < (1ULL << 22)) ? 1 : (*i < (1ULL << 30)) ? 2 : 3;
+                int n = kAdditionalBytes[encoding];
+
+                bytes.push_back((encoding << 6) | ((encoding < 3) ?
+                    static_cast<boost::uint8_t>(*i >> (8 * n)) & 0x3F : 0));
+                for (int j = n - 1; j >= 0; --j)
+                {
+                    bytes.push_back(static_cast<boost::uint8_t>(*i >> (8 * j)));
+                }
+            }
+
+            CUDA_PeriodicSamples& message =
+                add(::PeriodicSamples).CBTF_cuda_message_u.periodic_samples;
+            message.deltas.deltas_len = bytes.size();
+            message.deltas.deltas_val = &bytes[0];
+        }
+
+        /**
+         * Add a CUDA_SamplingConfig for the synthetic hardware performance
+         * counter with the given sampling interval.
+         */
+        void addSamplingConfig(boost::uint64_t interval)
+        {
+            CUDA_EventDescription event;
+            memset(&event, 0, sizeof(CUDA_EventDescription));
+            event.name = kCounterName;
+            dm_events.push_back(event);
+
+            CUDA_SamplingConfig& message =
+                add(SamplingConfig).CBTF_cuda_message_u.sampling_config;
+            message.interval = interval;
+            message.events.events_len = 1;
+            message.events.events_val = &dm_events.back();
+        }
+
+        /** Get the CBTF_cuda_data referencing this builder's contents. */
+        CBTF_cuda_data data()
+        {
+            CBTF_cuda_data data;
+            memset(&data, 0, sizeof(CBTF_cuda_data));
+            data.messages.messages_len = dm_messages.size();
+            data.messages.messages_val =
+                dm_messages.empty() ? NULL : &dm_messages[0];
+            data.stack_traces.stack_traces_len = dm_stack_traces.size();
+            data.stack_traces.stack_traces_val =
+                dm_stack_traces.empty() ? NULL : &dm_stack_traces[0];
+            return data;
+        }
+
+    private:
+
+        /** Prevent copying, which would leave dangling internal pointers. */
+        MessageBuilder(const MessageBuilder&);
+
+        /** Prevent assignment, which would leave dangling internal pointers. */
+        MessageBuilder& operator=(const MessageBuilder&);
+
+        /** Individual CUDA messages. */
+        std::vector<CBTF_cuda_message> dm_messages;
+
+        /** Stack traces referenced by those messages. */
+        std::vector<CBTF_Protocol_Address> dm_stack_traces;
+
+        /** Encoded periodic sample deltas referenced by those messages. */
+        std::deque<std::vector<boost::uint8_t> > dm_deltas;
+
+        /** Event descriptions referenced by those messages. */
+        std::deque<CUDA_EventDescription> dm_events;
+
+    }; // class MessageBuilder
+
+    /** Type of a list of synthetic messages and the threads applying them. */
+    typedef std::vector<
+        std::pair<ThreadName, boost::shared_ptr<MessageBuilder> >
+        > SyntheticMessages;
+
+    /**
+     * Generate synthetic messages for the given number of processes, spread
+     * over several hosts, each with the given number of threads. Every thread
+     * enqueues the given number of kernel executions and data transfers, and
+     * records as many periodic samples. Their completions are delivered by the
+     * next thread of the same process after all of the enqueues, and the
+     * messages for the different processes are interleaved, much as they are
+     * when arriving from a running experiment.
+     */
+    SyntheticMessages syntheticMessages(std::size_t processes,
+                                        std::size_t threads,
+                                        std::size_t events)
+    {
+        const std::size_t kProcessesPerHost = 16;
+
+        SyntheticMessages messages;
+
+        for (std::size_t p = 0; p < processes; ++p)
+        {
+            std::ostringstream host;
+            host << "node" << (p / kProcessesPerHost);
+
+            boost::uint64_t context = 0xC0000 + p;
+
+            for (std::size_t t = 0; t < threads; ++t)
+            {
+                ThreadName thread(host.str(), 1000 + p, t);
+                boost::shared_ptr<MessageBuilder> builder(new MessageBuilder());
+
+                if (t == 0)
+                {
+                    CUDA_DeviceInfo& device = builder->add(DeviceInfo).
+                        CBTF_cuda_message_u.device_info;
+                    device.device = p % 2;
+                    device.name = kDeviceName;
+
+                    CUDA_ContextInfo& info = builder->add(ContextInfo).
+                        CBTF_cuda_message_u.context_info;
+                    info.context = context;
+                    info.device = p % 2;
+                }
+
+                builder->addSamplingConfig(1000);
+
+                for (std::size_t e = 0; e < events; ++e)
+                {
+                    StackTrace trace;
+                    trace.push_back(Address(0x400000 + (e % 4)));
+                    trace.push_back(Address(0x500000 + t));
+                    trace.push_back(Address(0x600000 + (p % 8)));
+                    boost::uint32_t site = builder->add(trace);
+
+                    CUDA_EnqueueExec& exec = builder->add(EnqueueExec).
+                        CBTF_cuda_message_u.enqueue_exec;
+                    exec.id = (t * events) + e;
+                    exec.context = context;
+                    exec.time = (1000 * e) + (10 * t) + p + 1;
+                    exec.call_site = site;
+
+                    CUDA_EnqueueXfer& xfer = builder->add(EnqueueXfer).
+                        CBTF_cuda_message_u.enqueue_xfer;
+                    xfer.id = (t * events) + e;
+                    xfer.context = context;
+                    xfer.time = (1000 * e) + (10 * t) + p + 2;
+                    xfer.call_site = site;
+                }
+
+                std::vector<boost::uint64_t> deltas;
+                for (std::size_t e = 0; e < events; ++e)
+                {
+                    deltas.push_back((e == 0) ? (1ULL << 40) + p : 1000);
+                    deltas.push_back((e * e * 1000) + t);
+                }
+                builder->addPeriodicSamples(deltas);
+
+                messages.push_back(std::make_pair(thread, builder));
+            }
+        }
+
+        for (std::size_t p = 0; p < processes; ++p)
+        {
+            std::ostringstream host;
+            host << "node" << (p / kProcessesPerHost);
+
+            for (std::size_t t = 0; t < threads; ++t)
+            {
+                ThreadName thread(host.str(), 1000 + p, (t + 1) % threads);
+                boost::shared_ptr<MessageBuilder> builder(new MessageBuilder());
+
+                for (std::size_t e = 0; e < events; ++e)
+                {
+                    CUDA_CompletedExec& exec = builder->add(CompletedExec).
+                        CBTF_cuda_message_u.completed_exec;
+                    exec.id = (t * events) + e;
+                    exec.time_begin = (1000 * e) + (10 * t) + p + 3;
+                    exec.time_end = (1000 * e) + (10 * t) + p + 9;
+                    exec.function = kFunctionName;
+
+                    CUDA_CompletedXfer& xfer = builder->add(CompletedXfer).
+                        CBTF_cuda_message_u.completed_xfer;
+                    xfer.id = (t * events) + e;
+                    xfer.time_begin = (1000 * e) + (10 * t) + p + 4;
+                    xfer.time_end = (1000 * e) + (10 * t) + p + 8;
+                    xfer.size = 64 * (e + 1);
+                }
+
+                messages.push_back(std::make_pair(thread, builder));
+            }
+        }
+
+        return messages;
+    }
+
+    /** Apply the given synthetic messages to the given performance data. */
+    void apply(const SyntheticMessages& messages, PerformanceData& data)
+    {
+        for (SyntheticMessages::const_iterator
+                 i = messages.begin(); i != messages.end(); ++i)
+        {
+            data.apply(i->first, i->second->data());
+        }
+    }
+
+    /** Visitor used to accumulate the addresses. */
+    bool addAddress(const Address& address, std::vector<Address>& addresses)
+    {
+        addresses.push_back(address);
+        return true;
+    }
+
+    /**
+     * Visitor used to accumulate the contents of the blobs, terminating the
+     * visitation after the given number of blobs.
+     */
+    bool addBlob(const boost::shared_ptr<CBTF_Protocol_Blob>& blob,
+                 std::vector<std::string>& blobs, std::size_t max)
+    {
+        blobs.push_back(std::string(
+            reinterpret_cast<const char*>(blob->data.data_val),
+            blob->data.data_len
+            ));
+        return blobs.size() < max;
+    }
+
+    /** Visitor used to accumulate the kernel executions. */
+    bool addKernelExecution(const KernelExecution& exec,
+                            std::vector<KernelExecution>& executions)
+    {
+        executions.push_back(exec);
+        return true;
+    }
+
+    /**
+     * Add a kernel execution enqueue, at the given call site, to the given
+     * blob generator. The call site is added before the message referencing
+     * it, as is required by BlobGenerator::addSite(). The identifier of the
+     * kernel execution is set to the given identifier of the call site.
+     */
+    boost::uint32_t addSite(BlobGenerator& generator, const StackTrace& site,
+                            boost::uint32_t id)
+    {
+        boost::uint32_t call_site = generator.addSite(site);
+
+        CBTF_cuda_message* message = generator.addMessage();
+        memset(message, 0, sizeof(CBTF_cuda_message));
+        message->type = EnqueueExec;
+        message->CBTF_cuda_message_u.enqueue_exec.id = id;
+        message->CBTF_cuda_message_u.enqueue_exec.call_site = call_site;
+
+        return call_site;
+    }
+
+    /**
+     * Visitor used to check that the kernel execution enqueues within a blob
+     * reference the call sites identified by their identifiers.
+     */
+    bool checkBlob(const boost::shared_ptr<CBTF_Protocol_Blob>& blob,
+                   const std::vector<StackTrace>& sites, std::size_t& n)
+    {
+        std::pair<
+            boost::shared_ptr<CBTF_DataHeader>,
+            boost::shared_ptr<CBTF_cuda_data>
+            > unpacked = KrellInstitute::Messages::unpack<CBTF_cuda_data>(
+                blob, reinterpret_cast<xdrproc_t>(xdr_CBTF_cuda_data)
+                );
+
+        const CBTF_cuda_data& data = *unpacked.second;
+
+        for (u_int i = 0; i < data.messages.messages_len; ++i)
+        {
+            const CUDA_EnqueueExec& message =
+                data.messages.messages_val[i].CBTF_cuda_message_u.enqueue_exec;
+            const StackTrace& site = sites[message.id];
+
+            BOOST_REQUIRE(message.call_site + site.size() <
+                          data.stack_traces.stack_traces_len);
+
+            const CBTF_Protocol_Address* addresses =
+                &data.stack_traces.stack_traces_val[message.call_site];
+
+            for (std::size_t j = 0; j < site.size(); ++j)
+            {
+                BOOST_CHECK(site[j] == Address(addresses[j]));
+            }
+            BOOST_CHECK_EQUAL(addresses[site.size()], 0);
+
+            ++n;
+        }
+
+        return true;
+    }
+
+    /** Visitor used to count the blobs. */
+    bool countBlob(const boost::shared_ptr<CBTF_Protocol_Blob>& blob,
+                   std::size_t& n)
+    {
+        ++n;
+        return true;
+    }
+
+    /** Visitor used to count the kernel executions. */
+    bool countKernelExecution(const KernelExecution& exec, std::size_t& n)
+    {
+        ++n;
+        return true;
+    }
+
+    /** Visitor used to count the periodic samples. */
+    bool countPeriodicSample(const Time& time,
+                             const std::vector<boost::uint64_t>& values,
+                             std::size_t& n)
+    {
+        ++n;
+        return true;
+    }
+
+    /** Compare two kernel executions by their time interval. */
+    bool lessKernelExecution(const KernelExecution& lhs,
+                             const KernelExecution& rhs)
+    {
+        return TimeInterval(lhs.time_begin, lhs.time_end) <
+            TimeInterval(rhs.time_begin, rhs.time_end);
+    }
+
+    /**
+     * Check that the kernel executions found by a query of the given event
+     * table are exactly those, of the given added kernel executions, found by
+     * a linear scan. Kernel executions with identical time intervals are found
+     * in the order in which they were added.
+     */
+    void checkEventTable(const EventTable<KernelExecution>& table,
+                         const std::vector<KernelExecution>& added,
+                         const TimeInterval& interval)
+    {
+        std::vector<KernelExecution> expected;
+        for (std::vector<KernelExecution>::const_iterator
+                 i = added.begin(); i != added.end(); ++i)
+        {
+            if (TimeInterval(i->time_begin, i->time_end).intersects(interval))
+            {
+                expected.push_back(*i);
+            }
+        }
+        std::stable_sort(expected.begin(), expected.end(),
+                         lessKernelExecution);
+
+        std::vector<KernelExecution> visited;
+        table.visit(interval, boost::bind(
+            addKernelExecution, _1, boost::ref(visited)
+            ));
+
+        BOOST_REQUIRE_EQUAL(visited.size(), expected.size());
+        for (std::size_t i = 0; i < visited.size(); ++i)
+        {
+            BOOST_CHECK_EQUAL(visited[i].id, expected[i].id);
+            BOOST_CHECK_EQUAL(visited[i].function, expected[i].function);
+            BOOST_CHECK_EQUAL(visited[i].call_site, expected[i].call_site);
+            BOOST_CHECK(visited[i].time_begin == expected[i].time_begin);
+            BOOST_CHECK(visited[i].time_end == expected[i].time_end);
+        }
+    }
+
+    /**
+     * Generate the given number of synthetic, non-overlapping, kernel
+     * executions of the given number of classes. The executions are in time
+     * order except that each is swapped with a random one of its successors
+     * in a small window, as when the completions of several streams arrive
+     * interleaved.
+     */
+    std::vector<KernelExecution> kernelExecutions(std::size_t n,
+                                                  std::size_t classes)
+    {
+        const std::size_t kWindow = 16;
+
+        boost::random::mt19937 generator;
+        boost::random::uniform_int_distribution<std::size_t> swap(
+            0, kWindow - 1
+            );
+
+        std::vector<KernelExecution> executions;
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            std::ostringstream function;
+            function << "synthetic_kernel_" << (i % classes);
+
+            KernelExecution exec = KernelExecution();
+            exec.call_site = i % 3;
+            exec.id = i;
+            exec.time = 100 * i;
+            exec.time_begin = (100 * i) + 10;
+            exec.time_end = (100 * i) + 50 + (i % 40);
+            exec.function = function.str();
+            executions.push_back(exec);
+        }
+
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            std::swap(executions[i],
+                      executions[std::min(i + swap(generator), n - 1)]);
+        }
+
+        return executions;
+    }
+
+    /** Visitor used to accumulate the threads. */
+    bool addThread(const ThreadName& thread, std::vector<ThreadName>& threads)
+    {
+        threads.push_back(thread);
+        return true;
+    }
+
+    /** Visitor used to apply the blobs for a thread to performance data. */
+    bool applyBlob(const boost::shared_ptr<CBTF_Protocol_Blob>& blob,
+                   const ThreadName& thread, PerformanceData& data)
+    {
+        std::pair<
+            boost::shared_ptr<CBTF_DataHeader>,
+            boost::shared_ptr<CBTF_cuda_data>
+            > unpacked = KrellInstitute::Messages::unpack<CBTF_cuda_data>(
+                blob, reinterpret_cast<xdrproc_t>(xdr_CBTF_cuda_data)
+                );
+
+        data.apply(thread, *unpacked.second);
+        return true;
+    }
+
+    /** Describe a call site by its addresses rather than its index. */
+    void describeSite(const PerformanceData& data, std::size_t site,
+                      std::ostream& stream)
+    {
+        const StackTrace& trace = data.sites()[site];
+        for (StackTrace::const_iterator
+                 i = trace.begin(); i != trace.end(); ++i)
+        {
+            stream << "/" << static_cast<boost::uint64_t>(*i);
+        }
+    }
+
+    /** Visitor used to describe a data transfer. */
+    bool describeDataTransfer(const DataTransfer& xfer,
+                              const PerformanceData& data,
+                              std::ostream& stream)
+    {
+        stream << " X" << static_cast<boost::uint64_t>(xfer.time)
+               << "," << static_cast<boost::uint64_t>(xfer.time_begin)
+               << "," << static_cast<boost::uint64_t>(xfer.time_end)
+               << "," << xfer.size << ",";
+        describeSite(data, xfer.call_site, stream);
+        return true;
+    }
+
+    /** Visitor used to describe a kernel execution. */
+    bool describeKernelExecution(const KernelExecution& exec,
+                                 const PerformanceData& data,
+                                 std::ostream& stream)
+    {
+        stream << " K" << static_cast<boost::uint64_t>(exec.time)
+               << "," << static_cast<boost::uint64_t>(exec.time_begin)
+               << "," << static_cast<boost::uint64_t>(exec.time_end)
+               << "," << exec.function << ","
+               << data.devices()[exec.device].name << ",";
+        describeSite(data, exec.call_site, stream);
+        return true;
+    }
+
+    /** Visitor used to describe a periodic sample. */
+    bool describePeriodicSample(const Time& time,
+                                const std::vector<boost::uint64_t>& values,
+                                std::ostream& stream)
+    {
+        stream << " S" << static_cast<boost::uint64_t>(time);
+        for (std::vector<boost::uint64_t>::const_iterator
+                 i = values.begin(); i != values.end(); ++i)
+        {
+            stream << "," << *i;
+        }
+        return true;
+    }
+
+    /**
+     * Describe the given performance data. Sites, counters, and devices are
+     * described by their contents rather than their indices, so that the
+     * description doesn't depend on the order in which they were found.
+     */
+    std::string describe(const PerformanceData& data)
+    {
+        std::ostringstream stream;
+
+        stream << static_cast<boost::uint64_t>(data.interval().begin()) << "-"
+               << static_cast<boost::uint64_t>(data.interval().end())
+               << " " << data.sites().size() << " sites "
+               << data.counters().size() << " counters "
+               << data.devices().size() << " devices" << std::endl;
+
+        std::vector<ThreadName> threads;
+        data.visitThreads(boost::bind(addThread, _1, boost::ref(threads)));
+
+        for (std::vector<ThreadName>::const_iterator
+                 i = threads.begin(); i != threads.end(); ++i)
+        {
+            stream << std::string(*i);
+
+            data.visitDataTransfers(*i, data.interval(), boost::bind(
+                describeDataTransfer, _1, boost::cref(data), boost::ref(stream)
+                ));
+            data.visitKernelExecutions(*i, data.interval(), boost::bind(
+                describeKernelExecution, _1, boost::cref(data),
+                boost::ref(stream)
+                ));
+            data.visitPeriodicSamples(*i, data.interval(), boost::bind(
+                describePeriodicSample, _1, _2, boost::ref(stream)
+                ));
+
+            std::vector<boost::uint64_t> counts =
+                data.counts(*i, data.interval());
+            for (std::vector<boost::uint64_t>::const_iterator
+                     j = counts.begin(); j != counts.end(); ++j)
+            {
+                stream << " C" << *j;
+            }
+
+            stream << std::endl;
+        }
+
+        return stream.str();
+    }
+
+    /**
+     * Generate synthetic messages, for a single thread, recording the given
+     * number of periodic samples of the synthetic hardware performance counter.
+     * The samples are split across many messages, as they are when arriving
+     * from the CUDA collector, with the first sample in each message encoded
+     * relative to zero.
+     */
+    SyntheticMessages periodicSampleMessages(std::size_t samples)
+    {
+        const std::size_t kSamplesPerMessage = 1024;
+
+        ThreadName thread("node0", 1000, 0);
+        SyntheticMessages messages;
+
+        messages.push_back(std::make_pair(
+            thread, boost::shared_ptr<MessageBuilder>(new MessageBuilder())
+            ));
+        messages.back().second->addSamplingConfig(1000);
+
+        for (std::size_t s = 0; s < samples; s += kSamplesPerMessage)
+        {
+            std::vector<boost::uint64_t> deltas;
+            for (std::size_t i = s;
+                 i < std::min(s + kSamplesPerMessage, samples);
+                 ++i)
+            {
+                deltas.push_back((i == s) ? (1ULL << 40) + (1000 * i) : 1000);
+                deltas.push_back((i == s) ? (100 * i) : 100);
+            }
+
+            messages.push_back(std::make_pair(
+                thread, boost::shared_ptr<MessageBuilder>(new MessageBuilder())
+                ));
+            messages.back().second->addPeriodicSamples(deltas);
+        }
+
+        return messages;
+    }
+
+    /**
+     * Generate synthetic messages, for a single thread, enqueueing the given
+     * number of kernel executions at each of the given number of distinct call
+     * sites. Each of the call sites has the given depth, and differs from the
+     * others only in its innermost frame, as in an application with many CUDA
+     * launch points deep within a common call chain.
+     */
+    SyntheticMessages siteMessages(std::size_t sites, std::size_t depth,
+                                   std::size_t repeats,
+                                   boost::uint32_t first_id)
+    {
+        const std::size_t kSitesPerMessage = 1000;
+
+        ThreadName thread("node0", 1000, 0);
+        SyntheticMessages messages;
+
+        for (std::size_t s = 0; s < sites; ++s)
+        {
+            if ((s % kSitesPerMessage) == 0)
+            {
+                messages.push_back(std::make_pair(
+                    thread,
+                    boost::shared_ptr<MessageBuilder>(new MessageBuilder())
+                    ));
+            }
+
+            MessageBuilder& builder = *messages.back().second;
+
+            StackTrace trace;
+            trace.push_back(Address(0x400000 + s));
+            for (std::size_t d = 1; d < depth; ++d)
+            {
+                trace.push_back(Address(0x800000 + (16 * d)));
+            }
+            boost::uint32_t site = builder.add(trace);
+
+            for (std::size_t r = 0; r < repeats; ++r)
+            {
+                CUDA_EnqueueExec& exec = builder.add(EnqueueExec).
+                    CBTF_cuda_message_u.enqueue_exec;
+                exec.id = first_id + (s * repeats) + r;
+                exec.context = 0xC0000;
+                exec.time = 1000 + s;
+                exec.call_site = site;
+            }
+        }
+
+        return messages;
+    }
+
+    /**
+     * Scale the given benchmark problem size by the value of the optional
+     * ARGONAVIS_BENCHMARK_SCALE environment variable (if any). Allows the
+     * benchmarks to be shrunk for quick runs or grown for more stable timings.
+     */
+    std::size_t benchmarkSize(std::size_t size)
+    {
+        const char* scale = getenv("ARGONAVIS_BENCHMARK_SCALE");
+        if (scale == NULL)
+        {
+            return size;
+        }
+        return std::max<std::size_t>(
+            1, static_cast<std::size_t>(atof(scale) * size)
+            );
+    }
+
+    /** Seconds elapsed since the given time. */
+    double secondsSince(const Time& start)
+    {
+        return static_cast<double>(Time::Now() - start) / 1000000000.0;
+    }
+
+} // namespace <anonymous>
+
+
+
+/**
+ * Unit test for the BlobGenerator class.
+ */
+BOOST_AUTO_TEST_CASE(TestBlobGenerator)
+{
+    const std::size_t N = 20000;
+
+    // Generate call sites drawn from a small pool of addresses, so that many
+    // call sites are repeated, or are suffixes of other call sites
+
+    boost::random::mt19937 generator;
+    boost::random::uniform_int_distribution<std::size_t> depth(1, 12);
+    boost::random::uniform_int_distribution<boost::uint64_t> address(1, 8);
+
+    std::vector<StackTrace> sites;
+    for (std::size_t i = 0; i < N; ++i)
+    {
+        StackTrace site;
+        for (std::size_t j = 0, j_end = depth(generator); j < j_end; ++j)
+        {
+            site.push_back(Address(0x400000 + address(generator)));
+        }
+        sites.push_back(site);
+    }
+
+    std::size_t n = 0;
+    BlobVisitor visitor =
+        boost::bind(checkBlob, _1, boost::cref(sites), boost::ref(n));
+
+    ThreadName thread("node0", 1000, 0);
+
+    {
+        BlobGenerator blobs(
+            thread, visitor, TimeInterval(Time::TheBeginning(), Time::TheEnd())
+            );
+
+        for (boost::uint32_t i = 0; i < N; ++i)
+        {
+            addSite(blobs, sites[i], i);
+        }
+
+        StackTrace outer = boost::assign::list_of
+            (Address(0x500010))(Address(0x500020));
+        StackTrace inner = boost::assign::list_of
+            (Address(0x500000))(Address(0x500010))(Address(0x500020));
+
+        sites.push_back(inner);
+        sites.push_back(outer);
+
+        boost::uint32_t site = addSite(blobs, inner, N);
+        BOOST_CHECK_EQUAL(addSite(blobs, inner, N), site);
+        BOOST_CHECK_EQUAL(addSite(blobs, outer, N + 1), site + 1);
+    }
+
+    BOOST_CHECK_EQUAL(n, N + 3);
+}
+
+
+
+/**
+ * Unit test for the EventTable class.
+ */
+BOOST_AUTO_TEST_CASE(TestEventTable)
+{
+    const std::size_t N = 10000;
+    
+    std::vector<KernelExecution> executions = kernelExecutions(N, 7);
+
+    // Make some of the kernel executions long running, overlapping those
+    // following them, so that their intersection must be found even when
+    // they begin long before the queried time interval
+
+    for (std::size_t i = 0; i < N; i += 101)
+    {
+        executions[i].time_end += 1000 * (i % 50);
+    }
+
+    boost::random::mt19937 generator;
+    boost::random::uniform_int_distribution<boost::uint64_t> time(0, 100 * N);
+    boost::random::uniform_int_distribution<boost::uint64_t> width(0, 1000);
+
+    EventTable<KernelExecution> table;
+    std::vector<KernelExecution> added;
+    
+    for (std::size_t i = 0; i < N; ++i)
+    {
+        table.add(executions[i]);
+        added.push_back(executions[i]);
+
+        if ((i % 97) != 0)
+        {
+            continue;
+        }
+
+        // Query a random time interval, one ending at the beginning of an
+        // added event, or one beginning at the end of an added event
+
+        Time begin = time(generator);
+        const KernelExecution& event = added[time(generator) % added.size()];
+
+        TimeInterval interval =
+            ((i % 3) == 0) ?
+                TimeInterval(begin, begin + Time(width(generator))) :
+            ((i % 3) == 1) ?
+                TimeInterval(Time(event.time_begin) - Time(width(generator)),
+                             event.time_begin) :
+            TimeInterval(event.time_end,
+                         Time(event.time_end) + Time(width(generator)));
+
+        checkEventTable(table, added, interval);
+    }
+
+    std::vector<KernelExecution> classes;
+    table.visitClasses(boost::bind(
+        addKernelExecution, _1, boost::ref(classes)
+        ));
+    BOOST_REQUIRE_EQUAL(classes.size(), 21);
+    for (std::size_t i = 0; i < classes.size(); ++i)
+    {
+        BOOST_CHECK_EQUAL(classes[i].clas, i);
+    }
+
+    std::vector<KernelExecution> visited;
+    table.visit(TimeInterval(Time::TheBeginning(), Time::TheEnd()),
+                boost::bind(addKernelExecution, _1, boost::ref(visited)));
+    BOOST_REQUIRE_EQUAL(visited.size(), N);
+    for (std::size_t i = 0; i < N; ++i)
+    {
+        BOOST_CHECK_EQUAL(visited[i].id, i);
+        BOOST_CHECK_EQUAL(classes[visited[i].clas].function,
+                          visited[i].function);
+    }
+
+    EventTable<KernelExecution> copy(table);
+    std::size_t n = 0;
+    copy.visit(TimeInterval(Time::TheBeginning(), Time::TheEnd()),
+               boost::bind(countKernelExecution, _1, boost::ref(n)));
+    BOOST_CHECK_EQUAL(n, N);
+
+    SpillFile file(getSpillDirectory());
+
+    BOOST_CHECK_GT(copy.resident(), 0);
+    BOOST_CHECK_EQUAL(copy.spilled(), 0);
+    copy.spill(file);
+    BOOST_CHECK_EQUAL(copy.resident(), 0);
+    BOOST_CHECK_GT(copy.spilled(), 0);
+    BOOST_CHECK_EQUAL(file.size(), copy.spilled());
+
+    std::vector<KernelExecution> spilled;
+    copy.visit(TimeInterval(Time::TheBeginning(), Time::TheEnd()),
+               boost::bind(addKernelExecution, _1, boost::ref(spilled)));
+    BOOST_REQUIRE_EQUAL(spilled.size(), N);
+    for (std::size_t i = 0; i < N; ++i)
+    {
+        BOOST_CHECK_EQUAL(spilled[i].id, visited[i].id);
+        BOOST_CHECK_EQUAL(spilled[i].function, visited[i].function);
+    }
+
+    for (std::size_t i = 0; i < 100; ++i)
+    {
+        Time begin = time(generator);
+        checkEventTable(copy, executions,
+                        TimeInterval(begin, begin + Time(width(generator))));
+    }
+
+    copy.add(executions[0]);
+    BOOST_CHECK_GT(copy.resident(), 0);
+
+    n = 0;
+    copy.visit(TimeInterval(Time::TheBeginning(), Time::TheEnd()),
+               boost::bind(countKernelExecution, _1, boost::ref(n)));
+    BOOST_CHECK_EQUAL(n, N + 1);
+    BOOST_CHECK_EQUAL(copy.spilled(), 0);
+
+    // Check thousands of small tables of random sizes, and a few just around
+    // the powers of two, against a linear scan. The rightmost path of a tree
+    // refers to nodes beyond the end of the instances unless the table size is
+    // one less than a power of two. A few of the kernel executions are long
+    // running, and queries extend well past the last of them, so that every
+    // subtree's maximum ending time matters, including those on that path.
+
+    std::vector<std::size_t> sizes = boost::assign::list_of
+        (127)(128)(129)(255)(256)(257)(511)(512)(513)(1023)(1024)(1025);
+
+    boost::random::uniform_int_distribution<std::size_t> size(1, 300);
+    for (std::size_t i = 0; i < 2000; ++i)
+    {
+        sizes.push_back(size(generator));
+    }
+
+    boost::random::uniform_int_distribution<boost::uint64_t> start(0, 10000);
+    boost::random::uniform_int_distribution<boost::uint64_t> span(0, 10000);
+    boost::random::uniform_int_distribution<boost::uint64_t> query(0, 20000);
+    boost::random::uniform_int_distribution<boost::uint64_t> duration(0, 100);
+    boost::random::uniform_int_distribution<int> long_running(0, 20);
+
+    for (std::vector<std::size_t>::const_iterator
+             i = sizes.begin(); i != sizes.end(); ++i)
+    {
+        EventTable<KernelExecution> sized;
+        std::vector<KernelExecution> sized_added;
+
+        for (std::size_t j = 0; j < *i; ++j)
+        {
+            KernelExecution exec = KernelExecution();
+            exec.id = j;
+            exec.function = "synthetic_kernel";
+            exec.time_begin = start(generator);
+            exec.time_end = Time(exec.time_begin) + Time(
+                (long_running(generator) == 0) ?
+                    span(generator) : duration(generator)
+                );
+
+            sized.add(exec);
+            sized_added.push_back(exec);
+        }
+
+        for (std::size_t j = 0; j < 10; ++j)
+        {
+            Time begin = query(generator);
+            TimeInterval interval(begin, begin + Time(duration(generator)));
+            checkEventTable(sized, sized_added, interval);
+        }
+    }
+}
+
+
+
+/**
+ * Unit test for the PeriodicSampleTable class.
+ */
+BOOST_AUTO_TEST_CASE(TestPeriodicSampleTable)
+{
+    const std::size_t N = 10000;
+    const std::size_t kCounters = 3;
+    const std::size_t kWindow = 16;
+
+    boost::random::mt19937 generator;
+    boost::random::uniform_int_distribution<std::size_t> swap(0, kWindow - 1);
+
+    // Generate samples that are in time order except that each is swapped
+    // with a random one of its successors in a small window, and that every
+    // tenth sample repeats the time of an earlier one
+
+    std::vector<boost::uint64_t> times;
+    for (std::size_t i = 0; i < N; ++i)
+    {
+        times.push_back(1000 + (((i % 10) == 9) ? (100 * (i - 5)) : (100 * i)));
+    }
+    for (std::size_t i = 0; i < N; ++i)
+    {
+        std::swap(times[i], times[std::min(i + swap(generator), N - 1)]);
+    }
+
+    PeriodicSampleTable table(kCounters);
+    std::map<boost::uint64_t, std::vector<boost::uint64_t> > expected;
+
+    BOOST_CHECK(table.empty());
+
+    std::size_t min = 0, max = 0;
+    BOOST_CHECK(!table.find(
+        TimeInterval(Time::TheBeginning(), Time::TheEnd()), min, max
+        ));
+
+    for (std::size_t i = 0; i < N; ++i)
+    {
+        std::vector<boost::uint64_t> values;
+        for (std::size_t j = 0; j < kCounters; ++j)
+        {
+            values.push_back((kCounters * i) + j);
+        }
+
+        table.add(times[i], &values[0]);
+        expected.insert(std::make_pair(times[i], values));
+    }
+
+    BOOST_CHECK_EQUAL(table.counters(), kCounters);
+    BOOST_REQUIRE_EQUAL(table.size(), expected.size());
+
+    std::size_t n = 0;
+    for (std::map<boost::uint64_t, std::vector<boost::uint64_t> >::
+             const_iterator i = expected.begin(); i != expected.end(); ++i, ++n)
+    {
+        BOOST_CHECK_EQUAL(table.time(n), i->first);
+        BOOST_CHECK(std::equal(i->second.begin(), i->second.end(),
+                               table.values(n)));
+    }
+
+    BOOST_CHECK(!table.find(TimeInterval(0, 999), min, max));
+    BOOST_CHECK(!table.find(TimeInterval(100 * N + 1000, Time::TheEnd()),
+                            min, max));
+
+    // Query random time intervals, and ones aligned with the sample times,
+    // checking that the smallest enclosing range of samples is found
+
+    boost::random::uniform_int_distribution<boost::uint64_t> time(
+        0, 100 * N + 2000
+        );
+    boost::random::uniform_int_distribution<std::size_t> sample(0, N - 1);
+
+    for (std::size_t i = 0; i < 1000; ++i)
+    {
+        boost::uint64_t begin = ((i % 2) == 0) ?
+            time(generator) : table.time(sample(generator) % table.size());
+        boost::uint64_t end = begin + ((i % 3) * time(generator) / 100);
+
+        TimeInterval interval(begin, end);
+        TimeInterval clamped = interval &
+            TimeInterval(table.time(0), table.time(table.size() - 1));
+
+        if (clamped.empty())
+        {
+            BOOST_CHECK(!table.find(interval, min, max));
+            continue;
+        }
+
+        BOOST_REQUIRE(table.find(interval, min, max));
+        BOOST_REQUIRE(min <= max);
+        BOOST_REQUIRE(max < table.size());
+        BOOST_CHECK(Time(table.time(min)) <= clamped.begin());
+        BOOST_CHECK((min + 1 == table.size()) ||
+                    (clamped.begin() < Time(table.time(min + 1))));
+        BOOST_CHECK(Time(table.time(max)) >= clamped.end());
+        BOOST_CHECK((max == 0) ||
+                    (Time(table.time(max - 1)) < clamped.end()));
+    }
+
+    PeriodicSampleTable none;
+    none.add(1000, NULL);
+    none.add(2000, NULL);
+    BOOST_CHECK_EQUAL(none.counters(), 0);
+    BOOST_CHECK_EQUAL(none.size(), 2);
+
+    PeriodicSampleTable spilled(table);
+    SpillFile file(getSpillDirectory());
+
+    spilled.spill(file);
+    BOOST_CHECK_EQUAL(spilled.resident(), 0);
+    BOOST_CHECK_EQUAL(spilled.spilled(),
+                      table.size() * (kCounters + 1) * sizeof(boost::uint64_t));
+    BOOST_REQUIRE_EQUAL(spilled.size(), table.size());
+
+    for (std::size_t i = 0; i < table.size(); ++i)
+    {
+        BOOST_CHECK_EQUAL(spilled.time(i), table.time(i));
+        BOOST_CHECK(std::equal(table.values(i), table.values(i) + kCounters,
+                               spilled.values(i)));
+    }
+
+    for (std::size_t i = 0; i < 100; ++i)
+    {
+        boost::uint64_t begin = time(generator);
+        TimeInterval interval(begin, begin + (time(generator) / 100));
+
+        std::size_t spilled_min = 0, spilled_max = 0;
+        BOOST_CHECK_EQUAL(spilled.find(interval, spilled_min, spilled_max),
+                          table.find(interval, min, max));
+        BOOST_CHECK_EQUAL(spilled_min, min);
+        BOOST_CHECK_EQUAL(spilled_max, max);
+    }
+
+    std::vector<boost::uint64_t> values(kCounters, 7);
+    spilled.add(100 * N + 5000, &values[0]);
+    BOOST_CHECK_EQUAL(spilled.size(), table.size() + 1);
+    BOOST_CHECK_GT(spilled.resident(), 0);
+    BOOST_CHECK_EQUAL(spilled.spilled(), 0);
+
+    // Spilling the grown table relocates its columns, with room to grow, and
+    // releases the space of the original ones. Samples appended later are
+    // written after the relocated ones, a copy of the original table reuses
+    // the released space, and the relocated columns' space is given back to
+    // the file system once they are destroyed.
+
+    boost::uint64_t original_size = file.size();
+    spilled.spill(file);
+    boost::uint64_t relocated_size = file.size();
+    BOOST_CHECK_GT(relocated_size, original_size);
+
+    spilled.add(100 * N + 6000, &values[0]);
+    spilled.spill(file);
+    BOOST_CHECK_EQUAL(spilled.resident(), 0);
+    BOOST_CHECK_EQUAL(file.size(), relocated_size);
+
+    BOOST_REQUIRE_EQUAL(spilled.size(), table.size() + 2);
+    for (std::size_t i = 0; i < table.size(); ++i)
+    {
+        BOOST_CHECK_EQUAL(spilled.time(i), table.time(i));
+        BOOST_CHECK(std::equal(table.values(i), table.values(i) + kCounters,
+                               spilled.values(i)));
+    }
+    BOOST_CHECK_EQUAL(spilled.time(table.size() + 1), 100 * N + 6000);
+    BOOST_CHECK(std::equal(values.begin(), values.end(),
+                           spilled.values(table.size() + 1)));
+
+    PeriodicSampleTable reused(table);
+    reused.spill(file);
+    BOOST_CHECK_EQUAL(reused.resident(), 0);
+    BOOST_CHECK_EQUAL(file.size(), relocated_size);
+
+    spilled = PeriodicSampleTable();
+    BOOST_CHECK_EQUAL(file.size(), original_size);
+
+    BOOST_REQUIRE_EQUAL(reused.size(), table.size());
+    for (std::size_t i = 0; i < table.size(); ++i)
+    {
+        BOOST_CHECK_EQUAL(reused.time(i), table.time(i));
+        BOOST_CHECK(std::equal(table.values(i), table.values(i) + kCounters,
+                               reused.values(i)));
+    }
+}
+
+
+
+/**
+ * Unit test for the PerformanceData class.
+ */
+BOOST_AUTO_TEST_CASE(TestPerformanceData)
+{
+    SyntheticMessages messages = syntheticMessages(20, 4, 8);
+
+    BOOST_CHECK_EQUAL(getIngestionThreadCount(), 1);
+    PerformanceData serial;
+    apply(messages, serial);
+
+    std::string expected = describe(serial);
+    BOOST_CHECK_EQUAL(serial.sites().size(), 4 * 4 * 8);
+    BOOST_CHECK_EQUAL(serial.counters().size(), 1);
+    BOOST_CHECK_EQUAL(serial.devices().size(), 4);
+
+    for (unsigned int n = 2; n <= 5; ++n)
+    {
+        setIngestionThreadCount(n);
+        BOOST_CHECK_EQUAL(getIngestionThreadCount(), n);
+        PerformanceData concurrent;
+        setIngestionThreadCount(1);
+
+        apply(messages, concurrent);
+        BOOST_CHECK_EQUAL(describe(concurrent), expected);
+    }
+
+    setIngestionThreadCount(0);
+    BOOST_CHECK_GE(getIngestionThreadCount(), 1);
+    setIngestionThreadCount(1);
+
+    SyntheticMessages many = syntheticMessages(160, 4, 8);
+
+    PerformanceData unbudgeted;
+    apply(many, unbudgeted);
+    BOOST_CHECK_GT(unbudgeted.residentBytes(), 0);
+    BOOST_CHECK_EQUAL(unbudgeted.spilledBytes(), 0);
+
+    BOOST_CHECK_EQUAL(getMemoryBudget(), 0);
+    BOOST_CHECK_EQUAL(getSpillDirectory(), "/tmp");
+    setMemoryBudget(unbudgeted.residentBytes() / 4);
+    PerformanceData budgeted;
+    setMemoryBudget(0);
+
+    apply(many, budgeted);
+    BOOST_CHECK_GT(budgeted.spilledBytes(), 0);
+    BOOST_CHECK_LT(budgeted.residentBytes(), unbudgeted.residentBytes());
+    BOOST_CHECK_EQUAL(describe(budgeted), describe(unbudgeted));
+
+    std::vector<std::string> budgeted_blobs, unbudgeted_blobs;
+    budgeted.visitBlobs(boost::bind(
+        addBlob, _1, boost::ref(budgeted_blobs), std::size_t(-1)
+        ));
+    unbudgeted.visitBlobs(boost::bind(
+        addBlob, _1, boost::ref(unbudgeted_blobs), std::size_t(-1)
+        ));
+    BOOST_CHECK(budgeted_blobs == unbudgeted_blobs);
+
+    std::vector<ThreadName> threads;
+    serial.visitThreads(boost::bind(addThread, _1, boost::ref(threads)));
+    BOOST_REQUIRE_EQUAL(threads.size(), 20 * 4);
+
+    std::vector<std::string> expected_blobs;
+    for (std::vector<ThreadName>::const_iterator
+             i = threads.begin(); i != threads.end(); ++i)
+    {
+        serial.visitBlobs(*i, boost::bind(
+            addBlob, _1, boost::ref(expected_blobs), std::size_t(-1)
+            ));
+    }
+    BOOST_REQUIRE_GE(expected_blobs.size(), threads.size());
+
+    for (unsigned int n = 0; n <= 4; ++n)
+    {
+        std::vector<std::string> blobs;
+        serial.visitBlobs(boost::bind(
+            addBlob, _1, boost::ref(blobs), std::size_t(-1)
+            ), n);
+        BOOST_CHECK(blobs == expected_blobs);
+
+        std::vector<std::string> first_blobs;
+        serial.visitBlobs(boost::bind(
+            addBlob, _1, boost::ref(first_blobs), 5
+            ), n);
+        BOOST_REQUIRE_EQUAL(first_blobs.size(), 5);
+        BOOST_CHECK(std::equal(first_blobs.begin(), first_blobs.end(),
+                               expected_blobs.begin()));
+    }
+
+    PerformanceData discarding;
+    apply(messages, discarding);
+
+    std::vector<std::string> discarded_blobs, kept_blobs;
+    for (std::vector<ThreadName>::const_iterator
+             i = threads.begin(); i != threads.end(); ++i)
+    {
+        serial.visitBlobs(*i, boost::bind(
+            addBlob, _1, boost::ref((i->pid() == 1003) ?
+                                    discarded_blobs : kept_blobs),
+            std::size_t(-1)
+            ));
+    }
+    BOOST_REQUIRE(!discarded_blobs.empty());
+
+    std::vector<std::string> blobs;
+    discarding.discard(ThreadName("node0", 1003), boost::bind(
+        addBlob, _1, boost::ref(blobs), std::size_t(-1)
+        ));
+    BOOST_CHECK(blobs == discarded_blobs);
+
+    std::vector<ThreadName> kept_threads;
+    discarding.visitThreads(
+        boost::bind(addThread, _1, boost::ref(kept_threads))
+        );
+    BOOST_CHECK_EQUAL(kept_threads.size(), threads.size() - 4);
+
+    blobs.clear();
+    discarding.visitBlobs(boost::bind(
+        addBlob, _1, boost::ref(blobs), std::size_t(-1)
+        ), 2);
+    BOOST_CHECK(blobs == kept_blobs);
+
+    SyntheticMessages partial = syntheticMessages(1, 2, 1);
+    BOOST_REQUIRE_EQUAL(partial.size(), 4);
+
+    PerformanceData pending;
+    pending.apply(partial[0].first, partial[0].second->data());
+    pending.apply(partial[1].first, partial[1].second->data());
+    
+    blobs.clear();
+    pending.discard(partial[0].first, boost::bind(
+        addBlob, _1, boost::ref(blobs), std::size_t(-1)
+        ));
+    BOOST_CHECK(blobs.empty());
+
+    kept_threads.clear();
+    pending.visitThreads(boost::bind(addThread, _1, boost::ref(kept_threads)));
+    BOOST_CHECK_EQUAL(kept_threads.size(), 2);
+
+    pending.apply(partial[2].first, partial[2].second->data());
+    pending.apply(partial[3].first, partial[3].second->data());
+    pending.discard(partial[0].first, boost::bind(
+        addBlob, _1, boost::ref(blobs), std::size_t(-1)
+        ));
+    BOOST_CHECK_GE(blobs.size(), 2);
+
+    kept_threads.clear();
+    pending.visitThreads(boost::bind(addThread, _1, boost::ref(kept_threads)));
+    BOOST_CHECK(kept_threads.empty());
+
+    MessageBuilder late_samples;
+    late_samples.addPeriodicSamples(std::vector<boost::uint64_t>(2, 5000));
+    pending.apply(partial[1].first, late_samples.data());
+    pending.visitThreads(boost::bind(addThread, _1, boost::ref(kept_threads)));
+    BOOST_REQUIRE_EQUAL(kept_threads.size(), 1);
+    BOOST_CHECK(kept_threads[0] == partial[1].first);
+
+    std::size_t late_sample_count = 0;
+    pending.visitPeriodicSamples(
+        partial[1].first, pending.interval(), boost::bind(
+            countPeriodicSample, _1, _2, boost::ref(late_sample_count)
+            )
+        );
+    BOOST_CHECK_EQUAL(late_sample_count, 1);
+
+    ThreadName revived_thread("node0", 2000, 0);
+    StackTrace revived_site;
+    revived_site.push_back(Address(0x400000));
+
+    MessageBuilder early;
+    CUDA_DeviceInfo& device =
+        early.add(DeviceInfo).CBTF_cuda_message_u.device_info;
+    device.name = kDeviceName;
+    early.add(ContextInfo).CBTF_cuda_message_u.context_info.context = 0xC0000;
+    early.addSamplingConfig(1000);
+    CUDA_ExecClass& early_class =
+        early.add(ExecClass).CBTF_cuda_message_u.exec_class;
+    early_class.clas = 7;
+    early_class.context = 0xC0000;
+    early_class.function = kFunctionName;
+    early_class.call_site = early.add(revived_site);
+    CUDA_ExecInstance& early_instance =
+        early.add(ExecInstance).CBTF_cuda_message_u.exec_instance;
+    early_instance.clas = 7;
+    early_instance.time = 10;
+    early_instance.time_begin = 11;
+    early_instance.time_end = 19;
+    early.addPeriodicSamples(std::vector<boost::uint64_t>(4, 100));
+
+    MessageBuilder late;
+    CUDA_ExecInstance& late_instance =
+        late.add(ExecInstance).CBTF_cuda_message_u.exec_instance;
+    late_instance.clas = 7;
+    late_instance.time = 1000;
+    late_instance.time_begin = 1001;
+    late_instance.time_end = 1009;
+    late.addPeriodicSamples(std::vector<boost::uint64_t>(2, 2000));
+
+    PerformanceData revived;
+    revived.apply(revived_thread, early.data());
+    blobs.clear();
+    revived.discard(revived_thread, boost::bind(
+        addBlob, _1, boost::ref(blobs), std::size_t(-1)
+        ));
+    BOOST_CHECK(!blobs.empty());
+
+    BOOST_REQUIRE_NO_THROW(revived.apply(revived_thread, late.data()));
+    kept_threads.clear();
+    revived.visitThreads(boost::bind(addThread, _1, boost::ref(kept_threads)));
+    BOOST_REQUIRE_EQUAL(kept_threads.size(), 1);
+    BOOST_CHECK(kept_threads[0] == revived_thread);
+
+    PerformanceData replayed;
+    revived.discard(revived_thread, boost::bind(
+        applyBlob, _1, boost::cref(revived_thread), boost::ref(replayed)
+        ));
+
+    kept_threads.clear();
+    revived.visitThreads(boost::bind(addThread, _1, boost::ref(kept_threads)));
+    BOOST_CHECK(kept_threads.empty());
+
+    std::vector<KernelExecution> replayed_executions;
+    replayed.visitKernelExecutions(
+        revived_thread, replayed.interval(), boost::bind(
+            addKernelExecution, _1, boost::ref(replayed_executions)
+            )
+        );
+    BOOST_REQUIRE_EQUAL(replayed_executions.size(), 1);
+    BOOST_CHECK_EQUAL(replayed_executions[0].function, kFunctionName);
+    BOOST_CHECK(replayed_executions[0].time_begin == Time(1001));
+    BOOST_CHECK(replayed_executions[0].time_end == Time(1009));
+
+    late_sample_count = 0;
+    replayed.visitPeriodicSamples(
+        revived_thread, replayed.interval(), boost::bind(
+            countPeriodicSample, _1, _2, boost::ref(late_sample_count)
+            )
+        );
+    BOOST_CHECK_EQUAL(late_sample_count, 1);
+
+    ThreadName thread("node0", 1000, 0);
+    MessageBuilder invalid;
+    invalid.addSamplingConfig(1000);
+    invalid.addSamplingConfig(1000);
+
+    PerformanceData invalid_serial;
+    BOOST_CHECK_THROW(invalid_serial.apply(thread, invalid.data()),
+                      std::runtime_error);
+
+    setIngestionThreadCount(2);
+    PerformanceData invalid_concurrent;
+    setIngestionThreadCount(1);
+
+    BOOST_CHECK_NO_THROW(invalid_concurrent.apply(thread, invalid.data()));
+    BOOST_CHECK_THROW(invalid_concurrent.interval(), std::runtime_error);
+    BOOST_CHECK_NO_THROW(invalid_concurrent.interval());
+
+    StackTrace outer = boost::assign::list_of
+        (Address(0x400010))(Address(0x500020));
+    StackTrace inner = boost::assign::list_of
+        (Address(0x400010))(Address(0x500020))(Address(0x600030));
+
+    PerformanceData with_sites;
+
+    for (boost::uint32_t i = 0; i < 4; ++i)
+    {
+        MessageBuilder sites;
+        CUDA_EnqueueExec& exec =
+            sites.add(EnqueueExec).CBTF_cuda_message_u.enqueue_exec;
+        exec.id = i;
+        exec.call_site = sites.add((i % 2) ? outer : inner);
+        with_sites.apply(thread, sites.data());
+    }
+
+    BOOST_REQUIRE_EQUAL(with_sites.sites().size(), 2);
+    BOOST_CHECK(with_sites.sites()[0] == inner);
+    BOOST_CHECK(with_sites.sites()[1] == outer);
+
+    MessageBuilder repeated;
+    for (boost::uint32_t i = 0, site = repeated.add(inner); i < 4; ++i)
+    {
+        repeated.add(EnqueueExec).CBTF_cuda_message_u.enqueue_exec.call_site =
+            site;
+    }
+    repeated.add(EnqueueXfer).CBTF_cuda_message_u.enqueue_xfer.call_site =
+        repeated.add(outer);
+    repeated.add(ExecClass).CBTF_cuda_message_u.exec_class.call_site =
+        repeated.add(inner);
+    repeated.add(XferClass).CBTF_cuda_message_u.xfer_class.call_site =
+        repeated.add(outer);
+
+    std::vector<Address> pcs;
+    PerformanceData::visitPCs(
+        repeated.data(), boost::bind(addAddress, _1, boost::ref(pcs))
+        );
+    BOOST_CHECK_EQUAL(pcs.size(), 5 * inner.size() + 2 * outer.size());
+}
+
+
+
+/**
+ * Benchmark for the BlobGenerator class. Adds hundreds of thousands of
+ * distinct, deep, call sites, each referenced by two messages, as when
+ * regenerating the blobs for a thread with many distinct call sites.
+ */
+BENCHMARK_TEST_CASE(BenchmarkBlobGenerator)
+{
+    const std::size_t kDepth = 8;
+    const std::size_t N = benchmarkSize(1 << 18);
+
+    std::vector<StackTrace> sites;
+    for (std::size_t i = 0; i < N; ++i)
+    {
+        StackTrace site;
+        site.push_back(Address(0x400000 + i));
+        for (std::size_t d = 1; d < kDepth; ++d)
+        {
+            site.push_back(Address(0x800000 + (16 * d)));
+        }
+        sites.push_back(site);
+    }
+
+    std::size_t blobs = 0;
+    BlobVisitor visitor = boost::bind(countBlob, _1, boost::ref(blobs));
+
+    ThreadName thread("node0", 1000, 0);
+
+    Time start = Time::Now();
+    {
+        BlobGenerator generator(
+            thread, visitor, TimeInterval(Time::TheBeginning(), Time::TheEnd())
+            );
+
+        for (boost::uint32_t i = 0; i < N; ++i)
+        {
+            addSite(generator, sites[i], i);
+            addSite(generator, sites[i], i);
+        }
+    }
+    double elapsed = secondsSince(start);
+
+    BOOST_CHECK_GT(blobs, 0);
+
+    BOOST_TEST_MESSAGE(
+        "BenchmarkBlobGenerator: " << N << " sites of depth " << kDepth
+        << ", " << blobs << " blobs: " << elapsed << " s ("
+        << (1000000000.0 * elapsed / N) << " ns/site)"
+        );
+}
+
+
+
+/**
+ * Benchmark for the EventTable class. Adds millions of small kernel
+ * executions, mostly in time order, and then visits all of them, followed by
+ * many narrow time intervals.
+ */
+BENCHMARK_TEST_CASE(BenchmarkEventTable)
+{
+    const std::size_t N = benchmarkSize(1 << 21);
+    const std::size_t kClasses = 64;
+    const std::size_t kQueries = 10000;
+
+    std::vector<KernelExecution> executions = kernelExecutions(N, kClasses);
+
+    EventTable<KernelExecution> table;
+
+    Time start = Time::Now();
+    for (std::vector<KernelExecution>::const_iterator
+             i = executions.begin(); i != executions.end(); ++i)
+    {
+        table.add(*i);
+    }
+    double add_time = secondsSince(start);
+
+    std::size_t n = 0;
+    start = Time::Now();
+    table.visit(TimeInterval(Time::TheBeginning(), Time::TheEnd()),
+                boost::bind(countKernelExecution, _1, boost::ref(n)));
+    double first_time = secondsSince(start);
+
+    BOOST_CHECK_EQUAL(n, N);
+
+    n = 0;
+    start = Time::Now();
+    table.visit(TimeInterval(Time::TheBeginning(), Time::TheEnd()),
+                boost::bind(countKernelExecution, _1, boost::ref(n)));
+    double visit_time = secondsSince(start);
+
+    BOOST_CHECK_EQUAL(n, N);
+
+    boost::random::mt19937 generator;
+    boost::random::uniform_int_distribution<boost::uint64_t> time(0, 100 * N);
+
+    n = 0;
+    start = Time::Now();
+    for (std::size_t i = 0; i < kQueries; ++i)
+    {
+        Time begin = time(generator);
+        table.visit(TimeInterval(begin, begin + 1000),
+                    boost::bind(countKernelExecution, _1, boost::ref(n)));
+    }
+    double query_time = secondsSince(start);
+
+    BOOST_TEST_MESSAGE(
+        "BenchmarkEventTable: " << N << " kernel executions of " << kClasses
+        << " classes: add " << (1000000000.0 * add_time / N)
+        << " ns/event, first visit " << (1000000000.0 * first_time / N)
+        << " ns/event, visit " << (1000000000.0 * visit_time / N)
+        << " ns/event, " << kQueries << " narrow queries ("
+        << n << " events) " << query_time << " s"
+        );
+}
+
+
+
+/**
+ * Benchmark for the concurrent ingestion of performance data. Replays the
+ * synthetic messages for thousands of threads, timing the application of
+ * all of them, including the final wait for their processing to complete,
+ * for several ingestion thread counts.
+ */
+BENCHMARK_TEST_CASE(BenchmarkPerformanceData)
+{
+    const std::size_t kThreadsPerProcess = 8;
+    const std::size_t kEventsPerThread = 32;
+    const std::size_t N = benchmarkSize(512);
+
+    SyntheticMessages messages =
+        syntheticMessages(N, kThreadsPerProcess, kEventsPerThread);
+
+    double serial = 0.0;
+
+    for (unsigned int n = 1; n <= 8; n *= 2)
+    {
+        setIngestionThreadCount(n);
+        PerformanceData data;
+        setIngestionThreadCount(1);
+
+        Time start = Time::Now();
+        apply(messages, data);
+        data.interval();
+        double elapsed = secondsSince(start);
+
+        if (n == 1)
+        {
+            serial = elapsed;
+        }
+
+        std::vector<ThreadName> threads;
+        data.visitThreads(boost::bind(addThread, _1, boost::ref(threads)));
+        BOOST_CHECK_EQUAL(threads.size(), N * kThreadsPerProcess);
+
+        BOOST_TEST_MESSAGE(
+            "BenchmarkPerformanceData: " << threads.size() << " threads, "
+            << messages.size() << " messages, " << n << " ingestion threads: "
+            << elapsed << " s (" << (messages.size() / elapsed)
+            << " messages/s, " << (serial / elapsed) << "x serial)"
+            );
+    }
+}
+
+
+
+/**
+ * Benchmark for the regeneration of performance data blobs. Replays the
+ * synthetic messages for thousands of threads, and then times the generation
+ * and (in-order) visitation of all of their blobs for several thread counts.
+ */
+BENCHMARK_TEST_CASE(BenchmarkPerformanceDataBlobs)
+{
+    const std::size_t kThreadsPerProcess = 8;
+    const std::size_t kEventsPerThread = 32;
+    const std::size_t N = benchmarkSize(512);
+
+    SyntheticMessages messages =
+        syntheticMessages(N, kThreadsPerProcess, kEventsPerThread);
+
+    PerformanceData data;
+    apply(messages, data);
+
+    double serial = 0.0;
+
+    for (unsigned int n = 1; n <= 8; n *= 2)
+    {
+        std::size_t blobs = 0;
+
+        Time start = Time::Now();
+        data.visitBlobs(boost::bind(countBlob, _1, boost::ref(blobs)), n);
+        double elapsed = secondsSince(start);
+
+        if (n == 1)
+        {
+            serial = elapsed;
+        }
+
+        BOOST_CHECK_GE(blobs, N * kThreadsPerProcess);
+
+        BOOST_TEST_MESSAGE(
+            "BenchmarkPerformanceDataBlobs: " << (N * kThreadsPerProcess)
+            << " threads, " << blobs << " blobs, " << n << " threads: "
+            << elapsed << " s (" << (blobs / elapsed) << " blobs/s, "
+            << (serial / elapsed) << "x serial)"
+            );
+    }
+}
+
+
+
+/**
+ * Benchmark for the periodic samples of performance data. Applies messages
+ * containing millions of periodic samples for a single thread, and then
+ * computes the counts over many narrow time intervals, gets and visits all of
+ * the samples, and regenerates the blobs containing them.
+ */
+BENCHMARK_TEST_CASE(BenchmarkPerformanceDataPeriodicSamples)
+{
+    const std::size_t N = benchmarkSize(1 << 21);
+    const std::size_t kQueries = 100000;
+
+    SyntheticMessages messages = periodicSampleMessages(N);
+    ThreadName thread = messages.front().first;
+
+    PerformanceData data;
+
+    Time start = Time::Now();
+    apply(messages, data);
+    data.interval();
+    double apply_time = secondsSince(start);
+
+    boost::random::mt19937 generator;
+    boost::random::uniform_int_distribution<boost::uint64_t> time(
+        data.interval().begin(), data.interval().end()
+        );
+
+    boost::uint64_t total = 0;
+    start = Time::Now();
+    for (std::size_t i = 0; i < kQueries; ++i)
+    {
+        Time begin = time(generator);
+        total += data.counts(thread, TimeInterval(begin, begin + 10000))[0];
+    }
+    double counts_time = secondsSince(start);
+
+    start = Time::Now();
+    ArgoNavis::Base::PeriodicSamples samples =
+        data.periodic(thread, data.interval(), 0);
+    double periodic_time = secondsSince(start);
+
+    BOOST_CHECK_EQUAL(samples.size(), N);
+
+    std::size_t n = 0;
+    start = Time::Now();
+    data.visitPeriodicSamples(thread, data.interval(), boost::bind(
+        countPeriodicSample, _1, _2, boost::ref(n)
+        ));
+    double visit_time = secondsSince(start);
+
+    BOOST_CHECK_EQUAL(n, N);
+
+    std::size_t blobs = 0;
+    start = Time::Now();
+    data.visitBlobs(thread, boost::bind(countBlob, _1, boost::ref(blobs)));
+    double blobs_time = secondsSince(start);
+
+    BOOST_TEST_MESSAGE(
+        "BenchmarkPerformanceDataPeriodicSamples: " << N << " samples: apply "
+        << (1000000000.0 * apply_time / N) << " ns/sample, " << kQueries
+        << " narrow counts " << counts_time << " s (" << total
+        << "), periodic " << (1000000000.0 * periodic_time / N)
+        << " ns/sample, visit " << (1000000000.0 * visit_time / N)
+        << " ns/sample, " << blobs << " blobs "
+        << (1000000000.0 * blobs_time / N) << " ns/sample"
+        );
+}
+
+
+
+/**
+ * Benchmark for the interning of call sites. Applies messages containing 50k
+ * distinct, deep, call sites, and then applies the same call sites again. The
+ * call sites are applied once more with each referenced by several kernel
+ * executions, and their PC addresses are visited, within the same messages.
+ */
+BENCHMARK_TEST_CASE(BenchmarkPerformanceDataSites)
+{
+    const std::size_t kDepth = 24;
+    const std::size_t kRepeats = 8;
+    const std::size_t N = benchmarkSize(50000);
+
+    SyntheticMessages distinct = siteMessages(N, kDepth, 1, 0);
+    SyntheticMessages known = siteMessages(N, kDepth, 1, N);
+    SyntheticMessages repeated = siteMessages(N, kDepth, kRepeats, 2 * N);
+
+    PerformanceData data;
+
+    Time start = Time::Now();
+    apply(distinct, data);
+    double distinct_time = secondsSince(start);
+
+    BOOST_CHECK_EQUAL(data.sites().size(), N);
+
+    start = Time::Now();
+    apply(known, data);
+    double known_time = secondsSince(start);
+
+    BOOST_CHECK_EQUAL(data.sites().size(), N);
+
+    start = Time::Now();
+    apply(repeated, data);
+    double repeated_time = secondsSince(start);
+
+    BOOST_CHECK_EQUAL(data.sites().size(), N);
+
+    std::vector<Address> pcs;
+    start = Time::Now();
+    for (SyntheticMessages::const_iterator
+             i = repeated.begin(); i != repeated.end(); ++i)
+    {
+        PerformanceData::visitPCs(
+            i->second->data(), boost::bind(addAddress, _1, boost::ref(pcs))
+            );
+    }
+    double pcs_time = secondsSince(start);
+
+    BOOST_CHECK_EQUAL(pcs.size(), N * kDepth * kRepeats);
+
+    BOOST_TEST_MESSAGE(
+        "BenchmarkPerformanceDataSites: " << N << " sites of depth " << kDepth
+        << ": distinct " << distinct_time << " s ("
+        << (1000000000.0 * distinct_time / N) << " ns/site), known "
+        << known_time << " s (" << (1000000000.0 * known_time / N)
+        << " ns/site), repeated x" << kRepeats << " " << repeated_time
+        << " s (" << (1000000000.0 * repeated_time / N) << " ns/site), PCs "
+        << pcs_time << " s (" << (1000000000.0 * pcs_time / N)
+        << " ns/site)"
+        );
+}
@@ -23,9 +23,14 @@
 #include <boost/cstdint.hpp>
 #include <cstdlib>
 #include <cstring>
+#include <endian.h>
 #include <sstream>
 #include <stdexcept>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include <ArgoNavis/Base/AddressBitmap.hpp>
 #include <ArgoNavis/Base/Raise.hpp>
 
@@ -33,11 +38,110 @@ using namespace ArgoNavis::Base;
 
 
 
+/** Anonymous namespace hiding implementation details. */
+namespace {
+
+    /** Number of bits per word of an address bitmap. */
+    const boost::uint64_t kBitsPerWord = 64;
+
+    /** Word with all bits set. */
+    const boost::uint64_t kAllOnes = ~static_cast<boost::uint64_t>(0);
+    
+    /** Number of words required to store the given number of bits. */
+    std::size_t words(boost::uint64_t bits)
+    {
+        return (bits + kBitsPerWord - 1) / kBitsPerWord;
+    }
+
+    /** Number of bytes required to store the given number of bits. */
+    std::size_t bytes(boost::uint64_t bits)
+    {
+        return std::max<boost::uint64_t>(1, ((bits - 1) / 8) + 1);
+    }
+    
+    /** Mask selecting the bits [first, last] within a word. */
+    boost::uint64_t mask(boost::uint64_t first, boost::uint64_t last)
+    {
+        return (kAllOnes << first) &
+            (kAllOnes >> (kBitsPerWord - 1 - last));
+    }
+    
+    /**
+     * Find the first word at or after the given index, and before the given
+     * end, that isn't equal to the given pattern (all zeros or all ones). The
+     * words are compared two at a time when SSE2 is available, which speeds
+     * the scanning of the long uniform stretches found in sparse bitmaps.
+     */
+    std::size_t skip(const std::vector<boost::uint64_t>& bitmap,
+                     std::size_t i, std::size_t end, boost::uint64_t pattern)
+    {
+#if defined(__SSE2__)
+        const __m128i kPattern = _mm_set1_epi8(static_cast<char>(pattern));
+        
+        for (; (i + 2) <= end; i += 2)
+        {
+            __m128i x = _mm_loadu_si128(
+                reinterpret_cast<const __m128i*>(&bitmap[i])
+                );
+            
+            if (_mm_movemask_epi8(_mm_cmpeq_epi8(x, kPattern)) != 0xFFFF)
+            {
+                break;
+            }
+        }
+#endif
+        
+        for (; (i < end) && (bitmap[i] == pattern); ++i);
+        
+        return i;
+    }
+    
+    /**
+     * Find the index of the first bit, at or after the given index, with the
+     * given value. Returns the width of the bitmap if there is no such bit.
+     */
+    boost::uint64_t find(const std::vector<boost::uint64_t>& bitmap,
+                         boost::uint64_t width, boost::uint64_t from,
+                         bool value)
+    {
+        if (from >= width)
+        {
+            return width;
+        }
+        
+        const boost::uint64_t invert = value ? 0 : kAllOnes;
+        
+        std::size_t i = from / kBitsPerWord;
+        
+        boost::uint64_t word =
+            (bitmap[i] ^ invert) & (kAllOnes << (from % kBitsPerWord));
+
+        if (word == 0)
+        {
+            i = skip(bitmap, i + 1, bitmap.size(), invert);
+
+            if (i == bitmap.size())
+            {
+                return width;
+            }
+
+            word = bitmap[i] ^ invert;
+        }
+
+        return std::min<boost::uint64_t>(
+            width, (i * kBitsPerWord) + __builtin_ctzll(word)
+            );
+    }
+    
+} // namespace <anonymous>
+
+
+
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
 AddressBitmap::AddressBitmap(const AddressRange& range) :
     dm_range(range),
-    dm_bitmap(dm_range.width(), false)
+    dm_bitmap(words(dm_range.width()), 0)
 {
 }
 
@@ -47,31 +151,54 @@ AddressBitmap::AddressBitmap(const AddressRange& range) :
 //------------------------------------------------------------------------------
 AddressBitmap::AddressBitmap(const std::set<Address>& addresses) :
     dm_range(*(addresses.begin()), *(addresses.rbegin())),
-    dm_bitmap(dm_range.width(), false)
+    dm_bitmap(words(dm_range.width()), 0)
 {
     for (std::set<Address>::const_iterator
              i = addresses.begin(); i != addresses.end(); ++i)
     {
-        set(*i, true);
+        boost::uint64_t bit = *i - dm_range.begin();
+        dm_bitmap[bit / kBitsPerWord] |=
+            static_cast<boost::uint64_t>(1) << (bit % kBitsPerWord);
     }
 }
 
 
 
 //------------------------------------------------------------------------------
+// On little-endian hosts the byte array is copied directly into the words. On
+// big-endian hosts each word is assembled from its eight bytes. Either way any
+// bits beyond the end of the address range are then cleared.
 //------------------------------------------------------------------------------
 AddressBitmap::AddressBitmap(const CBTF_Protocol_AddressBitmap& message) :
     dm_range(message.range),
-    dm_bitmap(dm_range.width(), false)
+    dm_bitmap(words(dm_range.width()), 0)
 {
-    boost::uint64_t width = dm_range.width();    
-    boost::uint64_t size = std::max<boost::uint64_t>(1, ((width - 1) / 8) + 1);
+    boost::uint64_t width = dm_range.width();
+    boost::uint64_t size = bytes(width);
     
     BOOST_VERIFY(message.bitmap.data.data_len == size);
+
+    size = std::min<boost::uint64_t>(
+        size, dm_bitmap.size() * sizeof(boost::uint64_t)
+        );
     
-    for (boost::uint64_t i = 0; i < width; ++i)
+#if BYTE_ORDER == LITTLE_ENDIAN
+    if (size > 0)
+    {
+        memcpy(&dm_bitmap[0], message.bitmap.data.data_val, size);
+    }
+#else
+    for (boost::uint64_t i = 0; i < size; ++i)
     {
-        dm_bitmap[i] = message.bitmap.data.data_val[i / 8] & (1 << (i % 8));
+        dm_bitmap[i / 8] |= static_cast<boost::uint64_t>(
+            message.bitmap.data.data_val[i]
+            ) << (8 * (i % 8));
+    }
+#endif
+
+    if ((width % kBitsPerWord) != 0)
+    {
+        dm_bitmap.back() &= mask(0, (width % kBitsPerWord) - 1);
     }
 }
 
@@ -81,8 +208,8 @@ AddressBitmap::AddressBitmap(const CBTF_Protocol_AddressBitmap& message) :
 //------------------------------------------------------------------------------
 AddressBitmap::operator CBTF_Protocol_AddressBitmap() const
 {
-    boost::uint64_t width = dm_range.width();    
-    boost::uint64_t size = std::max<boost::uint64_t>(1, ((width - 1) / 8) + 1);
+    boost::uint64_t width = dm_range.width();
+    boost::uint64_t size = bytes(width);
 
     CBTF_Protocol_AddressBitmap message;
     memset(&message, 0, sizeof(message));
@@ -93,13 +220,23 @@ AddressBitmap::operator CBTF_Protocol_AddressBitmap() const
     
     memset(message.bitmap.data.data_val, 0, size);
 
-    for (boost::uint64_t i = 0; i < width; ++i)
+    size = std::min<boost::uint64_t>(
+        size, dm_bitmap.size() * sizeof(boost::uint64_t)
+        );
+    
+#if BYTE_ORDER == LITTLE_ENDIAN
+    if (size > 0)
     {
-        if (dm_bitmap[i])
-        {
-            message.bitmap.data.data_val[i / 8] |= 1 << (i % 8);
-        }
+        memcpy(message.bitmap.data.data_val, &dm_bitmap[0], size);
     }
+#else
+    for (boost::uint64_t i = 0; i < size; ++i)
+    {
+        message.bitmap.data.data_val[i] = static_cast<uint8_t>(
+            dm_bitmap[i / 8] >> (8 * (i % 8))
+            );
+    }
+#endif
     
     return message;
 }
@@ -152,7 +289,9 @@ bool AddressBitmap::get(const Address& address) const
             );
     }
     
-    return dm_bitmap[address - dm_range.begin()];
+    boost::uint64_t bit = address - dm_range.begin();
+
+    return (dm_bitmap[bit / kBitsPerWord] >> (bit % kBitsPerWord)) & 1;
 }
 
 
@@ -169,44 +308,73 @@ void AddressBitmap::set(const Address& address, bool value)
             );
     }
     
-    dm_bitmap[address - dm_range.begin()] = value;
+    set(AddressRange(address, address), value);
 }
 
 
 
 //------------------------------------------------------------------------------
+// Set the bits of each word overlapping the address range using a mask, rather
+// than setting one bit at a time, so large address ranges are filled quickly.
 //------------------------------------------------------------------------------
-std::set<AddressRange> AddressBitmap::ranges(bool value) const
+void AddressBitmap::set(const AddressRange& range, bool value)
 {
-    std::set<AddressRange> result;
-    
-    // Iterate over each address in this address bitmap
-    bool in = false;
-    Address begin;
-    for (Address i = dm_range.begin(); i <= dm_range.end(); ++i)
+    if (!dm_range.contains(range))
     {
-        // Is this address the beginning of a range?
-        if (!in && (get(i) == value))
+        raise<std::invalid_argument>(
+            "The given address range (%1%) isn't contained within "
+            "this bitmap's range (%2%).", range, dm_range
+            );
+    }
+
+    boost::uint64_t first = range.begin() - dm_range.begin();
+    boost::uint64_t last = range.end() - dm_range.begin();
+
+    for (std::size_t i = first / kBitsPerWord, i_end = last / kBitsPerWord;
+         i <= i_end;
+         ++i)
+    {
+        boost::uint64_t bits = mask(
+            (i == (first / kBitsPerWord)) ? (first % kBitsPerWord) : 0,
+            (i == i_end) ? (last % kBitsPerWord) : (kBitsPerWord - 1)
+            );
+
+        if (value)
         {
-            in = true;
-            begin = i;
+            dm_bitmap[i] |= bits;
         }
-        
-        // Is this address the end of a range?
-        else if (in && (get(i) != value))
+        else
         {
-            in = false;
-            result.insert(AddressRange(begin, i - 1));
+            dm_bitmap[i] &= ~bits;
         }
     }
+}
+
+
+
+//------------------------------------------------------------------------------
+// Alternately find the next bit with, and then without, the specified value. A
+// word at a time is examined, so a run of identical bits costs one iteration
+// per word (or pair of words) rather than one per address.
+//------------------------------------------------------------------------------
+std::set<AddressRange> AddressBitmap::ranges(bool value) const
+{
+    std::set<AddressRange> result;
+
+    boost::uint64_t width = dm_range.width();
     
-    // Does a range end at the end of the address bitmap?
-    if (in)
+    for (boost::uint64_t i = find(dm_bitmap, width, 0, value); i < width; )
     {
-        result.insert(AddressRange(begin, dm_range.end()));
+        boost::uint64_t i_end = find(dm_bitmap, width, i, !value);
+
+        result.insert(result.end(), AddressRange(
+            dm_range.begin() + Address(i),
+            dm_range.begin() + Address(i_end - 1)
+            ));
+        
+        i = find(dm_bitmap, width, i_end, value);
     }
     
-    // Return the resulting ranges to the caller
     return result;
 }
 
@@ -221,34 +389,29 @@ std::ostream& ArgoNavis::Base::operator<<(std::ostream& stream,
     
     stream << range << ": ";
     
-    bool has_false = false, has_true = false;
+    std::set<AddressRange> ranges = bitmap.ranges(true);
 
-    for (Address i = range.begin(); i <= range.end(); ++i)
-    {
-        if (bitmap.get(i) == true)
-        {
-            has_true = true;
-        }
-        else
-        {
-            has_false = true;
-        }
-    }
-    
-    if (has_false && !has_true)
+    if (ranges.empty())
     {
         stream << "0...0";
     }
-    else if (!has_false && has_true)
+    else if ((ranges.size() == 1) && (*ranges.begin() == range))
     {
         stream << "1...1";
     }
     else
     {
-        for (Address i = range.begin(); i <= range.end(); ++i)
+        Address next = range.begin();
+        
+        for (std::set<AddressRange>::const_iterator
+                 i = ranges.begin(); i != ranges.end(); ++i)
         {
-            stream << (bitmap.get(i) ? "1" : "0");
+            stream << std::string(i->begin() - next, '0')
+                   << std::string(i->width(), '1');
+            next = i->end() + 1;
         }
+
+        stream << std::string(range.end() - next + 1, '0');
     }
     
     return stream;
@@ -0,0 +1,199 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013,2014 Krell Institute. All Rights Reserved.
+// Copyright (c) 2015 Argo Navis Technologies. All Rights Reserved.
+//
+// This program is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation; either version 2 of the License, or (at your option) any later
+// version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+// Place, Suite 330, Boston, MA  02111-1307  USA
+////////////////////////////////////////////////////////////////////////////////
+
+/** @file Definition of the AddressRangeIndex class. */
+
+#include <algorithm>
+
+#include "AddressRangeIndex.hpp"
+
+using namespace ArgoNavis::Base;
+using namespace ArgoNavis::Base::Impl;
+
+
+
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+AddressRangeIndex::AddressRangeIndex() :
+    dm_ranges(),
+    dm_dirty(false),
+    dm_mutex(),
+    dm_rows(),
+    dm_levels(0)
+{
+}
+
+
+
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+AddressRangeIndex::AddressRangeIndex(const AddressRangeIndex& other) :
+    dm_ranges(other.dm_ranges),
+    dm_dirty(true),
+    dm_mutex(),
+    dm_rows(),
+    dm_levels(0)
+{
+}
+
+
+
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+AddressRangeIndex& AddressRangeIndex::operator=(const AddressRangeIndex& other)
+{
+    if (&other != this)
+    {
+        dm_ranges = other.dm_ranges;
+        
+        boost::mutex::scoped_lock lock(dm_mutex);
+        dm_dirty = true;
+    }
+    return *this;
+}
+
+
+
+//------------------------------------------------------------------------------
+// The address set's canonical list of address ranges is copied directly rather
+// than by way of an intermediate std::set<AddressRange>.
+//------------------------------------------------------------------------------
+void AddressRangeIndex::set(const EntityUID& uid, const AddressSet& addresses)
+{
+    if (uid >= dm_ranges.size())
+    {
+        dm_ranges.resize(uid + 1);
+    }
+
+    dm_ranges[uid] = addresses.dm_ranges;
+
+    boost::mutex::scoped_lock lock(dm_mutex);
+    dm_dirty = true;
+}
+
+
+
+//------------------------------------------------------------------------------
+// The address ranges of each entity are recovered from the rows, which being
+// sorted by beginning address, list each entity's address ranges in order.
+//------------------------------------------------------------------------------
+void AddressRangeIndex::assign(const Row* rows, std::size_t count, int levels)
+{
+    dm_ranges.clear();
+
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        if (rows[i].dm_uid >= dm_ranges.size())
+        {
+            dm_ranges.resize(rows[i].dm_uid + 1);
+        }
+        dm_ranges[rows[i].dm_uid].push_back(rows[i].dm_range);
+    }
+    
+    boost::mutex::scoped_lock lock(dm_mutex);
+    dm_rows.assign(rows, rows + count);
+    dm_levels = levels;
+    dm_dirty = false;
+}
+
+
+
+//------------------------------------------------------------------------------
+// Sweep the addresses and sorted address ranges together, pushing each address
+// range onto a stack once the sweep reaches its beginning. Addresses increase
+// monotonically, so an address range ending before the current address can be
+// discarded permanently. Pop those from the top of the stack until it holds an
+// address range containing the current address. That address range is the one
+// beginning closest to the address, since all later-beginning address ranges
+// were pushed after it and have already been popped. Expired address ranges
+// buried below the top are harmless, and are discarded when they are reached.
+//------------------------------------------------------------------------------
+void AddressRangeIndex::resolve(const std::vector<Address>& addresses,
+                                std::vector<EntityUID>& uids,
+                                const EntityUID& none) const
+{
+    update();
+
+    uids.assign(addresses.size(), none);
+    
+    std::vector<const Row*> stack;
+    std::vector<Row>::const_iterator r = dm_rows.begin();
+    
+    for (std::size_t i = 0, i_end = addresses.size(); i < i_end; ++i)
+    {
+        const Address& address = addresses[i];
+
+        for (; (r != dm_rows.end()) && (r->dm_range.begin() <= address); ++r)
+        {
+            stack.push_back(&*r);
+        }
+
+        while (!stack.empty() && (stack.back()->dm_range.end() < address))
+        {
+            stack.pop_back();
+        }
+
+        if (!stack.empty())
+        {
+            uids[i] = stack.back()->dm_uid;
+        }
+    }
+}
+
+
+
+//------------------------------------------------------------------------------
+// Sort the address ranges by their beginning address and then build the tree
+// over them.
+//------------------------------------------------------------------------------
+void AddressRangeIndex::update() const
+{
+    boost::mutex::scoped_lock lock(dm_mutex);
+
+    if (!dm_dirty)
+    {
+        return;
+    }
+    
+    dm_rows.clear();
+    
+    for (EntityUID uid = 0; uid < dm_ranges.size(); ++uid)
+    {
+        for (std::vector<AddressRange>::const_iterator
+                 i = dm_ranges[uid].begin(), i_end = dm_ranges[uid].end();
+             i != i_end;
+             ++i)
+        {
+            Row row;
+            row.dm_uid = uid;
+            row.dm_range = *i;
+            row.dm_previous_end = (i == dm_ranges[uid].begin()) ?
+                i->begin() : (i - 1)->end();
+            row.dm_max_end = i->end();
+            dm_rows.push_back(row);
+        }
+    }
+
+    std::sort(dm_rows.begin(), dm_rows.end(), compare);
+
+    Nodes nodes(dm_rows);
+    dm_levels = IntervalTree<Nodes>::build(nodes);
+
+    dm_dirty = false;
+}
@@ -17,76 +17,291 @@
 // Place, Suite 330, Boston, MA  02111-1307  USA
 ////////////////////////////////////////////////////////////////////////////////
 
-/** @file Declaration of the AddressRangeIndex type. */
+/** @file Declaration of the AddressRangeIndex class. */
 
 #pragma once
 
-#include <boost/multi_index_container.hpp>
-#include <boost/multi_index/member.hpp>
-#include <boost/multi_index/ordered_index.hpp>
+#include <boost/thread/mutex.hpp>
+#include <vector>
 
 #include <ArgoNavis/Base/Address.hpp>
 #include <ArgoNavis/Base/AddressRange.hpp>
+#include <ArgoNavis/Base/AddressSet.hpp>
+#include <ArgoNavis/Base/IntervalTree.hpp>
 
 #include "EntityUID.hpp"
 
 namespace ArgoNavis { namespace Base { namespace Impl {
 
-    /** Structure containing one row of an address range index. */
-    struct AddressRangeIndexRow
+    /**
+     * Index used to search for the entities overlapping a given address range.
+     *
+     * The address ranges of all entities are kept in an array sorted by their
+     * beginning address, over which an IntervalTree is laid. Each row records
+     * the maximum ending address found in its subtree. Overlap queries thus
+     * prune all subtrees ending before the query, and are O(log n + k) for k
+     * results without allocating any memory.
+     *
+     * The sorted array and tree are rebuilt, on the next query, after entities
+     * are modified. This is inexpensive since entities are normally added in
+     * bulk before being queried.
+     *
+     * @note    EntityTable is the only place where AddressRangeIndex is used.
+     *          It is a separate class, rather than a private nested type in
+     *          that class, to keep its non-template implementation out of the
+     *          EntityTable header.
+     *
+     * @sa https://github.com/lh3/cgranges
+     */
+    class AddressRangeIndex
     {
-        /** Unique identifier for an entity within this table. */
-        EntityUID dm_uid;
+
+    public:
+
+        /** Structure containing one row of an address range index. */
+        struct Row
+        {
+            /** Unique identifier for an entity. */
+            EntityUID dm_uid;
+            
+            /** Address range for that entity. */
+            AddressRange dm_range;
+
+            /**
+             * Ending address of the entity's preceding address range, or the
+             * beginning address of this address range if it is the entity's
+             * first. Used to visit each entity only once without allocating
+             * a set of visited entities.
+             */
+            Address dm_previous_end;
+            
+            /** Maximum ending address within this node's subtree. */
+            Address dm_max_end;
+        };
+
+        /** Construct an empty address range index. */
+        AddressRangeIndex();
+
+        /** Construct an address range index from an existing one. */
+        AddressRangeIndex(const AddressRangeIndex& other);
+
+        /** Replace this address range index with a copy of another one. */
+        AddressRangeIndex& operator=(const AddressRangeIndex& other);
         
-        /** Address range for that entity. */
-        AddressRange dm_range;
+        /**
+         * Set the address ranges of the given entity, replacing any address
+         * ranges previously set for that entity.
+         *
+         * @param uid          Unique identifier for the entity.
+         * @param addresses    Addresses for that entity.
+         */
+        void set(const EntityUID& uid, const AddressSet& addresses);
+
+        /**
+         * Replace this address range index with the given, previously built,
+         * rows and tree. Allows an index to be restored without sorting its
+         * address ranges or rebuilding its tree.
+         *
+         * @param rows      Rows sorted by beginning address, with the maximum
+         *                  ending address of each node's subtree computed.
+         * @param count     Number of rows.
+         * @param levels    Level of the root of the tree.
+         *
+         * @pre    The rows must have been obtained from rows() and levels().
+         */
+        void assign(const Row* rows, std::size_t count, int levels);
+
+        /** Get the rows of this index, sorted by beginning address. */
+        const std::vector<Row>& rows() const
+        {
+            update();
+            return dm_rows;
+        }
+
+        /** Get the level of the root of the tree. */
+        int levels() const
+        {
+            update();
+            return dm_levels;
+        }
+
+        /**
+         * Find the entity containing each of the given addresses. When more
+         * than one entity contains an address, the entity whose containing
+         * address range begins closest to the address is chosen. I.e. the
+         * innermost entity in the common case of nested address ranges.
+         *
+         * @param addresses    Addresses to be found, sorted in ascending order.
+         * @param uids         Unique identifier of the entity containing each
+         *                     address, or "none" for addresses not contained
+         *                     by any entity.
+         * @param none         Unique identifier indicating no entity.
+         *
+         * @note    All addresses are found in a single sweep over the sorted
+         *          address ranges, making the cost O(N + M) for N addresses
+         *          and M address ranges rather than one query per address.
+         */
+        void resolve(const std::vector<Address>& addresses,
+                     std::vector<EntityUID>& uids,
+                     const EntityUID& none) const;
         
-        /** Constructor from initial fields. */
-        AddressRangeIndexRow(const EntityUID& uid, const AddressRange& range) :
-            dm_uid(uid),
-            dm_range(range)
+        /**
+         * Visit the entities with an address range intersecting the given
+         * address range. Each entity is visited once, in ascending order of
+         * the beginning address of its first intersecting address range.
+         *
+         * @tparam V    Type of visitor for the entities. Invoked with each
+         *              entity's unique identifier and returns a boolean.
+         *
+         * @param range      Address range to be found.
+         * @param visitor    Visitor invoked for each entity.
+         * @return           Boolean "true" if the visitation was terminated
+         *                   by the visitor, or "false" otherwise.
+         *
+         * @note    The visitation is terminated immediately if "false" is
+         *          returned by the visitor.
+         */
+        template <typename V>
+        bool visit(const AddressRange& range, const V& visitor) const
         {
+            update();
+
+            return IntervalTree<Nodes>::visit(
+                Nodes(dm_rows), dm_levels, range.begin(), range.end(),
+                Reporter<V>(dm_rows, range, visitor)
+                );
         }
         
-        /** Key extractor for the address range's beginning. */
-        struct range_begin
+    private:
+
+        /** Adapter laying an interval tree over the rows. */
+        class Nodes
         {
-            typedef Address result_type;
-            
-            result_type operator()(const AddressRangeIndexRow& row) const
+
+        public:
+
+            /** Type of the intervals' values. */
+            typedef Address Point;
+
+            /** Construct an adapter for the given rows. */
+            Nodes(std::vector<Row>& rows) :
+                dm_rows(rows)
             {
-                return row.dm_range.begin();
             }
-        };
+
+            /** Get the number of rows. */
+            std::size_t size() const
+            {
+                return dm_rows.size();
+            }
+
+            /** Get the beginning address of the given row. */
+            Address begin(std::size_t i) const
+            {
+                return dm_rows[i].dm_range.begin();
+            }
+
+            /** Get the ending address of the given row. */
+            Address end(std::size_t i) const
+            {
+                return dm_rows[i].dm_range.end();
+            }
+
+            /** Get the maximum ending address within the given subtree. */
+            Address maxEnd(std::size_t i) const
+            {
+                return dm_rows[i].dm_max_end;
+            }
+
+            /** Set the maximum ending address within the given subtree. */
+            void setMaxEnd(std::size_t i, const Address& end)
+            {
+                dm_rows[i].dm_max_end = end;
+            }
+
+        private:
+
+            /** Rows over which the tree is laid. */
+            std::vector<Row>& dm_rows;
+
+        }; // class Nodes
+
+        /**
+         * Visitor reporting each row intersecting the queried address range
+         * to the given visitor, unless its entity's preceding address range
+         * also intersects that range, so each entity is reported only once.
+         */
+        template <typename V>
+        class Reporter
+        {
+
+        public:
+
+            /** Construct a reporter for the given rows, range, and visitor. */
+            Reporter(const std::vector<Row>& rows, const AddressRange& range,
+                     const V& visitor) :
+                dm_rows(rows),
+                dm_range(range),
+                dm_visitor(visitor)
+            {
+            }
+
+            /** Report the given row. */
+            bool operator()(std::size_t i) const
+            {
+                const Row& row = dm_rows[i];
+
+                if ((row.dm_previous_end != row.dm_range.begin()) &&
+                    (row.dm_previous_end >= dm_range.begin()))
+                {
+                    return true;
+                }
+
+                return dm_visitor(row.dm_uid);
+            }
+
+        private:
+
+            /** Rows over which the tree is laid. */
+            const std::vector<Row>& dm_rows;
+
+            /** Address range being queried. */
+            const AddressRange& dm_range;
+
+            /** Visitor invoked for each reported entity. */
+            const V& dm_visitor;
+
+        }; // class Reporter<V>
+
+        /**
+         * Compare two rows by the beginning address of their range, and then
+         * by their unique identifier, so the sort order is deterministic.
+         */
+        static bool compare(const Row& x, const Row& y)
+        {
+            return (x.dm_range.begin() < y.dm_range.begin()) ||
+                ((x.dm_range.begin() == y.dm_range.begin()) &&
+                 (x.dm_uid < y.dm_uid));
+        }
         
-    }; // struct AddressRangeIndexRow
-            
-    /**
-     * Type of associative container used to search for the entities overlapping
-     * a given address range.
-     *
-     * @note    EntityTable is the only place where AddressRangeIndex[Row] are
-     *          used. So normally it would be sensible for those 2 types to be
-     *          be private nested types in that class. But because EntityTable
-     *          and boost::multi_index_container are both templates, the syntax
-     *          for referencing AddressRangeIndex from EntityTable becomes very
-     *          messy if the former is a nested type of the later. So they have
-     *          been separated here.
-     */
-    typedef boost::multi_index_container<
-        AddressRangeIndexRow,
-        boost::multi_index::indexed_by<
-            boost::multi_index::ordered_non_unique<
-                boost::multi_index::member<
-                    AddressRangeIndexRow,
-                    EntityUID,
-                    &AddressRangeIndexRow::dm_uid
-                    >
-                >,
-            boost::multi_index::ordered_non_unique<
-                AddressRangeIndexRow::range_begin
-                >
-            >
-        > AddressRangeIndex;
+        /** Rebuild the sorted array and tree if entities were modified. */
+        void update() const;
+        
+        /** Address ranges of each entity, indexed by unique identifier. */
+        std::vector<std::vector<AddressRange> > dm_ranges;
 
+        /** Are the sorted array and tree out of date? */
+        mutable bool dm_dirty;
+
+        /** Mutual exclusion lock for rebuilding the sorted array and tree. */
+        mutable boost::mutex dm_mutex;
+        
+        /** Address ranges of all entities sorted by beginning address. */
+        mutable std::vector<Row> dm_rows;
+
+        /** Level of the root of the tree. */
+        mutable int dm_levels;
+        
+    }; // class AddressRangeIndex
+    
 } } } // namespace ArgoNavis::Base::Impl
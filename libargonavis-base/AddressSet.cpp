@@ -20,8 +20,12 @@
 /** @file Definition of the AddressSet class. */
 
 #include <algorithm>
+#include <boost/cstdint.hpp>
+#include <cstdlib>
 #include <deque>
+#include <utility>
 
+#include <ArgoNavis/Base/AddressBitmap.hpp>
 #include <ArgoNavis/Base/AddressSet.hpp>
 
 using namespace ArgoNavis::Base;
@@ -31,26 +35,88 @@ using namespace ArgoNavis::Base;
 /** Anonymous namespace hiding implementation details. */
 namespace {
 
+    /** Compare two address ranges by their beginning address. */
+    bool compareBegin(const AddressRange& x, const AddressRange& y)
+    {
+        return x.begin() < y.begin();
+    }
+    
+    /** Compare an address range's ending address against an address. */
+    bool compareEnd(const AddressRange& x, const Address& y)
+    {
+        return x.end() < y;
+    }
+
     /**
-     * Extract all contiguous address ranges within the given address bitmaps.
+     * Coalesce all overlapping or adjacent address ranges, in place, within a
+     * list of address ranges that is already sorted by beginning address.
      *
-     * @param bitmaps    Address bitmaps to be extracted.
-     * @return           Contiguous address ranges in those address bitmaps.
+     * @param ranges    Address ranges to be coalesced.
      */
-    std::set<AddressRange> extract(const std::vector<AddressBitmap>& bitmaps)
+    void coalesce(std::vector<AddressRange>& ranges)
     {
-        std::set<AddressRange> ranges;
+        std::vector<AddressRange>::iterator j = ranges.begin();
         
-        for (std::vector<AddressBitmap>::const_iterator
-                 i = bitmaps.begin(); i != bitmaps.end(); ++i)
+        for (std::vector<AddressRange>::const_iterator
+                 i = ranges.begin(); i != ranges.end(); ++i)
         {
-            std::set<AddressRange> i_ranges = i->ranges(true);
-            ranges.insert(i_ranges.begin(), i_ranges.end());
+            if (i->empty())
+            {
+                continue;
+            }
+
+            if (j != ranges.begin())
+            {
+                AddressRange& previous = *(j - 1);
+
+                if ((previous.end() == Address::TheHighest()) ||
+                    (i->begin() <= (previous.end() + 1)))
+                {
+                    if (i->end() > previous.end())
+                    {
+                        previous = AddressRange(previous.begin(), i->end());
+                    }
+                    continue;
+                }
+            }
+
+            *j++ = *i;
         }
-        
-        return ranges;
+
+        ranges.erase(j, ranges.end());
     }
-    
+
+    /**
+     * Canonicalize a list of address ranges by sorting them, and coalescing all
+     * overlapping or adjacent address ranges, in place.
+     *
+     * @param ranges    Address ranges to be canonicalized.
+     */
+    void canonicalize(std::vector<AddressRange>& ranges)
+    {
+        std::sort(ranges.begin(), ranges.end(), compareBegin);
+        coalesce(ranges);
+    }
+
+    /**
+     * Merge a sorted sequence of address ranges into a canonical list of address
+     * ranges, leaving that list canonical.
+     *
+     * @param ranges    Canonical address ranges to be merged into.
+     * @param begin     Beginning of the sorted sequence to be merged.
+     * @param end       End of the sorted sequence to be merged.
+     */
+    template <typename Iterator>
+    void merge(std::vector<AddressRange>& ranges, Iterator begin, Iterator end)
+    {
+        std::size_t n = ranges.size();
+        ranges.insert(ranges.end(), begin, end);
+        std::inplace_merge(
+            ranges.begin(), ranges.begin() + n, ranges.end(), compareBegin
+            );
+        coalesce(ranges);
+    }
+
     /**
      * Partition address ranges into address bitmaps. Addresses for functions
      * and statements are stored as pairings of an address range and a bitmap,
@@ -64,7 +130,7 @@ namespace {
      * exhibit spatial locality. This function iteratively subdivides all the
      * addresses until each bitmap exhibits sufficient spatial locality.
      *
-     * @param ranges    Address ranges to be partitioned.
+     * @param ranges    Canonical address ranges to be partitioned.
      * @return          Address bitmaps representing these address ranges.
      *
      * @note    The criteria for subdividing an address set is as follows. The
@@ -72,8 +138,10 @@ namespace {
      *          set is found. If the number of bits required to encode the gap
      *          within a bitmap is greater than the number of bits required to
      *          create a new address bitmap, the set is partitioned at the gap.
+     *          Since the address ranges are canonical, the only gaps that can
+     *          exist are those between adjacent address ranges.
      */
-    std::vector<AddressBitmap> partition(const std::set<AddressRange>& ranges)
+    std::vector<AddressBitmap> partition(const std::vector<AddressRange>& ranges)
     {
         std::vector<AddressBitmap> bitmaps;
 
@@ -86,70 +154,47 @@ namespace {
         // of CBTF_Protocol_SymbolTable objects.
         // 
         
-        const boost::int64_t kPartitioningCriteria = 8 /* Bits/Byte */ *
+        const boost::uint64_t kPartitioningCriteria = 8 /* Bits/Byte */ *
             (2 * sizeof(boost::uint64_t) /* Address Range */ +
              sizeof(boost::uint8_t) /* Single-Byte Bitmap */);
         
-        // Convert the provided set of address ranges into a set of addresses
-        std::set<Address> addresses;
-        for (std::set<AddressRange>::const_iterator
-                 i = ranges.begin(); i != ranges.end(); ++i)
-        {
-            for (Address j = i->begin(); j <= i->end(); ++j)
-            {
-                addresses.insert(j);
-            }
-        }
-        
         //
-        // Initialize a queue with this set of address and iterate over that
-        // queue until it has been emptied.
+        // Initialize a queue with the index range of all the address ranges
+        // and iterate over that queue until it has been emptied.
         //
         
-        std::deque<std::set<Address> > queue(1, addresses);        
+        std::deque<std::pair<std::size_t, std::size_t> > queue(
+            1, std::make_pair(0, ranges.size())
+            );
         while (!queue.empty())
         {
-            std::set<Address> i = queue.front();
+            std::size_t begin = queue.front().first;
+            std::size_t end = queue.front().second;
             queue.pop_front();
 
             // Handle the special case of an empty address set by ignoring it
-            if (i.empty())
-            {
-                continue;
-            }
-
-            //
-            // Handle the special case of a single-element address set by
-            // creating an address bitmap for it and adding that bitmap to
-            // the results.
-            //
-
-            if (i.size() == 1)
+            if (begin == end)
             {
-                bitmaps.push_back(AddressBitmap(i));
                 continue;
             }
 
             //
-            // Otherwise find the widest gap between any two adjacent addresses
-            // within this address set. Also remember WHERE that widest gap was
-            // located.
+            // Otherwise find the widest gap between any two adjacent address
+            // ranges within this address set. Also remember WHERE that widest
+            // gap was located.
             //
 
-            boost::int64_t widest_gap = 0;
-            std::set<Address>::const_iterator widest_gap_at = i.begin();
+            boost::uint64_t widest_gap = 0;
+            std::size_t widest_gap_at = begin;
             
-            for (std::set<Address>::const_iterator
-                     prev = i.begin(), current = ++i.begin();
-                 current != i.end();
-                 ++prev, ++current)
+            for (std::size_t i = begin + 1; i < end; ++i)
             {
-                boost::int64_t gap = AddressRange(*prev, *current).width() - 1;
+                boost::uint64_t gap = ranges[i].begin() - ranges[i - 1].end();
                 
                 if (gap > widest_gap)
                 {
                     widest_gap = gap;
-                    widest_gap_at = current;
+                    widest_gap_at = i;
                 }
             }
             
@@ -162,14 +207,22 @@ namespace {
             
             if (widest_gap > kPartitioningCriteria)
             {
-                queue.push_back(std::set<Address>(i.begin(), widest_gap_at));
-                queue.push_back(std::set<Address>(widest_gap_at, i.end()));
+                queue.push_back(std::make_pair(begin, widest_gap_at));
+                queue.push_back(std::make_pair(widest_gap_at, end));
             }
             else
             {
-                bitmaps.push_back(AddressBitmap(i));
+                AddressBitmap bitmap(AddressRange(
+                    ranges[begin].begin(), ranges[end - 1].end()
+                    ));
+
+                for (std::size_t i = begin; i < end; ++i)
+                {
+                    bitmap.set(ranges[i], true);
+                }
+                
+                bitmaps.push_back(bitmap);
             }
-            
         }
 
         // Return the final results to the caller        
@@ -183,8 +236,18 @@ namespace {
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
 AddressSet::AddressSet() :
-    dm_bitmaps()
+    dm_ranges()
+{
+}
+
+
+
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+AddressSet::AddressSet(const std::set<AddressRange>& ranges) :
+    dm_ranges(ranges.begin(), ranges.end())
 {
+    canonicalize(dm_ranges);
 }
 
 
@@ -192,12 +255,15 @@ AddressSet::AddressSet() :
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
 AddressSet::AddressSet(CBTF_Protocol_AddressBitmap* messages, u_int len) :
-    dm_bitmaps()
+    dm_ranges()
 {
     for (u_int i = 0; i < len; ++i)
     {
-        dm_bitmaps.push_back(AddressBitmap(messages[i]));
+        std::set<AddressRange> ranges = AddressBitmap(messages[i]).ranges(true);
+        dm_ranges.insert(dm_ranges.end(), ranges.begin(), ranges.end());
     }
+
+    canonicalize(dm_ranges);
 }
 
 
@@ -206,33 +272,105 @@ AddressSet::AddressSet(CBTF_Protocol_AddressBitmap* messages, u_int len) :
 //------------------------------------------------------------------------------
 AddressSet::operator std::set<AddressRange>() const
 {
-    return ::extract(dm_bitmaps);
+    return std::set<AddressRange>(dm_ranges.begin(), dm_ranges.end());
 }
 
 
         
 //------------------------------------------------------------------------------
-// Construct a set of address ranges that contains all current address ranges
-// for this set as well as the given new address ranges. Partition this new
-// set of address ranges into address bitmaps. The new list of address bitmaps
-// completely replaces any previous list.
+// The given address ranges are already sorted by std::set, so they are merged
+// with the current address ranges for this set in linear time.
 //------------------------------------------------------------------------------
 AddressSet& AddressSet::operator+=(const std::set<AddressRange>& ranges)
 {
-    std::set<AddressRange> all_ranges = ::extract(dm_bitmaps);
-    all_ranges.insert(ranges.begin(), ranges.end());
-    dm_bitmaps = ::partition(all_ranges);
+    merge(dm_ranges, ranges.begin(), ranges.end());
     return *this;
 }
 
 
 
 //------------------------------------------------------------------------------
+// Walk the two canonical lists of address ranges simultaneously, emitting the
+// intersection of each overlapping pair, and always advancing past whichever
+// of the two current address ranges ends first.
+//------------------------------------------------------------------------------
+AddressSet& AddressSet::operator&=(const AddressSet& other)
+{
+    std::vector<AddressRange> ranges;
+
+    for (std::vector<AddressRange>::const_iterator
+             i = dm_ranges.begin(), j = other.dm_ranges.begin();
+         (i != dm_ranges.end()) && (j != other.dm_ranges.end());
+         )
+    {
+        AddressRange intersection = *i & *j;
+        
+        if (!intersection.empty())
+        {
+            ranges.push_back(intersection);
+        }
+
+        if (i->end() < j->end())
+        {
+            ++i;
+        }
+        else
+        {
+            ++j;
+        }
+    }
+    
+    dm_ranges.swap(ranges);
+    return *this;
+}
+
+
+
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+AddressSet& AddressSet::operator|=(const AddressSet& other)
+{
+    if (&other != this)
+    {
+        merge(dm_ranges, other.dm_ranges.begin(), other.dm_ranges.end());
+    }
+    return *this;
+}
+
+
+
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+bool AddressSet::empty() const
+{
+    return dm_ranges.empty();
+}
+
+
+
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+bool AddressSet::contains(const Address& address) const
+{
+    std::vector<AddressRange>::const_iterator i = std::lower_bound(
+        dm_ranges.begin(), dm_ranges.end(), address, compareEnd
+        );
+
+    return (i != dm_ranges.end()) && i->contains(address);
+}
+
+
+
+//------------------------------------------------------------------------------
+// The address ranges are partitioned into address bitmaps here, rather than
+// being stored as bitmaps, because this is the only place they are needed.
 //------------------------------------------------------------------------------
 void AddressSet::extract(CBTF_Protocol_AddressBitmap*& messages,
                          u_int& len) const
 {
-    len = dm_bitmaps.size();
+    std::vector<AddressBitmap> bitmaps = ::partition(dm_ranges);
+    
+    len = bitmaps.size();
     
     messages = reinterpret_cast<CBTF_Protocol_AddressBitmap*>(
         malloc(std::max(1U, len) * sizeof(CBTF_Protocol_AddressBitmap))
@@ -240,6 +378,6 @@ void AddressSet::extract(CBTF_Protocol_AddressBitmap*& messages,
     
     for (u_int i = 0; i < len; ++i)
     {
-        messages[i] = dm_bitmaps[i];
+        messages[i] = bitmaps[i];
     }
 }
@@ -22,12 +22,21 @@
 #include <algorithm>
 #include <boost/bind.hpp>
 #include <boost/ref.hpp>
+#include <boost/functional/hash.hpp>
 #include <boost/tuple/tuple.hpp>
+#include <boost/tuple/tuple_comparison.hpp>
+#include <cstddef>
 #include <cstring>
 #include <set>
+#include <utility>
+#include <vector>
 
+#include <ArgoNavis/Base/AddressSet.hpp>
 #include <ArgoNavis/Base/AddressSpaces.hpp>
 
+#include "AddressRangeIndex.hpp"
+#include "ContentHash.hpp"
+
 using namespace ArgoNavis::Base;
 using namespace ArgoNavis::Base::Impl;
 
@@ -37,69 +46,174 @@ using namespace ArgoNavis::Base::Impl;
 namespace {
 
     /**
-     * Visitor used to determine if an arbitrary set of visited mappings
-     * contains a mapping equivalent to the given mapping. The visitation
-     * is terminated as soon as such a mapping is found.
+     * Type of the contents of a mapping that are compared when determining
+     * if two address spaces are equivalent. Linked objects are compared only
+     * by their file names.
      */
-    bool containsEquivalentMapping(const ThreadName& thread,
-                                   const LinkedObject& linked_object,
-                                   const AddressRange& range,
-                                   const TimeInterval& interval,
-                                   const ThreadName& x_thread,
-                                   const LinkedObject& x_linked_object,
-                                   const AddressRange& x_range,
-                                   const TimeInterval& x_interval,
-                                   bool& contains)
-    {
-        contains |= ((thread == x_thread) &&
-                     (linked_object.file() == x_linked_object.file()) &&
-                     (range == x_range) &&
-                     (interval == x_interval));
-        return !contains;
+    typedef boost::tuple<
+        ThreadName, FileName, AddressRange, TimeInterval
+        > MappingContents;
+
+    /** Type of a list of mapping contents paired with their hashes. */
+    typedef std::vector<
+        std::pair<std::size_t, MappingContents>
+        > HashedMappings;
+    
+    /** Visitor used to hash the contents of each visited mapping. */
+    bool hashMapping(const ThreadName& thread,
+                     const LinkedObject& linked_object,
+                     const AddressRange& range,
+                     const TimeInterval& interval,
+                     HashedMappings& mappings)
+    {
+        FileName file = linked_object.file();
+        
+        std::size_t seed = 0;
+        hashCombine(seed, thread);
+        hashCombine(seed, file);
+        hashCombine(seed, range);
+        hashCombine(seed, interval);
+        
+        mappings.push_back(std::make_pair(
+            seed, MappingContents(thread, file, range, interval)
+            ));
+        
+        return true;
+    }
+
+    /** Are the two given mapping contents equivalent? */
+    bool equivalentMappings(const MappingContents& first,
+                            const MappingContents& second)
+    {
+        return first == second;
     }
     
     /**
-     * Visitor for determining if the given address spaces contain a mapping
-     * equivalent to all mappings in an arbitrary set of visited mappings.
-     * The visitation is terminated as soon as a mapping is encountered that
-     * doesn't have an equivalent in the given address spaces.
+     * Visitor used to find the first indexed mapping whose time interval
+     * contains the given time. The visitation is terminated as soon as such
+     * a mapping is found.
      */
-    bool containsAllMappings(const AddressSpaces& address_spaces,
-                             const ThreadName& x_thread,
-                             const LinkedObject& x_linked_object,
-                             const AddressRange& x_range,
-                             const TimeInterval& x_interval,
-                             bool& contains)
-    {
-        bool contains_this = false;
-
-        address_spaces.visitMappings(
-            x_thread, x_range, x_interval, boost::bind(
-                containsEquivalentMapping,
-                x_thread, x_linked_object, x_range, x_interval,
-                _1, _2, _3, _4,
-                boost::ref(contains_this)
-                )
-            );
+    template <typename M>
+    bool findContaining(const EntityUID& uid, const std::vector<M>& mappings,
+                        const Time& time, boost::optional<EntityUID>& found)
+    {
+        if (mappings[uid].dm_interval.contains(time))
+        {
+            found = uid;
+            return false;
+        }
+        return true;
+    }
+    
+    /**
+     * Visitor used to visit those indexed mappings whose time intervals
+     * intersect the given time interval.
+     */
+    template <typename M>
+    bool visitIntersecting(const EntityUID& uid,
+                           const ThreadName& thread,
+                           const std::vector<M>& mappings,
+                           const TimeInterval& interval,
+                           const MappingVisitor& visitor)
+    {
+        const M& mapping = mappings[uid];
         
-        contains &= contains_this;
-        return contains;
+        if (!mapping.dm_interval.intersects(interval))
+        {
+            return true;
+        }
+        
+        return visitor(thread, mapping.dm_linked_object,
+                       mapping.dm_range, mapping.dm_interval);
     }
     
 } // namespace <anonymous>
 
 
 
+/**
+ * Index over the address ranges of the mappings for a single thread. Each
+ * mapping's unique identifier within the index is its position in the list
+ * of mappings. Once built, an index is never modified, and is discarded and
+ * rebuilt when that thread's mappings change, so a query may safely continue
+ * to use an index even after it is discarded.
+ */
+struct AddressSpaces::ThreadIndex
+{
+    /** Name of the thread. */
+    ThreadName dm_thread;
+
+    /** Mappings for the thread. */
+    std::vector<Mapping> dm_mappings;
+
+    /** Index over the address ranges of those mappings. */
+    AddressRangeIndex dm_index;
+
+    /** Constructor from the name of the thread. */
+    ThreadIndex(const ThreadName& thread) :
+        dm_thread(thread),
+        dm_mappings(),
+        dm_index()
+    {
+    }
+};
+
+
+
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
 AddressSpaces::AddressSpaces() :
+    dm_threads(),
     dm_linked_objects(),
-    dm_mappings()
+    dm_mappings(),
+    dm_indices_mutex(),
+    dm_indices()
 {
 }
 
 
 
+//------------------------------------------------------------------------------
+// The per-thread indices are never modified once built, and can thus be shared
+// with the copy rather than rebuilt.
+//------------------------------------------------------------------------------
+AddressSpaces::AddressSpaces(const AddressSpaces& other) :
+    dm_threads(other.dm_threads),
+    dm_linked_objects(other.dm_linked_objects),
+    dm_mappings(other.dm_mappings),
+    dm_indices_mutex(),
+    dm_indices()
+{
+    boost::mutex::scoped_lock lock(other.dm_indices_mutex);
+    dm_indices = other.dm_indices;
+}
+
+
+
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+AddressSpaces& AddressSpaces::operator=(const AddressSpaces& other)
+{
+    if (&other != this)
+    {
+        dm_threads = other.dm_threads;
+        dm_linked_objects = other.dm_linked_objects;
+        dm_mappings = other.dm_mappings;
+
+        std::vector<boost::shared_ptr<const ThreadIndex> > indices;
+        {
+            boost::mutex::scoped_lock lock(other.dm_indices_mutex);
+            indices = other.dm_indices;
+        }
+
+        boost::mutex::scoped_lock lock(dm_indices_mutex);
+        dm_indices.swap(indices);
+    }
+    return *this;
+}
+
+
+
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
 AddressSpaces::operator CBTF_Protocol_AttachedToThreads() const
@@ -111,7 +225,7 @@ AddressSpaces::operator CBTF_Protocol_AttachedToThreads() const
          i != i_end;
          ++i)
     {
-        threads.insert(i->dm_thread);
+        threads.insert(dm_threads.name(i->dm_thread));
     }
 
     CBTF_Protocol_AttachedToThreads message;
@@ -141,26 +255,28 @@ AddressSpaces::operator CBTF_Protocol_AttachedToThreads() const
 //------------------------------------------------------------------------------
 AddressSpaces::operator std::vector<CBTF_Protocol_LinkedObjectGroup>() const
 {
-    std::set<ThreadName> threads;
+    std::map<ThreadName, ThreadNameTable::Identifier> threads;
 
     for (MappingIndex::const_iterator
              i = dm_mappings.begin(), i_end = dm_mappings.end();
          i != i_end;
          ++i)
     {
-        threads.insert(i->dm_thread);
+        threads.insert(std::make_pair(dm_threads.name(i->dm_thread),
+                                      i->dm_thread));
     }
 
     std::vector<CBTF_Protocol_LinkedObjectGroup> message(threads.size());
 
     u_int m = 0;
-    for (std::set<ThreadName>::const_iterator
+    for (std::map<ThreadName, ThreadNameTable::Identifier>::const_iterator
              i = threads.begin(); i != threads.end(); ++i, ++m)
     {
         CBTF_Protocol_LinkedObjectGroup& entry = message[m];
-        entry.thread = *i;
+        entry.thread = i->first;
 
-        entry.linkedobjects.linkedobjects_len = dm_mappings.get<0>().count(*i);
+        entry.linkedobjects.linkedobjects_len =
+            dm_mappings.get<0>().count(i->second);
         entry.linkedobjects.linkedobjects_val =
             reinterpret_cast<CBTF_Protocol_LinkedObject*>(
                 malloc(std::max(1U, entry.linkedobjects.linkedobjects_len) *
@@ -169,8 +285,8 @@ AddressSpaces::operator std::vector<CBTF_Protocol_LinkedObjectGroup>() const
 
         u_int n = 0;
         for (MappingIndex::nth_index<0>::type::const_iterator
-                 j = dm_mappings.get<0>().lower_bound(*i),
-                 jEnd = dm_mappings.get<0>().upper_bound(*i);
+                 j = dm_mappings.get<0>().lower_bound(i->second),
+                 jEnd = dm_mappings.get<0>().upper_bound(i->second);
              j != jEnd;
              ++j, ++n)
         {
@@ -198,6 +314,9 @@ AddressSpaces::operator std::vector<CBTF_Protocol_LinkedObjectGroup>() const
 //------------------------------------------------------------------------------
 void AddressSpaces::apply(const CBTF_Protocol_LinkedObjectGroup& message)
 {
+    ThreadNameTable::Identifier thread =
+        dm_threads.add(ThreadName(message.thread));
+
     for (u_int i = 0; i < message.linkedobjects.linkedobjects_len; ++i)
     {
         const CBTF_Protocol_LinkedObject& entry =
@@ -216,10 +335,12 @@ void AddressSpaces::apply(const CBTF_Protocol_LinkedObjectGroup& message)
         }
         
         dm_mappings.insert(
-            Mapping(ThreadName(message.thread), j->second, entry.range,
+            Mapping(thread, j->second, entry.range,
                     TimeInterval(entry.time_begin, entry.time_end - 1))
             );
     }
+
+    invalidate(thread);
 }
 
 
@@ -290,6 +411,8 @@ void AddressSpaces::apply(const CBTF_Protocol_SymbolTable& message)
         }
         
         i->second = linked_object;
+
+        invalidate(boost::none);
     }
 }
 
@@ -315,9 +438,13 @@ void AddressSpaces::load(const ThreadName& thread,
             ).first;
     }
     
-    dm_mappings.insert(
-        Mapping(thread, i->second, range, TimeInterval(when, Time::TheEnd()))
-        );
+    ThreadNameTable::Identifier identifier = dm_threads.add(thread);
+
+    dm_mappings.insert(Mapping(
+        identifier, i->second, range, TimeInterval(when, Time::TheEnd())
+        ));
+
+    invalidate(identifier);
 }
 
 
@@ -331,12 +458,20 @@ void AddressSpaces::unload(const ThreadName& thread,
                            const LinkedObject& linked_object,
                            const Time& when)
 {
+    boost::optional<ThreadNameTable::Identifier> identifier =
+        dm_threads.find(thread);
+
+    if (!identifier)
+    {
+        return;
+    }
+
     for (MappingIndex::nth_index<2>::type::iterator
              i = dm_mappings.get<2>().lower_bound(
-                 boost::make_tuple(thread, linked_object)
+                 boost::make_tuple(*identifier, linked_object)
                  ),
              i_end = dm_mappings.get<2>().upper_bound(
-                 boost::make_tuple(thread, linked_object)
+                 boost::make_tuple(*identifier, linked_object)
                  );
          i != i_end;
          ++i)
@@ -349,6 +484,8 @@ void AddressSpaces::unload(const ThreadName& thread,
                 );
         }
     }
+
+    invalidate(identifier);
 }
 
 
@@ -358,18 +495,22 @@ void AddressSpaces::unload(const ThreadName& thread,
 void AddressSpaces::visitThreads(const ThreadVisitor& visitor) const
 {
     bool terminate = false;
-    std::set<ThreadName> visited;
+    std::set<ThreadName> threads;
     
     for (MappingIndex::const_iterator
              i = dm_mappings.begin(), i_end = dm_mappings.end();
+         i != i_end;
+         ++i)
+    {
+        threads.insert(dm_threads.name(i->dm_thread));
+    }
+
+    for (std::set<ThreadName>::const_iterator
+             i = threads.begin(), i_end = threads.end();
          !terminate && (i != i_end);
          ++i)
     {
-        if (visited.find(i->dm_thread) == visited.end())
-        {
-            visited.insert(i->dm_thread);
-            terminate |= !visitor(i->dm_thread);
-        }
+        terminate |= !visitor(*i);
     }
 }
 
@@ -397,12 +538,20 @@ void AddressSpaces::visitLinkedObjects(const LinkedObjectVisitor& visitor) const
 void AddressSpaces::visitLinkedObjects(const ThreadName& thread,
                                        const LinkedObjectVisitor& visitor) const
 {
+    boost::optional<ThreadNameTable::Identifier> identifier =
+        dm_threads.find(thread);
+
+    if (!identifier)
+    {
+        return;
+    }
+
     bool terminate = false;
     std::set<LinkedObject> visited;
 
     for (MappingIndex::nth_index<0>::type::const_iterator
-             i = dm_mappings.get<0>().lower_bound(thread),
-             i_end = dm_mappings.get<0>().upper_bound(thread);
+             i = dm_mappings.get<0>().lower_bound(*identifier),
+             i_end = dm_mappings.get<0>().upper_bound(*identifier);
          !terminate && (i != i_end);
          ++i)
     {
@@ -427,8 +576,8 @@ void AddressSpaces::visitMappings(const MappingVisitor& visitor) const
          !terminate && (i != i_end);
          ++i)
     {
-        terminate |= !visitor(i->dm_thread, i->dm_linked_object,
-                              i->dm_range, i->dm_interval);
+        terminate |= !visitor(dm_threads.name(i->dm_thread),
+                              i->dm_linked_object, i->dm_range, i->dm_interval);
     }
 }
 
@@ -439,15 +588,24 @@ void AddressSpaces::visitMappings(const MappingVisitor& visitor) const
 void AddressSpaces::visitMappings(const ThreadName& thread,
                                   const MappingVisitor& visitor) const
 {
+    boost::optional<ThreadNameTable::Identifier> identifier =
+        dm_threads.find(thread);
+
+    if (!identifier)
+    {
+        return;
+    }
+
     bool terminate = false;
+    const ThreadName& name = dm_threads.name(*identifier);
 
     for (MappingIndex::nth_index<0>::type::const_iterator
-             i = dm_mappings.get<0>().lower_bound(thread),
-             i_end = dm_mappings.get<0>().upper_bound(thread);
+             i = dm_mappings.get<0>().lower_bound(*identifier),
+             i_end = dm_mappings.get<0>().upper_bound(*identifier);
          !terminate && (i != i_end);
          ++i)
     {
-        terminate |= !visitor(i->dm_thread, i->dm_linked_object,
+        terminate |= !visitor(name, i->dm_linked_object,
                               i->dm_range, i->dm_interval);
     }
 }
@@ -461,19 +619,64 @@ void AddressSpaces::visitMappings(const ThreadName& thread,
                                   const TimeInterval& interval,
                                   const MappingVisitor& visitor) const
 {
-    bool terminate = false;
+    boost::optional<ThreadNameTable::Identifier> identifier =
+        dm_threads.find(thread);
 
-    for (MappingIndex::nth_index<0>::type::const_iterator
-             i = dm_mappings.get<0>().lower_bound(thread),
-             i_end = dm_mappings.get<0>().upper_bound(thread);
-         !terminate && (i != i_end);
-         ++i)
+    if (!identifier)
+    {
+        return;
+    }
+
+    boost::shared_ptr<const ThreadIndex> thread_index = index(*identifier);
+    
+    thread_index->dm_index.visit(range, boost::bind(
+        visitIntersecting<Mapping>, _1, boost::cref(thread_index->dm_thread),
+        boost::cref(thread_index->dm_mappings), boost::cref(interval),
+        boost::cref(visitor)
+        ));
+}
+
+
+
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+void AddressSpaces::resolve(
+    const ThreadName& thread,
+    const std::vector<std::pair<Address, Time> >& points,
+    std::vector<boost::optional<LinkedObject> >& linked_objects,
+    std::vector<AddressRange>& ranges
+    ) const
+{
+    linked_objects.assign(points.size(), boost::none);
+    ranges.assign(points.size(), AddressRange());
+
+    boost::optional<ThreadNameTable::Identifier> identifier =
+        dm_threads.find(thread);
+
+    if (!identifier)
+    {
+        return;
+    }
+
+    boost::shared_ptr<const ThreadIndex> thread_index = index(*identifier);
+
+    for (std::size_t i = 0, i_end = points.size(); i < i_end; ++i)
     {
-        if (i->dm_range.intersects(range) &&
-            i->dm_interval.intersects(interval))
+        boost::optional<EntityUID> found;
+
+        thread_index->dm_index.visit(
+            AddressRange(points[i].first, points[i].first), boost::bind(
+                findContaining<Mapping>, _1,
+                boost::cref(thread_index->dm_mappings),
+                boost::cref(points[i].second), boost::ref(found)
+                )
+            );
+
+        if (found)
         {
-            terminate |= !visitor(thread, i->dm_linked_object,
-                                  i->dm_range, i->dm_interval);
+            const Mapping& mapping = thread_index->dm_mappings[*found];
+            linked_objects[i] = mapping.dm_linked_object;
+            ranges[i] = mapping.dm_range;
         }
     }
 }
@@ -482,39 +685,92 @@ void AddressSpaces::visitMappings(const ThreadName& thread,
 
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
-bool ArgoNavis::Base::equivalent(const AddressSpaces& first,
-                                 const AddressSpaces& second)
+boost::shared_ptr<const AddressSpaces::ThreadIndex> AddressSpaces::index(
+    const ThreadNameTable::Identifier& thread
+    ) const
 {
-    // Is "second" missing any of the mappings from "first"?
-    
-    bool contains = true;
-    
-    first.visitMappings(
-        boost::bind(
-            containsAllMappings, second, _1, _2, _3, _4, boost::ref(contains)
-            )
+    boost::mutex::scoped_lock lock(dm_indices_mutex);
+
+    if (thread >= dm_indices.size())
+    {
+        dm_indices.resize(thread + 1);
+    }
+
+    if (dm_indices[thread])
+    {
+        return dm_indices[thread];
+    }
+
+    boost::shared_ptr<ThreadIndex> thread_index(
+        new ThreadIndex(dm_threads.name(thread))
         );
     
-    if (!contains)
+    for (MappingIndex::nth_index<0>::type::const_iterator
+             j = dm_mappings.get<0>().lower_bound(thread),
+             j_end = dm_mappings.get<0>().upper_bound(thread);
+         j != j_end;
+         ++j)
     {
-        return false;
+        std::set<AddressRange> ranges;
+        ranges.insert(j->dm_range);
+        
+        thread_index->dm_index.set(thread_index->dm_mappings.size(),
+                                   AddressSet(ranges));
+        thread_index->dm_mappings.push_back(*j);
     }
-    
-    // Is "first" missing any of the mappings from "second"?
 
-    contains = true;
-    
-    second.visitMappings(
-        boost::bind(
-            containsAllMappings, first, _1, _2, _3, _4, boost::ref(contains)
-            )
-        );
+    dm_indices[thread] = thread_index;
     
-    if (!contains)
+    return thread_index;
+}
+
+
+
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+void AddressSpaces::invalidate(
+    const boost::optional<ThreadNameTable::Identifier>& thread
+    )
+{
+    boost::mutex::scoped_lock lock(dm_indices_mutex);
+
+    if (thread)
+    {
+        if (*thread < dm_indices.size())
+        {
+            dm_indices[*thread].reset();
+        }
+    }
+    else
     {
-        return false;
+        dm_indices.clear();
     }
+}
+
+
+
+//------------------------------------------------------------------------------
+// Rather than searching all of one address space's mappings for an equivalent
+// of each mapping in the other, the mappings of both are sorted by a hash of
+// their contents, and only mappings with equal hashes are compared.
+//------------------------------------------------------------------------------
+bool ArgoNavis::Base::equivalent(const AddressSpaces& first,
+                                 const AddressSpaces& second)
+{
+    HashedMappings first_mappings, second_mappings;
+
+    first.visitMappings(
+        boost::bind(hashMapping, _1, _2, _3, _4, boost::ref(first_mappings))
+        );
+    second.visitMappings(
+        boost::bind(hashMapping, _1, _2, _3, _4, boost::ref(second_mappings))
+        );
+
+    std::sort(first_mappings.begin(), first_mappings.end(),
+              lessHash<MappingContents>);
+    std::sort(second_mappings.begin(), second_mappings.end(),
+              lessHash<MappingContents>);
     
-    // Otherwise the address spaces are equivalent
-    return true;
+    return equivalentContents(first_mappings, second_mappings,
+                              equivalentMappings);
 }
@@ -21,6 +21,7 @@
 
 #pragma once
 
+#include <boost/cstdint.hpp>
 #include <boost/operators.hpp>
 #include <iostream>
 #include <set>
@@ -39,6 +40,12 @@ namespace ArgoNavis { namespace Base {
      * to represent a non-contiguous, fragmented, portion of an address space.
      *
      * http://en.wikipedia.org/wiki/Bit_array
+     *
+     * @note    The bits are packed into 64-bit words, least significant bit
+     *          first, which is the same bit order used by the byte array of
+     *          a CBTF_Protocol_AddressBitmap. Conversions to and from those
+     *          messages are thus bulk copies, and contiguous address ranges
+     *          are found a word at a time using count-trailing-zeros.
      */
     class AddressBitmap :
         public boost::equality_comparable<AddressBitmap>
@@ -93,6 +100,17 @@ namespace ArgoNavis { namespace Base {
          *                                 within this bitmap's range.
          */
         void set(const Address& address, bool value);
+
+        /**
+         * Set the value of the given address range in this address bitmap.
+         *
+         * @param range    Address range to be set.
+         * @param value    Value to set for this address range.
+         *
+         * @throw std::invalid_argument    The given address range isn't
+         *                                 contained within this bitmap's range.
+         */
+        void set(const AddressRange& range, bool value);
         
         /**
          * Get the set of contiguous address ranges in this address bitmap 
@@ -108,8 +126,11 @@ namespace ArgoNavis { namespace Base {
         /** Address range covered by this address bitmap. */
         AddressRange dm_range;
 
-        /** Contents of this address bitmap. */
-        std::vector<bool> dm_bitmap;
+        /**
+         * Contents of this address bitmap. Bits beyond the end of the address
+         * range in the final word are always zero.
+         */
+        std::vector<boost::uint64_t> dm_bitmap;
         
     }; // class AddressBitmap
 
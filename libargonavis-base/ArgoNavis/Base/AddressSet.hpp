@@ -27,31 +27,45 @@
 
 #include <KrellInstitute/Messages/Symbol.h>
 
-#include <ArgoNavis/Base/AddressBitmap.hpp>
+#include <ArgoNavis/Base/Address.hpp>
 #include <ArgoNavis/Base/AddressRange.hpp>
 
 namespace ArgoNavis { namespace Base {
 
+    namespace Impl {
+        class AddressRangeIndex;
+        template <typename T> class EntityTable;
+    }
+
     /**
      * A set of memory addresses. Used to represent a non-contiguous, possibly
      * large and/or fragmented, portion of an address space.
      *
      * @sa http://en.wikipedia.org/wiki/Set_data_structure
      *
-     * @todo    The interface and implementation of this class is currently
-     *          as minimal as possible while still getting the job done. In
-     *          the future a more extensive interface and higher performance
-     *          implementation should be investigated.
+     * @note    Addresses are stored as a canonical list of address ranges that
+     *          are sorted, disjoint, and non-adjacent. Union, intersection and
+     *          membership operate directly upon that list, so their cost is a
+     *          function of the number of address ranges rather than addresses.
+     *          Address bitmaps are only constructed when the set is extracted
+     *          into CBTF_Protocol_AddressBitmap messages.
      */
     class AddressSet :
-        public boost::addable<AddressSet, std::set<AddressRange> >
+        public boost::addable<AddressSet, std::set<AddressRange> >,
+        public boost::andable<AddressSet>,
+        public boost::orable<AddressSet>
     {
+        friend class Impl::AddressRangeIndex;
+        template <typename T> friend class Impl::EntityTable;
         
     public:
 
         /** Default constructor. */
         AddressSet();
 
+        /** Construct an address set from a set of address ranges. */
+        AddressSet(const std::set<AddressRange>& ranges);
+        
         /**
          * Construct an address set from a CBTF_Protocol_AddressBitmap array.
          */
@@ -63,13 +77,25 @@ namespace ArgoNavis { namespace Base {
         /** Add a set of address ranges to this address set. */
         AddressSet& operator+=(const std::set<AddressRange>& ranges);
 
+        /** Intersect this address set with another one. */
+        AddressSet& operator&=(const AddressSet& other);
+
+        /** Union this address set with another one. */
+        AddressSet& operator|=(const AddressSet& other);
+
+        /** Is this address set empty? */
+        bool empty() const;
+        
+        /** Does this address set contain an address? */
+        bool contains(const Address& address) const;
+        
         /** Extract an address set into a CBTF_Protocol_AddressBitmap array. */
         void extract(CBTF_Protocol_AddressBitmap*& messages, u_int& len) const;
         
     private:
 
-        /** Address bitmap(s) containing this address set. */
-        std::vector<AddressBitmap> dm_bitmaps;
+        /** Sorted, disjoint, and non-adjacent address ranges in this set. */
+        std::vector<AddressRange> dm_ranges;
         
     }; // class AddressSet
 
@@ -25,7 +25,11 @@
 #include <boost/multi_index/composite_key.hpp>
 #include <boost/multi_index/member.hpp>
 #include <boost/multi_index/ordered_index.hpp>
+#include <boost/optional.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
 #include <map>
+#include <utility>
 #include <vector>
 
 #include <KrellInstitute/Messages/LinkedObjectEvents.h>
@@ -39,6 +43,7 @@
 #include <ArgoNavis/Base/LinkedObjectVisitor.hpp>
 #include <ArgoNavis/Base/MappingVisitor.hpp>
 #include <ArgoNavis/Base/ThreadName.hpp>
+#include <ArgoNavis/Base/ThreadNameTable.hpp>
 #include <ArgoNavis/Base/ThreadVisitor.hpp>
 #include <ArgoNavis/Base/Time.hpp>
 #include <ArgoNavis/Base/TimeInterval.hpp>
@@ -56,6 +61,12 @@ namespace ArgoNavis { namespace Base {
         /** Construct empty address spaces. */
         AddressSpaces();
 
+        /** Construct address spaces from existing address spaces. */
+        AddressSpaces(const AddressSpaces& other);
+
+        /** Replace these address spaces with a copy of other ones. */
+        AddressSpaces& operator=(const AddressSpaces& other);
+
         /**
          * Type conversion to a CBTF_Protocol_AttachedToThreads.
          *
@@ -205,19 +216,45 @@ namespace ArgoNavis { namespace Base {
          *
          * @note    The visitation is terminated immediately if "false" is
          *          returned by the visitor.
+         *
+         * @note    Mappings are found using a per-thread index over their
+         *          address ranges, so the cost is logarithmic in the number
+         *          of mappings for that thread, rather than linear.
          */
         void visitMappings(const ThreadName& thread,
                            const AddressRange& range,
                            const TimeInterval& interval,
                            const MappingVisitor& visitor) const;
+
+        /**
+         * Find the mapping containing each of the given address and time
+         * pairs within the address space of the given thread.
+         *
+         * @param thread            Name of the thread to be found.
+         * @param points            Address and time pairs to be found.
+         * @param linked_objects    Linked object mapped at each address and
+         *                          time, or none if no linked object was.
+         * @param ranges            Address range of each of those mappings.
+         *
+         * @note    Any order of the address and time pairs is supported, but
+         *          pairs sorted by address make the best use of the caches.
+         *          If more than one mapping contains a pair, the one whose
+         *          address range begins at the lowest address is found.
+         */
+        void resolve(
+            const ThreadName& thread,
+            const std::vector<std::pair<Address, Time> >& points,
+            std::vector<boost::optional<LinkedObject> >& linked_objects,
+            std::vector<AddressRange>& ranges
+            ) const;
         
     private:
 
         /** Structure representing one mapping in these address spaces. */
         struct Mapping
         {
-            /** Name of the thread containing this mapping. */
-            ThreadName dm_thread;
+            /** Identifier of the thread containing this mapping. */
+            ThreadNameTable::Identifier dm_thread;
             
             /** Linked object being mapped. */
             LinkedObject dm_linked_object;
@@ -229,7 +266,7 @@ namespace ArgoNavis { namespace Base {
             TimeInterval dm_interval;
             
             /** Constructor from initial fields. */
-            Mapping(const ThreadName& thread,
+            Mapping(const ThreadNameTable::Identifier& thread,
                     const LinkedObject& linked_object,
                     const AddressRange& range,
                     const TimeInterval& interval) :
@@ -252,7 +289,8 @@ namespace ArgoNavis { namespace Base {
             boost::multi_index::indexed_by<
                 boost::multi_index::ordered_non_unique<
                     boost::multi_index::member<
-                        Mapping, ThreadName, &Mapping::dm_thread
+                        Mapping, ThreadNameTable::Identifier,
+                        &Mapping::dm_thread
                         >
                     >,
                 boost::multi_index::ordered_non_unique<
@@ -264,7 +302,8 @@ namespace ArgoNavis { namespace Base {
                     boost::multi_index::composite_key<
                         Mapping,
                         boost::multi_index::member<
-                            Mapping, ThreadName, &Mapping::dm_thread
+                            Mapping, ThreadNameTable::Identifier,
+                            &Mapping::dm_thread
                             >,
                         boost::multi_index::member<
                             Mapping, LinkedObject, &Mapping::dm_linked_object
@@ -274,12 +313,42 @@ namespace ArgoNavis { namespace Base {
                 >
             > MappingIndex;
 
+        /**
+         * Index over the address ranges of the mappings for a single thread,
+         * whose time intervals are checked after the address ranges match.
+         */
+        struct ThreadIndex;
+
+        /** Get the index for the given thread, building it if necessary. */
+        boost::shared_ptr<const ThreadIndex> index(
+            const ThreadNameTable::Identifier& thread
+            ) const;
+
+        /** Discard the index for the given thread, or for all threads. */
+        void invalidate(
+            const boost::optional<ThreadNameTable::Identifier>& thread
+            );
+        
+        /** Names of the threads in these address spaces. */
+        ThreadNameTable dm_threads;
+
         /** Indexed list of linked objects in these address spaces. */
         std::map<FileName, LinkedObject> dm_linked_objects;
 
         /** Indexed list of mappings in these address spaces. */
         MappingIndex dm_mappings;
 
+        /** Mutual exclusion lock for the per-thread indices. */
+        mutable boost::mutex dm_indices_mutex;
+        
+        /**
+         * Per-thread indices, indexed by thread identifier, and built as they
+         * are first needed.
+         */
+        mutable std::vector<
+            boost::shared_ptr<const ThreadIndex>
+            > dm_indices;
+
     }; // class AddressSpaces
 
     /**
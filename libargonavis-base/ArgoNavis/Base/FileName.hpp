@@ -93,4 +93,19 @@ namespace ArgoNavis { namespace Base {
     /** Redirect a file name to an output stream. */
     std::ostream& operator<<(std::ostream& stream, const FileName& name);
 
+    /**
+     * Get the maximum number of threads used to checksum a single file. Unless
+     * set explicitly, this is the number of hardware threads available.
+     */
+    unsigned int getChecksumThreadCount();
+
+    /**
+     * Set the maximum number of threads used to checksum a single file. A count
+     * of one checksums all files serially in the calling thread, while a count
+     * of zero restores the default.
+     *
+     * @note    The checksums are identical regardless of the thread count.
+     */
+    void setChecksumThreadCount(unsigned int count);
+
 } } // namespace ArgoNavis::Base
@@ -48,6 +48,7 @@ namespace ArgoNavis { namespace Base {
         public boost::totally_ordered<Function>
     {
         template <typename T> friend class Impl::EntityTable;
+        friend class LinkedObject;
 
     public:
 
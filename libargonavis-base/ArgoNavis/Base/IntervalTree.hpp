@@ -0,0 +1,225 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2015 Argo Navis Technologies. All Rights Reserved.
+//
+// This program is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation; either version 2 of the License, or (at your option) any later
+// version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+// Place, Suite 330, Boston, MA  02111-1307  USA
+////////////////////////////////////////////////////////////////////////////////
+
+/** @file Declaration and definition of the IntervalTree class. */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+
+namespace ArgoNavis { namespace Base {
+
+    /**
+     * Implicit, augmented, binary search tree laid over an array of closed
+     * intervals sorted by their beginning. Each array element is a tree node,
+     * with its level given by the number of trailing one bits in its array
+     * index, and each node records the maximum ending found in its subtree.
+     * Queries for the intervals intersecting a given interval thus prune all
+     * subtrees ending before the query, and are O(log n + k) for k results
+     * without allocating any memory.
+     *
+     * The tree itself has no state besides the level of its root. The array
+     * and the maximum endings are accessed through an adapter, allowing them
+     * to be stored however the user of the tree sees fit.
+     *
+     * @tparam A    Type of adapter for the array. Must define the type Point
+     *              of the intervals' values, and provide size(), begin(i),
+     *              end(i), and maxEnd(i) member functions returning the array
+     *              size, and the beginning, ending, and maximum ending in the
+     *              subtree of its i'th element. Building the tree additionally
+     *              requires a setMaxEnd(i, end) member function.
+     *
+     * @sa https://github.com/lh3/cgranges
+     */
+    template <typename A>
+    class IntervalTree
+    {
+
+    public:
+
+        /** Type of the intervals' values. */
+        typedef typename A::Point Point;
+
+        /**
+         * Build the tree by computing the maximum ending of each node's
+         * subtree, one tree level at a time, from the leaves upwards. Nodes at
+         * level k are found at the array indices whose lowest k bits are all
+         * ones. The rightmost path of the tree may refer to nodes beyond the
+         * end of the array. For those, the maximum ending of the last real
+         * node at the level below is used instead. That node is the parent of
+         * the previous one, found to its left or right depending on whether
+         * the previous one was a right or left child.
+         *
+         * @param array    Array of intervals sorted by their beginning.
+         * @return         Level of the root of the tree.
+         */
+        static int build(A& array)
+        {
+            const std::size_t N = array.size();
+
+            if (N == 0)
+            {
+                return 0;
+            }
+
+            for (std::size_t i = 0; i < N; ++i)
+            {
+                array.setMaxEnd(i, array.end(i));
+            }
+
+            std::size_t last_i = 0;
+            Point last = array.maxEnd(0);
+
+            for (std::size_t i = 0; i < N; i += 2)
+            {
+                last_i = i;
+                last = array.maxEnd(i);
+            }
+
+            int k;
+            for (k = 1; (static_cast<std::size_t>(1) << k) <= N; ++k)
+            {
+                std::size_t x = static_cast<std::size_t>(1) << (k - 1);
+
+                for (std::size_t i = (x << 1) - 1; i < N; i += x << 2)
+                {
+                    Point end = array.end(i);
+                    end = std::max(end, array.maxEnd(i - x));
+                    end = std::max(
+                        end, ((i + x) < N) ? array.maxEnd(i + x) : last
+                        );
+                    array.setMaxEnd(i, end);
+                }
+
+                last_i = ((last_i >> k) & 1) ? (last_i - x) : (last_i + x);
+
+                if ((last_i < N) && (array.maxEnd(last_i) > last))
+                {
+                    last = array.maxEnd(last_i);
+                }
+            }
+
+            return k - 1;
+        }
+
+        /**
+         * Visit the intervals intersecting the given interval. The intervals
+         * are visited in the order of their array indices.
+         *
+         * @tparam V    Type of visitor for the intervals. Invoked with each
+         *              interval's array index and returns a boolean.
+         *
+         * @param array     Array of intervals over which the tree was built.
+         * @param levels    Level of the root of the tree.
+         * @param begin     Beginning of the interval to be found.
+         * @param end       Ending of the interval to be found.
+         * @param visitor   Visitor invoked for each interval.
+         * @return          Boolean "true" if the visitation was terminated
+         *                  by the visitor, or "false" otherwise.
+         *
+         * @note    The visitation is terminated immediately if "false" is
+         *          returned by the visitor.
+         */
+        template <typename V>
+        static bool visit(const A& array, int levels,
+                          const Point& begin, const Point& end,
+                          const V& visitor)
+        {
+            const std::size_t N = array.size();
+
+            if (N == 0)
+            {
+                return false;
+            }
+
+            // Stack of (level, node, left subtree visited?) tuples
+            struct { int k; std::size_t x; bool w; } stack[64];
+            int top = 0;
+
+            stack[top].k = levels;
+            stack[top].x = (static_cast<std::size_t>(1) << levels) - 1;
+            stack[top++].w = false;
+
+            while (top > 0)
+            {
+                int k = stack[--top].k;
+                std::size_t x = stack[top].x;
+                bool w = stack[top].w;
+
+                // Scan small subtrees linearly
+                if (k <= kLinearScanLevel)
+                {
+                    std::size_t i = (x >> k) << k;
+                    std::size_t i_end = std::min(
+                        i + (static_cast<std::size_t>(1) << (k + 1)) - 1, N
+                        );
+
+                    for (; (i < i_end) && (array.begin(i) <= end); ++i)
+                    {
+                        if ((array.end(i) >= begin) && !visitor(i))
+                        {
+                            return true;
+                        }
+                    }
+                }
+
+                // Descend into the left subtree if it may intersect
+                else if (!w)
+                {
+                    std::size_t y =
+                        x - (static_cast<std::size_t>(1) << (k - 1));
+
+                    stack[top].k = k;
+                    stack[top].x = x;
+                    stack[top++].w = true;
+
+                    if ((y >= N) || (array.maxEnd(y) >= begin))
+                    {
+                        stack[top].k = k - 1;
+                        stack[top].x = y;
+                        stack[top++].w = false;
+                    }
+                }
+
+                // Check this node and then descend into the right subtree
+                else if ((x < N) && (array.begin(x) <= end))
+                {
+                    if ((array.end(x) >= begin) && !visitor(x))
+                    {
+                        return true;
+                    }
+
+                    stack[top].k = k - 1;
+                    stack[top].x =
+                        x + (static_cast<std::size_t>(1) << (k - 1));
+                    stack[top++].w = false;
+                }
+            }
+
+            return false;
+        }
+
+    private:
+
+        /** Maximum tree level of subtrees that are scanned linearly. */
+        static const int kLinearScanLevel = 3;
+
+    }; // class IntervalTree<A>
+
+} } // namespace ArgoNavis::Base
@@ -22,13 +22,18 @@
 #pragma once
 
 #include <boost/cstdint.hpp>
+#include <boost/filesystem.hpp>
 #include <boost/operators.hpp>
+#include <boost/optional.hpp>
 #include <boost/shared_ptr.hpp>
+#include <cstddef>
 #include <iostream>
 #include <string>
+#include <vector>
 
 #include <KrellInstitute/Messages/Symbol.h>
 
+#include <ArgoNavis/Base/Address.hpp>
 #include <ArgoNavis/Base/AddressRange.hpp>
 #include <ArgoNavis/Base/FileName.hpp>
 #include <ArgoNavis/Base/FunctionVisitor.hpp>
@@ -57,6 +62,20 @@ namespace ArgoNavis { namespace Base {
         
     public:
 
+        /**
+         * Type of identifier for a function or statement within this linked
+         * object, as returned by resolve(). Unlike Function and Statement,
+         * these identifiers are plain integers, and so are inexpensive to
+         * store in large quantities.
+         */
+        typedef boost::uint32_t Identifier;
+        
+        /** Identifier indicating that no function or statement was found. */
+        static Identifier TheNone()
+        {
+            return 0xFFFFFFFF;
+        }
+        
         /**
          * Construct a linked object from its file. This linked object initially
          * has no symbols (functions, statements, etc.)
@@ -69,9 +88,37 @@ namespace ArgoNavis { namespace Base {
          * Construct a linked object from a CBTF_Protocol_SymbolTable.
          *
          * @param message    Message containing this linked object.
+         * @param lazy       Boolean "true" if decoding the addresses of this
+         *                   linked object's functions, statements, etc. should
+         *                   be deferred until they are first queried, or
+         *                   "false" if they should all be decoded now.
+         *
+         * @note    Lazy construction is significantly faster when most of the
+         *          linked objects constructed are never queried by address,
+         *          as is typical for the many shared libraries of a process.
          */
-        LinkedObject(const CBTF_Protocol_SymbolTable& message);
+        LinkedObject(const CBTF_Protocol_SymbolTable& message,
+                     bool lazy = true);
 
+        /**
+         * Load a linked object from a symbol table cache. Loading a linked
+         * object from the cache is significantly faster than constructing it
+         * from a CBTF_Protocol_SymbolTable because its addresses, and their
+         * index, are used directly from the memory mapped cache file.
+         *
+         * @param directory    Directory containing the symbol table cache.
+         * @param file         Name of the linked object's file.
+         * @return             Linked object for that file, or none if the
+         *                     cache doesn't contain that linked object.
+         *
+         * @note    The cache is keyed by both the path and checksum of the
+         *          linked object's file. A cache entry is thus never found
+         *          for a file whose contents have since been modified.
+         */
+        static boost::optional<LinkedObject> load(
+            const boost::filesystem::path& directory, const FileName& file
+            );
+        
         /**
          * Type conversion to a CBTF_Protocol_SymbolTable.
          *
@@ -105,6 +152,19 @@ namespace ArgoNavis { namespace Base {
         /** Get the name of this linked object's file. */
         FileName file() const;
 
+        /**
+         * Get a hash of the contents of this linked object. Equivalent linked
+         * objects always have equal hashes, allowing identical linked objects
+         * (e.g. from many processes) to be bucketed by their hashes before
+         * being compared with equivalent().
+         *
+         * @return    Hash of the contents of this linked object.
+         *
+         * @note    The hashes are cached, and are only recomputed after this
+         *          linked object is modified.
+         */
+        std::size_t hash() const;
+
         /**
          * Visit the functions contained within this linked object.
          *
@@ -192,6 +252,66 @@ namespace ArgoNavis { namespace Base {
         void visitStatements(const AddressRange& range,
                              const StatementVisitor& vistor) const;
 
+        /**
+         * Save this linked object to a symbol table cache, replacing any
+         * existing entry for this linked object's file.
+         *
+         * @param directory    Directory containing the symbol table cache.
+         *
+         * @throw std::invalid_argument    This linked object's file has no
+         *                                 checksum.
+         * @throw std::runtime_error       The cache file couldn't be written.
+         */
+        void save(const boost::filesystem::path& directory) const;
+        
+        /**
+         * Find the function and statement containing each of the given
+         * addresses. When more than one function (or statement) contains an
+         * address, the one whose containing address range begins closest to
+         * the address is chosen. E.g. the innermost of several nested inlined
+         * functions.
+         *
+         * @param addresses     Addresses to be found, sorted in ascending
+         *                      order.
+         * @param functions     Identifier of the function containing each
+         *                      address, or TheNone() if none does.
+         * @param statements    Identifier of the statement containing each
+         *                      address, or TheNone() if none does.
+         *
+         * @throw std::invalid_argument    The given addresses aren't sorted.
+         *
+         * @note    All of the addresses are found in a single sweep over the
+         *          symbol table, which is much faster than calling
+         *          visitFunctions() and visitStatements() once per address.
+         *
+         * @note    The addresses specified must be relative to the beginning
+         *          of this linked object rather than an absolute address from
+         *          the address space of a specific process.
+         */
+        void resolve(const std::vector<Address>& addresses,
+                     std::vector<Identifier>& functions,
+                     std::vector<Identifier>& statements) const;
+
+        /**
+         * Get the function with the given identifier.
+         *
+         * @param identifier    Identifier returned by resolve().
+         * @return              Function with that identifier.
+         *
+         * @throw std::invalid_argument    The given identifier isn't valid.
+         */
+        Function function(const Identifier& identifier) const;
+
+        /**
+         * Get the statement with the given identifier.
+         *
+         * @param identifier    Identifier returned by resolve().
+         * @return              Statement with that identifier.
+         *
+         * @throw std::invalid_argument    The given identifier isn't valid.
+         */
+        Statement statement(const Identifier& identifier) const;
+        
         /**
          * Redirection to an output stream.
          *
@@ -206,6 +326,9 @@ namespace ArgoNavis { namespace Base {
         friend std::ostream& operator<<(std::ostream& stream,
                                         const LinkedObject& linked_object);
 
+        friend bool equivalent(const LinkedObject& first,
+                               const LinkedObject& second);
+        
     private:
 
         /**
@@ -231,6 +354,10 @@ namespace ArgoNavis { namespace Base {
      * @note    Differs from the LinkedObject equality operator in that it
      *          compares the contents of the two linked objects rather than
      *          just their symbol table pointers.
+     *
+     * @note    Only functions, loops, and statements with equal hashes are
+     *          compared, so this takes time linear in the size of the two
+     *          linked objects, and is nearly free when their hashes differ.
      */
     bool equivalent(const LinkedObject& first, const LinkedObject& second);
 
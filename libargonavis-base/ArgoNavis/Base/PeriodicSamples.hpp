@@ -22,8 +22,8 @@
 
 #include <boost/cstdint.hpp>
 #include <boost/optional.hpp>
-#include <map>
 #include <string>
+#include <vector>
 
 #include <ArgoNavis/Base/PeriodicSampleVisitor.hpp>
 #include <ArgoNavis/Base/Time.hpp>
@@ -33,9 +33,22 @@ namespace ArgoNavis { namespace Base {
 
     /**
      * Zero or more samples taken at specific (usually periodic) points in time.
+     *
+     * @note    Samples are stored as two parallel, time-sorted, columns rather
+     *          than in an associative container. Samples almost always arrive
+     *          in time order, so adding one is normally a simple append, with
+     *          a sorted insertion used as the fallback for out-of-order times.
+     *          This keeps the per-sample overhead to the 16 bytes of the time
+     *          and value themselves, and turns every scan of the samples into
+     *          a linear walk over contiguous memory.
      */
     class PeriodicSamples
     {
+        friend void visitConcurrently(
+            const std::vector<PeriodicSamples>& group,
+            const boost::optional<TimeInterval>& interval,
+            const PeriodicSampleVisitor& visitor
+            );
         
     public:
 
@@ -70,7 +83,7 @@ namespace ArgoNavis { namespace Base {
         /** Number of samples. */
         boost::uint64_t size() const
         {
-            return dm_samples.size();
+            return dm_times.size();
         }
         
         /** Smallest time interval containing all of these samples. */
@@ -126,8 +139,11 @@ namespace ArgoNavis { namespace Base {
         /** Kind of sampled values. */
         Kind dm_kind;
 
-        /** Individual samples indexed by time. */
-        std::map<Time, boost::uint64_t> dm_samples;
+        /** Time of each individual sample (sorted in ascending order). */
+        std::vector<Time> dm_times;
+
+        /** Value of each individual sample (parallel to dm_times). */
+        std::vector<boost::uint64_t> dm_values;
         
     }; // class PeriodicSamples
 
@@ -43,6 +43,21 @@ namespace ArgoNavis { namespace Base {
     /** Get the average sampling rate of all samples in a group. */
     Time getAverageSamplingRate(const PeriodicSamplesGroup& group);
 
+    /**
+     * Get the number of threads used to resample and combine a group. Unless
+     * set explicitly, this is the number of hardware threads available.
+     */
+    unsigned int getResamplingThreadCount();
+
+    /**
+     * Set the number of threads used to resample and combine a group. A count
+     * of one performs all of the work serially in the calling thread, while a
+     * count of zero restores the default.
+     *
+     * @note    The results are identical regardless of the thread count.
+     */
+    void setResamplingThreadCount(unsigned int count);
+
     /** Resample a group at a fixed sampling rate. */
     PeriodicSamplesGroup getResampled(
         const PeriodicSamplesGroup& group,
@@ -50,6 +50,7 @@ namespace ArgoNavis { namespace Base {
         public boost::totally_ordered<Statement>
     {
         template <typename T> friend class Impl::EntityTable;
+        friend class LinkedObject;
 
     public:
 
@@ -24,6 +24,7 @@
 #include <boost/cstdint.hpp>
 #include <boost/operators.hpp>
 #include <boost/optional.hpp>
+#include <cstddef>
 #include <iostream>
 #include <string>
 
@@ -148,5 +149,8 @@ namespace ArgoNavis { namespace Base {
         
     /** Redirect a thread name to an output stream. */
     std::ostream& operator<<(std::ostream& stream, const ThreadName& name);
+
+    /** Compute the hash value of a thread name. */
+    std::size_t hash_value(const ThreadName& name);
             
 } } // namespace ArgoNavis::Base
@@ -0,0 +1,100 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2017 Argo Navis Technologies. All Rights Reserved.
+//
+// This program is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation; either version 2 of the License, or (at your option) any later
+// version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+// Place, Suite 330, Boston, MA  02111-1307  USA
+////////////////////////////////////////////////////////////////////////////////
+
+/** @file Declaration of the ThreadNameTable class. */
+
+#pragma once
+
+#include <boost/cstdint.hpp>
+#include <boost/optional.hpp>
+#include <boost/unordered_map.hpp>
+#include <deque>
+
+#include <ArgoNavis/Base/ThreadName.hpp>
+
+namespace ArgoNavis { namespace Base {
+
+    /**
+     * Table of interned thread names. Each distinct thread name added to the
+     * table is assigned a dense identifier, starting at zero, allowing tables
+     * of per-thread data to be vectors indexed by that identifier rather than
+     * associative containers keyed by the (comparatively expensive to compare)
+     * thread name itself.
+     *
+     * @note    Identifiers are only meaningful within the table that assigned
+     *          them, and are never reassigned for the life of that table.
+     */
+    class ThreadNameTable
+    {
+
+    public:
+
+        /** Type of identifier assigned to each thread name. */
+        typedef boost::uint32_t Identifier;
+
+        /** Construct an empty thread name table. */
+        ThreadNameTable();
+
+        /**
+         * Add a thread name to this table if it isn't already present.
+         *
+         * @param name    Thread name to be added.
+         * @return        Identifier assigned to that thread name.
+         */
+        Identifier add(const ThreadName& name);
+
+        /**
+         * Find the identifier of a thread name in this table.
+         *
+         * @param name    Thread name to be found.
+         * @return        Identifier assigned to that thread name, or "none"
+         *                if it isn't present in this table.
+         */
+        boost::optional<Identifier> find(const ThreadName& name) const;
+
+        /**
+         * Get the thread name with the given identifier.
+         *
+         * @param identifier    Identifier assigned to the thread name.
+         * @return              Thread name with that identifier. The reference
+         *                      remains valid for the life of this table.
+         *
+         * @throw std::invalid_argument    The given identifier isn't valid.
+         */
+        const ThreadName& name(const Identifier& identifier) const;
+
+        /** Get the number of thread names in this table. */
+        Identifier size() const
+        {
+            return dm_names.size();
+        }
+
+    private:
+
+        /**
+         * Thread name with each identifier. A deque, rather than a vector,
+         * so that references to the names survive adding further names.
+         */
+        std::deque<ThreadName> dm_names;
+
+        /** Identifier of each thread name. */
+        boost::unordered_map<ThreadName, Identifier> dm_identifiers;
+
+    }; // class ThreadNameTable
+
+} } // namespace ArgoNavis::Base
@@ -0,0 +1,203 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2015 Argo Navis Technologies. All Rights Reserved.
+//
+// This program is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation; either version 2 of the License, or (at your option) any later
+// version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+// Place, Suite 330, Boston, MA  02111-1307  USA
+////////////////////////////////////////////////////////////////////////////////
+
+/** @file Definition of the content hashing functions. */
+
+#pragma once
+
+#include <algorithm>
+#include <boost/cstdint.hpp>
+#include <boost/filesystem/path.hpp>
+#include <boost/functional/hash.hpp>
+#include <boost/optional.hpp>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include <ArgoNavis/Base/FileName.hpp>
+#include <ArgoNavis/Base/Interval.hpp>
+#include <ArgoNavis/Base/ThreadName.hpp>
+
+namespace ArgoNavis { namespace Base { namespace Impl {
+
+    /**
+     * Combine the hash of an optional value with the given hash. An absent
+     * value hashes differently than any of the values that might be present.
+     */
+    template <typename T>
+    void hashCombine(std::size_t& seed, const boost::optional<T>& value)
+    {
+        boost::hash_combine(seed, value ? true : false);
+        if (value)
+        {
+            boost::hash_combine(seed, *value);
+        }
+    }
+
+    /** Combine the hash of a file name with the given hash. */
+    inline void hashCombine(std::size_t& seed, const FileName& file)
+    {
+        // The checksum isn't hashed because a file name without a checksum
+        // is equal to one with the same path having any checksum. The path
+        // is hashed element by element, exactly as paths are compared, so
+        // that equal paths spelled differently (e.g. "/a//b" and "/a/b") have
+        // equal hashes.
+        const boost::filesystem::path& path = file.path();
+        for (boost::filesystem::path::const_iterator
+                 i = path.begin(); i != path.end(); ++i)
+        {
+            boost::hash_combine(seed, i->native());
+        }
+    }
+
+    /** Combine the hash of an interval with the given hash. */
+    template <typename T, typename M>
+    void hashCombine(std::size_t& seed, const Interval<T, M>& interval)
+    {
+        boost::hash_combine(seed, static_cast<boost::uint64_t>(
+                                interval.begin()
+                                ));
+        boost::hash_combine(seed, static_cast<boost::uint64_t>(
+                                interval.end()
+                                ));
+    }
+
+    /** Combine the hash of a thread name with the given hash. */
+    inline void hashCombine(std::size_t& seed, const ThreadName& thread)
+    {
+        boost::hash_combine(seed, thread);
+    }
+
+    /**
+     * Compare two contents by only their hash. Used to sort lists of
+     * contents paired with their hashes.
+     */
+    template <typename K>
+    bool lessHash(const std::pair<std::size_t, K>& first,
+                  const std::pair<std::size_t, K>& second)
+    {
+        return first.first < second.first;
+    }
+
+    /**
+     * Compute a single hash of a list of contents, sorted by their hashes,
+     * that is independent of both the order and the multiplicity of those
+     * contents.
+     *
+     * @param contents    Contents, paired with their hashes, sorted by hash.
+     * @return            Hash of those contents.
+     */
+    template <typename K>
+    std::size_t hashContents(
+        const std::vector<std::pair<std::size_t, K> >& contents
+        )
+    {
+        std::size_t seed = 0;
+
+        for (typename std::vector<std::pair<std::size_t, K> >::const_iterator
+                 i = contents.begin(); i != contents.end(); ++i)
+        {
+            if ((i == contents.begin()) || ((i - 1)->first != i->first))
+            {
+                boost::hash_combine(seed, i->first);
+            }
+        }
+
+        return seed;
+    }
+
+    /**
+     * Are two lists of contents, sorted by their hashes, equivalent? I.e. does
+     * each list contain an equivalent of every content in the other list?
+     * Equivalent contents must have equal hashes, so only contents with equal
+     * hashes are ever compared, and the comparison takes linear time unless
+     * there are many hash collisions.
+     *
+     * @param first         First contents, paired with their hashes,
+     *                      sorted by hash.
+     * @param second        Second contents, paired with their hashes,
+     *                      sorted by hash.
+     * @param equivalent    Predicate for determining if a content from the
+     *                      first list is equivalent to one from the second.
+     * @return              Boolean "true" if the two lists are equivalent,
+     *                      or "false" otherwise.
+     */
+    template <typename K, typename P>
+    bool equivalentContents(
+        const std::vector<std::pair<std::size_t, K> >& first,
+        const std::vector<std::pair<std::size_t, K> >& second,
+        const P& equivalent
+        )
+    {
+        typedef typename std::vector<
+            std::pair<std::size_t, K>
+            >::const_iterator Iterator;
+
+        for (Iterator i = first.begin(), j = second.begin();
+             (i != first.end()) || (j != second.end());)
+        {
+            if ((i == first.end()) || (j == second.end()) ||
+                (i->first != j->first))
+            {
+                return false;
+            }
+
+            Iterator i_end = i, j_end = j;
+            while ((i_end != first.end()) && (i_end->first == i->first))
+            {
+                ++i_end;
+            }
+            while ((j_end != second.end()) && (j_end->first == j->first))
+            {
+                ++j_end;
+            }
+
+            for (Iterator x = i; x != i_end; ++x)
+            {
+                Iterator y = j;
+                while ((y != j_end) && !equivalent(x->second, y->second))
+                {
+                    ++y;
+                }
+                if (y == j_end)
+                {
+                    return false;
+                }
+            }
+
+            for (Iterator y = j; y != j_end; ++y)
+            {
+                Iterator x = i;
+                while ((x != i_end) && !equivalent(x->second, y->second))
+                {
+                    ++x;
+                }
+                if (x == i_end)
+                {
+                    return false;
+                }
+            }
+
+            i = i_end;
+            j = j_end;
+        }
+
+        return true;
+    }
+
+} } } // namespace ArgoNavis::Base::Impl
@@ -21,18 +21,26 @@
 
 #pragma once
 
+#include <algorithm>
 #include <boost/assert.hpp>
-#include <boost/dynamic_bitset.hpp>
+#include <boost/bind.hpp>
 #include <boost/optional.hpp>
+#include <boost/ref.hpp>
 #include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <cstddef>
 #include <set>
 #include <utility>
 #include <vector>
 
+#include <KrellInstitute/Messages/Symbol.h>
+
+#include <ArgoNavis/Base/AddressBitmap.hpp>
 #include <ArgoNavis/Base/AddressRange.hpp>
 #include <ArgoNavis/Base/AddressSet.hpp>
 
 #include "AddressRangeIndex.hpp"
+#include "ContentHash.hpp"
 #include "EntityUID.hpp"
 
 namespace ArgoNavis { namespace Base { namespace Impl {
@@ -43,7 +51,18 @@ namespace ArgoNavis { namespace Base { namespace Impl {
      * Table of entities (functions, loops, statements, etc.) contained within
      * a symbol table. An index is used to accelerate visitation by addresses.
      *
+     * Entities may be added with their addresses still encoded as address
+     * bitmaps. Decoding those bitmaps into address sets, and indexing them,
+     * is deferred until the addresses of any entity in the table are first
+     * needed. Tables that are never queried by address never pay that cost.
+     * Similarly, a previously built index may be adopted, in which case the
+     * address sets are recovered from its rows when they are first needed.
+     *
+     * The content hash of every entity is computed the first time the table
+     * is hashed or compared, and is cached until the table is next modified.
+     *
      * @tparam T    Type containing the (non-address) fields for the entities.
+     *              Must provide an equality operator and a hash_value().
      */
     template <typename T>
     class EntityTable
@@ -53,9 +72,66 @@ namespace ArgoNavis { namespace Base { namespace Impl {
 
         /** Construct an empty entity table. */
         EntityTable() :
+            dm_mutex(),
+            dm_entities(),
+            dm_pending(),
+            dm_pending_data(),
+            dm_pending_mapping(),
+            dm_pending_rows(NULL),
+            dm_pending_row_count(0),
+            dm_pending_levels(0),
+            dm_index(),
+            dm_hashes(),
+            dm_hash()
+        {
+        }
+
+        /** Construct an entity table from an existing one. */
+        EntityTable(const EntityTable& other) :
+            dm_mutex(),
             dm_entities(),
-            dm_index()
+            dm_pending(),
+            dm_pending_data(),
+            dm_pending_mapping(),
+            dm_pending_rows(NULL),
+            dm_pending_row_count(0),
+            dm_pending_levels(0),
+            dm_index(),
+            dm_hashes(),
+            dm_hash()
         {
+            boost::mutex::scoped_lock lock(other.dm_mutex);
+            dm_entities = other.dm_entities;
+            dm_pending = other.dm_pending;
+            dm_pending_data = other.dm_pending_data;
+            dm_pending_mapping = other.dm_pending_mapping;
+            dm_pending_rows = other.dm_pending_rows;
+            dm_pending_row_count = other.dm_pending_row_count;
+            dm_pending_levels = other.dm_pending_levels;
+            dm_index = other.dm_index;
+            dm_hashes = other.dm_hashes;
+            dm_hash = other.dm_hash;
+        }
+
+        /** Replace this entity table with a copy of another one. */
+        EntityTable& operator=(const EntityTable& other)
+        {
+            if (&other != this)
+            {
+                EntityTable copy(other);
+                boost::mutex::scoped_lock lock(dm_mutex);
+                dm_entities.swap(copy.dm_entities);
+                dm_pending.swap(copy.dm_pending);
+                dm_pending_data.swap(copy.dm_pending_data);
+                dm_pending_mapping.swap(copy.dm_pending_mapping);
+                dm_pending_rows = copy.dm_pending_rows;
+                dm_pending_row_count = copy.dm_pending_row_count;
+                dm_pending_levels = copy.dm_pending_levels;
+                dm_index = copy.dm_index;
+                dm_hashes.swap(copy.dm_hashes);
+                dm_hash = copy.dm_hash;
+            }
+            return *this;
         }
         
         /**
@@ -70,10 +146,12 @@ namespace ArgoNavis { namespace Base { namespace Impl {
             const boost::optional<AddressSet>& addresses = boost::none
             )
         {
+            invalidate();
+            
             if (addresses)
             {
                 dm_entities.push_back(std::make_pair(fields, *addresses));
-                index(dm_entities.size() - 1, false);
+                index(dm_entities.size() - 1);
             }
             else
             {
@@ -82,6 +160,68 @@ namespace ArgoNavis { namespace Base { namespace Impl {
             
             return dm_entities.size() - 1;
         }
+
+        /**
+         * Add a new entity to this table whose addresses are given by an
+         * array of address bitmaps. The bitmaps are copied into a single flat
+         * buffer, but are not decoded until the addresses of an entity in this
+         * table are first needed.
+         *
+         * @param fields      Fields of the new entity.
+         * @param messages    Address bitmaps for the new entity.
+         * @param len         Number of address bitmaps.
+         * @return            Unique identifier for the new entity.
+         */
+        EntityUID add(const T& fields,
+                      const CBTF_Protocol_AddressBitmap* messages, u_int len)
+        {
+            dm_entities.push_back(std::make_pair(fields, AddressSet()));
+            
+            boost::mutex::scoped_lock lock(dm_mutex);
+            invalidate();
+            for (u_int i = 0; i < len; ++i)
+            {
+                const CBTF_Protocol_AddressBitmap& message = messages[i];
+
+                PendingBitmap pending;
+                pending.dm_uid = dm_entities.size() - 1;
+                pending.dm_range = message.range;
+                pending.dm_offset = dm_pending_data.size();
+                pending.dm_length = message.bitmap.data.data_len;
+                dm_pending.push_back(pending);
+                
+                dm_pending_data.insert(
+                    dm_pending_data.end(),
+                    message.bitmap.data.data_val,
+                    message.bitmap.data.data_val + message.bitmap.data.data_len
+                    );
+            }
+            
+            return dm_entities.size() - 1;
+        }
+        
+        /**
+         * Adopt a previously built index as the addresses of the entities
+         * already in this table. The rows are neither copied nor decoded
+         * until the addresses of an entity in this table are first needed.
+         *
+         * @param mapping    Memory mapping containing the rows, which is
+         *                   kept alive until the rows have been decoded.
+         * @param rows       Rows previously obtained from addressIndex().
+         * @param count      Number of rows.
+         * @param levels     Level of the root of the index's tree.
+         */
+        void adopt(const boost::shared_ptr<const void>& mapping,
+                   const AddressRangeIndex::Row* rows, std::size_t count,
+                   int levels)
+        {
+            boost::mutex::scoped_lock lock(dm_mutex);
+            invalidate();
+            dm_pending_mapping = mapping;
+            dm_pending_rows = rows;
+            dm_pending_row_count = count;
+            dm_pending_levels = levels;
+        }
         
         /**
          * Associate the given address ranges with the given entity.
@@ -92,8 +232,10 @@ namespace ArgoNavis { namespace Base { namespace Impl {
         void add(const EntityUID& uid, const std::set<AddressRange>& ranges)
         {
             BOOST_ASSERT(uid < dm_entities.size());
+            decode();
+            invalidate();
             dm_entities[uid].second += ranges;
-            index(uid, true);
+            index(uid);
         }
 
         /**
@@ -105,6 +247,7 @@ namespace ArgoNavis { namespace Base { namespace Impl {
         const AddressSet& addresses(const EntityUID& uid) const
         {
             BOOST_ASSERT(uid < dm_entities.size());
+            decode();
             return dm_entities[uid].second;
         }
         
@@ -123,9 +266,11 @@ namespace ArgoNavis { namespace Base { namespace Impl {
          */
         EntityUID clone(const EntityTable& table, const EntityUID& uid)
         {
-            BOOST_ASSERT(uid < table.dm_entities.size());            
+            BOOST_ASSERT(uid < table.dm_entities.size());
+            table.decode();
+            invalidate();
             dm_entities.push_back(table.dm_entities[uid]);
-            index(dm_entities.size() - 1, false);
+            index(dm_entities.size() - 1);
             return dm_entities.size() - 1;
         }
         
@@ -141,12 +286,85 @@ namespace ArgoNavis { namespace Base { namespace Impl {
             return dm_entities[uid].first;
         }
         
+        /**
+         * Reserve space in this table for the given number of entities.
+         *
+         * @param size    Number of entities for which to reserve space.
+         */
+        void reserve(const EntityUID& size)
+        {
+            dm_entities.reserve(size);
+        }
+        
         /** Get the size of this table. */
         EntityUID size() const
         {
             return dm_entities.size();
         }
                 
+        /**
+         * Get a hash of the contents of this table. The hash is independent
+         * of the order of the entities, and of any duplicated entities, so
+         * equivalent tables always have equal hashes.
+         */
+        std::size_t hash() const
+        {
+            decode();
+            boost::mutex::scoped_lock lock(dm_mutex);
+            rehash();
+            return *dm_hash;
+        }
+
+        /**
+         * Is this table equivalent to another one? I.e. does each table
+         * contain an entity with equivalent fields and addresses for every
+         * entity in the other table? Only entities with equal content hashes
+         * are compared, so this takes linear time in the size of the tables
+         * once their hashes have been computed.
+         *
+         * @param other    Table to be compared.
+         * @return         Boolean "true" if the two tables are equivalent,
+         *                 or "false" otherwise.
+         */
+        bool equivalent(const EntityTable& other) const
+        {
+            if (hash() != other.hash())
+            {
+                return false;
+            }
+
+            return equivalentContents(
+                dm_hashes, other.dm_hashes, boost::bind(
+                    &EntityTable::equivalentEntities, this,
+                    boost::cref(other), _1, _2
+                    )
+                );
+        }
+        
+        /** Get the index used to find the entities by addresses. */
+        const AddressRangeIndex& addressIndex() const
+        {
+            decode();
+            return dm_index;
+        }
+        
+        /**
+         * Find the entity containing each of the given addresses.
+         *
+         * @param addresses    Addresses to be found, sorted in ascending order.
+         * @param uids         Unique identifier of the entity containing each
+         *                     address, or "none" for addresses not contained
+         *                     by any entity.
+         * @param none         Unique identifier indicating no entity.
+         */
+        void resolve(const std::vector<Address>& addresses,
+                     std::vector<EntityUID>& uids,
+                     const EntityUID& none) const
+        {
+            decode();
+            dm_index.resolve(addresses, uids, none);
+        }
+        
         /**
          * Visit all of the entities in this table.
          *
@@ -202,31 +420,12 @@ namespace ArgoNavis { namespace Base { namespace Impl {
                    const V& visitor) const
         {
             E entity(symbol_table, 0);
-            bool terminate = false;
-            boost::dynamic_bitset<> visited(dm_entities.size());
 
-            AddressRangeIndex::nth_index<1>::type::const_iterator i =
-                dm_index.get<1>().lower_bound(range.begin());
-            
-            if (i != dm_index.get<1>().begin())
-            {
-                --i;
-            }
-            
-            AddressRangeIndex::nth_index<1>::type::const_iterator i_end = 
-                dm_index.get<1>().upper_bound(range.end());
-            
-            for (; !terminate && (i != i_end); ++i)
-            {
-                if (i->dm_range.intersects(range) &&
-                    (i->dm_uid < visited.size()) &&
-                    !visited[i->dm_uid])
-                {
-                    visited[i->dm_uid] = true;
-                    entity.dm_unique_identifier = i->dm_uid;
-                    terminate |= !visitor(entity);
-                }
-            }
+            decode();
+            dm_index.visit(range, boost::bind(
+                &EntityTable::template visitEntity<E, V>, _1,
+                boost::ref(entity), boost::cref(visitor)
+                ));
         }
         
         /**
@@ -254,37 +453,28 @@ namespace ArgoNavis { namespace Base { namespace Impl {
                    const V& visitor) const
         {
             E entity(symbol_table, 0);
-            bool terminate = false;
-            boost::dynamic_bitset<> visited(dm_entities.size());
-            
+            std::vector<EntityUID> uids;
+
+            decode();
             std::set<AddressRange> ranges = set;
             
             for (std::set<AddressRange>::const_iterator
-                     r = ranges.begin(); !terminate && (r != ranges.end()); ++r)
+                     r = ranges.begin(); r != ranges.end(); ++r)
             {
-                const AddressRange& range = *r;
-                
-                AddressRangeIndex::nth_index<1>::type::const_iterator i = 
-                    dm_index.get<1>().lower_bound(range.begin());
+                dm_index.visit(*r, boost::bind(
+                    &EntityTable::collectEntity, _1, boost::ref(uids)
+                    ));
+            }
+
+            std::sort(uids.begin(), uids.end());
+            uids.erase(std::unique(uids.begin(), uids.end()), uids.end());
             
-                if (i != dm_index.get<1>().begin())
-                {
-                    --i;
-                }
-                
-                AddressRangeIndex::nth_index<1>::type::const_iterator i_end = 
-                    dm_index.get<1>().upper_bound(range.end());
-                
-                for (; !terminate && (i != i_end); ++i)
+            for (std::vector<EntityUID>::const_iterator
+                     i = uids.begin(); i != uids.end(); ++i)
+            {
+                if (!visitEntity<E, V>(*i, entity, visitor))
                 {
-                    if (i->dm_range.intersects(range) &&
-                        (i->dm_uid < visited.size()) &&
-                        !visited[i->dm_uid])
-                    {
-                        visited[i->dm_uid] = true;
-                        entity.dm_unique_identifier = i->dm_uid;
-                        terminate |= !visitor(entity);
-                    }
+                    break;
                 }
             }
         }
@@ -293,37 +483,194 @@ namespace ArgoNavis { namespace Base { namespace Impl {
 
         /** Type of container used to store the list of entities. */
         typedef std::vector< std::pair<T, AddressSet> > List;
+
+        /** Structure describing an address bitmap not yet decoded. */
+        struct PendingBitmap
+        {
+            /** Unique identifier of the entity with this address bitmap. */
+            EntityUID dm_uid;
+
+            /** Address range covered by this address bitmap. */
+            CBTF_Protocol_AddressRange dm_range;
+
+            /** Offset of this address bitmap's bits in the flat buffer. */
+            std::size_t dm_offset;
+
+            /** Length (in bytes) of this address bitmap's bits. */
+            u_int dm_length;
+        };
         
         /**
-         * Index the given entity by its addresses.
-         *
-         * @param uid           Unique identifier for the entity to be indexed.
-         * @param reindexing    Boolean "true" if the entity is being reindexed,
-         *                      or "false" otherwise. This is an optimization to
-         *                      eliminate the erase() in the cases where it is
-         *                      known to be unnecessary.
+         * Decode any pending address bitmaps into the address sets of their
+         * entities, and index those entities by their addresses.
          */
-        void index(const EntityUID& uid, bool reindexing)
+        void decode() const
         {
-            if (reindexing)
+            boost::mutex::scoped_lock lock(dm_mutex);
+
+            if (dm_pending_mapping)
             {
-                dm_index.get<0>().erase(uid);
+                for (std::size_t i = 0; i < dm_pending_row_count; ++i)
+                {
+                    const AddressRangeIndex::Row& row = dm_pending_rows[i];
+                    dm_entities[row.dm_uid].second.dm_ranges.push_back(
+                        row.dm_range
+                        );
+                }
+                
+                dm_index.assign(dm_pending_rows, dm_pending_row_count,
+                                dm_pending_levels);
+
+                dm_pending_mapping.reset();
+                dm_pending_rows = NULL;
+                dm_pending_row_count = 0;
             }
-            
-            std::set<AddressRange> ranges = dm_entities[uid].second;
-            
-            for (std::set<AddressRange>::const_iterator
-                     i = ranges.begin(); i != ranges.end(); ++i)
+
+            for (typename std::vector<PendingBitmap>::const_iterator
+                     i = dm_pending.begin(); i != dm_pending.end(); ++i)
             {
-                dm_index.insert(AddressRangeIndexRow(uid, *i));
+                CBTF_Protocol_AddressBitmap message;
+                message.range = i->dm_range;
+                message.bitmap.data.data_len = i->dm_length;
+                message.bitmap.data.data_val = (i->dm_length == 0) ? NULL :
+                    &dm_pending_data[i->dm_offset];
+
+                dm_entities[i->dm_uid].second +=
+                    AddressBitmap(message).ranges(true);
+
+                typename std::vector<PendingBitmap>::const_iterator
+                    next = i + 1;
+                if ((next == dm_pending.end()) || (next->dm_uid != i->dm_uid))
+                {
+                    dm_index.set(i->dm_uid, dm_entities[i->dm_uid].second);
+                }
+            }
+
+            std::vector<PendingBitmap>().swap(dm_pending);
+            std::vector<uint8_t>().swap(dm_pending_data);
+        }
+        
+        /**
+         * Compute the content hash of every entity in this table, and of
+         * the table as a whole, unless they are already cached. The caller
+         * must hold the mutex and must have decoded any pending addresses.
+         */
+        void rehash() const
+        {
+            if (dm_hash)
+            {
+                return;
+            }
+
+            dm_hashes.clear();
+            dm_hashes.reserve(dm_entities.size());
+
+            for (EntityUID i = 0, i_end = dm_entities.size(); i != i_end; ++i)
+            {
+                std::size_t seed = hash_value(dm_entities[i].first);
+
+                const std::vector<AddressRange>& ranges =
+                    dm_entities[i].second.dm_ranges;
+                for (std::vector<AddressRange>::const_iterator
+                         r = ranges.begin(); r != ranges.end(); ++r)
+                {
+                    hashCombine(seed, *r);
+                }
+
+                dm_hashes.push_back(std::make_pair(seed, i));
             }
+
+            std::stable_sort(dm_hashes.begin(), dm_hashes.end(),
+                             lessHash<EntityUID>);
+            dm_hash = hashContents(dm_hashes);
+        }
+
+        /** Discard the cached content hashes after this table is modified. */
+        void invalidate()
+        {
+            dm_hashes.clear();
+            dm_hash = boost::none;
+        }
+
+        /**
+         * Is the given entity in this table equivalent to the given entity
+         * in another table?
+         */
+        bool equivalentEntities(const EntityTable& other,
+                                const EntityUID& uid,
+                                const EntityUID& other_uid) const
+        {
+            return (dm_entities[uid].first ==
+                    other.dm_entities[other_uid].first) &&
+                (dm_entities[uid].second.dm_ranges ==
+                 other.dm_entities[other_uid].second.dm_ranges);
+        }
+        
+        /**
+         * Index (or reindex) the given entity by its addresses.
+         *
+         * @param uid    Unique identifier for the entity to be indexed.
+         */
+        void index(const EntityUID& uid)
+        {
+            dm_index.set(uid, dm_entities[uid].second);
+        }
+
+        /** Visitor used to collect the unique identifiers of entities. */
+        static bool collectEntity(const EntityUID& uid,
+                                  std::vector<EntityUID>& uids)
+        {
+            uids.push_back(uid);
+            return true;
+        }
+        
+        /** Visit a single entity given its unique identifier. */
+        template <typename E, typename V>
+        static bool visitEntity(const EntityUID& uid, E& entity,
+                                const V& visitor)
+        {
+            entity.dm_unique_identifier = uid;
+            return visitor(entity);
         }
         
-        /** List of entities in this table. */
-        List dm_entities;
+        /** Mutex serializing the decoding of pending address bitmaps. */
+        mutable boost::mutex dm_mutex;
+        
+        /**
+         * List of entities in this table. Mutable so the address sets of its
+         * entities can be filled in when their address bitmaps are decoded.
+         */
+        mutable List dm_entities;
+
+        /** Address bitmaps of the entities that are not yet decoded. */
+        mutable std::vector<PendingBitmap> dm_pending;
+
+        /** Flat buffer containing the bits of those address bitmaps. */
+        mutable std::vector<uint8_t> dm_pending_data;
+
+        /** Memory mapping containing the previously built index, if any. */
+        mutable boost::shared_ptr<const void> dm_pending_mapping;
+
+        /** Rows of the previously built index that are not yet adopted. */
+        mutable const AddressRangeIndex::Row* dm_pending_rows;
+
+        /** Number of rows in the previously built index. */
+        mutable std::size_t dm_pending_row_count;
+
+        /** Level of the root of the previously built index's tree. */
+        mutable int dm_pending_levels;
         
         /** Index used to find entities by addresses. */
-        AddressRangeIndex dm_index;
+        mutable AddressRangeIndex dm_index;
+
+        /**
+         * Content hash of each entity, paired with that entity's unique
+         * identifier, and sorted by hash. Empty until first computed.
+         */
+        mutable std::vector< std::pair<std::size_t, EntityUID> > dm_hashes;
+
+        /** Content hash of this table, or none if not yet computed. */
+        mutable boost::optional<std::size_t> dm_hash;
         
     }; // class EntityTable<T>
 
@@ -19,11 +19,23 @@
 
 /** @file Definition of the FileName class. */
 
-#include <boost/crc.hpp>
-#include <boost/filesystem/fstream.hpp>
+#include <algorithm>
+#include <boost/bind.hpp>
+#include <boost/cstdint.hpp>
 #include <boost/format.hpp>
+#include <boost/ref.hpp>
+#include <boost/thread.hpp>
+#include <boost/tuple/tuple.hpp>
+#include <boost/tuple/tuple_comparison.hpp>
 #include <cstring>
+#include <endian.h>
+#include <fcntl.h>
+#include <map>
 #include <sstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
 
 #include <ArgoNavis/Base/FileName.hpp>
 
@@ -31,46 +43,268 @@ using namespace ArgoNavis::Base;
 
 
 
+/** Anonymous namespace hiding implementation details. */
+namespace {
+
+    /** Generator polynomial of the checksum (without its x^64 term). */
+    const boost::uint64_t kPolynomial = 0x42f0e1eba9ea3693ULL;
+
+    /** Number of threads used for checksumming (zero for the default). */
+    unsigned int checksum_thread_count = 0;
+    
+    /** Minimum number of bytes checksummed by each thread. */
+    const std::size_t kMinBytesPerThread = 16 * 1024 * 1024 /* 16 MB */;
+    
+    /**
+     * Lookup tables for computing the checksum eight bytes at a time. Entry
+     * [k][i] is the checksum of byte "i" followed by "k" zero bytes.
+     */
+    class Tables
+    {
+
+    public:
+
+        /** Construct the lookup tables. */
+        Tables()
+        {
+            for (int i = 0; i < 256; ++i)
+            {
+                boost::uint64_t crc = static_cast<boost::uint64_t>(i) << 56;
+                for (int j = 0; j < 8; ++j)
+                {
+                    crc = (crc << 1) ^ ((crc >> 63) ? kPolynomial : 0);
+                }
+                dm_table[0][i] = crc;
+            }
+
+            for (int k = 1; k < 8; ++k)
+            {
+                for (int i = 0; i < 256; ++i)
+                {
+                    boost::uint64_t crc = dm_table[k - 1][i];
+                    dm_table[k][i] = (crc << 8) ^ dm_table[0][crc >> 56];
+                }
+            }
+        }
+
+        /** Lookup tables. */
+        boost::uint64_t dm_table[8][256];
+        
+    }; // class Tables
+
+    /** Access the lookup tables. */
+    const Tables& tables()
+    {
+        static const Tables kTables;
+        return kTables;
+    }
+    
+    /** Update a checksum with the given bytes. */
+    boost::uint64_t update(boost::uint64_t crc,
+                           const unsigned char* data, std::size_t size)
+    {
+        const boost::uint64_t (*t)[256] = tables().dm_table;
+        
+        for (; size >= 8; data += 8, size -= 8)
+        {
+            boost::uint64_t bytes;
+            memcpy(&bytes, data, sizeof(bytes));
+            crc ^= be64toh(bytes);
+            
+            crc = t[7][crc >> 56] ^ t[6][(crc >> 48) & 0xFF] ^
+                t[5][(crc >> 40) & 0xFF] ^ t[4][(crc >> 32) & 0xFF] ^
+                t[3][(crc >> 24) & 0xFF] ^ t[2][(crc >> 16) & 0xFF] ^
+                t[1][(crc >> 8) & 0xFF] ^ t[0][crc & 0xFF];
+        }
+
+        for (; size > 0; ++data, --size)
+        {
+            crc = (crc << 8) ^ t[0][(crc >> 56) ^ *data];
+        }
+        
+        return crc;
+    }
+
+    /** Multiply two polynomials modulo the generator polynomial. */
+    boost::uint64_t multiply(boost::uint64_t a, boost::uint64_t b)
+    {
+        boost::uint64_t product = 0;
+        for (int i = 63; i >= 0; --i)
+        {
+            product = (product << 1) ^ ((product >> 63) ? kPolynomial : 0);
+            if ((b >> i) & 1)
+            {
+                product ^= a;
+            }
+        }
+        return product;
+    }
+    
+    /**
+     * Combine the checksums of two consecutive blocks of bytes. Since the
+     * initial and final XOR values are both zero, the checksum is linear,
+     * and the checksum of the concatenation is simply the first checksum
+     * multiplied by x^(8 * size of the second block), plus the second.
+     */
+    boost::uint64_t combine(boost::uint64_t first, boost::uint64_t second,
+                            boost::uint64_t second_size)
+    {
+        boost::uint64_t power = 1;
+        for (boost::uint64_t x = 0x100 /* x^8 */; second_size > 0;
+             second_size >>= 1, x = multiply(x, x))
+        {
+            if (second_size & 1)
+            {
+                power = multiply(power, x);
+            }
+        }
+        return multiply(first, power) ^ second;
+    }
+
+    /** Compute the checksum of one thread's share of the given bytes. */
+    void checksumChunk(const unsigned char* data, std::size_t size,
+                       boost::uint64_t& crc)
+    {
+        crc = update(0, data, size);
+    }
+    
+    /**
+     * Compute the checksum of the given bytes, splitting large blocks of
+     * bytes across multiple threads.
+     */
+    boost::uint64_t checksumBytes(const unsigned char* data, std::size_t size)
+    {
+        std::size_t n = std::min<std::size_t>(
+            getChecksumThreadCount(),
+            std::max<std::size_t>(1, size / kMinBytesPerThread)
+            );
+
+        if (n == 1)
+        {
+            return update(0, data, size);
+        }
+
+        tables(); // Construct the tables before starting any threads
+        
+        std::vector<boost::uint64_t> crcs(n, 0);
+        std::size_t chunk = size / n;
+        
+        boost::thread_group threads;
+        for (std::size_t i = 1; i < n; ++i)
+        {
+            threads.create_thread(boost::bind(
+                checksumChunk, data + (i * chunk),
+                (i == (n - 1)) ? (size - (i * chunk)) : chunk,
+                boost::ref(crcs[i])
+                ));
+        }
+        checksumChunk(data, chunk, crcs[0]);
+        threads.join_all();
+
+        boost::uint64_t crc = crcs[0];
+        for (std::size_t i = 1; i < n; ++i)
+        {
+            crc = combine(crc, crcs[i],
+                          (i == (n - 1)) ? (size - (i * chunk)) : chunk);
+        }
+        return crc;
+    }
+
+    /** Type of key identifying a specific version of a file's contents. */
+    typedef boost::tuple<
+        dev_t, ino_t, off_t, time_t, long /* Nanoseconds */
+        > CacheKey;
+
+    /** Mutual exclusion lock for the cache of previous checksums. */
+    boost::mutex& cacheMutex()
+    {
+        static boost::mutex kMutex;
+        return kMutex;
+    }
+    
+    /** Cache of previously computed checksums. */
+    std::map<CacheKey, boost::uint64_t>& cache()
+    {
+        static std::map<CacheKey, boost::uint64_t> kCache;
+        return kCache;
+    }
+    
+} // namespace <anonymous>
+
+
+
 //------------------------------------------------------------------------------
 // If the path names a real file, compute the checksum of that file's contents
 // using "CRC-64" from:
 //
 //     http://reveng.sourceforge.net/crc-catalogue/17plus.htm#crc.cat-bits.64
 //
-// Comments below note the names of the template parameters to the crc_optimized
-// class as listed in Boost documentation, and their correspondence to fields in
-// the above-mentioned document (in parentheses).
+// The file is memory mapped and checksummed eight bytes at a time, and large
+// files are split across several threads whose partial checksums are then
+// combined. Checksums are cached by the file's device, inode, size, and time
+// of last modification, so a given version of a file is only checksummed once
+// per process.
 //------------------------------------------------------------------------------
 FileName::FileName(const boost::filesystem::path& path) :
     dm_path(path),
     dm_checksum(0)
 {
-    if (boost::filesystem::is_regular_file(path))
-    {
-        char buffer[1 * 1024 * 1024 /* 1 MB */];
-
-        boost::crc_optimal<
-            64,                 // Bits (width)
-            0x42f0e1eba9ea3693, // TruncPoly (poly)
-            0x0000000000000000, // InitRem (init)
-            0x0000000000000000, // FinalXor (xorout)
-            false,              // ReflectIn (refin)
-            false               // ReflectRem (refout)
-            > crc;
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1)
+    {
+        return;
+    }
+
+    struct stat status;
+    if ((fstat(fd, &status) != 0) || !S_ISREG(status.st_mode))
+    {
+        close(fd);
+        return;
+    }
+
+    CacheKey key(status.st_dev, status.st_ino, status.st_size,
+                 status.st_mtim.tv_sec, status.st_mtim.tv_nsec);
     
-        boost::filesystem::ifstream stream(path, std::ios::binary);
-        
-        for (std::streamsize n = stream.readsome(buffer, sizeof(buffer));
-             n > 0;
-             n = stream.readsome(buffer, sizeof(buffer)))
+    {
+        boost::mutex::scoped_lock lock(cacheMutex());
+        std::map<CacheKey, boost::uint64_t>::const_iterator i =
+            cache().find(key);
+        if (i != cache().end())
         {
-            crc.process_bytes(buffer, n);
+            dm_checksum = i->second;
+            close(fd);
+            return;
         }
-        
-        stream.close();
-        
-        dm_checksum = static_cast<boost::uint64_t>(crc.checksum());
     }
+    
+    if (status.st_size > 0)
+    {
+        void* data = mmap(NULL, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (data != MAP_FAILED)
+        {
+            madvise(data, status.st_size, MADV_SEQUENTIAL);
+            dm_checksum = checksumBytes(
+                reinterpret_cast<const unsigned char*>(data), status.st_size
+                );
+            munmap(data, status.st_size);
+        }
+        else
+        {
+            std::vector<unsigned char> buffer(1 * 1024 * 1024 /* 1 MB */);
+            for (ssize_t n = read(fd, &buffer[0], buffer.size());
+                 n > 0;
+                 n = read(fd, &buffer[0], buffer.size()))
+            {
+                dm_checksum = update(dm_checksum, &buffer[0], n);
+            }
+        }
+    }
+    
+    close(fd);
+
+    boost::mutex::scoped_lock lock(cacheMutex());
+    cache().insert(std::make_pair(key, dm_checksum));
 }
 
 
@@ -141,10 +375,14 @@ bool FileName::operator<(const FileName& other) const
 
 
 //------------------------------------------------------------------------------
+// Comparing two paths element by element is expensive, and is only necessary
+// when the two paths aren't spelled identically. Identical spellings are thus
+// compared directly first.
 //------------------------------------------------------------------------------
 bool FileName::operator==(const FileName& other) const
 {
-    if (dm_path != other.dm_path)
+    if ((dm_path.native() != other.dm_path.native()) &&
+        (dm_path != other.dm_path))
     {
         return false;
     }
@@ -172,3 +410,22 @@ std::ostream& ArgoNavis::Base::operator<<(std::ostream& stream,
     
     return stream;
 }
+
+
+
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+unsigned int ArgoNavis::Base::getChecksumThreadCount()
+{
+    return (checksum_thread_count > 0) ? checksum_thread_count :
+        std::max(boost::thread::hardware_concurrency(), 1u);
+}
+
+
+
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+void ArgoNavis::Base::setChecksumThreadCount(unsigned int count)
+{
+    checksum_thread_count = count;
+}
@@ -19,14 +19,14 @@
 
 /** @file Definition of the LinkedObject class. */
 
-#include <boost/bind.hpp>
 #include <boost/format.hpp>
-#include <boost/ref.hpp>
 #include <sstream>
+#include <stdexcept>
 
 #include <ArgoNavis/Base/Function.hpp>
 #include <ArgoNavis/Base/LinkedObject.hpp>
 #include <ArgoNavis/Base/Loop.hpp>
+#include <ArgoNavis/Base/Raise.hpp>
 #include <ArgoNavis/Base/Statement.hpp>
 
 #include "SymbolTable.hpp"
@@ -35,88 +35,6 @@ using namespace ArgoNavis::Base;
 
 
 
-/** Anonymous namespace hiding implementation details. */
-namespace {
-
-    /**
-     * Visitor used to determine if an arbitrary set of visited entities
-     * contains an entity equivalent to the given entity. The visitation
-     * is terminated as soon as such an entity is found.
-     */
-    template <typename T>
-    bool containsEquivalent(const T& entity, const T& x, bool& contains)
-    {
-        contains |= ArgoNavis::Base::equivalent(x, entity);
-        return !contains;
-    }
-    
-    /**
-     * Visitor for determining if the given linked object contains a function
-     * equivalent to all functions in an arbitrary set of visited functions.
-     * The visitation is terminated as soon as a function is encountered that
-     * doesn't have an equivalent in the given linked object.
-     */
-    bool containsAllFunctions(const LinkedObject& linked_object,
-                              const Function& x, bool& contains)
-    {
-        bool contains_this = false;
-
-        linked_object.visitFunctions(
-            boost::bind(
-                containsEquivalent<Function>, x, _1, boost::ref(contains_this)
-                )
-            );
-        
-        contains &= contains_this;
-        return contains;
-    }
-    
-    /**
-     * Visitor for determining if the given linked object contains a loop
-     * equivalent to all loops in an arbitrary set of visited loops. The
-     * visitation is terminated as soon as a loop is encountered that
-     * doesn't have an equivalent in the given linked object.
-     */
-    bool containsAllLoops(const LinkedObject& linked_object,
-                          const Loop& x, bool& contains)
-    {
-        bool contains_this = false;
-
-        linked_object.visitLoops(
-            boost::bind(
-                containsEquivalent<Loop>, x, _1, boost::ref(contains_this)
-                )
-            );
-        
-        contains &= contains_this;
-        return contains;
-    }
-    
-    /**
-     * Visitor for determining if the given linked object contains a statement
-     * equivalent to all statements in an arbitrary set of visited statements.
-     * The visitation is terminated as soon as a statement is encountered that
-     * doesn't have an equivalent in the given linked object.
-     */
-    bool containsAllStatements(const LinkedObject& linked_object,
-                               const Statement& x, bool& contains)
-    {
-        bool contains_this = false;
-        
-        linked_object.visitStatements(
-            boost::bind(
-                containsEquivalent<Statement>, x, _1, boost::ref(contains_this)
-                )
-            );
-        
-        contains &= contains_this;
-        return contains;
-    }
-    
-} // namespace <anonymous>
-
-
-
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
 LinkedObject::LinkedObject(const FileName& file) :
@@ -128,13 +46,33 @@ LinkedObject::LinkedObject(const FileName& file) :
         
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
-LinkedObject::LinkedObject(const CBTF_Protocol_SymbolTable& message) :
-    dm_symbol_table(new Impl::SymbolTable(message))
+LinkedObject::LinkedObject(const CBTF_Protocol_SymbolTable& message,
+                           bool lazy) :
+    dm_symbol_table(new Impl::SymbolTable(message, lazy))
 {
 }
 
 
 
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+boost::optional<LinkedObject> LinkedObject::load(
+    const boost::filesystem::path& directory, const FileName& file
+    )
+{
+    Impl::SymbolTable::Handle symbol_table =
+        Impl::SymbolTable::load(directory, file);
+
+    if (!symbol_table)
+    {
+        return boost::none;
+    }
+    
+    return LinkedObject(symbol_table);
+}
+
+
+
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
 LinkedObject::operator CBTF_Protocol_SymbolTable() const
@@ -193,6 +131,15 @@ FileName LinkedObject::file() const
 
 
 
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+std::size_t LinkedObject::hash() const
+{
+    return dm_symbol_table->hash();
+}
+
+
+
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
 void LinkedObject::visitFunctions(const FunctionVisitor& visitor) const
@@ -264,118 +211,105 @@ void LinkedObject::visitStatements(const AddressRange& range,
 
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
-std::ostream& ArgoNavis::Base::operator<<(std::ostream& stream,
-                                          const LinkedObject& linked_object)
+void LinkedObject::save(const boost::filesystem::path& directory) const
 {
-    stream << boost::str(boost::format("SymbolTable 0x%016X") % 
-                         linked_object.dm_symbol_table.get());
-    
-    return stream;
+    dm_symbol_table->save(directory);
 }
 
 
 
 //------------------------------------------------------------------------------
+// Function and statement identifiers are simply the unique identifiers of the
+// corresponding entities within the symbol table, which allows the sweep over
+// the addresses to be performed directly on the symbol table's indices.
 //------------------------------------------------------------------------------
-LinkedObject::LinkedObject(const Impl::SymbolTable::Handle& symbol_table) :
-    dm_symbol_table(symbol_table)
+void LinkedObject::resolve(const std::vector<Address>& addresses,
+                           std::vector<Identifier>& functions,
+                           std::vector<Identifier>& statements) const
 {
+    for (std::size_t i = 1, i_end = addresses.size(); i < i_end; ++i)
+    {
+        if (addresses[i] < addresses[i - 1])
+        {
+            raise<std::invalid_argument>(
+                "The given addresses (%1% > %2%) aren't sorted.",
+                addresses[i - 1], addresses[i]
+                );
+        }
+    }
+    
+    dm_symbol_table->functions().resolve(addresses, functions, TheNone());
+    dm_symbol_table->statements().resolve(addresses, statements, TheNone());
 }
 
 
 
 //------------------------------------------------------------------------------
-// The individual comparisons are performed from least to most expensive in
-// order to optimize performance. The implementation of the comparisons would
-// be signficantly simplified if lambda expresions could be used here...
 //------------------------------------------------------------------------------
-bool ArgoNavis::Base::equivalent(const LinkedObject& first,
-                                 const LinkedObject& second)
+Function LinkedObject::function(const Identifier& identifier) const
 {
-    // Are the two linked object's files different?
-    if (first.file() != second.file())
+    if (identifier >= dm_symbol_table->functions().size())
     {
-        return false;
+        raise<std::invalid_argument>(
+            "The given function identifier (%1%) isn't valid.", identifier
+            );
     }
 
-    // Is "second" missing any of the functions from "first"?
-    
-    bool contains = true;
-    
-    first.visitFunctions(
-        boost::bind(containsAllFunctions, second, _1, boost::ref(contains))
-        );
-    
-    if (!contains)
-    {
-        return false;
-    }
+    return Function(dm_symbol_table, identifier);
+}
 
-    // Is "first" missing any of the functions from "second"?
 
-    contains = true;
-    
-    second.visitFunctions(
-        boost::bind(containsAllFunctions, first, _1, boost::ref(contains))
-        );
 
-    if (!contains)
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+Statement LinkedObject::statement(const Identifier& identifier) const
+{
+    if (identifier >= dm_symbol_table->statements().size())
     {
-        return false;
+        raise<std::invalid_argument>(
+            "The given statement identifier (%1%) isn't valid.", identifier
+            );
     }
     
-    // Is "second" missing any of the loops from "first"?
-    
-    contains = true;
-    
-    first.visitLoops(
-        boost::bind(containsAllLoops, second, _1, boost::ref(contains))
-        );
-    
-    if (!contains)
-    {
-        return false;
-    }
+    return Statement(dm_symbol_table, identifier);
+}
 
-    // Is "first" missing any of the loops from "second"?
 
-    contains = true;
-    
-    second.visitLoops(
-        boost::bind(containsAllLoops, first, _1, boost::ref(contains))
-        );
 
-    if (!contains)
-    {
-        return false;
-    }
-    
-    // Is "second" missing any of the statements from "first"?
-    
-    contains = true;
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+std::ostream& ArgoNavis::Base::operator<<(std::ostream& stream,
+                                          const LinkedObject& linked_object)
+{
+    stream << boost::str(boost::format("SymbolTable 0x%016X") % 
+                         linked_object.dm_symbol_table.get());
     
-    first.visitStatements(
-        boost::bind(containsAllStatements, second, _1, boost::ref(contains))
-        );
+    return stream;
+}
+
 
-    if (!contains)
-    {
-        return false;
-    }
-    
-    // Is "first" missing any of the statements from "second"?
-    
-    contains = true;
-    
-    second.visitStatements(
-        boost::bind(containsAllStatements, first, _1, boost::ref(contains))
-        );
 
-    if (!contains)
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+LinkedObject::LinkedObject(const Impl::SymbolTable::Handle& symbol_table) :
+    dm_symbol_table(symbol_table)
+{
+}
+
+
+
+//------------------------------------------------------------------------------
+// Rather than searching the whole of one linked object for an equivalent of
+// each entity in the other, the entities of both are sorted by content hash,
+// and only entities with equal hashes are compared. See SymbolTable.
+//------------------------------------------------------------------------------
+bool ArgoNavis::Base::equivalent(const LinkedObject& first,
+                                 const LinkedObject& second)
+{
+    if (first.dm_symbol_table == second.dm_symbol_table)
     {
-        return false;
+        return true;
     }
 
-    // Otherwise the linked objects are equivalent    
-    return true;
+    return first.dm_symbol_table->equivalent(*second.dm_symbol_table);
 }
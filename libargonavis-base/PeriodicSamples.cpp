@@ -18,6 +18,7 @@
 
 /** @file Definition of the PeriodicSamples class. */
 
+#include <algorithm>
 #include <boost/format.hpp>
 #include <boost/optional.hpp>
 #include <cmath>
@@ -80,7 +81,8 @@ namespace {
 PeriodicSamples::PeriodicSamples(const std::string& name, Kind kind) :
     dm_name(name),
     dm_kind(kind),
-    dm_samples()
+    dm_times(),
+    dm_values()
 {
 }
 
@@ -90,49 +92,67 @@ PeriodicSamples::PeriodicSamples(const std::string& name, Kind kind) :
 //------------------------------------------------------------------------------
 TimeInterval PeriodicSamples::interval() const
 {
-    if (dm_samples.empty())
+    if (dm_times.empty())
     {
         return TimeInterval();
     }
 
-    return TimeInterval(dm_samples.begin()->first, dm_samples.rbegin()->first);
+    return TimeInterval(dm_times.front(), dm_times.back());
 }
 
 
 
 //------------------------------------------------------------------------------
+// The sum of the deltas between each pair of adjacent samples telescopes into
+// the difference between the last and first sample times. So there is no need
+// to actually iterate over the samples here.
 //------------------------------------------------------------------------------
 Time PeriodicSamples::rate() const
 {
-    if (dm_samples.size() < 2)
+    if (dm_times.size() < 2)
     {
         return Time();
     }
     
-    boost::uint64_t sum = 0;
-    Time previous = dm_samples.begin()->first;
-    
-    for (std::map<Time, boost::uint64_t>::const_iterator
-             i = dm_samples.begin()++, i_end = dm_samples.end();
-         i != i_end;
-         ++i)
-    {
-        sum += i->first - previous;
-        previous = i->first;
-    }
+    boost::uint64_t sum = dm_times.back() - dm_times.front();
 
     return Time(static_cast<boost::uint64_t>(round(
-        static_cast<double>(sum) / static_cast<double>(dm_samples.size() - 1)
+        static_cast<double>(sum) / static_cast<double>(dm_times.size() - 1)
         )));
 }
 
 
 
 //------------------------------------------------------------------------------
+// Samples are almost always added in time order, in which case the new sample
+// is simply appended to the columns. Otherwise fall back to locating the new
+// sample's position with a binary search. As was the case when the samples were
+// stored in an associative container, adding a sample for an existing time
+// replaces that sample's value.
 //------------------------------------------------------------------------------
 void PeriodicSamples::add(const Time& time, boost::uint64_t value)
 {
-    dm_samples[time] = value;
+    if (dm_times.empty() || (dm_times.back() < time))
+    {
+        dm_times.push_back(time);
+        dm_values.push_back(value);
+        return;
+    }
+
+    std::vector<Time>::iterator i =
+        std::lower_bound(dm_times.begin(), dm_times.end(), time);
+    std::vector<boost::uint64_t>::iterator j =
+        dm_values.begin() + (i - dm_times.begin());
+
+    if (*i == time)
+    {
+        *j = value;
+    }
+    else
+    {
+        dm_times.insert(i, time);
+        dm_values.insert(j, value);
+    }
 }
 
 
@@ -167,7 +187,7 @@ PeriodicSamples PeriodicSamples::resample(
     case kRate: std::cout << "Rate"; break;
     }
     std::cout << std::endl;
-    std::cout << "           size = " << dm_samples.size() << std::endl;
+    std::cout << "           size = " << dm_times.size() << std::endl;
     std::cout << "     interval() = " << debug(this->interval()) << std::endl;
     std::cout << "         rate() = " << debug(this->rate()) << std::endl;    
     std::cout << "       interval = " << debug(interval) << std::endl;    
@@ -189,42 +209,45 @@ void PeriodicSamples::visit(const TimeInterval& interval,
     std::vector<boost::uint64_t> samples(1);
     bool terminate = false;
     
-    for (std::map<Time, boost::uint64_t>::const_iterator
-             i = dm_samples.lower_bound(interval.begin()),
-             i_end = dm_samples.upper_bound(interval.end());
-         !terminate && (i != i_end);
+    for (std::size_t
+             i = std::lower_bound(dm_times.begin(), dm_times.end(),
+                                  interval.begin()) - dm_times.begin(),
+             i_end = std::upper_bound(dm_times.begin(), dm_times.end(),
+                                      interval.end()) - dm_times.begin();
+         !terminate && (i < i_end);
          ++i)
     {
-        samples[0] = i->second;
-        terminate |= !visitor(i->first, samples);
+        samples[0] = dm_values[i];
+        terminate |= !visitor(dm_times[i], samples);
     }
 }
 
 
 
 //------------------------------------------------------------------------------
+// Both the new samples and the original samples cover contiguous, ascending
+// time ranges. So rather than searching for the original samples covering each
+// new sample, a single cursor is advanced through the original samples as the
+// new samples are generated. Only the last original sample covering each new
+// sample is visited more than once, making the resampling O(N + M).
 //------------------------------------------------------------------------------
 PeriodicSamples PeriodicSamples::resampleDeltas(const TimeInterval& interval,
                                                 const Time& rate) const
 {
-    typedef std::map<Time, boost::uint64_t>::const_iterator IteratorType;
-        
     // Compute the number of new samples
     boost::uint64_t N = ((interval.width() + rate - 1) / rate) + 1;
 
 #if defined(DEBUG_RESAMPLING)
-    Time origin = dm_samples.begin()->first;
+    Time origin = dm_times.front();
     
     std::cout << "              N = " << N << std::endl;
     std::cout << "         origin = " << debug(origin) << std::endl;
 
     std::cout << std::endl;
-    for (IteratorType i = dm_samples.begin(), i_end = dm_samples.end();
-         i != i_end;
-         ++i)
+    for (std::size_t i = 0; i < dm_times.size(); ++i)
     {
-        std::cout << "        original: " << debug(i->first, origin)
-                  << " = " << i->second << std::endl;
+        std::cout << "        original: " << debug(dm_times[i], origin)
+                  << " = " << dm_values[i] << std::endl;
     }
     
     int debug_count = 10;
@@ -233,8 +256,13 @@ PeriodicSamples PeriodicSamples::resampleDeltas(const TimeInterval& interval,
     // Construct and return the final resampled PeriodicSamples
     
     PeriodicSamples resampled(dm_name, dm_kind);
+    resampled.dm_times.reserve(N);
+    resampled.dm_values.reserve(N);
 
     boost::uint64_t v = 0;
+
+    // Index of the first original sample covering the current new sample
+    std::size_t i_next = 0;
     
     for (boost::uint64_t n = 0; n < N; ++n)
     {
@@ -263,35 +291,18 @@ PeriodicSamples PeriodicSamples::resampleDeltas(const TimeInterval& interval,
         }
 #endif
         
-        // Compute the range of original samples covering this new sample
-        
-        IteratorType i_begin = dm_samples.lower_bound(nue.begin());
-        IteratorType i_end = dm_samples.upper_bound(nue.end());
-
-        if (i_begin != dm_samples.begin())
-        {
-            --i_begin;
-        }
-        
-        if (i_end != dm_samples.end())
-        {
-            ++i_end;
-        }
-        
         // Iterate over each original sample covering this new sample
-        for (IteratorType i = i_begin; i != i_end; ++i)
+        for (std::size_t i = i_next; i < dm_times.size(); ++i)
         {
             // Compute the time range covered by this original sample
             TimeInterval original(
-                (i == dm_samples.begin()) ?
-                    Time::TheBeginning() :
-                    (--IteratorType(i))->first + 1,
-                i->first
+                (i == 0) ? Time::TheBeginning() : dm_times[i - 1] + 1,
+                dm_times[i]
                 );
             
             // Compute the value for the original sample
-            boost::uint64_t total = i->second -
-                ((i == dm_samples.begin()) ? 0 : (--IteratorType(i))->second);
+            boost::uint64_t total =
+                dm_values[i] - ((i == 0) ? 0 : dm_values[i - 1]);
             
             // Compute the weight value to be added to the new sample
 
@@ -317,6 +328,15 @@ PeriodicSamples PeriodicSamples::resampleDeltas(const TimeInterval& interval,
                         
             // Add the weighted value to the new sample
             v += value;
+
+            // Stop after the first original sample extending past this new
+            // sample. It also covers the next new sample and is revisited.
+            if (dm_times[i] > nue.end())
+            {
+                break;
+            }
+            
+            i_next = i + 1;
         }
 
 #if defined(DEBUG_RESAMPLING)
@@ -332,21 +352,18 @@ PeriodicSamples PeriodicSamples::resampleDeltas(const TimeInterval& interval,
     
 #if defined(DEBUG_RESAMPLING)
     std::cout << std::endl;    
-    for (IteratorType i = resampled.dm_samples.begin(),
-             i_end = resampled.dm_samples.end();
-         i != i_end;
-         ++i)
+    for (std::size_t i = 0; i < resampled.dm_times.size(); ++i)
     {
-        std::cout << "       resampled: " << debug(i->first, origin)
-                  << " = " << i->second << std::endl;
+        std::cout << "       resampled: "
+                  << debug(resampled.dm_times[i], origin)
+                  << " = " << resampled.dm_values[i] << std::endl;
     }
 
-    boost::uint64_t sum_original = dm_samples.empty() ? 0 :
-        (dm_samples.rbegin()->second - dm_samples.begin()->second);
+    boost::uint64_t sum_original = dm_values.empty() ? 0 :
+        (dm_values.back() - dm_values.front());
 
-    boost::uint64_t sum_resampled = resampled.dm_samples.empty() ? 0 :
-        (resampled.dm_samples.rbegin()->second -
-         resampled.dm_samples.begin()->second);
+    boost::uint64_t sum_resampled = resampled.dm_values.empty() ? 0 :
+        (resampled.dm_values.back() - resampled.dm_values.front());
     
     if (sum_resampled != sum_original)
     {
@@ -369,24 +386,20 @@ PeriodicSamples PeriodicSamples::resampleDeltas(const TimeInterval& interval,
 PeriodicSamples PeriodicSamples::resampleValues(const TimeInterval& interval,
                                                 const Time& rate) const
 {
-    typedef std::map<Time, boost::uint64_t>::const_iterator IteratorType;
-    
     // Compute the number of new samples
     boost::uint64_t N = ((interval.width() + rate - 1) / rate) + 1;
 
 #if defined(DEBUG_RESAMPLING)
-    Time origin = dm_samples.begin()->first;
+    Time origin = dm_times.front();
     
     std::cout << "              N = " << N << std::endl;
     std::cout << "         origin = " << debug(origin) << std::endl;
 
     std::cout << std::endl;
-    for (IteratorType i = dm_samples.begin(), i_end = dm_samples.end();
-         i != i_end;
-         ++i)
+    for (std::size_t i = 0; i < dm_times.size(); ++i)
     {
-        std::cout << "        original: " << debug(i->first, origin)
-                  << " = " << i->second << std::endl;
+        std::cout << "        original: " << debug(dm_times[i], origin)
+                  << " = " << dm_values[i] << std::endl;
     }
     
     int debug_count = 10;
@@ -395,6 +408,8 @@ PeriodicSamples PeriodicSamples::resampleValues(const TimeInterval& interval,
     // Construct and return the final resampled PeriodicSamples
     
     PeriodicSamples resampled(dm_name, dm_kind);
+    resampled.dm_times.reserve(N);
+    resampled.dm_values.reserve(N);
    
     for (boost::uint64_t n = 0; n < N; ++n)
     {
@@ -409,30 +424,34 @@ PeriodicSamples PeriodicSamples::resampleValues(const TimeInterval& interval,
 
         boost::uint64_t v = 0;
 
-        IteratorType min = dm_samples.lower_bound(t);
-        IteratorType max = dm_samples.upper_bound(t);
+        std::size_t min = std::lower_bound(
+            dm_times.begin(), dm_times.end(), t
+            ) - dm_times.begin();
+        std::size_t max = std::upper_bound(
+            dm_times.begin(), dm_times.end(), t
+            ) - dm_times.begin();
 
-        if (max == dm_samples.begin())
+        if (max == 0)
         {
-            v = dm_samples.begin()->second;
+            v = dm_values.front();
         }
-        else if (min == dm_samples.end())
+        else if ((min == dm_times.size()) || (max == dm_times.size()))
         {
-            v = dm_samples.rbegin()->second;
+            v = dm_values.back();
         }
         else
         {
-            if ((min != dm_samples.begin()) && (min->first != t))
+            if ((min != 0) && (dm_times[min] != t))
             {
                 --min;
             }
             
-            double weight = static_cast<double>(t - min->first) /
-                static_cast<double>(max->first - min->first);
+            double weight = static_cast<double>(t - dm_times[min]) /
+                static_cast<double>(dm_times[max] - dm_times[min]);
             
             v = static_cast<boost::uint64_t>(
-                round(weight * static_cast<double>(min->second) +
-                      (1.0 - weight) * static_cast<double>(max->second))
+                round(weight * static_cast<double>(dm_values[min]) +
+                      (1.0 - weight) * static_cast<double>(dm_values[max]))
                 );
         }
         
@@ -443,23 +462,25 @@ PeriodicSamples PeriodicSamples::resampleValues(const TimeInterval& interval,
             std::cout << "    ------->  n = " << n << std::endl;
             std::cout << "              t = " << debug(t, origin) << std::endl;
             std::cout << "            min = ";
-            if (min == dm_samples.end())
+            if (min == dm_times.size())
             {
                 std::cout << "<end>";
             }
             else
             {
-                std::cout << debug(min->first, origin) << ", " << min->second;
+                std::cout << debug(dm_times[min], origin) << ", "
+                          << dm_values[min];
             }
             std::cout << std::endl;
             std::cout << "            max = ";
-            if (max == dm_samples.end())
+            if (max == dm_times.size())
             {
                 std::cout << "<end>";
             }
             else
             {
-                std::cout << debug(max->first, origin) << ", " << max->second;
+                std::cout << debug(dm_times[max], origin) << ", "
+                          << dm_values[max];
             }
             std::cout << std::endl;
             std::cout << "              v = " << v << std::endl;
@@ -471,13 +492,11 @@ PeriodicSamples PeriodicSamples::resampleValues(const TimeInterval& interval,
 
 #if defined(DEBUG_RESAMPLING)
     std::cout << std::endl;
-    for (IteratorType i = resampled.dm_samples.begin(),
-             i_end = resampled.dm_samples.end();
-         i != i_end;
-         ++i)
+    for (std::size_t i = 0; i < resampled.dm_times.size(); ++i)
     {
-        std::cout << "       resampled: " << debug(i->first, origin)
-                  << " = " << i->second << std::endl;
+        std::cout << "       resampled: "
+                  << debug(resampled.dm_times[i], origin)
+                  << " = " << resampled.dm_values[i] << std::endl;
     }
 #endif
     
@@ -18,10 +18,15 @@
 
 /** @file Definition of the PeriodicSamplesGroup functions. */
 
+#include <algorithm>
 #include <boost/bind.hpp>
+#include <boost/function.hpp>
 #include <boost/ref.hpp>
+#include <boost/thread.hpp>
 #include <cmath>
+#include <functional>
 #include <map>
+#include <queue>
 #include <set>
 #include <stddef.h>
 #include <utility>
@@ -35,51 +40,161 @@ using namespace ArgoNavis::Base;
 /** Anonymous namespace hiding implementation details. */
 namespace {
 
-    /** Type used to hold accumulated single values. */
-    typedef std::map<
-        Time, std::pair<boost::uint64_t /* Count */, boost::uint64_t /* Sum */>
-        > AccumulatedData;
+    /**
+     * Type used to hold the indices, within a group, of all the samples with
+     * an identical name and kind.
+     */
+    typedef std::set<std::size_t> GroupIndex;
+
+    /** Type of function invoked for each iteration of a parallel loop. */
+    typedef boost::function<void (std::size_t)> LoopBody;
+
+    /**
+     * Portion of the combined samples computed by a single iteration of the
+     * parallel loop in getResampledAndCombined(). Each one sums a contiguous
+     * range of time bins from a set of identically named samples, so no two
+     * iterations ever write the same bin.
+     */
+    struct CombineTask
+    {
+        /** Indicies of the resampled samples being combined. */
+        const GroupIndex* dm_index;
+
+        /** Sums for all time bins of the combined samples. */
+        std::vector<boost::uint64_t>* dm_sums;
+
+        /** Index of the first time bin summed by this task. */
+        std::size_t dm_begin;
 
-    /** Typed used to hold a flattened PeriodicSamplesGroup. */
-    typedef std::map<Time, std::vector<boost::uint64_t> > FlattenedData;
+        /** Index one beyond the last time bin summed by this task. */
+        std::size_t dm_end;
+    };
+
+    /** Maximum number of time bins summed by a single CombineTask. */
+    const std::size_t kMaxBinsPerCombineTask = 16384;
     
-    /** Visitor used to accumulate single values. */
+    /** Number of threads used for resampling (zero for the default). */
+    unsigned int resampling_thread_count = 0;
+
+    /** Visitor used to add single values to consecutive time bins. */
     bool accumulate(const Time& time,
                     const std::vector<boost::uint64_t>& values,
-                    AccumulatedData& data)
+                    std::vector<boost::uint64_t>::iterator& bin)
     {
-        AccumulatedData::iterator i = data.find(time);
+        *bin++ += values[0];
+        return true;
+    }
 
-        if (i == data.end())
+    /** Execute a single CombineTask. */
+    void combine(const PeriodicSamplesGroup& resampled,
+                 const TimeInterval& interval, const Time& rate,
+                 const std::vector<CombineTask>& tasks, std::size_t n)
+    {
+        const CombineTask& task = tasks[n];
+        
+        TimeInterval bins(interval.begin() + Time(task.dm_begin * rate),
+                          interval.begin() + Time((task.dm_end - 1) * rate));
+        
+        for (GroupIndex::const_iterator
+                 i = task.dm_index->begin(), i_end = task.dm_index->end();
+             i != i_end;
+             ++i)
         {
-            i = data.insert(std::make_pair(time, std::make_pair(0, 0))).first;
+            std::vector<boost::uint64_t>::iterator bin =
+                task.dm_sums->begin() + task.dm_begin;
+            
+            resampled[*i].visit(
+                bins, boost::bind(accumulate, _1, _2, boost::ref(bin))
+                );
         }
-
-        i->second.first += 1;       
-        i->second.second += values[0];
-
-        return true;
     }
 
-    /** Visitor used to flatten a PeriodicSamplesGroup. */
-    bool flatten(const Time& time,
-                 const std::vector<boost::uint64_t>& values,
-                 const std::size_t& n, const std::size_t& N,
-                 FlattenedData& data)
+    /** Worker executing iterations of a parallel loop until none remain. */
+    void execute(std::size_t N, std::size_t& next, boost::mutex& mutex,
+                 const LoopBody& body)
     {
-        FlattenedData::iterator i = data.find(time);
+        while (true)
+        {
+            std::size_t n;
+            
+            {
+                boost::mutex::scoped_lock lock(mutex);
+                n = next++;
+            }
+            
+            if (n >= N)
+            {
+                break;
+            }
+            
+            body(n);
+        }
+    }
 
-        if (i == data.end())
+    /**
+     * Invoke the given function once for each index in the range [0, N). The
+     * iterations are distributed dynamically over up to the number of threads
+     * returned by getResamplingThreadCount(), including the calling thread.
+     */
+    void parallelFor(std::size_t N, const LoopBody& body)
+    {
+        std::size_t next = 0;
+        boost::mutex mutex;
+        boost::thread_group threads;
+
+        for (std::size_t i = 1,
+                 i_end = std::min<std::size_t>(getResamplingThreadCount(), N);
+             i < i_end;
+             ++i)
         {
-            i = data.insert(
-                std::make_pair(time, std::vector<boost::uint64_t>(N, 0))
-                ).first;            
+            threads.create_thread(boost::bind(
+                execute, N, boost::ref(next), boost::ref(mutex),
+                boost::cref(body)
+                ));
         }
 
-        i->second[n] = values[0];
+        execute(N, next, mutex, body);
         
-        return true;
+        threads.join_all();
+    }
+
+    /** Resample a single PeriodicSamples within a group. */
+    void resample(const PeriodicSamplesGroup& group,
+                  const TimeInterval& interval, const Time& rate,
+                  PeriodicSamplesGroup& resampled, std::size_t n)
+    {
+        resampled[n] = group[n].resample(interval, rate);
+    }
+
+    /** Resolve the time interval and rate used to resample a group. */
+    std::pair<TimeInterval, Time> resolve(
+        const PeriodicSamplesGroup& group,
+        const boost::optional<TimeInterval>& interval,
+        const boost::optional<Time>& rate
+        )
+    {
+        return std::make_pair(
+            interval ? *interval : getSmallestTimeInterval(group),
+            rate ? *rate : Time(
+                1000000 /* ms/ns */ * static_cast<boost::uint64_t>(
+                    round(static_cast<double>(getAverageSamplingRate(group)) /
+                          1000000.0 /* ms/ns */)
+                    )
+                )
+            );
     }
+
+    /**
+     * Type of entry in the heap used to merge a PeriodicSamplesGroup. Holds the
+     * time of the next sample from one PeriodicSamples, and the index of that
+     * PeriodicSamples within the group.
+     */
+    typedef std::pair<Time, std::size_t> MergeEntry;
+
+    /** Type of heap used to merge a PeriodicSamplesGroup. */
+    typedef std::priority_queue<
+        MergeEntry, std::vector<MergeEntry>, std::greater<MergeEntry>
+        > MergeHeap;
     
 } // namespace <anonymous>
 
@@ -145,28 +260,42 @@ Time ArgoNavis::Base::getAverageSamplingRate(const PeriodicSamplesGroup& group)
 
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
+unsigned int ArgoNavis::Base::getResamplingThreadCount()
+{
+    return (resampling_thread_count > 0) ? resampling_thread_count :
+        std::max(boost::thread::hardware_concurrency(), 1u);
+}
+
+
+
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+void ArgoNavis::Base::setResamplingThreadCount(unsigned int count)
+{
+    resampling_thread_count = count;
+}
+
+
+
+//------------------------------------------------------------------------------
+// Each PeriodicSamples is resampled independently of the others, so they are
+// simply distributed across the resampling threads.
+//------------------------------------------------------------------------------
 PeriodicSamplesGroup ArgoNavis::Base::getResampled(
     const PeriodicSamplesGroup& group,
     const boost::optional<TimeInterval>& interval_,
     const boost::optional<Time>& rate_
     )
 {
-    TimeInterval interval = interval_ ? *interval_ :
-        getSmallestTimeInterval(group);
-    
-    Time rate = rate_ ? *rate_ :
-        Time(1000000 /* ms/ns */ * static_cast<boost::uint64_t>(
-            round(static_cast<double>(getAverageSamplingRate(group)) /
-                  1000000.0 /* ms/ns */)
-            ));
+    std::pair<TimeInterval, Time> resolved = resolve(group, interval_, rate_);
 
-    PeriodicSamplesGroup result;
+    PeriodicSamplesGroup result(group.size(), PeriodicSamples(std::string()));
 
-    for (PeriodicSamplesGroup::const_iterator
-             i = group.begin(), i_end = group.end(); i != i_end; ++i)
-    {
-        result.push_back(i->resample(interval, rate));
-    }
+    parallelFor(group.size(), boost::bind(
+                    resample, boost::cref(group),
+                    boost::cref(resolved.first), boost::cref(resolved.second),
+                    boost::ref(result), _1
+                    ));
     
     return result;    
 }
@@ -174,16 +303,24 @@ PeriodicSamplesGroup ArgoNavis::Base::getResampled(
 
 
 //------------------------------------------------------------------------------
+// Every PeriodicSamples in the group is resampled onto the same time grid, with
+// exactly one sample per grid point. So each set of identically named samples
+// is combined by summing their values into a flat array of time bins, with the
+// count of values in every bin being the number of samples in the set. Those
+// sums are split into disjoint ranges of bins that are computed in parallel.
 //------------------------------------------------------------------------------
 PeriodicSamplesGroup ArgoNavis::Base::getResampledAndCombined(
     const PeriodicSamplesGroup& group,
-    const boost::optional<TimeInterval>& interval,
-    const boost::optional<Time>& rate
+    const boost::optional<TimeInterval>& interval_,
+    const boost::optional<Time>& rate_
     )
 {
     typedef std::pair<std::string, PeriodicSamples::Kind> NameAndKind;
-    typedef std::set<std::size_t> GroupIndex;
 
+    std::pair<TimeInterval, Time> resolved = resolve(group, interval_, rate_);
+    const TimeInterval& interval = resolved.first;
+    const Time& rate = resolved.second;
+    
     PeriodicSamplesGroup resampled = getResampled(group, interval, rate);
 
     std::map<NameAndKind, GroupIndex> unique;
@@ -204,44 +341,52 @@ PeriodicSamplesGroup ArgoNavis::Base::getResampledAndCombined(
         j->second.insert(i);
     }
 
-    PeriodicSamplesGroup resampledAndCombined;
+    std::size_t N = resampled.empty() ? 0 : resampled.front().size();
+
+    std::vector<std::vector<boost::uint64_t> > sums(
+        unique.size(), std::vector<boost::uint64_t>(N, 0)
+        );
+    
+    std::vector<CombineTask> tasks;
 
+    std::size_t s = 0;
     for (std::map<NameAndKind, GroupIndex>::const_iterator
-             i = unique.begin(), i_end = unique.end(); i != i_end; ++i)
+             i = unique.begin(), i_end = unique.end(); i != i_end; ++i, ++s)
     {
-        AccumulatedData data;
-
-        for (std::set<std::size_t>::const_iterator
-                 j = i->second.begin(), j_end = i->second.end();
-             j != j_end;
-             ++j)
+        for (std::size_t n = 0; n < N; n += kMaxBinsPerCombineTask)
         {
-            resampled[*j].visit(
-                resampled[*j].interval(),
-                boost::bind(accumulate, _1, _2, boost::ref(data))
-                );
+            CombineTask task;
+            task.dm_index = &i->second;
+            task.dm_sums = &sums[s];
+            task.dm_begin = n;
+            task.dm_end = std::min(n + kMaxBinsPerCombineTask, N);
+            tasks.push_back(task);
         }
-        
+    }
+    
+    parallelFor(tasks.size(), boost::bind(
+                    combine, boost::cref(resampled),
+                    boost::cref(interval), boost::cref(rate),
+                    boost::cref(tasks), _1
+                    ));
+    
+    PeriodicSamplesGroup resampledAndCombined;
+
+    s = 0;
+    for (std::map<NameAndKind, GroupIndex>::const_iterator
+             i = unique.begin(), i_end = unique.end(); i != i_end; ++i, ++s)
+    {
         PeriodicSamples samples(i->first.first, i->first.second);
-        
-        if (i->first.second == PeriodicSamples::kCount)
-        {
-            for (AccumulatedData::const_iterator
-                     k = data.begin(), k_end = data.end(); k != k_end; ++k)
-            {
-                samples.add(k->first /* Time */, k->second.second /* Sum */);
-            }
-        }
-        else
+
+        boost::uint64_t count = i->second.size();
+
+        for (std::size_t n = 0; n < N; ++n)
         {
-            for (AccumulatedData::const_iterator
-                     k = data.begin(), k_end = data.end(); k != k_end; ++k)
-            {
-                samples.add(
-                    k->first /* Time */,
-                    k->second.second /* Sum */ / k->second.first /* Count */
-                    );
-            }
+            samples.add(
+                interval.begin() + Time(n * rate),
+                (i->first.second == PeriodicSamples::kCount) ?
+                    sums[s][n] : (sums[s][n] / count)
+                );
         }
         
         resampledAndCombined.push_back(samples);
@@ -253,6 +398,10 @@ PeriodicSamplesGroup ArgoNavis::Base::getResampledAndCombined(
 
 
 //------------------------------------------------------------------------------
+// Rather than flattening the entire group before visiting it, perform a k-way
+// merge of the samples using a heap holding the next sample time from each of
+// the PeriodicSamples. Only one row of values is ever materialized, and early
+// termination by the visitor avoids touching the remaining samples entirely.
 //------------------------------------------------------------------------------
 void ArgoNavis::Base::visitConcurrently(
     const PeriodicSamplesGroup& group,
@@ -260,26 +409,59 @@ void ArgoNavis::Base::visitConcurrently(
     const PeriodicSampleVisitor& visitor
     )
 {
-    FlattenedData data;
+    std::size_t N = group.size();
+    
+    std::vector<std::size_t> next(N), end(N);
+    MergeHeap heap;
 
-    for (std::size_t n = 0, N = group.size(); n < N; ++n)
+    for (std::size_t n = 0; n < N; ++n)
     {
-        group[n].visit(
-            group[n].interval(),
-            boost::bind(flatten, _1, _2,
-                        boost::cref(n), boost::cref(N), boost::ref(data))
-            );
+        const std::vector<Time>& times = group[n].dm_times;
+        
+        next[n] = !interval ? 0 : (std::lower_bound(
+            times.begin(), times.end(), interval->begin()
+            ) - times.begin());
+        end[n] = !interval ? times.size() : (std::upper_bound(
+            times.begin(), times.end(), interval->end()
+            ) - times.begin());
+
+        if (next[n] < end[n])
+        {
+            heap.push(std::make_pair(times[next[n]], n));
+        }
     }
 
+    std::vector<boost::uint64_t> row(N, 0);
+    std::vector<std::size_t> touched;
+    touched.reserve(N);
+    
     bool terminate = false;
 
-    for (FlattenedData::const_iterator i = data.begin(), i_end = data.end();
-         !terminate && (i != i_end);
-         ++i)
+    while (!terminate && !heap.empty())
     {
-        if (!interval || interval->contains(i->first))
+        Time time = heap.top().first;
+
+        for (std::vector<std::size_t>::const_iterator
+                 i = touched.begin(), i_end = touched.end(); i != i_end; ++i)
         {
-            terminate |= !visitor(i->first, i->second);
+            row[*i] = 0;
         }
+        touched.clear();
+
+        while (!heap.empty() && (heap.top().first == time))
+        {
+            std::size_t n = heap.top().second;
+            heap.pop();
+
+            row[n] = group[n].dm_values[next[n]];
+            touched.push_back(n);
+            
+            if (++next[n] < end[n])
+            {
+                heap.push(std::make_pair(group[n].dm_times[next[n]], n));
+            }
+        }
+
+        terminate |= !visitor(time, row);
     }
 }
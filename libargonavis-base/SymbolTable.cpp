@@ -20,7 +20,23 @@
 /** @file Definition of the SymbolTable class. */
 
 #include <algorithm>
+#include <boost/crc.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/format.hpp>
+#include <boost/noncopyable.hpp>
+#include <cstdlib>
 #include <cstring>
+#include <fcntl.h>
+#include <limits>
+#include <map>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#include <ArgoNavis/Base/Raise.hpp>
 
 #include "SymbolTable.hpp"
 
@@ -29,6 +45,311 @@ using namespace ArgoNavis::Base::Impl;
 
 
 
+/** Anonymous namespace hiding implementation details. */
+namespace {
+
+    /** Magic number identifying a symbol table cache file. */
+    const char kCacheMagic[8] = { 'A', 'N', 'S', 'Y', 'M', 'T', 'A', 'B' };
+
+    /**
+     * Version number of the symbol table cache file format. Version 1 files
+     * may contain address range index trees whose maximum ending addresses
+     * are too small, and are therefore rejected.
+     */
+    const boost::uint32_t kCacheVersion = 2;
+
+    /** Value used to detect a cache file written with another byte order. */
+    const boost::uint64_t kCacheByteOrder = 0x0102030405060708ULL;
+    
+    /** Structure describing one entity table within a cache file. */
+    struct CacheTable
+    {
+        /** Offset of the entity records. */
+        boost::uint64_t dm_entities;
+
+        /** Number of entity records. */
+        boost::uint64_t dm_entity_count;
+
+        /** Offset of the address range index rows. */
+        boost::uint64_t dm_rows;
+
+        /** Number of address range index rows. */
+        boost::uint64_t dm_row_count;
+
+        /** Level of the root of the address range index's tree. */
+        boost::int64_t dm_levels;
+    };
+    
+    /**
+     * Header of a symbol table cache file. All offsets are in bytes from the
+     * beginning of the file, and all string offsets are in bytes from the
+     * beginning of the string table. Values are in the native byte order.
+     */
+    struct CacheHeader
+    {
+        /** Magic number identifying a symbol table cache file. */
+        char dm_magic[8];
+
+        /** Version number of the cache file format. */
+        boost::uint32_t dm_version;
+
+        /** Size of an address range index row. */
+        boost::uint32_t dm_row_size;
+
+        /** Value used to detect a different byte order. */
+        boost::uint64_t dm_byte_order;
+        
+        /** Checksum of the linked object file. */
+        boost::uint64_t dm_checksum;
+
+        /** Offset of the string table. */
+        boost::uint64_t dm_strings;
+
+        /** Size of the string table. */
+        boost::uint64_t dm_strings_size;
+
+        /** String offset of the linked object file's path. */
+        boost::uint64_t dm_path;
+
+        /** Table of functions. */
+        CacheTable dm_functions;
+
+        /** Table of loops. */
+        CacheTable dm_loops;
+
+        /** Table of statements. */
+        CacheTable dm_statements;
+    };
+
+    /** Entity record for a function within a cache file. */
+    struct CacheFunction
+    {
+        /** String offset of the function's mangled name. */
+        boost::uint64_t dm_name;
+    };
+
+    /** Entity record for a loop within a cache file. */
+    struct CacheLoop
+    {
+        /** Head address of the loop. */
+        boost::uint64_t dm_head;
+    };
+
+    /** Entity record for a statement within a cache file. */
+    struct CacheStatement
+    {
+        /** String offset of the statement's source file path. */
+        boost::uint64_t dm_path;
+
+        /** Checksum of the statement's source file. */
+        boost::uint64_t dm_checksum;
+
+        /** Line number of the statement. */
+        boost::uint32_t dm_line;
+
+        /** Column number of the statement. */
+        boost::uint32_t dm_column;
+    };
+
+    /** Read-only memory mapping of a symbol table cache file. */
+    class CacheMapping :
+        private boost::noncopyable
+    {
+
+    public:
+
+        /** Map the given file into memory. */
+        CacheMapping(const boost::filesystem::path& path) :
+            dm_data(MAP_FAILED),
+            dm_size(0)
+        {
+            int fd = open(path.c_str(), O_RDONLY);
+            if (fd == -1)
+            {
+                return;
+            }
+
+            struct stat status;
+            if ((fstat(fd, &status) == 0) && (status.st_size > 0))
+            {
+                dm_size = status.st_size;
+                dm_data = mmap(NULL, dm_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            }
+            
+            close(fd);
+        }
+
+        /** Unmap the file from memory. */
+        ~CacheMapping()
+        {
+            if (dm_data != MAP_FAILED)
+            {
+                munmap(dm_data, dm_size);
+            }
+        }
+
+        /** Get a pointer to the given offset within the file. */
+        const char* at(boost::uint64_t offset) const
+        {
+            return reinterpret_cast<const char*>(dm_data) + offset;
+        }
+        
+        /** Does the file contain the given region? */
+        bool contains(boost::uint64_t offset, boost::uint64_t size) const
+        {
+            return (dm_data != MAP_FAILED) && (offset <= dm_size) &&
+                (size <= (dm_size - offset));
+        }
+        
+    private:
+
+        /** Address of the mapping. */
+        void* dm_data;
+
+        /** Size of the mapping. */
+        std::size_t dm_size;
+        
+    }; // class CacheMapping
+
+    /** Type of table used to assign offsets to the unique strings. */
+    typedef std::map<std::string, boost::uint64_t> StringTable;
+    
+    /** Add a string to the string table, returning its offset. */
+    boost::uint64_t add(const std::string& value, StringTable& table,
+                        std::string& strings)
+    {
+        StringTable::const_iterator i = table.find(value);
+        if (i != table.end())
+        {
+            return i->second;
+        }
+        
+        boost::uint64_t offset = strings.size();
+        strings.append(value.c_str(), value.size() + 1);
+        table.insert(std::make_pair(value, offset));
+        return offset;
+    }
+
+    /** Round the given offset up to a multiple of 8 bytes. */
+    boost::uint64_t align(boost::uint64_t offset)
+    {
+        return (offset + 7) & ~static_cast<boost::uint64_t>(7);
+    }
+
+    /** Compute the name of the cache file for the given linked object. */
+    boost::filesystem::path cacheFile(const boost::filesystem::path& directory,
+                                      const FileName& file)
+    {
+        boost::crc_optimal<
+            64,                 // Bits (width)
+            0x42f0e1eba9ea3693, // TruncPoly (poly)
+            0x0000000000000000, // InitRem (init)
+            0x0000000000000000, // FinalXor (xorout)
+            false,              // ReflectIn (refin)
+            false               // ReflectRem (refout)
+            > crc;
+
+        std::string path = file.path().string();
+        crc.process_bytes(path.c_str(), path.size());
+
+        return directory / boost::str(
+            boost::format("%016X-%016X.symtab") %
+            static_cast<boost::uint64_t>(crc.checksum()) % file.checksum()
+            );
+    }
+    
+    /** Fill in the rows and levels of an entity table within a cache file. */
+    template <typename T>
+    void layout(const EntityTable<T>& table, std::size_t record_size,
+                boost::uint64_t& offset, CacheTable& entry)
+    {
+        const AddressRangeIndex& index = table.addressIndex();
+
+        entry.dm_entities = offset = align(offset);
+        entry.dm_entity_count = table.size();
+        offset += entry.dm_entity_count * record_size;
+        
+        entry.dm_rows = offset = align(offset);
+        entry.dm_row_count = index.rows().size();
+        offset += entry.dm_row_count * sizeof(AddressRangeIndex::Row);
+        
+        entry.dm_levels = index.levels();
+    }
+
+    /** Get a pointer to the first element of a vector, if any. */
+    template <typename T>
+    const void* data(const std::vector<T>& vector)
+    {
+        return vector.empty() ? NULL : &vector[0];
+    }
+    
+    /** Write the given bytes at the given offset within a cache file. */
+    void write(boost::filesystem::ofstream& stream, boost::uint64_t offset,
+               const void* data, std::size_t size)
+    {
+        if (size > 0)
+        {
+            stream.seekp(offset);
+            stream.write(reinterpret_cast<const char*>(data), size);
+        }
+    }
+
+    /** Level of the root of an address range index with the given rows. */
+    boost::int64_t levels(boost::uint64_t count)
+    {
+        boost::int64_t k = 0;
+        while ((count >> (k + 1)) > 0)
+        {
+            ++k;
+        }
+        return k;
+    }
+
+    /**
+     * Is the given entity table within a cache file valid? The layout of the
+     * table is validated, as is the entity referenced by each row, since the
+     * rows are later used to index the entities without further checks. The
+     * rest of the rows' contents are trusted.
+     */
+    bool valid(const CacheMapping& mapping, const CacheTable& entry,
+               std::size_t record_size)
+    {
+        const boost::uint64_t kMaxRowCount =
+            std::numeric_limits<boost::uint64_t>::max() /
+            sizeof(AddressRangeIndex::Row);
+
+        if ((entry.dm_entity_count > 0xFFFFFFFF) ||
+            (entry.dm_row_count > kMaxRowCount) ||
+            !mapping.contains(entry.dm_entities,
+                              entry.dm_entity_count * record_size) ||
+            !mapping.contains(entry.dm_rows, entry.dm_row_count *
+                              sizeof(AddressRangeIndex::Row)) ||
+            ((entry.dm_entities % 8) != 0) || ((entry.dm_rows % 8) != 0) ||
+            (entry.dm_levels != levels(entry.dm_row_count)))
+        {
+            return false;
+        }
+
+        const AddressRangeIndex::Row* rows =
+            reinterpret_cast<const AddressRangeIndex::Row*>(
+                mapping.at(entry.dm_rows)
+                );
+
+        for (boost::uint64_t i = 0; i < entry.dm_row_count; ++i)
+        {
+            if (rows[i].dm_uid >= entry.dm_entity_count)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+    
+} // namespace <anonymous>
+
+
+
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
 SymbolTable::SymbolTable(const FileName& file) :
@@ -42,8 +363,12 @@ SymbolTable::SymbolTable(const FileName& file) :
 
 
 //------------------------------------------------------------------------------
+// In the lazy case only the (small) non-address fields of each entity are
+// constructed here. The address bitmaps are merely copied, and the expensive
+// work of decoding them into address sets and indexing those is left to the
+// first query of each entity table by address.
 //------------------------------------------------------------------------------
-SymbolTable::SymbolTable(const CBTF_Protocol_SymbolTable& message) :
+SymbolTable::SymbolTable(const CBTF_Protocol_SymbolTable& message, bool lazy) :
     dm_file(message.linked_object),
     dm_functions(),
     dm_loops(),
@@ -53,16 +378,28 @@ SymbolTable::SymbolTable(const CBTF_Protocol_SymbolTable& message) :
     // Iterate over each function in the given CBTF_Protocol_SymbolTable
     // and construct the corresponding entries in this symbol table.
     //
+
+    dm_functions.reserve(message.functions.functions_len);
     
     for (u_int i = 0; i < message.functions.functions_len; ++i)
     {
         const CBTF_Protocol_FunctionEntry& entry =
             message.functions.functions_val[i];
-        
-        EntityUID uid = dm_functions.add(
-            FunctionFields(entry.name),
-            AddressSet(entry.bitmaps.bitmaps_val, entry.bitmaps.bitmaps_len)
-            );
+
+        if (lazy)
+        {
+            dm_functions.add(FunctionFields(entry.name),
+                             entry.bitmaps.bitmaps_val,
+                             entry.bitmaps.bitmaps_len);
+        }
+        else
+        {
+            dm_functions.add(
+                FunctionFields(entry.name),
+                AddressSet(entry.bitmaps.bitmaps_val,
+                           entry.bitmaps.bitmaps_len)
+                );
+        }
     }
 
     //
@@ -70,17 +407,30 @@ SymbolTable::SymbolTable(const CBTF_Protocol_SymbolTable& message) :
     // and construct the corresponding entries in this symbol table.
     //
 
+    dm_statements.reserve(message.statements.statements_len);
+    
     for (u_int i = 0; i < message.statements.statements_len; ++i)
     {
         const CBTF_Protocol_StatementEntry& entry =
             message.statements.statements_val[i];
 
-        EntityUID uid = dm_statements.add(
-            StatementFields(entry.path,
-                            static_cast<unsigned int>(entry.line),
-                            static_cast<unsigned int>(entry.column)),
-            AddressSet(entry.bitmaps.bitmaps_val, entry.bitmaps.bitmaps_len)
-            );
+        StatementFields fields(entry.path,
+                               static_cast<unsigned int>(entry.line),
+                               static_cast<unsigned int>(entry.column));
+
+        if (lazy)
+        {
+            dm_statements.add(fields,
+                              entry.bitmaps.bitmaps_val,
+                              entry.bitmaps.bitmaps_len);
+        }
+        else
+        {
+            dm_statements.add(
+                fields, AddressSet(entry.bitmaps.bitmaps_val,
+                                   entry.bitmaps.bitmaps_len)
+                );
+        }
     }
 }
 
@@ -156,3 +506,314 @@ SymbolTable::operator CBTF_Protocol_SymbolTable() const
     // Return the completed CBTF_Protocol_SymbolTable to the caller
     return message;
 }
+
+
+
+//------------------------------------------------------------------------------
+// Only the (small) non-address fields of each entity are constructed here. The
+// rows of each address range index are left in the memory mapped file until
+// the first query of that entity table by address, at which time they, along
+// with the address sets recovered from them, are adopted without sorting or
+// rebuilding the index. The cache file is found by the linked object's path
+// and checksum, so a stale cache file is never found for a modified file.
+//------------------------------------------------------------------------------
+SymbolTable::Handle SymbolTable::load(const boost::filesystem::path& directory,
+                                      const FileName& file)
+{
+    boost::shared_ptr<const CacheMapping> mapping(
+        new CacheMapping(cacheFile(directory, file))
+        );
+
+    if (!mapping->contains(0, sizeof(CacheHeader)))
+    {
+        return Handle();
+    }
+
+    const CacheHeader& header =
+        *reinterpret_cast<const CacheHeader*>(mapping->at(0));
+
+    if ((memcmp(header.dm_magic, kCacheMagic, sizeof(kCacheMagic)) != 0) ||
+        (header.dm_version != kCacheVersion) ||
+        (header.dm_row_size != sizeof(AddressRangeIndex::Row)) ||
+        (header.dm_byte_order != kCacheByteOrder) ||
+        (header.dm_checksum != file.checksum()) ||
+        (header.dm_strings_size == 0) ||
+        !mapping->contains(header.dm_strings, header.dm_strings_size) ||
+        (*mapping->at(header.dm_strings + header.dm_strings_size - 1) != 0) ||
+        (header.dm_path >= header.dm_strings_size) ||
+        !valid(*mapping, header.dm_functions, sizeof(CacheFunction)) ||
+        !valid(*mapping, header.dm_loops, sizeof(CacheLoop)) ||
+        !valid(*mapping, header.dm_statements, sizeof(CacheStatement)))
+    {
+        return Handle();
+    }
+    
+    const char* strings = mapping->at(header.dm_strings);
+
+    if (file.path().string() != (strings + header.dm_path))
+    {
+        return Handle();
+    }
+    
+    Handle table(new SymbolTable(file));
+
+    //
+    // Construct the functions, loops, and statements from their entity
+    // records, and then adopt the rows of their address range indices.
+    //
+    
+    const CacheFunction* functions = reinterpret_cast<const CacheFunction*>(
+        mapping->at(header.dm_functions.dm_entities)
+        );
+
+    table->dm_functions.reserve(header.dm_functions.dm_entity_count);
+    
+    for (boost::uint64_t i = 0; i < header.dm_functions.dm_entity_count; ++i)
+    {
+        if (functions[i].dm_name >= header.dm_strings_size)
+        {
+            return Handle();
+        }
+        
+        table->dm_functions.add(
+            FunctionFields(strings + functions[i].dm_name)
+            );
+    }
+
+    const CacheLoop* loops = reinterpret_cast<const CacheLoop*>(
+        mapping->at(header.dm_loops.dm_entities)
+        );
+
+    table->dm_loops.reserve(header.dm_loops.dm_entity_count);
+    
+    for (boost::uint64_t i = 0; i < header.dm_loops.dm_entity_count; ++i)
+    {
+        table->dm_loops.add(LoopFields(Address(loops[i].dm_head)));
+    }
+    
+    const CacheStatement* statements = 
+        reinterpret_cast<const CacheStatement*>(
+            mapping->at(header.dm_statements.dm_entities)
+            );
+
+    table->dm_statements.reserve(header.dm_statements.dm_entity_count);
+    
+    for (boost::uint64_t i = 0; i < header.dm_statements.dm_entity_count; ++i)
+    {
+        if (statements[i].dm_path >= header.dm_strings_size)
+        {
+            return Handle();
+        }
+
+        CBTF_Protocol_FileName path;
+        path.path = const_cast<char*>(strings + statements[i].dm_path);
+        path.checksum = statements[i].dm_checksum;
+        
+        table->dm_statements.add(StatementFields(
+            FileName(path), statements[i].dm_line, statements[i].dm_column
+            ));
+    }
+
+    table->dm_functions.adopt(
+        mapping,
+        reinterpret_cast<const AddressRangeIndex::Row*>(
+            mapping->at(header.dm_functions.dm_rows)
+            ),
+        header.dm_functions.dm_row_count, header.dm_functions.dm_levels
+        );
+
+    table->dm_loops.adopt(
+        mapping,
+        reinterpret_cast<const AddressRangeIndex::Row*>(
+            mapping->at(header.dm_loops.dm_rows)
+            ),
+        header.dm_loops.dm_row_count, header.dm_loops.dm_levels
+        );
+
+    table->dm_statements.adopt(
+        mapping,
+        reinterpret_cast<const AddressRangeIndex::Row*>(
+            mapping->at(header.dm_statements.dm_rows)
+            ),
+        header.dm_statements.dm_row_count, header.dm_statements.dm_levels
+        );
+    
+    return table;
+}
+
+
+
+//------------------------------------------------------------------------------
+// The cache file is written under a unique temporary name and then renamed, so
+// that concurrent readers never see a partially written cache file, and that
+// concurrent writers (in this or other processes) never write the same file.
+//------------------------------------------------------------------------------
+void SymbolTable::save(const boost::filesystem::path& directory) const
+{
+    if (dm_file.checksum() == 0)
+    {
+        raise<std::invalid_argument>(
+            "The linked object file (%1%) has no checksum.", dm_file
+            );
+    }
+    
+    CacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.dm_magic, kCacheMagic, sizeof(kCacheMagic));
+    header.dm_version = kCacheVersion;
+    header.dm_row_size = sizeof(AddressRangeIndex::Row);
+    header.dm_byte_order = kCacheByteOrder;
+    header.dm_checksum = dm_file.checksum();
+
+    //
+    // Construct the string table and the entity records.
+    //
+    
+    StringTable table;
+    std::string strings;
+
+    header.dm_path = add(dm_file.path().string(), table, strings);
+    
+    std::vector<CacheFunction> functions(dm_functions.size());
+    for (EntityUID i = 0; i < dm_functions.size(); ++i)
+    {
+        functions[i].dm_name = add(dm_functions.fields(i).dm_name,
+                                   table, strings);
+    }
+
+    std::vector<CacheLoop> loops(dm_loops.size());
+    for (EntityUID i = 0; i < dm_loops.size(); ++i)
+    {
+        loops[i].dm_head = dm_loops.fields(i).dm_head;
+    }
+
+    std::vector<CacheStatement> statements(dm_statements.size());
+    for (EntityUID i = 0; i < dm_statements.size(); ++i)
+    {
+        const StatementFields& fields = dm_statements.fields(i);
+        statements[i].dm_path = add(fields.dm_file.path().string(),
+                                    table, strings);
+        statements[i].dm_checksum = fields.dm_file.checksum();
+        statements[i].dm_line = fields.dm_line;
+        statements[i].dm_column = fields.dm_column;
+    }
+
+    //
+    // Lay out the cache file and then write it.
+    //
+    
+    boost::uint64_t offset = sizeof(CacheHeader);
+
+    layout(dm_functions, sizeof(CacheFunction), offset, header.dm_functions);
+    layout(dm_loops, sizeof(CacheLoop), offset, header.dm_loops);
+    layout(dm_statements, sizeof(CacheStatement), offset,
+           header.dm_statements);
+
+    header.dm_strings = align(offset);
+    header.dm_strings_size = strings.size();
+
+    boost::filesystem::path path = cacheFile(directory, dm_file);
+
+    std::string name = path.string() + ".XXXXXX";
+    std::vector<char> buffer(name.begin(), name.end());
+    buffer.push_back('\0');
+
+    int fd = mkstemp(&buffer[0]);
+    if (fd == -1)
+    {
+        raise<std::runtime_error>(
+            "The symbol table cache file (%1%) couldn't be written.", path
+            );
+    }
+    fchmod(fd, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    close(fd);
+
+    boost::filesystem::path temporary(&buffer[0]);
+    
+    {
+        boost::filesystem::ofstream stream(
+            temporary, std::ios::binary | std::ios::trunc
+            );
+
+        write(stream, 0, &header, sizeof(header));
+        write(stream, header.dm_functions.dm_entities,
+              data(functions), functions.size() * sizeof(CacheFunction));
+        write(stream, header.dm_functions.dm_rows,
+              data(dm_functions.addressIndex().rows()),
+              header.dm_functions.dm_row_count *
+              sizeof(AddressRangeIndex::Row));
+        write(stream, header.dm_loops.dm_entities,
+              data(loops), loops.size() * sizeof(CacheLoop));
+        write(stream, header.dm_loops.dm_rows,
+              data(dm_loops.addressIndex().rows()),
+              header.dm_loops.dm_row_count *
+              sizeof(AddressRangeIndex::Row));
+        write(stream, header.dm_statements.dm_entities,
+              data(statements), statements.size() * sizeof(CacheStatement));
+        write(stream, header.dm_statements.dm_rows,
+              data(dm_statements.addressIndex().rows()),
+              header.dm_statements.dm_row_count *
+              sizeof(AddressRangeIndex::Row));
+        write(stream, header.dm_strings, strings.data(), strings.size());
+
+        if (!stream)
+        {
+            boost::system::error_code error;
+            boost::filesystem::remove(temporary, error);
+            raise<std::runtime_error>(
+                "The symbol table cache file (%1%) couldn't be written.",
+                temporary
+                );
+        }
+    }
+
+    boost::system::error_code error;
+    boost::filesystem::rename(temporary, path, error);
+    if (error)
+    {
+        boost::filesystem::remove(temporary, error);
+        raise<std::runtime_error>(
+            "The symbol table cache file (%1%) couldn't be written.", path
+            );
+    }
+}
+
+
+
+//------------------------------------------------------------------------------
+// The checksum of the linked object file isn't hashed because the file names
+// of equivalent symbol tables may differ in whether they have a checksum.
+//------------------------------------------------------------------------------
+std::size_t SymbolTable::hash() const
+{
+    std::size_t seed = 0;
+    hashCombine(seed, dm_file);
+    boost::hash_combine(seed, dm_functions.hash());
+    boost::hash_combine(seed, dm_loops.hash());
+    boost::hash_combine(seed, dm_statements.hash());
+    return seed;
+}
+
+
+
+//------------------------------------------------------------------------------
+// The individual comparisons are performed from least to most expensive in
+// order to optimize performance. Comparing the (cached) hashes first rejects
+// nearly all non-equivalent symbol tables without comparing any entities.
+//------------------------------------------------------------------------------
+bool SymbolTable::equivalent(const SymbolTable& other) const
+{
+    if (dm_file != other.dm_file)
+    {
+        return false;
+    }
+
+    if (hash() != other.hash())
+    {
+        return false;
+    }
+
+    return dm_functions.equivalent(other.dm_functions) &&
+        dm_loops.equivalent(other.dm_loops) &&
+        dm_statements.equivalent(other.dm_statements);
+}
@@ -21,7 +21,11 @@
 
 #pragma once
 
+#include <boost/cstdint.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/functional/hash.hpp>
 #include <boost/shared_ptr.hpp>
+#include <cstddef>
 #include <string>
 
 #include <KrellInstitute/Messages/Symbol.h>
@@ -29,6 +33,7 @@
 #include <ArgoNavis/Base/Address.hpp>
 #include <ArgoNavis/Base/FileName.hpp>
 
+#include "ContentHash.hpp"
 #include "EntityTable.hpp"
 
 namespace ArgoNavis { namespace Base { namespace Impl {
@@ -58,6 +63,18 @@ namespace ArgoNavis { namespace Base { namespace Impl {
             {
             }
 
+            /** Are these fields equivalent to another function's fields? */
+            bool operator==(const FunctionFields& other) const
+            {
+                return dm_name == other.dm_name;
+            }
+
+            /** Compute a hash of these fields. */
+            friend std::size_t hash_value(const FunctionFields& fields)
+            {
+                return boost::hash_value(fields.dm_name);
+            }
+
         }; // struct FunctionFields
 
         /** Structure containing the non-address fields of a loop. */
@@ -72,6 +89,20 @@ namespace ArgoNavis { namespace Base { namespace Impl {
             {
             }
 
+            /** Are these fields equivalent to another loop's fields? */
+            bool operator==(const LoopFields& other) const
+            {
+                return dm_head == other.dm_head;
+            }
+
+            /** Compute a hash of these fields. */
+            friend std::size_t hash_value(const LoopFields& fields)
+            {
+                return boost::hash_value(
+                    static_cast<boost::uint64_t>(fields.dm_head)
+                    );
+            }
+
         }; // struct LoopFields
 
         /** Structure containing the non-address fields of a statement. */
@@ -94,6 +125,24 @@ namespace ArgoNavis { namespace Base { namespace Impl {
                 dm_column(column)
             {
             }
+
+            /** Are these fields equivalent to another statement's fields? */
+            bool operator==(const StatementFields& other) const
+            {
+                return (dm_line == other.dm_line) &&
+                    (dm_column == other.dm_column) &&
+                    (dm_file == other.dm_file);
+            }
+
+            /** Compute a hash of these fields. */
+            friend std::size_t hash_value(const StatementFields& fields)
+            {
+                std::size_t seed = 0;
+                hashCombine(seed, fields.dm_file);
+                boost::hash_combine(seed, fields.dm_line);
+                boost::hash_combine(seed, fields.dm_column);
+                return seed;
+            }
             
         }; // struct StatementFields
                 
@@ -105,18 +154,70 @@ namespace ArgoNavis { namespace Base { namespace Impl {
          */
         SymbolTable(const FileName& file);
 
-        /** Construct a symbol table from a CBTF_Protocol_SymbolTable. */
-        SymbolTable(const CBTF_Protocol_SymbolTable& message);
+        /**
+         * Construct a symbol table from a CBTF_Protocol_SymbolTable.
+         *
+         * @param message    Message containing this symbol table.
+         * @param lazy       Boolean "true" if decoding the address bitmaps
+         *                   of each entity table should be deferred until
+         *                   that table is first queried by address, or
+         *                   "false" if they should all be decoded now.
+         */
+        SymbolTable(const CBTF_Protocol_SymbolTable& message, bool lazy);
         
         /** Type conversion to a CBTF_Protocol_SymbolTable. */
         operator CBTF_Protocol_SymbolTable() const;
 
+        /**
+         * Load a symbol table from a symbol table cache. The cache file is
+         * memory mapped, and its address indices are adopted directly by the
+         * entity tables the first time each of them is queried by address.
+         *
+         * @param directory    Directory containing the symbol table cache.
+         * @param file         Name of the linked object file whose symbol
+         *                     table is to be loaded.
+         * @return             Symbol table for that linked object file, or
+         *                     a null handle if the cache doesn't contain a
+         *                     (valid) symbol table for that file.
+         */
+        static Handle load(const boost::filesystem::path& directory,
+                           const FileName& file);
+
+        /**
+         * Save this symbol table to a symbol table cache.
+         *
+         * @param directory    Directory containing the symbol table cache.
+         *
+         * @throw std::invalid_argument    This symbol table's linked object
+         *                                 file has no checksum.
+         * @throw std::runtime_error       The cache file couldn't be written.
+         */
+        void save(const boost::filesystem::path& directory) const;
+
         /** Get the name of this symbol table's linked object file. */
         const FileName& file() const
         {
             return dm_file;
         }
 
+        /**
+         * Get a hash of the contents of this symbol table. Equivalent symbol
+         * tables always have equal hashes. The hash of each entity table is
+         * cached until that table is next modified.
+         */
+        std::size_t hash() const;
+
+        /**
+         * Is this symbol table equivalent to another one? I.e. do they have
+         * the same linked object file, and does each contain an equivalent
+         * of every function, loop, and statement in the other?
+         *
+         * @param other    Symbol table to be compared.
+         * @return         Boolean "true" if the two symbol tables are
+         *                 equivalent, or "false" otherwise.
+         */
+        bool equivalent(const SymbolTable& other) const;
+
         /** Access the table of functions in this symbol table. */
         const EntityTable<FunctionFields>& functions() const
         {
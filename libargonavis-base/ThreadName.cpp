@@ -20,6 +20,7 @@
 /** @file Definition of the ThreadName class. */
 
 #include <boost/format.hpp>
+#include <boost/functional/hash.hpp>
 #include <cstring>
 #include <sstream>
 
@@ -224,3 +225,23 @@ std::ostream& ArgoNavis::Base::operator<<(std::ostream& stream,
     
     return stream;
 }
+
+
+
+//------------------------------------------------------------------------------
+// The MPI and OpenMP ranks aren't hashed because they aren't considered when
+// comparing thread names. An absent thread identifier hashes differently than
+// any thread identifier that might be present.
+//------------------------------------------------------------------------------
+std::size_t ArgoNavis::Base::hash_value(const ThreadName& name)
+{
+    std::size_t seed = 0;
+    boost::hash_combine(seed, name.host());
+    boost::hash_combine(seed, name.pid());
+    boost::hash_combine(seed, name.tid() ? true : false);
+    if (name.tid())
+    {
+        boost::hash_combine(seed, *name.tid());
+    }
+    return seed;
+}
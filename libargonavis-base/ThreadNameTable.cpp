@@ -0,0 +1,93 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2017 Argo Navis Technologies. All Rights Reserved.
+//
+// This program is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation; either version 2 of the License, or (at your option) any later
+// version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+// Place, Suite 330, Boston, MA  02111-1307  USA
+////////////////////////////////////////////////////////////////////////////////
+
+/** @file Definition of the ThreadNameTable class. */
+
+#include <stdexcept>
+#include <utility>
+
+#include <ArgoNavis/Base/Raise.hpp>
+#include <ArgoNavis/Base/ThreadNameTable.hpp>
+
+using namespace ArgoNavis::Base;
+
+
+
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+ThreadNameTable::ThreadNameTable() :
+    dm_names(),
+    dm_identifiers()
+{
+}
+
+
+
+//------------------------------------------------------------------------------
+// A single hash table lookup is performed, whether or not the thread name is
+// already present, by attempting the insertion of the next identifier.
+//------------------------------------------------------------------------------
+ThreadNameTable::Identifier ThreadNameTable::add(const ThreadName& name)
+{
+    std::pair<
+        boost::unordered_map<ThreadName, Identifier>::iterator, bool
+        > i = dm_identifiers.insert(std::make_pair(name, dm_names.size()));
+
+    if (i.second)
+    {
+        dm_names.push_back(name);
+    }
+
+    return i.first->second;
+}
+
+
+
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+boost::optional<ThreadNameTable::Identifier> ThreadNameTable::find(
+    const ThreadName& name
+    ) const
+{
+    boost::unordered_map<ThreadName, Identifier>::const_iterator i =
+        dm_identifiers.find(name);
+
+    if (i == dm_identifiers.end())
+    {
+        return boost::none;
+    }
+
+    return i->second;
+}
+
+
+
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+const ThreadName& ThreadNameTable::name(const Identifier& identifier) const
+{
+    if (identifier >= dm_names.size())
+    {
+        raise<std::invalid_argument>(
+            "The given thread name identifier (%1%) is not valid (< %2%).",
+            identifier, dm_names.size()
+            );
+    }
+
+    return dm_names[identifier];
+}
@@ -25,15 +25,26 @@
 
 #include <boost/assign/list_of.hpp>
 #include <boost/bind.hpp>
+#include <boost/crc.hpp>
 #include <boost/cstdint.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/filesystem/fstream.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_int_distribution.hpp>
 #include <boost/ref.hpp>
 #include <boost/test/unit_test.hpp>
+#include <boost/version.hpp>
+#include <boost/tuple/tuple.hpp>
+#include <algorithm>
 #include <cstdlib>
+#include <cstring>
 #include <functional>
+#include <malloc.h>
 #include <map>
+#include <new>
 #include <set>
+#include <sstream>
 #include <stdexcept>
 #include <string>
 #include <utility>
@@ -42,13 +53,17 @@
 #include <ArgoNavis/Base/Address.hpp>
 #include <ArgoNavis/Base/AddressBitmap.hpp>
 #include <ArgoNavis/Base/AddressRange.hpp>
+#include <ArgoNavis/Base/AddressSet.hpp>
 #include <ArgoNavis/Base/AddressSpaces.hpp>
 #include <ArgoNavis/Base/FileName.hpp>
 #include <ArgoNavis/Base/Function.hpp>
 #include <ArgoNavis/Base/LinkedObject.hpp>
 #include <ArgoNavis/Base/Loop.hpp>
+#include <ArgoNavis/Base/PeriodicSamples.hpp>
+#include <ArgoNavis/Base/PeriodicSamplesGroup.hpp>
 #include <ArgoNavis/Base/Statement.hpp>
 #include <ArgoNavis/Base/ThreadName.hpp>
+#include <ArgoNavis/Base/ThreadNameTable.hpp>
 #include <ArgoNavis/Base/Time.hpp>
 #include <ArgoNavis/Base/TimeInterval.hpp>
 
@@ -57,9 +72,356 @@ using namespace ArgoNavis::Base::Impl;
 
 
 
+/**
+ * Declare a benchmark test case. Benchmarks are disabled by default, and run
+ * only when selected explicitly (e.g. "--run_test='Benchmark*'"), where the
+ * Boost version supports test case decorators (1.59 and later). Older versions
+ * run them along with the tests.
+ */
+#if BOOST_VERSION >= 105900
+#define BENCHMARK_TEST_CASE(name) \
+    BOOST_AUTO_TEST_CASE(name, *boost::unit_test::disabled())
+#else
+#define BENCHMARK_TEST_CASE(name) BOOST_AUTO_TEST_CASE(name)
+#endif
+
+
+
+/**
+ * Number of bytes currently allocated on the heap via operator new. Maintained
+ * by the replacement global allocation functions below so that the benchmarks
+ * can report the memory footprint of the data structures they exercise.
+ */
+static boost::uint64_t heap_bytes_in_use = 0;
+
+/**
+ * Replacement global allocation function tracking heap usage. Never inlined,
+ * so that the compiler doesn't pair the malloc() and free() underlying these
+ * replacements with the new and delete expressions that call them.
+ */
+__attribute__ ((noinline)) void* operator new(std::size_t size)
+{
+    void* ptr = malloc((size > 0) ? size : 1);
+    if (ptr == NULL)
+    {
+        throw std::bad_alloc();
+    }
+    __sync_fetch_and_add(&heap_bytes_in_use, malloc_usable_size(ptr));
+    return ptr;
+}
+
+/** Replacement global deallocation function tracking heap usage. */
+__attribute__ ((noinline)) void operator delete(void* ptr) throw()
+{
+    if (ptr != NULL)
+    {
+        __sync_fetch_and_sub(&heap_bytes_in_use, malloc_usable_size(ptr));
+        free(ptr);
+    }
+}
+
+/** Replacement global array allocation function tracking heap usage. */
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+/** Replacement global array deallocation function tracking heap usage. */
+void operator delete[](void* ptr) throw()
+{
+    operator delete(ptr);
+}
+
+
+
 /** Anonymous namespace hiding implementation details. */
 namespace {
 
+    /**
+     * Reference implementation of PeriodicSamples::resampleDeltas(), using the
+     * original lower_bound/upper_bound search over a map for every new sample.
+     * Used to check the merge-based implementation gives identical results.
+     */
+    std::vector<std::pair<Time, boost::uint64_t> > referenceResampleDeltas(
+        const std::map<Time, boost::uint64_t>& samples,
+        const TimeInterval& interval, const Time& rate
+        )
+    {
+        typedef std::map<Time, boost::uint64_t>::const_iterator IteratorType;
+        
+        boost::uint64_t N = ((interval.width() + rate - 1) / rate) + 1;
+        
+        std::vector<std::pair<Time, boost::uint64_t> > resampled;
+        
+        boost::uint64_t v = 0;
+        
+        for (boost::uint64_t n = 0; n < N; ++n)
+        {
+            Time t = interval.begin() + Time(n * rate);
+            
+            TimeInterval nue(
+                (n == 0) ?
+                    Time::TheBeginning() :
+                    interval.begin() + Time((n - 1) * rate) + 1,
+                t
+                );
+            
+            IteratorType i_begin = samples.lower_bound(nue.begin());
+            IteratorType i_end = samples.upper_bound(nue.end());
+            
+            if (i_begin != samples.begin())
+            {
+                --i_begin;
+            }
+            
+            if (i_end != samples.end())
+            {
+                ++i_end;
+            }
+            
+            for (IteratorType i = i_begin; i != i_end; ++i)
+            {
+                TimeInterval original(
+                    (i == samples.begin()) ?
+                        Time::TheBeginning() :
+                        (--IteratorType(i))->first + 1,
+                    i->first
+                    );
+                
+                boost::uint64_t total = i->second -
+                    ((i == samples.begin()) ? 0 : (--IteratorType(i))->second);
+                
+                double weight = original.empty() ? 0.0 :
+                    (static_cast<double>((nue & original).width()) /
+                     static_cast<double>(original.width()));
+                
+                v += static_cast<boost::uint64_t>(
+                    round(static_cast<double>(total) * weight)
+                    );
+            }
+            
+            resampled.push_back(std::make_pair(t, v));
+        }
+        
+        return resampled;
+    }
+    
+    /**
+     * Reference implementation of AddressBitmap::ranges(), using the original
+     * per-bit iteration over a std::vector<bool>, including the range check
+     * that AddressBitmap::get() performed on every bit.
+     */
+    std::set<AddressRange> referenceRanges(const AddressRange& range,
+                                           const std::vector<bool>& bitmap,
+                                           bool value)
+    {
+        std::set<AddressRange> result;
+        
+        bool in = false;
+        Address begin;
+        for (Address i = range.begin(); i <= range.end(); ++i)
+        {
+            if (!range.contains(i))
+            {
+                throw std::invalid_argument("");
+            }
+
+            bool bit = bitmap[i - range.begin()];
+            
+            if (!in && (bit == value))
+            {
+                in = true;
+                begin = i;
+            }
+            else if (in && (bit != value))
+            {
+                in = false;
+                result.insert(AddressRange(begin, i - 1));
+            }
+        }
+        
+        if (in)
+        {
+            result.insert(AddressRange(begin, range.end()));
+        }
+        
+        return result;
+    }
+
+    /**
+     * Reference implementation of the AddressBitmap constructor accepting a
+     * CBTF_Protocol_AddressBitmap, using the original per-bit decoding into
+     * a std::vector<bool>.
+     */
+    std::vector<bool> referenceFromMessage(
+        const CBTF_Protocol_AddressBitmap& message
+        )
+    {
+        AddressRange range(message.range);
+        std::vector<bool> bitmap(range.width(), false);
+        
+        for (boost::uint64_t i = 0; i < range.width(); ++i)
+        {
+            bitmap[i] = message.bitmap.data.data_val[i / 8] & (1 << (i % 8));
+        }
+
+        return bitmap;
+    }
+
+    /**
+     * Reference implementation of the AddressBitmap conversion to a
+     * CBTF_Protocol_AddressBitmap, using the original per-bit encoding from
+     * a std::vector<bool>.
+     */
+    CBTF_Protocol_AddressBitmap referenceToMessage(
+        const AddressRange& range, const std::vector<bool>& bitmap
+        )
+    {
+        boost::uint64_t width = range.width();
+        boost::uint64_t size =
+            std::max<boost::uint64_t>(1, ((width - 1) / 8) + 1);
+
+        CBTF_Protocol_AddressBitmap message;
+        memset(&message, 0, sizeof(message));
+        
+        message.range = range;
+        message.bitmap.data.data_len = size;
+        message.bitmap.data.data_val = reinterpret_cast<uint8_t*>(malloc(size));
+        
+        memset(message.bitmap.data.data_val, 0, size);
+        
+        for (boost::uint64_t i = 0; i < width; ++i)
+        {
+            if (bitmap[i])
+            {
+                message.bitmap.data.data_val[i / 8] |= 1 << (i % 8);
+            }
+        }
+        
+        return message;
+    }
+    
+    /**
+     * Extract an address set into CBTF_Protocol_AddressBitmap messages and then
+     * reconstruct an address set from those messages.
+     */
+    std::set<AddressRange> roundTrip(const AddressSet& set, u_int& len)
+    {
+        CBTF_Protocol_AddressBitmap* messages = NULL;
+        set.extract(messages, len);
+        
+        std::set<AddressRange> ranges = AddressSet(messages, len);
+        
+        for (u_int i = 0; i < len; ++i)
+        {
+            free(messages[i].bitmap.data.data_val);
+        }
+        free(messages);
+
+        return ranges;
+    }
+
+    /**
+     * Scale the given default benchmark problem size by the factor found in
+     * the ARGONAVIS_BENCHMARK_SCALE environment variable (if any). Allows the
+     * benchmarks to be shrunk for quick runs or grown for more stable timings.
+     */
+    std::size_t benchmarkSize(std::size_t size)
+    {
+        const char* scale = getenv("ARGONAVIS_BENCHMARK_SCALE");
+        if (scale == NULL)
+        {
+            return size;
+        }
+        return std::max<std::size_t>(
+            1, static_cast<std::size_t>(atof(scale) * size)
+            );
+    }
+
+    /** Seconds elapsed since the given time. */
+    double secondsSince(const Time& start)
+    {
+        return static_cast<double>(Time::Now() - start) / 1000000000.0;
+    }
+
+    /** Visitor used to accumulate the periodic samples. */
+    bool addPeriodicSample(
+        const Time& time, const std::vector<boost::uint64_t>& values,
+        std::vector<std::pair<Time, boost::uint64_t> >& samples
+        )
+    {
+        samples.push_back(std::make_pair(time, values[0]));
+        return true;
+    }
+
+    /** Visitor used to accumulate up to a maximum number of sample rows. */
+    bool addPeriodicSamples(
+        const Time& time, const std::vector<boost::uint64_t>& values,
+        std::vector<std::pair<Time, std::vector<boost::uint64_t> > >& rows,
+        std::size_t max
+        )
+    {
+        rows.push_back(std::make_pair(time, values));
+        return rows.size() < max;
+    }
+
+    /** Get all of the samples within a PeriodicSamples. */
+    std::vector<std::pair<Time, boost::uint64_t> > samplesOf(
+        const PeriodicSamples& samples
+        )
+    {
+        std::vector<std::pair<Time, boost::uint64_t> > result;
+        samples.visit(
+            samples.interval(),
+            boost::bind(addPeriodicSample, _1, _2, boost::ref(result))
+            );
+        return result;
+    }
+
+    /** Visitor used to sum the periodic samples. */
+    bool sumPeriodicSamples(const Time& time,
+                            const std::vector<boost::uint64_t>& values,
+                            boost::uint64_t& sum)
+    {
+        sum += values[0];
+        return true;
+    }
+
+    /** Reference checksum of a file's contents, as FileName formerly did. */
+    boost::uint64_t referenceChecksum(const boost::filesystem::path& path)
+    {
+        static char buffer[1 * 1024 * 1024 /* 1 MB */];
+        
+        boost::crc_optimal<64, 0x42f0e1eba9ea3693, 0, 0, false, false> crc;
+        
+        boost::filesystem::ifstream stream(path, std::ios::binary);
+        for (std::streamsize n = stream.readsome(buffer, sizeof(buffer));
+             n > 0;
+             n = stream.readsome(buffer, sizeof(buffer)))
+        {
+            crc.process_bytes(buffer, n);
+        }
+        
+        return static_cast<boost::uint64_t>(crc.checksum());
+    }
+
+    /** Write a file of the given size containing random bytes. */
+    void writeRandomFile(const boost::filesystem::path& path, std::size_t size,
+                         boost::random::mt19937& generator)
+    {
+        std::vector<char> buffer(size);
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            buffer[i] = static_cast<char>(generator() & 0xFF);
+        }
+        
+        boost::filesystem::ofstream stream(path, std::ios::binary);
+        if (size > 0)
+        {
+            stream.write(&buffer[0], size);
+        }
+    }
+    
     /** Templated visitor for accumulating functions, etc. */
     template <typename T>
     bool accumulate(const T& x, std::set<T>& set)
@@ -68,6 +430,44 @@ namespace {
         return true;
     }
 
+    /** Visitor for accumulating functions intersecting an address range. */
+    bool accumulateIntersecting(const Function& function,
+                                const AddressRange& range,
+                                std::set<Function>& functions)
+    {
+        std::set<AddressRange> ranges = function.ranges();
+        for (std::set<AddressRange>::const_iterator
+                 i = ranges.begin(); i != ranges.end(); ++i)
+        {
+            if (i->intersects(range))
+            {
+                functions.insert(function);
+                break;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * Templated function returning the greatest beginning address of those
+     * address ranges of a function, etc. containing the given address.
+     */
+    template <typename T>
+    Address innermostBegin(const T& x, const Address& address)
+    {
+        Address result = Address::TheLowest();
+        std::set<AddressRange> ranges = x.ranges();
+        for (std::set<AddressRange>::const_iterator
+                 i = ranges.begin(); i != ranges.end(); ++i)
+        {
+            if (i->contains(address) && (result < i->begin()))
+            {
+                result = i->begin();
+            }
+        }
+        return result;
+    }
+
     /** Templated visitor for accumulating mappings. */
     bool accumulateMappings(
         const ThreadName& thread,
@@ -86,6 +486,38 @@ namespace {
         set.insert(std::make_pair(linked_object, where));
         return true;
     }
+
+    /** Type of a single mapping as found by the mapping visitors. */
+    typedef boost::tuple<LinkedObject, AddressRange, TimeInterval> Mapping;
+    
+    /** Visitor for accumulating mappings into a list. */
+    bool accumulateMappingList(const ThreadName& thread,
+                               const LinkedObject& linked_object,
+                               const AddressRange& range,
+                               const TimeInterval& interval,
+                               std::vector<Mapping>& list)
+    {
+        list.push_back(boost::make_tuple(linked_object, range, interval));
+        return true;
+    }
+
+    /** Describe each of the given mappings, in sorted order. */
+    std::vector<std::string> describeMappings(
+        const std::vector<Mapping>& mappings
+        )
+    {
+        std::vector<std::string> descriptions;
+        for (std::vector<Mapping>::const_iterator
+                 i = mappings.begin(); i != mappings.end(); ++i)
+        {
+            std::ostringstream stream;
+            stream << i->get<0>().file() << " " << i->get<1>() << " "
+                   << i->get<2>();
+            descriptions.push_back(stream.str());
+        }
+        std::sort(descriptions.begin(), descriptions.end());
+        return descriptions;
+    }
     
 } // namespace <anonymous>
 
@@ -178,6 +610,57 @@ BOOST_AUTO_TEST_CASE(TestAddressBitmap)
         AddressBitmap(static_cast<CBTF_Protocol_AddressBitmap>(bitmap)),
         bitmap
         );
+
+    bitmap = AddressBitmap(AddressRange(0x1000, 0x1000 + 999));
+    bitmap.set(AddressRange(0x1000 + 60, 0x1000 + 200), true);
+    bitmap.set(AddressRange(0x1000 + 64, 0x1000 + 127), false);
+    bitmap.set(AddressRange(0x1000 + 900, 0x1000 + 999), true);
+    BOOST_CHECK_THROW(
+        bitmap.set(AddressRange(0x1000 + 900, 0x1000 + 1000), true),
+        std::invalid_argument
+        );
+    ranges = bitmap.ranges(true);
+    BOOST_CHECK(ranges == boost::assign::list_of
+                (AddressRange(0x1000 + 60, 0x1000 + 63))
+                (AddressRange(0x1000 + 128, 0x1000 + 200))
+                (AddressRange(0x1000 + 900, 0x1000 + 999))
+                .convert_to_container<std::set<AddressRange> >());
+    ranges = bitmap.ranges(false);
+    BOOST_CHECK(ranges == boost::assign::list_of
+                (AddressRange(0x1000, 0x1000 + 59))
+                (AddressRange(0x1000 + 64, 0x1000 + 127))
+                (AddressRange(0x1000 + 201, 0x1000 + 899))
+                .convert_to_container<std::set<AddressRange> >());
+    
+    // Compare against per-bit results on randomized bitmaps
+    
+    boost::random::mt19937 generator;
+    boost::random::uniform_int_distribution<boost::uint64_t> width(1, 2000);
+    boost::random::uniform_int_distribution<int> bit(0, 1);
+    
+    for (int trial = 0; trial < 100; ++trial)
+    {
+        AddressRange range(0x4000, 0x4000 + width(generator) - 1);
+        std::vector<bool> expected(range.width());
+
+        bitmap = AddressBitmap(range);
+        for (std::size_t i = 0; i < expected.size(); ++i)
+        {
+            // Favor runs of identical bits spanning multiple words
+            expected[i] = ((i / (64 * bit(generator) + 1)) % 3) == 0;
+            bitmap.set(range.begin() + Address(i), expected[i]);
+        }
+
+        BOOST_CHECK(bitmap.ranges(true) ==
+                    referenceRanges(range, expected, true));
+        BOOST_CHECK(bitmap.ranges(false) ==
+                    referenceRanges(range, expected, false));
+
+        CBTF_Protocol_AddressBitmap message = bitmap;
+        BOOST_CHECK(referenceFromMessage(message) == expected);
+        BOOST_CHECK_EQUAL(AddressBitmap(message), bitmap);
+        free(message.bitmap.data.data_val);
+    }
 }
 
 
@@ -296,6 +779,79 @@ BOOST_AUTO_TEST_CASE(TestAddressRange)
 
 
 
+/**
+ * Unit test for the AddressSet class.
+ */
+BOOST_AUTO_TEST_CASE(TestAddressSet)
+{
+    AddressSet set;
+    BOOST_CHECK(set.empty());
+    BOOST_CHECK(static_cast<std::set<AddressRange> >(set).empty());
+
+    set += boost::assign::list_of
+        (AddressRange(10, 19))
+        (AddressRange(40, 49))
+        .convert_to_container<std::set<AddressRange> >();
+    set += boost::assign::list_of
+        (AddressRange(15, 24))
+        (AddressRange(25, 29))
+        (AddressRange(35, 39))
+        .convert_to_container<std::set<AddressRange> >();
+    
+    BOOST_CHECK(!set.empty());
+    BOOST_CHECK(static_cast<std::set<AddressRange> >(set) ==
+                boost::assign::list_of
+                    (AddressRange(10, 29))
+                    (AddressRange(35, 49))
+                    .convert_to_container<std::set<AddressRange> >());
+
+    BOOST_CHECK(!set.contains(9));
+    BOOST_CHECK(set.contains(10));
+    BOOST_CHECK(set.contains(29));
+    BOOST_CHECK(!set.contains(30));
+    BOOST_CHECK(!set.contains(34));
+    BOOST_CHECK(set.contains(35));
+    BOOST_CHECK(set.contains(49));
+    BOOST_CHECK(!set.contains(50));
+
+    AddressSet other(boost::assign::list_of
+                     (AddressRange(0, 12))
+                     (AddressRange(27, 37))
+                     (AddressRange(45, 100))
+                     .convert_to_container<std::set<AddressRange> >());
+
+    BOOST_CHECK(static_cast<std::set<AddressRange> >(set & other) ==
+                boost::assign::list_of
+                    (AddressRange(10, 12))
+                    (AddressRange(27, 29))
+                    (AddressRange(35, 37))
+                    (AddressRange(45, 49))
+                    .convert_to_container<std::set<AddressRange> >());
+    BOOST_CHECK(static_cast<std::set<AddressRange> >(set | other) ==
+                boost::assign::list_of
+                    (AddressRange(0, 100))
+                    .convert_to_container<std::set<AddressRange> >());
+    BOOST_CHECK((set & AddressSet()).empty());
+    
+    u_int len = 0;
+    BOOST_CHECK(roundTrip(set, len) ==
+                static_cast<std::set<AddressRange> >(set));
+    BOOST_CHECK_EQUAL(len, 1);
+
+    set += boost::assign::list_of
+        (AddressRange(1000, 1009))
+        (AddressRange(0x7FFFFFFF0000, 0x7FFFFFFF0FFF))
+        .convert_to_container<std::set<AddressRange> >();
+    BOOST_CHECK(roundTrip(set, len) ==
+                static_cast<std::set<AddressRange> >(set));
+    BOOST_CHECK_EQUAL(len, 3);
+
+    BOOST_CHECK(roundTrip(AddressSet(), len).empty());
+    BOOST_CHECK_EQUAL(len, 0);
+}
+
+
+
 /**
  * Unit test for the AddressSpace class.
  */
@@ -585,6 +1141,275 @@ BOOST_AUTO_TEST_CASE(TestAddressSpace)
     BOOST_CHECK(mappings.find(linked_object3) != mappings.end());
     BOOST_CHECK(mappings.find(linked_object4) != mappings.end());
     BOOST_CHECK(mappings.find(linked_object5) == mappings.end());
+
+    //
+    // Compare AddressSpaces::visitMappings(<thread>, <range>, <interval>) and
+    // AddressSpaces::resolve() to a brute force search on randomized mappings,
+    // loading more mappings between the queries so the indices are rebuilt.
+    //
+
+    boost::random::mt19937 generator;
+    boost::random::uniform_int_distribution<boost::uint64_t> begin(0, 1000000);
+    boost::random::uniform_int_distribution<boost::uint64_t> width(1, 20000);
+    boost::random::uniform_int_distribution<boost::uint64_t> when(0, 1000);
+    boost::random::uniform_int_distribution<int> which(0, 9);
+
+    std::vector<LinkedObject> random_linked_objects;
+    for (int i = 0; i < 10; ++i)
+    {
+        random_linked_objects.push_back(LinkedObject(FileName(
+            "/path/to/nonexistent/library" + boost::lexical_cast<std::string>(i)
+            )));
+    }
+    
+    for (int round = 0; round < 3; ++round)
+    {
+        for (int i = 0; i < 100; ++i)
+        {
+            Address b(begin(generator));
+            Time t(when(generator));
+            const LinkedObject& linked_object =
+                random_linked_objects[which(generator)];
+
+            address_spaces.load(
+                thread2, linked_object,
+                AddressRange(b, b + Address(width(generator))), t
+                );
+
+            if (which(generator) < 5)
+            {
+                address_spaces.unload(thread2, linked_object,
+                                      t + Time(when(generator)));
+            }
+        }
+
+        std::vector<Mapping> all;
+        address_spaces.visitMappings(
+            thread2,
+            boost::bind(accumulateMappingList, _1, _2, _3, _4, boost::ref(all))
+            );
+        
+        std::vector<std::pair<Address, Time> > points;
+        for (int i = 0; i < 500; ++i)
+        {
+            points.push_back(std::make_pair(Address(begin(generator)),
+                                            Time(when(generator) * 2)));
+        }
+        std::sort(points.begin(), points.end());
+
+        std::vector<boost::optional<LinkedObject> > linked_objects;
+        std::vector<AddressRange> ranges;
+        address_spaces.resolve(thread2, points, linked_objects, ranges);
+        BOOST_REQUIRE_EQUAL(linked_objects.size(), points.size());
+        BOOST_REQUIRE_EQUAL(ranges.size(), points.size());
+        
+        for (std::size_t i = 0; i < points.size(); ++i)
+        {
+            std::vector<Mapping> expected;
+            for (std::vector<Mapping>::const_iterator
+                     j = all.begin(); j != all.end(); ++j)
+            {
+                if (j->get<1>().contains(points[i].first) &&
+                    j->get<2>().contains(points[i].second))
+                {
+                    expected.push_back(*j);
+                }
+            }
+
+            if (expected.empty())
+            {
+                BOOST_CHECK(!linked_objects[i]);
+                continue;
+            }
+
+            BOOST_REQUIRE(linked_objects[i]);
+            
+            bool found = false;
+            for (std::vector<Mapping>::const_iterator
+                     j = expected.begin(); j != expected.end(); ++j)
+            {
+                BOOST_CHECK(ranges[i].begin() <= j->get<1>().begin());
+                found |= (j->get<0>() == *linked_objects[i]) &&
+                    (j->get<1>() == ranges[i]);
+            }
+            BOOST_CHECK(found);
+        }
+
+        for (int i = 0; i < 100; ++i)
+        {
+            Address b(begin(generator));
+            Time t(when(generator));
+            AddressRange range(b, b + Address(width(generator)));
+            TimeInterval interval(t, t + Time(when(generator)));
+
+            std::vector<Mapping> expected;
+            for (std::vector<Mapping>::const_iterator
+                     j = all.begin(); j != all.end(); ++j)
+            {
+                if (j->get<1>().intersects(range) &&
+                    j->get<2>().intersects(interval))
+                {
+                    expected.push_back(*j);
+                }
+            }
+            
+            std::vector<Mapping> found;
+            address_spaces.visitMappings(
+                thread2, range, interval, boost::bind(
+                    accumulateMappingList, _1, _2, _3, _4, boost::ref(found)
+                    )
+                );
+
+            BOOST_CHECK_EQUAL(found.size(), expected.size());
+        }
+    }
+
+    //
+    // Compare AddressSpaces::visitMappings(<thread>, <range>, <interval>) and
+    // AddressSpaces::resolve() to a linear scan of every mapping, for every
+    // query, on address spaces of many sizes, not only powers of two, whose
+    // mappings mix short and very long address ranges.
+    //
+
+    std::vector<int> sizes = boost::assign::list_of
+        (127)(128)(129)(255)(256)(257)(1023)(1024)(1025);
+    for (int n = 1; n <= 1100; n += (n < 40) ? 1 : 37)
+    {
+        sizes.push_back(n);
+    }
+
+    boost::random::uniform_int_distribution<boost::uint64_t> query(
+        0, 2000000
+        );
+    boost::random::uniform_int_distribution<int> long_range(0, 20);
+
+    for (std::vector<int>::const_iterator
+             n = sizes.begin(); n != sizes.end(); ++n)
+    {
+        AddressSpaces sized;
+
+        for (int i = 0; i < *n; ++i)
+        {
+            Address b(begin(generator));
+            Address w((long_range(generator) == 0) ?
+                      begin(generator) : width(generator));
+            Time t(when(generator));
+            const LinkedObject& linked_object =
+                random_linked_objects[which(generator)];
+
+            sized.load(thread2, linked_object, AddressRange(b, b + w), t);
+
+            if (which(generator) < 5)
+            {
+                sized.unload(thread2, linked_object,
+                             t + Time(when(generator)));
+            }
+        }
+
+        std::vector<Mapping> all;
+        sized.visitMappings(
+            thread2,
+            boost::bind(accumulateMappingList, _1, _2, _3, _4, boost::ref(all))
+            );
+
+        for (int i = 0; i < 100; ++i)
+        {
+            Address b(query(generator));
+            Time t(when(generator));
+            AddressRange range(b, b + Address(width(generator)));
+            TimeInterval interval(t, t + Time(when(generator)));
+
+            std::vector<Mapping> expected;
+            for (std::vector<Mapping>::const_iterator
+                     j = all.begin(); j != all.end(); ++j)
+            {
+                if (j->get<1>().intersects(range) &&
+                    j->get<2>().intersects(interval))
+                {
+                    expected.push_back(*j);
+                }
+            }
+
+            std::vector<Mapping> found;
+            sized.visitMappings(
+                thread2, range, interval, boost::bind(
+                    accumulateMappingList, _1, _2, _3, _4, boost::ref(found)
+                    )
+                );
+
+            BOOST_CHECK(describeMappings(found) == describeMappings(expected));
+        }
+
+        std::vector<std::pair<Address, Time> > points;
+        for (int i = 0; i < 100; ++i)
+        {
+            points.push_back(std::make_pair(Address(query(generator)),
+                                            Time(when(generator) * 2)));
+        }
+        std::sort(points.begin(), points.end());
+
+        std::vector<boost::optional<LinkedObject> > linked_objects;
+        std::vector<AddressRange> ranges;
+        sized.resolve(thread2, points, linked_objects, ranges);
+        BOOST_REQUIRE_EQUAL(linked_objects.size(), points.size());
+
+        for (std::size_t i = 0; i < points.size(); ++i)
+        {
+            bool expected = false, found = false;
+            for (std::vector<Mapping>::const_iterator
+                     j = all.begin(); j != all.end(); ++j)
+            {
+                if (j->get<1>().contains(points[i].first) &&
+                    j->get<2>().contains(points[i].second))
+                {
+                    expected = true;
+                    found |= linked_objects[i] &&
+                        (j->get<0>() == *linked_objects[i]) &&
+                        (j->get<1>() == ranges[i]);
+                }
+            }
+
+            BOOST_CHECK_EQUAL(static_cast<bool>(linked_objects[i]), expected);
+            BOOST_CHECK_EQUAL(found, expected);
+        }
+    }
+
+    //
+    // Test equivalent(AddressSpaces, AddressSpaces).
+    //
+    
+    AddressSpaces copy(address_spaces);
+    BOOST_CHECK(ArgoNavis::Base::equivalent(copy, address_spaces));
+    BOOST_CHECK(ArgoNavis::Base::equivalent(AddressSpaces(), AddressSpaces()));
+    BOOST_CHECK(!ArgoNavis::Base::equivalent(copy, AddressSpaces()));
+    BOOST_CHECK(!ArgoNavis::Base::equivalent(AddressSpaces(), copy));
+
+    copy.load(thread1, linked_object1, AddressRange(300, 307), Time(13));
+    BOOST_CHECK(!ArgoNavis::Base::equivalent(copy, address_spaces));
+    BOOST_CHECK(!ArgoNavis::Base::equivalent(address_spaces, copy));
+    address_spaces.load(thread1, linked_object1, AddressRange(300, 307),
+                        Time(13));
+    BOOST_CHECK(ArgoNavis::Base::equivalent(copy, address_spaces));
+
+    AddressSpaces ranked;
+    ranked.load(ThreadName("nonexistenthost.com", 27, boost::none, 3),
+                linked_object1, AddressRange(0, 7));
+    AddressSpaces unranked;
+    unranked.load(thread1, linked_object1, AddressRange(0, 7));
+    BOOST_CHECK(ArgoNavis::Base::equivalent(ranked, unranked));
+
+    // Equal paths spelled differently must hash, and compare, equally
+
+    BOOST_CHECK_EQUAL(FileName("/path/to//nonexistent/dso"),
+                      FileName("/path/to/nonexistent/dso"));
+    AddressSpaces spelled;
+    spelled.load(thread1, LinkedObject(FileName("/path/to/nonexistent/dso")),
+                 AddressRange(0, 7));
+    AddressSpaces respelled;
+    respelled.load(thread1,
+                   LinkedObject(FileName("/path/to//nonexistent/dso")),
+                   AddressRange(0, 7));
+    BOOST_CHECK(ArgoNavis::Base::equivalent(spelled, respelled));
 }
 
 
@@ -671,27 +1496,359 @@ BOOST_AUTO_TEST_CASE(TestFileName)
     BOOST_CHECK_EQUAL(
         FileName(static_cast<CBTF_Protocol_FileName>(name2)), name2
         );
+
+    //
+    // Compare the checksums of files containing random bytes, including one
+    // large enough to be checksummed by multiple threads, to the reference.
+    //
+
+    boost::random::mt19937 generator;
+
+    setChecksumThreadCount(4);
+    
+    std::vector<std::size_t> sizes = boost::assign::list_of
+        (0)(1)(7)(8)(9)(63)(4096)(100003)(40 * 1024 * 1024 + 13);
+
+    for (std::vector<std::size_t>::const_iterator
+             i = sizes.begin(); i != sizes.end(); ++i)
+    {
+        writeRandomFile(tmp_path, *i, generator);
+        
+        BOOST_CHECK_EQUAL(FileName(tmp_path).checksum(),
+                          referenceChecksum(tmp_path));
+
+        // The second checksum of the same file comes from the cache
+        BOOST_CHECK_EQUAL(FileName(tmp_path).checksum(),
+                          referenceChecksum(tmp_path));
+        
+        boost::filesystem::remove(tmp_path);
+    }
+
+    setChecksumThreadCount(0);
 }
 
 
 
 /**
- * Unit test for the LinkedObject, Function, Loop, and Statement classes.
+ * Unit test for the PeriodicSamples class.
  */
-BOOST_AUTO_TEST_CASE(TestSymbolTable)
+BOOST_AUTO_TEST_CASE(TestPeriodicSamples)
 {
-    std::set<AddressRange> addresses;
-    
-    LinkedObject linked_object(FileName("/path/to/nonexistent/dso"));
+    PeriodicSamples samples("Counts", PeriodicSamples::kCount);
+
+    BOOST_CHECK_EQUAL(samples.name(), "Counts");
+    BOOST_CHECK_EQUAL(samples.kind(), PeriodicSamples::kCount);
+    BOOST_CHECK_EQUAL(samples.size(), 0);
+    BOOST_CHECK(samples.interval().empty());
+    BOOST_CHECK_EQUAL(samples.rate(), Time());
+
+    samples.add(Time(10), 10);
+    samples.add(Time(30), 30);
+    samples.add(Time(0), 0);
+    samples.add(Time(20), 27);
+    samples.add(Time(20), 20);
+
+    BOOST_CHECK_EQUAL(samples.size(), 4);
+    BOOST_CHECK_EQUAL(samples.interval(), TimeInterval(0, 30));
+    BOOST_CHECK_EQUAL(samples.rate(), Time(10));
+
+    std::vector<std::pair<Time, boost::uint64_t> > visited;
+    samples.visit(
+        TimeInterval(5, 25),
+        boost::bind(addPeriodicSample, _1, _2, boost::ref(visited))
+        );
+    BOOST_REQUIRE_EQUAL(visited.size(), 2);
+    BOOST_CHECK_EQUAL(visited[0].first, Time(10));
+    BOOST_CHECK_EQUAL(visited[0].second, 10);
+    BOOST_CHECK_EQUAL(visited[1].first, Time(20));
+    BOOST_CHECK_EQUAL(visited[1].second, 20);
+
+    PeriodicSamples resampled = samples.resample(TimeInterval(0, 30), Time(5));
+
+    BOOST_CHECK_EQUAL(resampled.name(), samples.name());
+    BOOST_CHECK_EQUAL(resampled.kind(), samples.kind());
+    BOOST_CHECK_EQUAL(resampled.size(), 8);
+    BOOST_CHECK_EQUAL(resampled.interval(), TimeInterval(0, 35));
+
+    visited.clear();
+    resampled.visit(
+        resampled.interval(),
+        boost::bind(addPeriodicSample, _1, _2, boost::ref(visited))
+        );
+    BOOST_REQUIRE_EQUAL(visited.size(), 8);
+    for (std::size_t i = 0; i < visited.size(); ++i)
+    {
+        BOOST_CHECK_EQUAL(visited[i].first, Time(5 * i));
+        BOOST_CHECK_EQUAL(visited[i].second, std::min<std::size_t>(5 * i, 30));
+    }
+
+    PeriodicSamples rates("Rates", PeriodicSamples::kRate);
+    rates.add(Time(0), 100);
+    rates.add(Time(10), 200);
+
+    resampled = rates.resample(TimeInterval(0, 10), Time(5));
+
+    BOOST_CHECK_EQUAL(resampled.size(), 4);
+    BOOST_CHECK_EQUAL(resampled.interval(), TimeInterval(0, 15));
     
-    BOOST_CHECK_EQUAL(LinkedObject(linked_object), linked_object);
-    BOOST_CHECK_EQUAL(linked_object.file(),
-                      FileName("/path/to/nonexistent/dso"));
+    visited.clear();
+    resampled.visit(
+        TimeInterval(10, 10),
+        boost::bind(addPeriodicSample, _1, _2, boost::ref(visited))
+        );
+    BOOST_REQUIRE_EQUAL(visited.size(), 1);
+    BOOST_CHECK_EQUAL(visited[0].second, 200);
+
+    // Compare resampled counts against the reference on randomized inputs
+
+    boost::random::mt19937 generator;
+
+    for (int trial = 0; trial < 100; ++trial)
+    {
+        boost::random::uniform_int_distribution<boost::uint64_t> count(1, 500);
+        boost::random::uniform_int_distribution<boost::uint64_t> step(1, 5000);
+        boost::random::uniform_int_distribution<boost::uint64_t> delta(0, 1000);
+
+        PeriodicSamples counts("Counts", PeriodicSamples::kCount);
+        std::map<Time, boost::uint64_t> reference;
+
+        Time time(step(generator));
+        boost::uint64_t value = delta(generator);
+        for (boost::uint64_t i = 0, n = count(generator); i < n; ++i)
+        {
+            counts.add(time, value);
+            reference.insert(std::make_pair(time, value));
+            time += step(generator);
+            value += delta(generator);
+        }
+
+        boost::random::uniform_int_distribution<boost::uint64_t> offset(
+            0, counts.interval().width()
+            );
+        boost::random::uniform_int_distribution<boost::uint64_t> shift(
+            0, counts.interval().begin()
+            );
+        boost::random::uniform_int_distribution<boost::uint64_t> rate(
+            1, 2 * counts.rate() + 1
+            );
+
+        std::vector<TimeInterval> intervals = boost::assign::list_of
+            (counts.interval())
+            (TimeInterval(counts.interval().begin() + Time(offset(generator)),
+                          counts.interval().end() + Time(offset(generator))))
+            (TimeInterval(counts.interval().begin() - Time(shift(generator)),
+                          counts.interval().end() - Time(offset(generator))));
+        
+        for (std::vector<TimeInterval>::const_iterator
+                 i = intervals.begin(); i != intervals.end(); ++i)
+        {
+            Time r(rate(generator));
+            
+            std::vector<std::pair<Time, boost::uint64_t> > expected =
+                referenceResampleDeltas(reference, *i, r);
+            
+            visited.clear();
+            counts.resample(*i, r).visit(
+                TimeInterval(Time::TheBeginning(), Time::TheEnd()),
+                boost::bind(addPeriodicSample, _1, _2, boost::ref(visited))
+                );
+            
+            BOOST_CHECK(visited == expected);
+        }
+    }
+}
+
+
+
+/**
+ * Unit test for the PeriodicSamplesGroup functions.
+ */
+BOOST_AUTO_TEST_CASE(TestPeriodicSamplesGroup)
+{
+    PeriodicSamplesGroup group;
+
+    group.push_back(PeriodicSamples("Counts", PeriodicSamples::kCount));
+    group.back().add(Time(0), 0);
+    group.back().add(Time(10), 10);
+    group.back().add(Time(20), 20);
+
+    group.push_back(PeriodicSamples("Counts", PeriodicSamples::kCount));
+    group.back().add(Time(0), 0);
+    group.back().add(Time(10), 30);
+    group.back().add(Time(20), 40);
+
+    group.push_back(PeriodicSamples("Rates", PeriodicSamples::kRate));
+    group.back().add(Time(0), 100);
+    group.back().add(Time(20), 100);
+
+    group.push_back(PeriodicSamples("Rates", PeriodicSamples::kRate));
+    group.back().add(Time(0), 200);
+    group.back().add(Time(20), 200);
+    
+    BOOST_CHECK_EQUAL(getTotalSampleCount(group), 10);
+    BOOST_CHECK_EQUAL(getSmallestTimeInterval(group), TimeInterval(0, 20));
+    
+    setResamplingThreadCount(2);
+    BOOST_CHECK_EQUAL(getResamplingThreadCount(), 2);
+    
+    PeriodicSamplesGroup combined = getResampledAndCombined(
+        group, TimeInterval(0, 20), Time(10)
+        );
+
+    BOOST_REQUIRE_EQUAL(combined.size(), 2);
+    BOOST_CHECK_EQUAL(combined[0].name(), "Counts");
+    BOOST_CHECK_EQUAL(combined[1].name(), "Rates");
+
+    std::vector<std::pair<Time, boost::uint64_t> > visited;
+    combined[0].visit(
+        TimeInterval(0, 20),
+        boost::bind(addPeriodicSample, _1, _2, boost::ref(visited))
+        );
+    BOOST_REQUIRE_EQUAL(visited.size(), 3);
+    BOOST_CHECK_EQUAL(visited[0].second, 0);
+    BOOST_CHECK_EQUAL(visited[1].second, 40);
+    BOOST_CHECK_EQUAL(visited[2].second, 60);
+
+    visited.clear();
+    combined[1].visit(
+        TimeInterval(0, 20),
+        boost::bind(addPeriodicSample, _1, _2, boost::ref(visited))
+        );
+    BOOST_REQUIRE_EQUAL(visited.size(), 3);
+    BOOST_CHECK_EQUAL(visited[0].second, 150);
+    BOOST_CHECK_EQUAL(visited[1].second, 150);
+    BOOST_CHECK_EQUAL(visited[2].second, 150);
+    
+    std::vector<std::pair<Time, std::vector<boost::uint64_t> > > rows;
+    visitConcurrently(
+        group, TimeInterval(5, 20),
+        boost::bind(addPeriodicSamples, _1, _2, boost::ref(rows), 2)
+        );
+    BOOST_REQUIRE_EQUAL(rows.size(), 2);
+    BOOST_CHECK_EQUAL(rows[0].first, Time(10));
+    BOOST_CHECK(rows[0].second == boost::assign::list_of(10)(30)(0)(0));
+    BOOST_CHECK_EQUAL(rows[1].first, Time(20));
+    BOOST_CHECK(rows[1].second == boost::assign::list_of(20)(40)(100)(200));
+
+    rows.clear();
+    visitConcurrently(
+        group, boost::none,
+        boost::bind(addPeriodicSamples, _1, _2, boost::ref(rows), 1)
+        );
+    BOOST_REQUIRE_EQUAL(rows.size(), 1);
+    BOOST_CHECK_EQUAL(rows[0].first, Time(0));
+    BOOST_CHECK(rows[0].second == boost::assign::list_of(0)(0)(100)(200));
+    
+    // Compare parallel and serial results on randomized inputs
+
+    boost::random::mt19937 generator;
+    boost::random::uniform_int_distribution<boost::uint64_t> step(
+        1000000 /* 1 mS */, 20000000 /* 20 mS */
+        );
+    boost::random::uniform_int_distribution<boost::uint64_t> delta(0, 1000);
+    boost::random::uniform_int_distribution<int> name(0, 7);
+    
+    group.clear();
+    for (int i = 0; i < 64; ++i)
+    {
+        int n = name(generator);
+        
+        group.push_back(PeriodicSamples(
+            boost::lexical_cast<std::string>(n),
+            (n < 4) ? PeriodicSamples::kCount : PeriodicSamples::kRate
+            ));
+
+        Time time(step(generator));
+        boost::uint64_t value = delta(generator);
+        for (int j = 0; j < 1000; ++j)
+        {
+            group.back().add(time, value);
+            time += step(generator);
+            value += delta(generator);
+        }
+    }
+
+    setResamplingThreadCount(1);
+    PeriodicSamplesGroup serial_resampled = getResampled(group);
+    PeriodicSamplesGroup serial_combined = getResampledAndCombined(group);
+
+    setResamplingThreadCount(7);
+    PeriodicSamplesGroup parallel_resampled = getResampled(group);
+    PeriodicSamplesGroup parallel_combined = getResampledAndCombined(group);
+    
+    setResamplingThreadCount(0);
+    BOOST_CHECK_GE(getResamplingThreadCount(), 1);
+
+    BOOST_REQUIRE_EQUAL(parallel_resampled.size(), serial_resampled.size());
+    for (std::size_t i = 0; i < serial_resampled.size(); ++i)
+    {
+        BOOST_CHECK(samplesOf(parallel_resampled[i]) ==
+                    samplesOf(serial_resampled[i]));
+    }
+
+    BOOST_REQUIRE_EQUAL(parallel_combined.size(), serial_combined.size());
+    for (std::size_t i = 0; i < serial_combined.size(); ++i)
+    {
+        BOOST_CHECK_EQUAL(parallel_combined[i].name(),
+                          serial_combined[i].name());
+        BOOST_CHECK(samplesOf(parallel_combined[i]) ==
+                    samplesOf(serial_combined[i]));
+    }
+
+    std::map<Time, std::vector<boost::uint64_t> > flattened;
+    for (std::size_t i = 0; i < group.size(); ++i)
+    {
+        std::vector<std::pair<Time, boost::uint64_t> > samples =
+            samplesOf(group[i]);
+        for (std::size_t j = 0; j < samples.size(); ++j)
+        {
+            std::vector<boost::uint64_t>& row = flattened.insert(
+                std::make_pair(samples[j].first,
+                               std::vector<boost::uint64_t>(group.size(), 0))
+                ).first->second;
+            row[i] = samples[j].second;
+        }
+    }
+
+    TimeInterval interval(
+        getSmallestTimeInterval(group).begin() + 1000000000 /* 1 S */,
+        getSmallestTimeInterval(group).end() - 1000000000 /* 1 S */
+        );
+
+    rows.clear();
+    visitConcurrently(
+        group, interval,
+        boost::bind(addPeriodicSamples, _1, _2, boost::ref(rows),
+                    flattened.size())
+        );
+    
+    std::vector<std::pair<Time, std::vector<boost::uint64_t> > > expected(
+        flattened.lower_bound(interval.begin()),
+        flattened.upper_bound(interval.end())
+        );
+    BOOST_CHECK(!expected.empty());
+    BOOST_CHECK(rows == expected);
+}
+
+
+
+/**
+ * Unit test for the LinkedObject, Function, Loop, and Statement classes.
+ */
+BOOST_AUTO_TEST_CASE(TestSymbolTable)
+{
+    std::set<AddressRange> addresses;
+    
+    LinkedObject linked_object(FileName("/path/to/nonexistent/dso"));
+    
+    BOOST_CHECK_EQUAL(LinkedObject(linked_object), linked_object);
+    BOOST_CHECK_EQUAL(linked_object.file(),
+                      FileName("/path/to/nonexistent/dso"));
 
     //
-    // The following functions, loops, and statements (along with their listed
-    // address ranges) are added to this linked object during the test:
-    //
+    // The following functions, loops, and statements (along with their listed
+    // address ranges) are added to this linked object during the test:
+    //
     //      function1:  [  0,   7]  [ 13,  27]
     //      function2:  [113, 127]
     //      function3:  [  7,  13]  [213, 227]
@@ -1042,6 +2199,39 @@ BOOST_AUTO_TEST_CASE(TestSymbolTable)
         linked_object
         ));
 
+    CBTF_Protocol_SymbolTable message = linked_object;
+
+    BOOST_CHECK(ArgoNavis::Base::equivalent(
+        LinkedObject(message, false), linked_object
+        ));
+    BOOST_CHECK(ArgoNavis::Base::equivalent(
+        LinkedObject(message, true).clone(), linked_object
+        ));
+
+    LinkedObject lazy_linked_object(message, true);
+
+    functions.clear();
+    lazy_linked_object.visitFunctions(
+        AddressRange(0, 20),
+        boost::bind(accumulate<Function>, _1, boost::ref(functions))
+        );
+    BOOST_CHECK_EQUAL(functions.size(), 2);
+
+    std::vector<Address> message_pcs = boost::assign::list_of
+        (Address(0))(Address(5))(Address(15))(Address(35));
+    std::vector<LinkedObject::Identifier> lazy_function_ids;
+    std::vector<LinkedObject::Identifier> lazy_statement_ids;
+    std::vector<LinkedObject::Identifier> eager_function_ids;
+    std::vector<LinkedObject::Identifier> eager_statement_ids;
+    LinkedObject(message, true).resolve(
+        message_pcs, lazy_function_ids, lazy_statement_ids
+        );
+    LinkedObject(message, false).resolve(
+        message_pcs, eager_function_ids, eager_statement_ids
+        );
+    BOOST_CHECK(lazy_function_ids == eager_function_ids);
+    BOOST_CHECK(lazy_statement_ids == eager_statement_ids);
+
     //
     // Test adding loops and the LinkedObject::visitLoops query.
     //
@@ -1310,8 +2500,369 @@ BOOST_AUTO_TEST_CASE(TestSymbolTable)
     BOOST_CHECK_NE(clone, linked_object);
 
     BOOST_CHECK(ArgoNavis::Base::equivalent(clone, linked_object));
+    BOOST_CHECK_EQUAL(clone.hash(), linked_object.hash());
     Function function5(clone, "_Z2f5RKf");
     BOOST_CHECK(!ArgoNavis::Base::equivalent(clone, linked_object));
+    BOOST_CHECK_NE(clone.hash(), linked_object.hash());
+
+    //
+    // Test that equivalent() and LinkedObject::hash() are independent of the
+    // order in which the entities were added, and of duplicated entities.
+    //
+
+    std::set<AddressRange> first_ranges = boost::assign::list_of
+        (AddressRange(0, 7))(AddressRange(13, 27));
+    std::set<AddressRange> second_ranges = boost::assign::list_of
+        (AddressRange(113, 127));
+    
+    LinkedObject forward(FileName("/path/to/nonexistent/dso"));
+    Function forward_function1(forward, "_Z2f1RKf");
+    forward_function1.add(first_ranges);
+    Function forward_function2(forward, "_Z2f2RKf");
+    forward_function2.add(second_ranges);
+    Statement forward_statement1(
+        forward, FileName("/path/to/nonexistent/source/file"), 1, 1
+        );
+    forward_statement1.add(first_ranges);
+    Statement forward_statement2(
+        forward, FileName("/path/to/nonexistent/source/file"), 2, 1
+        );
+    forward_statement2.add(second_ranges);
+    
+    LinkedObject reverse(FileName("/path/to/nonexistent/dso"));
+    Statement reverse_statement2(
+        reverse, FileName("/path/to/nonexistent/source/file"), 2, 1
+        );
+    reverse_statement2.add(second_ranges);
+    Statement reverse_statement1(
+        reverse, FileName("/path/to/nonexistent/source/file"), 1, 1
+        );
+    reverse_statement1.add(first_ranges);
+    Function reverse_function2(reverse, "_Z2f2RKf");
+    reverse_function2.add(second_ranges);
+    Function reverse_function1(reverse, "_Z2f1RKf");
+    reverse_function1.add(first_ranges);
+    
+    BOOST_CHECK(ArgoNavis::Base::equivalent(forward, reverse));
+    BOOST_CHECK(ArgoNavis::Base::equivalent(reverse, forward));
+    BOOST_CHECK_EQUAL(forward.hash(), reverse.hash());
+
+    Function reverse_function3(reverse_function1.clone(reverse));
+    BOOST_CHECK(ArgoNavis::Base::equivalent(forward, reverse));
+    BOOST_CHECK_EQUAL(forward.hash(), reverse.hash());
+    
+    forward_statement2.add(boost::assign::list_of
+                          (AddressRange(300, 307))
+                          .convert_to_container<std::set<AddressRange> >());
+    BOOST_CHECK(!ArgoNavis::Base::equivalent(forward, reverse));
+    BOOST_CHECK(!ArgoNavis::Base::equivalent(reverse, forward));
+    BOOST_CHECK_NE(forward.hash(), reverse.hash());
+    reverse_statement2.add(boost::assign::list_of
+                          (AddressRange(300, 307))
+                          .convert_to_container<std::set<AddressRange> >());
+    BOOST_CHECK(ArgoNavis::Base::equivalent(forward, reverse));
+    
+    Loop forward_loop(forward, Address(13));
+    BOOST_CHECK(!ArgoNavis::Base::equivalent(forward, reverse));
+    Loop reverse_loop(reverse, Address(14));
+    BOOST_CHECK(!ArgoNavis::Base::equivalent(forward, reverse));
+    
+    LinkedObject elsewhere(FileName("/path/to/another/nonexistent/dso"));
+    BOOST_CHECK(!ArgoNavis::Base::equivalent(
+                    LinkedObject(FileName("/path/to/nonexistent/dso")),
+                    elsewhere
+                    ));
+    BOOST_CHECK(ArgoNavis::Base::equivalent(
+                    LinkedObject(FileName("/path/to/nonexistent/dso")),
+                    LinkedObject(FileName("/path/to/nonexistent/dso"))
+                    ));
+
+    //
+    // Test LinkedObject::save() and LinkedObject::load().
+    //
+
+    boost::filesystem::path cache = boost::filesystem::temp_directory_path() /
+        boost::filesystem::unique_path();
+    boost::filesystem::create_directories(cache);
+
+    BOOST_CHECK_THROW(linked_object.save(cache), std::invalid_argument);
+    
+    CBTF_Protocol_SymbolTable cacheable_message = linked_object;
+    cacheable_message.linked_object.checksum = 0x0123456789ABCDEFULL;
+    LinkedObject cacheable(cacheable_message);
+
+    Loop cacheable_loop(cacheable, Address(13));
+    cacheable_loop.add(boost::assign::list_of
+                       (AddressRange(13, 27))
+                       .convert_to_container<std::set<AddressRange> >());
+
+    FileName cacheable_file = cacheable.file();
+    BOOST_CHECK(!LinkedObject::load(cache, cacheable_file));
+
+    cacheable.save(cache);
+    boost::optional<LinkedObject> cached =
+        LinkedObject::load(cache, cacheable_file);
+
+    BOOST_REQUIRE(cached);
+    BOOST_CHECK_EQUAL(cached->file(), cacheable_file);
+    BOOST_CHECK(ArgoNavis::Base::equivalent(*cached, cacheable));
+    
+    loops.clear();
+    cached->visitLoops(AddressRange(20, 20),
+                       boost::bind(accumulate<Loop>, _1, boost::ref(loops)));
+    BOOST_REQUIRE_EQUAL(loops.size(), 1);
+    BOOST_CHECK_EQUAL(loops.begin()->head(), Address(13));
+
+    std::vector<Address> cache_pcs = boost::assign::list_of
+        (Address(0))(Address(10))(Address(20))(Address(120))(Address(500));
+    std::vector<LinkedObject::Identifier> cached_function_ids;
+    std::vector<LinkedObject::Identifier> cached_statement_ids;
+    std::vector<LinkedObject::Identifier> cacheable_function_ids;
+    std::vector<LinkedObject::Identifier> cacheable_statement_ids;
+    cached->resolve(cache_pcs, cached_function_ids, cached_statement_ids);
+    cacheable.resolve(cache_pcs, cacheable_function_ids,
+                      cacheable_statement_ids);
+    BOOST_CHECK(cached_function_ids == cacheable_function_ids);
+    BOOST_CHECK(cached_statement_ids == cacheable_statement_ids);
+    
+    cacheable_message.linked_object.checksum = 0xFEDCBA9876543210ULL;
+    BOOST_CHECK(!LinkedObject::load(
+                    cache, FileName(cacheable_message.linked_object)
+                    ));
+
+    // Only the cache file itself, and no temporary file, should remain, and
+    // it should be rejected once its format version is changed to version 1
+
+    std::vector<boost::filesystem::path> cache_files(
+        boost::filesystem::directory_iterator(cache),
+        (boost::filesystem::directory_iterator())
+        );
+    BOOST_REQUIRE_EQUAL(cache_files.size(), 1);
+    BOOST_CHECK_EQUAL(cache_files[0].extension().string(), ".symtab");
+
+    {
+        boost::filesystem::fstream stream(
+            cache_files[0], std::ios::binary | std::ios::in | std::ios::out
+            );
+        boost::uint32_t version = 1;
+        stream.seekp(8);
+        stream.write(reinterpret_cast<const char*>(&version), sizeof(version));
+    }
+    BOOST_CHECK(!LinkedObject::load(cache, cacheable_file));
+
+    boost::filesystem::remove_all(cache);
+
+    //
+    // Test LinkedObject::visitFunctions(<address_range>) finds functions with
+    // long address ranges beginning well before the query, and compare it to
+    // a brute force search on randomized functions.
+    //
+
+    LinkedObject linked_object2(FileName("/path/to/nonexistent/dso"));
+
+    Function outer(linked_object2, "outer");
+    outer.add(boost::assign::list_of
+              (AddressRange(0, 999))
+              .convert_to_container<std::set<AddressRange> >());
+    Function inner1(linked_object2, "inner1");
+    inner1.add(boost::assign::list_of
+               (AddressRange(10, 19))
+               .convert_to_container<std::set<AddressRange> >());
+    Function inner2(linked_object2, "inner2");
+    inner2.add(boost::assign::list_of
+               (AddressRange(20, 29))
+               (AddressRange(400, 409))
+               (AddressRange(500, 509))
+               .convert_to_container<std::set<AddressRange> >());
+
+    functions.clear();
+    linked_object2.visitFunctions(
+        AddressRange(450, 550),
+        boost::bind(accumulate<Function>, _1, boost::ref(functions))
+        );
+    BOOST_CHECK(functions == boost::assign::list_of(outer)(inner2)
+                .convert_to_container<std::set<Function> >());
+
+    boost::random::mt19937 generator;
+    boost::random::uniform_int_distribution<boost::uint64_t> begin(0, 100000);
+    boost::random::uniform_int_distribution<boost::uint64_t> width(1, 100);
+    boost::random::uniform_int_distribution<int> count(1, 4);
+    boost::random::uniform_int_distribution<int> long_range(0, 20);
+    
+    std::vector<Function> random_functions;
+    for (int i = 0; i < 1000; ++i)
+    {
+        random_functions.push_back(Function(linked_object2, "random"));
+        
+        std::set<AddressRange> ranges;
+        for (int j = 0, j_end = count(generator); j < j_end; ++j)
+        {
+            Address b(begin(generator));
+            Address w(width(generator) *
+                      ((long_range(generator) == 0) ? 500 : 1));
+            ranges.insert(AddressRange(b, b + w - 1));
+        }
+        random_functions.back().add(ranges);
+    }
+    
+    for (int i = 0; i < 200; ++i)
+    {
+        Address b(begin(generator));
+        AddressRange range(b, b + Address(width(generator)) - 1);
+
+        std::set<Function> expected;
+        linked_object2.visitFunctions(
+            boost::bind(accumulateIntersecting, _1, boost::cref(range),
+                        boost::ref(expected))
+            );
+
+        functions.clear();
+        linked_object2.visitFunctions(
+            range, boost::bind(accumulate<Function>, _1, boost::ref(functions))
+            );
+
+        BOOST_CHECK(functions == expected);
+    }
+
+    //
+    // Compare LinkedObject::visitFunctions(<address_range>) to a brute force
+    // search for every query on linked objects of many sizes, not only powers
+    // of two, whose functions mix short and very long address ranges. This
+    // exercises every shape of the rightmost path of the interval tree.
+    //
+
+    std::vector<int> sizes = boost::assign::list_of
+        (127)(128)(129)(255)(256)(257)(511)(1000)(1023)(1025);
+    for (int n = 1; n <= 70; ++n)
+    {
+        sizes.push_back(n);
+    }
+
+    boost::random::uniform_int_distribution<boost::uint64_t> span(0, 10000);
+    boost::random::uniform_int_distribution<boost::uint64_t> query(0, 20000);
+
+    for (std::vector<int>::const_iterator
+             n = sizes.begin(); n != sizes.end(); ++n)
+    {
+        LinkedObject sized(FileName("/path/to/nonexistent/dso"));
+
+        for (int i = 0; i < *n; ++i)
+        {
+            Address b(span(generator));
+            Address w((long_range(generator) == 0) ?
+                      span(generator) : width(generator));
+
+            Function function(sized, "sized");
+            function.add(boost::assign::list_of
+                         (AddressRange(b, b + w))
+                         .convert_to_container<std::set<AddressRange> >());
+        }
+
+        for (int i = 0; i < 100; ++i)
+        {
+            Address b(query(generator));
+            AddressRange range(b, b + Address(width(generator)) - 1);
+
+            std::set<Function> expected;
+            sized.visitFunctions(
+                boost::bind(accumulateIntersecting, _1, boost::cref(range),
+                            boost::ref(expected))
+                );
+
+            functions.clear();
+            sized.visitFunctions(
+                range,
+                boost::bind(accumulate<Function>, _1, boost::ref(functions))
+                );
+
+            BOOST_CHECK(functions == expected);
+        }
+    }
+
+    //
+    // Test LinkedObject::resolve() picks the innermost function or statement
+    // containing each address, and compare it to a brute force search on the
+    // randomized functions.
+    //
+
+    Statement outer_statement(linked_object2,
+                              FileName("/path/to/nonexistent/source/file"),
+                              1, 1);
+    outer_statement.add(boost::assign::list_of
+                        (AddressRange(0, 99))
+                        .convert_to_container<std::set<AddressRange> >());
+    Statement inner_statement(linked_object2,
+                              FileName("/path/to/nonexistent/source/file"),
+                              2, 1);
+    inner_statement.add(boost::assign::list_of
+                        (AddressRange(10, 14))
+                        .convert_to_container<std::set<AddressRange> >());
+    
+    std::vector<Address> pcs = boost::assign::list_of
+        (Address(5))(Address(12))(Address(15))(Address(25))(Address(405));
+    std::vector<LinkedObject::Identifier> function_ids, statement_ids;
+    
+    linked_object2.resolve(pcs, function_ids, statement_ids);
+    BOOST_REQUIRE_EQUAL(function_ids.size(), pcs.size());
+    BOOST_REQUIRE_EQUAL(statement_ids.size(), pcs.size());
+    BOOST_CHECK_EQUAL(linked_object2.function(function_ids[1]), inner1);
+    BOOST_CHECK_EQUAL(linked_object2.function(function_ids[3]), inner2);
+    BOOST_CHECK_EQUAL(linked_object2.statement(statement_ids[0]),
+                      outer_statement);
+    BOOST_CHECK_EQUAL(linked_object2.statement(statement_ids[1]),
+                      inner_statement);
+    BOOST_CHECK_EQUAL(linked_object2.statement(statement_ids[2]),
+                      outer_statement);
+    BOOST_CHECK_EQUAL(statement_ids[4], LinkedObject::TheNone());
+
+    std::reverse(pcs.begin(), pcs.end());
+    BOOST_CHECK_THROW(
+        linked_object2.resolve(pcs, function_ids, statement_ids),
+        std::invalid_argument
+        );
+    BOOST_CHECK_THROW(linked_object2.function(LinkedObject::TheNone()),
+                      std::invalid_argument);
+    BOOST_CHECK_THROW(linked_object2.statement(LinkedObject::TheNone()),
+                      std::invalid_argument);
+
+    boost::random::uniform_int_distribution<boost::uint64_t> pc(0, 200000);
+
+    pcs.clear();
+    for (int i = 0; i < 2000; ++i)
+    {
+        pcs.push_back(Address(pc(generator)));
+    }
+    std::sort(pcs.begin(), pcs.end());
+
+    linked_object2.resolve(pcs, function_ids, statement_ids);
+    BOOST_REQUIRE_EQUAL(function_ids.size(), pcs.size());
+    
+    for (std::size_t i = 0; i < pcs.size(); ++i)
+    {
+        functions.clear();
+        linked_object2.visitFunctions(
+            AddressRange(pcs[i], pcs[i]),
+            boost::bind(accumulate<Function>, _1, boost::ref(functions))
+            );
+
+        if (functions.empty())
+        {
+            BOOST_CHECK_EQUAL(function_ids[i], LinkedObject::TheNone());
+            continue;
+        }
+
+        Address expected = Address::TheLowest();
+        for (std::set<Function>::const_iterator
+                 j = functions.begin(); j != functions.end(); ++j)
+        {
+            expected = std::max(expected, innermostBegin(*j, pcs[i]));
+        }
+
+        BOOST_REQUIRE_NE(function_ids[i], LinkedObject::TheNone());
+        Function function = linked_object2.function(function_ids[i]);
+        BOOST_CHECK(functions.find(function) != functions.end());
+        BOOST_CHECK_EQUAL(innermostBegin(function, pcs[i]), expected);
+    }
 }
 
 
@@ -1433,6 +2984,61 @@ BOOST_AUTO_TEST_CASE(TestThreadName)
 
 
 
+/**
+ * Unit test for the ThreadNameTable class.
+ */
+BOOST_AUTO_TEST_CASE(TestThreadNameTable)
+{
+    ThreadName name1("first.host", 13);
+    ThreadName name2("first.host", 13, 27);
+    ThreadName name3("first.host", 13, 2002);
+    ThreadName name4("first.host", 13, 2002, 2004);
+    ThreadName name5("second.host", 13);
+
+    BOOST_CHECK_EQUAL(hash_value(name3), hash_value(name4));
+    BOOST_CHECK_NE(hash_value(name1), hash_value(name2));
+    BOOST_CHECK_NE(hash_value(name1), hash_value(name5));
+
+    ThreadNameTable table;
+    
+    BOOST_CHECK_EQUAL(table.size(), 0);
+    BOOST_CHECK(!table.find(name1));
+    BOOST_CHECK_THROW(table.name(0), std::invalid_argument);
+
+    BOOST_CHECK_EQUAL(table.add(name1), 0);
+    BOOST_CHECK_EQUAL(table.add(name2), 1);
+    BOOST_CHECK_EQUAL(table.add(name3), 2);
+    BOOST_CHECK_EQUAL(table.add(name4), 2);
+    BOOST_CHECK_EQUAL(table.add(name1), 0);
+    BOOST_CHECK_EQUAL(table.size(), 3);
+
+    BOOST_REQUIRE(table.find(name4));
+    BOOST_CHECK_EQUAL(*table.find(name4), 2);
+    BOOST_CHECK(!table.find(name5));
+
+    BOOST_CHECK_EQUAL(table.name(0), name1);
+    BOOST_CHECK_EQUAL(table.name(1), name2);
+    BOOST_CHECK_EQUAL(table.name(2), name3);
+    BOOST_CHECK(!table.name(2).mpi_rank());
+    BOOST_CHECK_THROW(table.name(3), std::invalid_argument);
+
+    ThreadNameTable copy(table);
+    BOOST_CHECK_EQUAL(copy.add(name5), 3);
+    BOOST_CHECK_EQUAL(copy.size(), 4);
+    BOOST_CHECK_EQUAL(table.size(), 3);
+    BOOST_CHECK(!table.find(name5));
+
+    const ThreadName& first = copy.name(0);
+    for (int i = 0; i < 1000; ++i)
+    {
+        copy.add(ThreadName("third.host", 13, i));
+    }
+    BOOST_REQUIRE_EQUAL(&copy.name(0), &first);
+    BOOST_CHECK_EQUAL(first, name1);
+}
+
+
+
 /**
  * Unit test for the Time class.
  */
@@ -1583,3 +3189,419 @@ BOOST_AUTO_TEST_CASE(TestTimeInterval)
                     TimeInterval(13, 27), TimeInterval(0, 7)
                     ));
 }
+
+
+
+
+/**
+ * Benchmark comparing the AddressBitmap class against the per-bit std::vector
+ * of bool implementation it replaced. Reports the time required to decode a
+ * large, fragmented, CBTF_Protocol_AddressBitmap, extract its address ranges,
+ * and encode it again.
+ */
+BENCHMARK_TEST_CASE(BenchmarkAddressBitmap)
+{
+    const std::size_t N = benchmarkSize(1 << 26);
+    
+    boost::random::mt19937 generator;
+    boost::random::uniform_int_distribution<boost::uint64_t> run(1, 4096);
+    
+    AddressRange range(0x400000, 0x400000 + N - 1);
+    AddressBitmap bitmap(range);
+
+    bool value = false;
+    for (boost::uint64_t i = 0; i < N; value = !value)
+    {
+        boost::uint64_t i_end =
+            std::min<boost::uint64_t>(i + run(generator), N);
+        bitmap.set(AddressRange(range.begin() + Address(i),
+                                range.begin() + Address(i_end - 1)),
+                   value);
+        i = i_end;
+    }
+    
+    CBTF_Protocol_AddressBitmap message = bitmap;
+
+    Time start = Time::Now();
+    std::vector<bool> reference = referenceFromMessage(message);
+    double reference_decode = secondsSince(start);
+
+    start = Time::Now();
+    std::set<AddressRange> reference_ranges =
+        referenceRanges(range, reference, true);
+    double reference_ranges_time = secondsSince(start);
+
+    start = Time::Now();
+    CBTF_Protocol_AddressBitmap reference_message =
+        referenceToMessage(range, reference);
+    double reference_encode = secondsSince(start);
+    
+    start = Time::Now();
+    AddressBitmap decoded(message);
+    double decode = secondsSince(start);
+
+    start = Time::Now();
+    std::set<AddressRange> ranges = decoded.ranges(true);
+    double ranges_time = secondsSince(start);
+
+    start = Time::Now();
+    CBTF_Protocol_AddressBitmap encoded = decoded;
+    double encode = secondsSince(start);
+
+    BOOST_CHECK(ranges == reference_ranges);
+    BOOST_CHECK_EQUAL(encoded.bitmap.data.data_len,
+                      reference_message.bitmap.data.data_len);
+    BOOST_CHECK(memcmp(encoded.bitmap.data.data_val,
+                       reference_message.bitmap.data.data_val,
+                       encoded.bitmap.data.data_len) == 0);
+
+    free(message.bitmap.data.data_val);
+    free(reference_message.bitmap.data.data_val);
+    free(encoded.bitmap.data.data_val);
+    
+    BOOST_TEST_MESSAGE("AddressBitmap (" << N << " addresses, "
+                       << ranges.size() << " ranges)");
+    BOOST_TEST_MESSAGE("    std::vector<bool>: " << reference_decode
+                       << " S decode, " << reference_ranges_time
+                       << " S ranges, " << reference_encode << " S encode");
+    BOOST_TEST_MESSAGE("    words:             " << decode
+                       << " S decode, " << ranges_time
+                       << " S ranges, " << encode << " S encode");
+}
+
+
+
+/**
+ * Benchmark of the AddressSet class on the large, highly fragmented, address
+ * ranges typical of a function with many inlined call sites. Reports the time
+ * required to incrementally add the address ranges, test for membership, and
+ * extract the address bitmaps; along with the time required simply to expand
+ * the address ranges into the set of individual addresses that was formerly
+ * rebuilt by every addition.
+ */
+BENCHMARK_TEST_CASE(BenchmarkAddressSet)
+{
+    const std::size_t N = benchmarkSize(100000);
+    const std::size_t kRangesPerAddition = 8;
+    
+    boost::random::mt19937 generator;
+    boost::random::uniform_int_distribution<boost::uint64_t> width(4, 256);
+    boost::random::uniform_int_distribution<boost::uint64_t> gap(1, 4096);
+
+    std::vector<AddressRange> ranges;
+    boost::uint64_t total = 0;
+    for (Address address(0x400000); ranges.size() < N; )
+    {
+        boost::uint64_t w = width(generator);
+        ranges.push_back(AddressRange(address, address + Address(w - 1)));
+        address += Address(w + gap(generator));
+        total += w;
+    }
+
+    // Add the ranges in a scattered order, as is seen for inlined functions
+    std::vector<std::size_t> order(N);
+    for (std::size_t i = 0; i < N; ++i)
+    {
+        order[i] = (i * 7919) % N;
+    }
+    
+    Time start = Time::Now();
+    
+    AddressSet set;
+    for (std::size_t i = 0; i < N; i += kRangesPerAddition)
+    {
+        std::set<AddressRange> addition;
+        for (std::size_t j = i; j < std::min(i + kRangesPerAddition, N); ++j)
+        {
+            addition.insert(ranges[order[j]]);
+        }
+        set += addition;
+    }
+
+    double add = secondsSince(start);
+    start = Time::Now();
+
+    std::size_t hits = 0;
+    for (std::size_t i = 0; i < N; ++i)
+    {
+        hits += set.contains(ranges[i].begin()) ? 1 : 0;
+        hits += set.contains(ranges[i].end() + 1) ? 1 : 0;
+    }
+    
+    double contains = secondsSince(start);
+    start = Time::Now();
+
+    CBTF_Protocol_AddressBitmap* messages = NULL;
+    u_int len = 0;
+    set.extract(messages, len);
+
+    double extract = secondsSince(start);
+
+    for (u_int i = 0; i < len; ++i)
+    {
+        free(messages[i].bitmap.data.data_val);
+    }
+    free(messages);
+
+    start = Time::Now();
+
+    std::set<Address> addresses;
+    for (std::vector<AddressRange>::const_iterator
+             i = ranges.begin(); i != ranges.end(); ++i)
+    {
+        for (Address j = i->begin(); j <= i->end(); ++j)
+        {
+            addresses.insert(j);
+        }
+    }
+
+    double expand = secondsSince(start);
+
+    BOOST_CHECK_EQUAL(hits, N);
+    BOOST_CHECK_EQUAL(addresses.size(), total);
+    BOOST_CHECK_EQUAL(static_cast<std::set<AddressRange> >(set).size(), N);
+    BOOST_CHECK_GT(len, 0);
+
+    BOOST_TEST_MESSAGE("AddressSet (" << N << " ranges, "
+                       << total << " addresses)");
+    BOOST_TEST_MESSAGE("    add:      " << add << " S ("
+                       << (N / kRangesPerAddition) << " additions)");
+    BOOST_TEST_MESSAGE("    contains: " << contains << " S ("
+                       << (2 * N) << " queries)");
+    BOOST_TEST_MESSAGE("    extract:  " << extract << " S ("
+                       << len << " bitmaps)");
+    BOOST_TEST_MESSAGE("    expand:   " << expand << " S (per addition, "
+                       << "formerly)");
+}
+
+
+
+/**
+ * Benchmark for the checksumming of files by FileName.
+ */
+BENCHMARK_TEST_CASE(BenchmarkFileName)
+{
+    const std::size_t N = benchmarkSize(256 * 1024 * 1024);
+
+    boost::random::mt19937 generator;
+    boost::filesystem::path path = boost::filesystem::temp_directory_path() /
+        boost::filesystem::unique_path();
+    writeRandomFile(path, N, generator);
+
+    Time start = Time::Now();
+    boost::uint64_t reference = referenceChecksum(path);
+    double bytewise = secondsSince(start);
+
+    start = Time::Now();
+    boost::uint64_t first = FileName(path).checksum();
+    double mapped = secondsSince(start);
+
+    start = Time::Now();
+    boost::uint64_t second = FileName(path).checksum();
+    double cached = secondsSince(start);
+
+    boost::filesystem::remove(path);
+    
+    BOOST_CHECK_EQUAL(first, reference);
+    BOOST_CHECK_EQUAL(second, reference);
+
+    BOOST_TEST_MESSAGE("FileName (" << N << " bytes, "
+                       << getChecksumThreadCount() << " threads)");
+    BOOST_TEST_MESSAGE("    bytewise: " << bytewise << " S");
+    BOOST_TEST_MESSAGE("    mapped:   " << mapped << " S");
+    BOOST_TEST_MESSAGE("    cached:   " << cached << " S");
+}
+
+
+
+/**
+ * Benchmark for the construction of LinkedObject from symbol table messages.
+ */
+BENCHMARK_TEST_CASE(BenchmarkLinkedObject)
+{
+    const std::size_t N = benchmarkSize(100000);
+    const std::size_t kLinkedObjects = 20;
+    
+    boost::random::mt19937 generator;
+    boost::random::uniform_int_distribution<boost::uint64_t> width(4, 256);
+    boost::random::uniform_int_distribution<boost::uint64_t> gap(1, 64);
+
+    LinkedObject linked_object(FileName("/path/to/nonexistent/dso"));
+    
+    Address address(0x400000);
+    for (std::size_t i = 0; i < N; ++i)
+    {
+        Function function(linked_object, "function");
+        Statement statement(linked_object,
+                            FileName("/path/to/nonexistent/source/file"),
+                            i, 1);
+        
+        std::set<AddressRange> ranges;
+        for (int j = 0; j < 2; ++j)
+        {
+            boost::uint64_t w = width(generator);
+            ranges.insert(AddressRange(address, address + Address(w - 1)));
+            address += Address(w + gap(generator));
+        }
+        function.add(ranges);
+        statement.add(ranges);
+    }
+
+    CBTF_Protocol_SymbolTable message = linked_object;
+    message.linked_object.checksum = 0x0123456789ABCDEFULL;
+
+    boost::filesystem::path cache = boost::filesystem::temp_directory_path() /
+        boost::filesystem::unique_path();
+    boost::filesystem::create_directories(cache);
+    LinkedObject(message).save(cache);
+    
+    Time start = Time::Now();
+
+    std::vector<LinkedObject> eager;
+    for (std::size_t i = 0; i < kLinkedObjects; ++i)
+    {
+        eager.push_back(LinkedObject(message, false));
+    }
+
+    double construct_eager = secondsSince(start);
+    start = Time::Now();
+    
+    std::vector<LinkedObject> lazy;
+    for (std::size_t i = 0; i < kLinkedObjects; ++i)
+    {
+        lazy.push_back(LinkedObject(message, true));
+    }
+
+    double construct_lazy = secondsSince(start);
+    start = Time::Now();
+
+    std::set<Function> functions;
+    lazy[0].visitFunctions(
+        AddressRange(0x400000, 0x400000),
+        boost::bind(accumulate<Function>, _1, boost::ref(functions))
+        );
+
+    double first_query = secondsSince(start);
+    start = Time::Now();
+
+    std::vector<LinkedObject> cached;
+    for (std::size_t i = 0; i < kLinkedObjects; ++i)
+    {
+        boost::optional<LinkedObject> linked_object =
+            LinkedObject::load(cache, FileName(message.linked_object));
+        BOOST_REQUIRE(linked_object);
+        cached.push_back(*linked_object);
+    }
+    
+    double load_cached = secondsSince(start);
+    start = Time::Now();
+
+    std::set<Function> cached_functions;
+    cached[0].visitFunctions(
+        AddressRange(0x400000, 0x400000),
+        boost::bind(accumulate<Function>, _1, boost::ref(cached_functions))
+        );
+
+    double first_cached_query = secondsSince(start);
+    start = Time::Now();
+
+    bool all_equivalent = true;
+    for (std::size_t i = 0; i < kLinkedObjects; ++i)
+    {
+        all_equivalent &= ArgoNavis::Base::equivalent(eager[i], cached[i]);
+    }
+
+    double compare = secondsSince(start);
+    
+    boost::filesystem::remove_all(cache);
+    
+    BOOST_CHECK_EQUAL(functions.size(), 1);
+    BOOST_CHECK_EQUAL(cached_functions.size(), 1);
+    BOOST_CHECK(all_equivalent);
+
+    BOOST_TEST_MESSAGE("LinkedObject (" << kLinkedObjects << " x "
+                       << N << " functions and statements)");
+    BOOST_TEST_MESSAGE("    construct (eager): " << construct_eager << " S");
+    BOOST_TEST_MESSAGE("    construct (lazy):  " << construct_lazy << " S");
+    BOOST_TEST_MESSAGE("    first query:       " << first_query << " S "
+                       << "(lazy, one linked object)");
+    BOOST_TEST_MESSAGE("    load (cached):     " << load_cached << " S");
+    BOOST_TEST_MESSAGE("    first query:       " << first_cached_query
+                       << " S (cached, one linked object)");
+    BOOST_TEST_MESSAGE("    equivalent:        " << compare << " S "
+                       << "(eager versus cached)");
+}
+
+
+
+/**
+ * Benchmark comparing the PeriodicSamples columnar storage against the tree of
+ * (time, value) pairs it replaced. Reports the heap footprint, construction
+ * time, and full scan time of each for 10^7 samples taken every 10 mS.
+ */
+BENCHMARK_TEST_CASE(BenchmarkPeriodicSamples)
+{
+    const std::size_t N = benchmarkSize(10000000);
+    const Time kInterval(10000000 /* 10 mS */);
+
+    boost::uint64_t heap = heap_bytes_in_use;
+    Time start = Time::Now();
+
+    std::map<Time, boost::uint64_t> tree;
+    for (std::size_t i = 0; i < N; ++i)
+    {
+        tree.insert(std::make_pair(Time(i * kInterval), i));
+    }
+
+    double tree_build = secondsSince(start);
+    boost::uint64_t tree_bytes = heap_bytes_in_use - heap;
+
+    heap = heap_bytes_in_use;
+    start = Time::Now();
+
+    PeriodicSamples columns("Benchmark");
+    for (std::size_t i = 0; i < N; ++i)
+    {
+        columns.add(Time(i * kInterval), i);
+    }
+
+    double columns_build = secondsSince(start);
+    boost::uint64_t columns_bytes = heap_bytes_in_use - heap;
+
+    PeriodicSampleVisitor visitor;
+    std::vector<boost::uint64_t> values(1);
+    boost::uint64_t tree_sum = 0, columns_sum = 0;
+
+    start = Time::Now();
+
+    visitor = boost::bind(sumPeriodicSamples, _1, _2, boost::ref(tree_sum));
+    for (std::map<Time, boost::uint64_t>::const_iterator
+             i = tree.begin(); i != tree.end(); ++i)
+    {
+        values[0] = i->second;
+        if (!visitor(i->first, values))
+        {
+            break;
+        }
+    }
+
+    double tree_scan = secondsSince(start);
+    start = Time::Now();
+
+    visitor = boost::bind(sumPeriodicSamples, _1, _2, boost::ref(columns_sum));
+    columns.visit(columns.interval(), visitor);
+
+    double columns_scan = secondsSince(start);
+    
+    BOOST_CHECK_EQUAL(columns.size(), tree.size());
+    BOOST_CHECK_EQUAL(columns_sum, tree_sum);
+    BOOST_CHECK_LT(columns_bytes, tree_bytes);
+
+    BOOST_TEST_MESSAGE("PeriodicSamples (" << N << " samples)");
+    BOOST_TEST_MESSAGE("    std::map: " << tree_bytes << " bytes, "
+                       << tree_build << " S build, "
+                       << tree_scan << " S scan");
+    BOOST_TEST_MESSAGE("    columns:  " << columns_bytes << " bytes, "
+                       << columns_build << " S build, "
+                       << columns_scan << " S scan");
+}